@@ -0,0 +1,79 @@
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "AssetArchive.h"
+
+/*
+* Packs hook_fonts and hook_textures into hook_assets.pak for the hook to map at startup.
+* Images are decoded to RGBA8 here, so the hook creates textures straight from the archive.
+*
+*	AssetPacker.exe [game folder]
+*
+* The archive is written to the game folder (the current folder by default), next to the folders it was built from.
+*/
+
+static IWICImagingFactory* wicFactory = nullptr;
+
+static bool DecodeImage(const std::vector<uint8_t>& file, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height)
+{
+	using Microsoft::WRL::ComPtr;
+
+	ComPtr<IWICStream> stream = nullptr;
+	ComPtr<IWICBitmapDecoder> decoder = nullptr;
+	ComPtr<IWICBitmapFrameDecode> frame = nullptr;
+	ComPtr<IWICFormatConverter> converter = nullptr;
+	if (FAILED(wicFactory->CreateStream(stream.GetAddressOf()))
+		|| FAILED(stream->InitializeFromMemory((BYTE*)file.data(), (DWORD)file.size()))
+		|| FAILED(wicFactory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf()))
+		|| FAILED(decoder->GetFrame(0, frame.GetAddressOf()))
+		|| FAILED(wicFactory->CreateFormatConverter(converter.GetAddressOf()))
+		|| FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom))
+		|| FAILED(converter->GetSize(&width, &height)))
+	{
+		return false;
+	}
+
+	pixels.resize((size_t)width * height * 4);
+	return SUCCEEDED(converter->CopyPixels(nullptr, width * 4, (UINT)pixels.size(), pixels.data()));
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path root = argc > 1 ? argv[1] : ".";
+
+	if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))
+		|| FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicFactory))))
+	{
+		printf("WIC is not available, images are stored undecoded\n");
+		wicFactory = nullptr;
+	}
+
+	AssetArchiveBuilder builder;
+	AssetArchiveBuilder::ImageDecoder decoder = wicFactory != nullptr ? &DecodeImage : nullptr;
+	size_t fonts = builder.AddDirectory(root, "hook_fonts", decoder);
+	size_t textures = builder.AddDirectory(root, "hook_textures", decoder);
+	printf("Found %zu font(s) and %zu texture(s)\n", fonts, textures);
+
+	std::string fileName = (root / "hook_assets.pak").string();
+	bool written = builder.Write(fileName);
+	if (written)
+	{
+		printf("Wrote %s, %llu duplicate bytes left out\n", fileName.c_str(), (unsigned long long)builder.DuplicateBytes());
+	}
+	else
+	{
+		printf("%s\n", builder.Error().c_str());
+	}
+
+	if (wicFactory != nullptr)
+	{
+		wicFactory->Release();
+	}
+	CoUninitialize();
+	return written ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "PeImage.h"
+#include "MemoryAccess.h"
+#include "Logger.h"
+
+/*
+* Remembers resolved addresses between launches so signatures only have to be scanned for once per game build.
+* The cache file is tied to a fingerprint of the game's module (PE timestamp, image size and a hash of sampled code bytes),
+* any mismatch (a patch, a different build) throws the whole cache away.
+* Every entry also carries a key, a hash of what it was resolved from (the signature and the offsets used with it),
+* so changing a signature or an offset in the hook's code misses the cache instead of reusing the old result.
+*
+* File layout, little endian:
+*	"DXAC", version, fingerprint (timestamp, image size, hash), entry count,
+*	entries (name length, name, key, address relative to the module, offset count, offsets),
+*	hash of everything before it
+*/
+
+struct ModuleFingerprint
+{
+	uint32_t timeDateStamp = 0;
+	uint32_t sizeOfImage = 0;
+	uint64_t sampleHash = 0;
+
+	// Samples are read through memory, so a page that isn't readable (yet) can't take the game down.
+	// Unreadable samples hash as zeros.
+	static ModuleFingerprint Of(const PeImage& image, IMemoryAccess& memory)
+	{
+		ModuleFingerprint fingerprint;
+		if (!image.IsValid())
+		{
+			return fingerprint;
+		}
+
+		fingerprint.timeDateStamp = image.TimeDateStamp();
+		fingerprint.sizeOfImage = image.SizeOfImage();
+
+		// Hashing all of the code would cost as much as scanning it, a spread of small samples is enough to tell builds apart.
+		uint64_t hash = FnvOffsetBasis;
+		for (const ScanRange& section : image.CodeSections())
+		{
+			size_t stride = section.size / NumSamples;
+			if (stride < SampleSize)
+			{
+				stride = SampleSize;
+			}
+
+			for (size_t offset = 0; offset + SampleSize <= section.size; offset += stride)
+			{
+				uint8_t sample[SampleSize];
+				if (!memory.Read(section.address + offset, sample, SampleSize))
+				{
+					memset(sample, 0, SampleSize);
+				}
+				hash = Hash(sample, SampleSize, hash);
+			}
+		}
+		fingerprint.sampleHash = hash;
+
+		return fingerprint;
+	}
+
+	bool operator==(const ModuleFingerprint& other) const
+	{
+		return timeDateStamp == other.timeDateStamp && sizeOfImage == other.sizeOfImage && sampleHash == other.sampleHash;
+	}
+
+	bool operator!=(const ModuleFingerprint& other) const
+	{
+		return !(*this == other);
+	}
+
+	// 64-bit FNV-1a
+	static uint64_t Hash(const uint8_t* data, size_t size, uint64_t hash = FnvOffsetBasis)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	static constexpr uint64_t FnvOffsetBasis = 0xCBF29CE484222325ull;
+	static constexpr size_t NumSamples = 256;
+	static constexpr size_t SampleSize = 64;
+};
+
+struct CachedAddress
+{
+	std::string name;
+	uint64_t key = 0; // see AddressCache::Key()
+	uint64_t moduleOffset = 0; // address relative to the module base
+	std::vector<uintptr_t> offsets; // pointer chain offsets that follow it, if any
+};
+
+class AddressCache
+{
+public:
+	AddressCache(const std::string& fileName, const ModuleFingerprint& fingerprint)
+	{
+		m_fileName = fileName;
+		m_fingerprint = fingerprint;
+	}
+
+	// Hash of the signature text and the offsets used with it (where the displacement is, the instruction size,
+	// the pointer chain), an entry is only used by a lookup with the same key.
+	static uint64_t Key(const std::string& signature, const std::vector<uint64_t>& offsets)
+	{
+		uint64_t hash = ModuleFingerprint::Hash((const uint8_t*)signature.data(), signature.size());
+		for (uint64_t offset : offsets)
+		{
+			uint8_t bytes[sizeof(uint64_t)];
+			for (size_t i = 0; i < sizeof(uint64_t); i++)
+			{
+				bytes[i] = (uint8_t)(offset >> (8 * i));
+			}
+			hash = ModuleFingerprint::Hash(bytes, sizeof(bytes), hash);
+		}
+		return hash;
+	}
+
+	// Reads the cache file. Returns false (and starts out empty) if it's missing, damaged or for another build.
+	bool Load()
+	{
+		m_entries.clear();
+		m_dirty = false;
+
+		std::ifstream file(m_fileName, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (!Parse(data))
+		{
+			m_logger.Log("Discarding %s, it is damaged or was made for another game build", m_fileName.c_str());
+			m_entries.clear();
+			return false;
+		}
+		return true;
+	}
+
+	bool Save()
+	{
+		std::vector<uint8_t> data;
+		Put(data, Magic);
+		Put(data, Version);
+		Put(data, m_fingerprint.timeDateStamp);
+		Put(data, m_fingerprint.sizeOfImage);
+		Put(data, m_fingerprint.sampleHash);
+		Put(data, (uint32_t)m_entries.size());
+		for (const CachedAddress& entry : m_entries)
+		{
+			Put(data, (uint16_t)entry.name.size());
+			data.insert(data.end(), entry.name.begin(), entry.name.end());
+			Put(data, entry.key);
+			Put(data, entry.moduleOffset);
+			Put(data, (uint16_t)entry.offsets.size());
+			for (uintptr_t offset : entry.offsets)
+			{
+				Put(data, (uint64_t)offset);
+			}
+		}
+		Put(data, ModuleFingerprint::Hash(data.data(), data.size()));
+
+		// Written next to the real file first so a crash halfway through can't leave a damaged cache behind.
+		std::string tempFileName = m_fileName + ".tmp";
+		{
+			std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+			if (!file.is_open() || !file.write((const char*)data.data(), data.size()))
+			{
+				m_logger.Log("Could not write %s", tempFileName.c_str());
+				return false;
+			}
+		}
+
+		// Replaces the old file in one step, there's no moment without a cache file.
+		if (!MoveFileExA(tempFileName.c_str(), m_fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		{
+			m_logger.Log("Could not replace %s", m_fileName.c_str());
+			return false;
+		}
+
+		m_dirty = false;
+		return true;
+	}
+
+	const CachedAddress* Lookup(const std::string& name, uint64_t key) const
+	{
+		for (const CachedAddress& entry : m_entries)
+		{
+			if (entry.name == name && entry.key == key)
+			{
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	void Store(const std::string& name, uint64_t key, uint64_t moduleOffset, const std::vector<uintptr_t>& offsets = {})
+	{
+		for (CachedAddress& entry : m_entries)
+		{
+			if (entry.name == name)
+			{
+				entry.key = key;
+				entry.moduleOffset = moduleOffset;
+				entry.offsets = offsets;
+				m_dirty = true;
+				return;
+			}
+		}
+
+		m_entries.push_back({ name, key, moduleOffset, offsets });
+		m_dirty = true;
+	}
+
+	// Whether anything was stored since the last Load() or Save()
+	bool IsDirty() const
+	{
+		return m_dirty;
+	}
+
+private:
+	static constexpr uint32_t Magic = 0x43415844; // "DXAC"
+	static constexpr uint32_t Version = 2;
+
+	Logger m_logger{ "AddressCache" };
+	std::string m_fileName = "";
+	ModuleFingerprint m_fingerprint;
+	std::vector<CachedAddress> m_entries;
+	bool m_dirty = false;
+
+	template<typename T>
+	static void Put(std::vector<uint8_t>& data, T value)
+	{
+		for (size_t i = 0; i < sizeof(T); i++)
+		{
+			data.push_back((uint8_t)((uint64_t)value >> (8 * i)));
+		}
+	}
+
+	template<typename T>
+	static bool Get(const std::vector<uint8_t>& data, size_t* position, T* value)
+	{
+		if (*position + sizeof(T) > data.size())
+		{
+			return false;
+		}
+
+		uint64_t result = 0;
+		for (size_t i = 0; i < sizeof(T); i++)
+		{
+			result |= (uint64_t)data[*position + i] << (8 * i);
+		}
+		*value = (T)result;
+		*position += sizeof(T);
+		return true;
+	}
+
+	bool Parse(const std::vector<uint8_t>& data)
+	{
+		if (data.size() < sizeof(uint64_t))
+		{
+			return false;
+		}
+
+		size_t end = data.size() - sizeof(uint64_t);
+		size_t position = end;
+		uint64_t storedHash;
+		if (!Get(data, &position, &storedHash) || storedHash != ModuleFingerprint::Hash(data.data(), end))
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> body(data.begin(), data.begin() + end);
+		position = 0;
+
+		uint32_t magic, version, numEntries;
+		ModuleFingerprint fingerprint;
+		if (!Get(body, &position, &magic) || magic != Magic
+			|| !Get(body, &position, &version) || version != Version
+			|| !Get(body, &position, &fingerprint.timeDateStamp)
+			|| !Get(body, &position, &fingerprint.sizeOfImage)
+			|| !Get(body, &position, &fingerprint.sampleHash)
+			|| fingerprint != m_fingerprint
+			|| !Get(body, &position, &numEntries))
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < numEntries; i++)
+		{
+			CachedAddress entry;
+			uint16_t nameLength, numOffsets;
+			if (!Get(body, &position, &nameLength) || position + nameLength > body.size())
+			{
+				return false;
+			}
+
+			entry.name.assign((const char*)body.data() + position, nameLength);
+			position += nameLength;
+
+			if (!Get(body, &position, &entry.key)
+				|| !Get(body, &position, &entry.moduleOffset) || entry.moduleOffset >= m_fingerprint.sizeOfImage
+				|| !Get(body, &position, &numOffsets))
+			{
+				return false;
+			}
+
+			for (uint16_t j = 0; j < numOffsets; j++)
+			{
+				uint64_t offset;
+				if (!Get(body, &position, &offset))
+				{
+					return false;
+				}
+				entry.offsets.push_back((uintptr_t)offset);
+			}
+
+			m_entries.push_back(entry);
+		}
+
+		return position == body.size();
+	}
+};
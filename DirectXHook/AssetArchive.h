@@ -0,0 +1,561 @@
+#pragma once
+
+#include <Windows.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "Logger.h"
+
+enum class AssetKind : uint32_t
+{
+	Raw = 0,
+	Font = 1, // a .spritefont file
+	Texture = 2, // decoded RGBA8 pixels, width, height and rowPitch are set
+	Image = 3 // an image file as it is (png, jpg, dds ...), decoded when the texture is created
+};
+
+// A view into the mapped archive, valid while the archive is open.
+struct AssetView
+{
+	AssetKind kind = AssetKind::Raw;
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t rowPitch = 0;
+
+	explicit operator bool() const
+	{
+		return data != nullptr;
+	}
+};
+
+/*
+* The hook's fonts and textures packed into one file (hook_assets.pak), mapped once and never copied:
+* lookups return views into the mapping that go straight to texture and font creation.
+* Assets are named by their path relative to the game folder, as overlays pass them to LoadTexture()/LoadFont().
+* Names are case insensitive and either slash works.
+*
+* File layout, little endian:
+*
+*	Header
+*	Entry[numEntries]	sorted by name hash
+*	Blob[numBlobs]		payloads, several entries share a blob when their contents are identical
+*	names				normalized names, not terminated
+*	payloads			each aligned to PayloadAlignment
+*
+* Build archives with AssetArchiveBuilder (the AssetPacker tool uses it).
+*/
+class AssetArchive
+{
+public:
+	static constexpr uint32_t Magic = 0x4B50464F; // "OFPK"
+	static constexpr uint32_t FormatVersion = 1;
+	static constexpr uint64_t PayloadAlignment = 64;
+
+	struct Header
+	{
+		uint32_t magic = Magic;
+		uint32_t version = FormatVersion;
+		uint32_t numEntries = 0;
+		uint32_t numBlobs = 0;
+		uint64_t namesOffset = 0;
+		uint64_t namesSize = 0;
+		uint64_t fileSize = 0;
+	};
+
+	struct Entry
+	{
+		uint64_t nameHash = 0;
+		uint32_t nameOffset = 0; // into the names
+		uint32_t nameLength = 0;
+		uint32_t blob = 0;
+		uint32_t reserved = 0;
+	};
+
+	struct Blob
+	{
+		uint64_t offset = 0; // from the start of the file
+		uint64_t size = 0;
+		uint64_t contentHash = 0;
+		uint32_t kind = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t rowPitch = 0;
+	};
+
+	// Mapped on first use, the hook touches it at startup so the first overlay doesn't wait for it.
+	static AssetArchive& Instance()
+	{
+		static AssetArchive archive("hook_assets.pak");
+		return archive;
+	}
+
+	AssetArchive() { }
+
+	AssetArchive(const std::string& fileName)
+	{
+		Open(fileName);
+	}
+
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	~AssetArchive()
+	{
+		Close();
+	}
+
+	// False if the file is missing or malformed, lookups then find nothing.
+	bool Open(const std::string& fileName)
+	{
+		Close();
+
+		m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+		{
+			m_file = nullptr;
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(Header))
+		{
+			m_logger.Log("%s is too small to be an asset archive", fileName.c_str());
+			Close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		m_view = m_mapping != nullptr ? (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (m_view == nullptr)
+		{
+			m_logger.Log("Failed to map %s: %lu", fileName.c_str(), GetLastError());
+			Close();
+			return false;
+		}
+		m_size = (size_t)fileSize.QuadPart;
+
+		if (!Validate())
+		{
+			m_logger.Log("%s is not a valid asset archive", fileName.c_str());
+			Close();
+			return false;
+		}
+
+		m_logger.Log("Mapped %s: %u assets in %u blobs, %zu bytes", fileName.c_str(), m_header->numEntries, m_header->numBlobs, m_size);
+		return true;
+	}
+
+	void Close()
+	{
+		if (m_view != nullptr)
+		{
+			UnmapViewOfFile(m_view);
+		}
+		if (m_mapping != nullptr)
+		{
+			CloseHandle(m_mapping);
+		}
+		if (m_file != nullptr)
+		{
+			CloseHandle(m_file);
+		}
+		m_file = nullptr;
+		m_mapping = nullptr;
+		m_view = nullptr;
+		m_size = 0;
+		m_header = nullptr;
+		m_entries = nullptr;
+		m_blobs = nullptr;
+		m_names = nullptr;
+	}
+
+	bool IsOpen() const
+	{
+		return m_view != nullptr;
+	}
+
+	size_t NumEntries() const
+	{
+		return m_header != nullptr ? m_header->numEntries : 0;
+	}
+
+	size_t NumBlobs() const
+	{
+		return m_header != nullptr ? m_header->numBlobs : 0;
+	}
+
+	AssetView Find(std::string_view name) const
+	{
+		if (m_header == nullptr)
+		{
+			return AssetView();
+		}
+
+		char buffer[MAX_PATH];
+		std::string_view normalized = NormalizeName(name, buffer, sizeof(buffer));
+		uint64_t hash = Hash(normalized.data(), normalized.size());
+
+		const Entry* end = m_entries + m_header->numEntries;
+		const Entry* entry = std::lower_bound(m_entries, end, hash, [](const Entry& entry, uint64_t hash)
+		{
+			return entry.nameHash < hash;
+		});
+
+		for (; entry != end && entry->nameHash == hash; entry++)
+		{
+			if (std::string_view(m_names + entry->nameOffset, entry->nameLength) == normalized)
+			{
+				const Blob& blob = m_blobs[entry->blob];
+				AssetView view;
+				view.kind = (AssetKind)blob.kind;
+				view.data = m_view + blob.offset;
+				view.size = (size_t)blob.size;
+				view.width = blob.width;
+				view.height = blob.height;
+				view.rowPitch = blob.rowPitch;
+				return view;
+			}
+		}
+		return AssetView();
+	}
+
+	// Lower case with backslashes and without a leading ".\", written to the buffer. Names that don't fit are cut off.
+	static std::string_view NormalizeName(std::string_view name, char* buffer, size_t bufferSize)
+	{
+		while (name.size() >= 2 && name[0] == '.' && (name[1] == '\\' || name[1] == '/'))
+		{
+			name.remove_prefix(2);
+		}
+
+		size_t length = std::min(name.size(), bufferSize);
+		for (size_t i = 0; i < length; i++)
+		{
+			char c = name[i];
+			buffer[i] = c == '/' ? '\\' : (c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c);
+		}
+		return std::string_view(buffer, length);
+	}
+
+	// FNV-1a, 64 bit
+	static uint64_t Hash(const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+private:
+	Logger m_logger{ "AssetArchive" };
+	HANDLE m_file = nullptr;
+	HANDLE m_mapping = nullptr;
+	const uint8_t* m_view = nullptr;
+	size_t m_size = 0;
+	const Header* m_header = nullptr;
+	const Entry* m_entries = nullptr;
+	const Blob* m_blobs = nullptr;
+	const char* m_names = nullptr;
+
+	// Checks every offset once so lookups don't have to.
+	bool Validate()
+	{
+		const Header* header = (const Header*)m_view;
+		if (header->magic != Magic || header->version != FormatVersion || header->fileSize != m_size)
+		{
+			return false;
+		}
+
+		uint64_t tablesEnd = sizeof(Header) + (uint64_t)header->numEntries * sizeof(Entry) + (uint64_t)header->numBlobs * sizeof(Blob);
+		if (tablesEnd > m_size || header->namesOffset < tablesEnd || header->namesSize > m_size - header->namesOffset)
+		{
+			return false;
+		}
+
+		const Entry* entries = (const Entry*)(m_view + sizeof(Header));
+		const Blob* blobs = (const Blob*)(entries + header->numEntries);
+		for (uint32_t i = 0; i < header->numBlobs; i++)
+		{
+			if (blobs[i].offset > m_size || blobs[i].size > m_size - blobs[i].offset)
+			{
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < header->numEntries; i++)
+		{
+			if (entries[i].blob >= header->numBlobs || (uint64_t)entries[i].nameOffset + entries[i].nameLength > header->namesSize
+				|| (i > 0 && entries[i].nameHash < entries[i - 1].nameHash))
+			{
+				return false;
+			}
+		}
+
+		m_header = header;
+		m_entries = entries;
+		m_blobs = blobs;
+		m_names = (const char*)m_view + header->namesOffset;
+		return true;
+	}
+};
+
+/*
+* Collects assets and writes an archive. Identical payloads are stored once.
+* Images can be decoded while building, so the hook only has to upload the pixels, see AssetPacker.
+*/
+class AssetArchiveBuilder
+{
+public:
+	// Decodes an image file into RGBA8 pixels with a row pitch of width * 4. Returns false to keep the file as it is.
+	typedef bool(*ImageDecoder)(const std::vector<uint8_t>& file, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height);
+
+	void Add(std::string_view name, AssetKind kind, std::vector<uint8_t> data, uint32_t width = 0, uint32_t height = 0, uint32_t rowPitch = 0)
+	{
+		char buffer[MAX_PATH];
+		Asset asset;
+		asset.name = std::string(AssetArchive::NormalizeName(name, buffer, sizeof(buffer)));
+		asset.kind = kind;
+		asset.data = std::move(data);
+		asset.width = width;
+		asset.height = height;
+		asset.rowPitch = rowPitch;
+		m_assets.push_back(std::move(asset));
+	}
+
+	// Fonts by their .spritefont extension, known image types as images (decoded if a decoder is given), anything else raw.
+	bool AddFile(std::string_view name, const std::filesystem::path& path, ImageDecoder decoder = nullptr)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			m_error = "Could not open " + path.string();
+			return false;
+		}
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+
+		if (extension == ".spritefont")
+		{
+			Add(name, AssetKind::Font, std::move(data));
+			return true;
+		}
+
+		if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp"
+			|| extension == ".gif" || extension == ".tif" || extension == ".tiff" || extension == ".dds")
+		{
+			std::vector<uint8_t> pixels;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			if (decoder != nullptr && extension != ".dds" && decoder(data, pixels, width, height))
+			{
+				Add(name, AssetKind::Texture, std::move(pixels), width, height, width * 4);
+			}
+			else
+			{
+				Add(name, AssetKind::Image, std::move(data));
+			}
+			return true;
+		}
+
+		Add(name, AssetKind::Raw, std::move(data));
+		return true;
+	}
+
+	// Adds every file below root\directory, named "directory\relative path". Returns the number of files added.
+	size_t AddDirectory(const std::filesystem::path& root, const std::string& directory, ImageDecoder decoder = nullptr)
+	{
+		size_t added = 0;
+		std::error_code error;
+		std::filesystem::path base = root / directory;
+		for (std::filesystem::recursive_directory_iterator it(base, error), end; !error && it != end; it.increment(error))
+		{
+			if (!it->is_regular_file())
+			{
+				continue;
+			}
+
+			std::string relative = std::filesystem::relative(it->path(), base).string();
+			if (AddFile(directory + "\\" + relative, it->path(), decoder))
+			{
+				added++;
+			}
+		}
+		return added;
+	}
+
+	size_t NumAssets() const
+	{
+		return m_assets.size();
+	}
+
+	// Why the last AddFile() or Write() failed. The builder doesn't log, it runs in the packer as well.
+	const std::string& Error() const
+	{
+		return m_error;
+	}
+
+	// Bytes saved by sharing identical payloads in the last Write()
+	uint64_t DuplicateBytes() const
+	{
+		return m_duplicateBytes;
+	}
+
+	// Writes to a temporary file first and then replaces the archive, a failed build leaves the old one intact.
+	bool Write(const std::string& fileName)
+	{
+		// Later additions of the same name win.
+		std::vector<const Asset*> assets;
+		std::unordered_map<std::string_view, size_t> byName;
+		for (const Asset& asset : m_assets)
+		{
+			auto [it, inserted] = byName.try_emplace(asset.name, assets.size());
+			if (inserted)
+			{
+				assets.push_back(&asset);
+			}
+			else
+			{
+				assets[it->second] = &asset;
+			}
+		}
+
+		std::vector<AssetArchive::Entry> entries;
+		std::vector<AssetArchive::Blob> blobs;
+		std::vector<const Asset*> blobAssets;
+		std::unordered_multimap<uint64_t, uint32_t> blobsByHash;
+		std::string names;
+		m_duplicateBytes = 0;
+
+		for (const Asset* asset : assets)
+		{
+			uint64_t contentHash = AssetArchive::Hash(asset->data.data(), asset->data.size());
+			uint32_t blobIndex = UINT32_MAX;
+			auto range = blobsByHash.equal_range(contentHash);
+			for (auto it = range.first; it != range.second; it++)
+			{
+				if (SamePayload(*blobAssets[it->second], *asset))
+				{
+					blobIndex = it->second;
+					m_duplicateBytes += asset->data.size();
+					break;
+				}
+			}
+
+			if (blobIndex == UINT32_MAX)
+			{
+				blobIndex = (uint32_t)blobs.size();
+				AssetArchive::Blob blob;
+				blob.size = asset->data.size();
+				blob.contentHash = contentHash;
+				blob.kind = (uint32_t)asset->kind;
+				blob.width = asset->width;
+				blob.height = asset->height;
+				blob.rowPitch = asset->rowPitch;
+				blobs.push_back(blob);
+				blobAssets.push_back(asset);
+				blobsByHash.emplace(contentHash, blobIndex);
+			}
+
+			AssetArchive::Entry entry;
+			entry.nameHash = AssetArchive::Hash(asset->name.data(), asset->name.size());
+			entry.nameOffset = (uint32_t)names.size();
+			entry.nameLength = (uint32_t)asset->name.size();
+			entry.blob = blobIndex;
+			entries.push_back(entry);
+			names += asset->name;
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const AssetArchive::Entry& a, const AssetArchive::Entry& b)
+		{
+			return a.nameHash < b.nameHash;
+		});
+
+		AssetArchive::Header header;
+		header.numEntries = (uint32_t)entries.size();
+		header.numBlobs = (uint32_t)blobs.size();
+		header.namesOffset = sizeof(header) + entries.size() * sizeof(AssetArchive::Entry) + blobs.size() * sizeof(AssetArchive::Blob);
+		header.namesSize = names.size();
+
+		uint64_t offset = header.namesOffset + header.namesSize;
+		for (AssetArchive::Blob& blob : blobs)
+		{
+			offset = AlignUp(offset);
+			blob.offset = offset;
+			offset += blob.size;
+		}
+		header.fileSize = offset;
+
+		std::string tempName = fileName + ".tmp";
+		{
+			std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)entries.data(), entries.size() * sizeof(AssetArchive::Entry));
+			file.write((const char*)blobs.data(), blobs.size() * sizeof(AssetArchive::Blob));
+			file.write(names.data(), names.size());
+
+			static const char padding[AssetArchive::PayloadAlignment] = { 0 };
+			uint64_t position = header.namesOffset + header.namesSize;
+			for (size_t i = 0; i < blobs.size(); i++)
+			{
+				file.write(padding, blobs[i].offset - position);
+				file.write((const char*)blobAssets[i]->data.data(), blobAssets[i]->data.size());
+				position = blobs[i].offset + blobs[i].size;
+			}
+
+			if (!file)
+			{
+				m_error = "Failed to write " + tempName;
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempName, fileName, error);
+		if (error)
+		{
+			m_error = "Failed to replace " + fileName + ": " + error.message();
+			return false;
+		}
+		return true;
+	}
+
+private:
+	struct Asset
+	{
+		std::string name = "";
+		AssetKind kind = AssetKind::Raw;
+		std::vector<uint8_t> data;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t rowPitch = 0;
+	};
+
+	std::vector<Asset> m_assets;
+	std::string m_error = "";
+	uint64_t m_duplicateBytes = 0;
+
+	static uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + AssetArchive::PayloadAlignment - 1) & ~(AssetArchive::PayloadAlignment - 1);
+	}
+
+	static bool SamePayload(const Asset& a, const Asset& b)
+	{
+		return a.kind == b.kind && a.width == b.width && a.height == b.height && a.rowPitch == b.rowPitch
+			&& a.data.size() == b.data.size() && std::memcmp(a.data.data(), b.data.data(), a.data.size()) == 0;
+	}
+};
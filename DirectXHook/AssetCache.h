@@ -0,0 +1,247 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <WICTextureLoader.h>
+#include <DDSTextureLoader.h>
+#include <SpriteFont.h>
+#include <comdef.h>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "AssetArchive.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// A texture or font queued with AssetCache::RequestTexture() or RequestFont(). Done() turns true when the cache
+// has loaded it, the asset stays null if loading failed.
+struct AssetRequest
+{
+	std::string path = "";
+	ID3D11Device* device = nullptr;
+	bool font = false;
+	bool done = false;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture = nullptr;
+	std::shared_ptr<DirectX::SpriteFont> spriteFont = nullptr;
+
+	bool Done() const
+	{
+		return done;
+	}
+};
+
+/*
+* Textures and fonts shared by every overlay. Each asset is created once per device, later loads of the same path
+* return the same object. Assets come from the mapped AssetArchive when it has them and from the loose file otherwise.
+*
+* Texture() and Font() load right away. RequestTexture() and RequestFont() queue the load instead, the renderer
+* loads MaxLoadsPerFrame queued assets each frame so an overlay that needs many of them doesn't stall a single frame.
+* Tasks wait for a request with co_await AssetReady(request), see OverlayTask.h.
+*
+* Present thread only, like overlay Setup().
+*/
+class AssetCache
+{
+public:
+	static AssetCache& Instance()
+	{
+		static AssetCache cache;
+		return cache;
+	}
+
+	static constexpr size_t MaxLoadsPerFrame = 1;
+
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Texture(ID3D11Device* device, const std::string& path)
+	{
+		TRACE_SCOPE("AssetCache::Texture");
+		UseDevice(device);
+		std::string key = Key(path);
+		auto cached = m_textures.find(key);
+		if (cached != m_textures.end())
+		{
+			return cached->second;
+		}
+
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture = nullptr;
+		HRESULT result = E_FAIL;
+		AssetView asset = AssetArchive::Instance().Find(path);
+		if (asset.kind == AssetKind::Texture)
+		{
+			result = CreateFromPixels(device, asset, texture.GetAddressOf());
+		}
+		else if (asset.kind == AssetKind::Image)
+		{
+			result = asset.size >= 4 && std::memcmp(asset.data, "DDS ", 4) == 0
+				? DirectX::CreateDDSTextureFromMemory(device, asset.data, asset.size, nullptr, texture.GetAddressOf())
+				: DirectX::CreateWICTextureFromMemory(device, asset.data, asset.size, nullptr, texture.GetAddressOf());
+		}
+		else
+		{
+			std::wstring widePath(path.begin(), path.end());
+			result = DirectX::CreateWICTextureFromFile(device, widePath.c_str(), nullptr, texture.GetAddressOf());
+		}
+
+		if (FAILED(result))
+		{
+			_com_error error(result);
+			m_logger.Log("Texture loading failed: %s (%s)", path.c_str(), error.ErrorMessage());
+			return nullptr;
+		}
+
+		m_logger.Log("Loaded texture %s%s", path.c_str(), asset ? " from the asset archive" : "");
+		m_textures.emplace(key, texture);
+		return texture;
+	}
+
+	std::shared_ptr<DirectX::SpriteFont> Font(ID3D11Device* device, const std::string& path)
+	{
+		TRACE_SCOPE("AssetCache::Font");
+		UseDevice(device);
+		std::string key = Key(path);
+		auto cached = m_fonts.find(key);
+		if (cached != m_fonts.end())
+		{
+			return cached->second;
+		}
+
+		std::shared_ptr<DirectX::SpriteFont> font = nullptr;
+		AssetView asset = AssetArchive::Instance().Find(path);
+		try
+		{
+			if (asset.kind == AssetKind::Font)
+			{
+				font = std::make_shared<DirectX::SpriteFont>(device, asset.data, asset.size);
+			}
+			else
+			{
+				std::wstring widePath(path.begin(), path.end());
+				font = std::make_shared<DirectX::SpriteFont>(device, widePath.c_str());
+			}
+		}
+		catch (const std::exception& exception)
+		{
+			m_logger.Log("Font loading failed: %s (%s)", path.c_str(), exception.what());
+			return nullptr;
+		}
+
+		m_logger.Log("Loaded font %s%s", path.c_str(), asset ? " from the asset archive" : "");
+		m_fonts.emplace(key, font);
+		return font;
+	}
+
+	// An asset that is already cached is done at once.
+	std::shared_ptr<const AssetRequest> RequestTexture(ID3D11Device* device, const std::string& path)
+	{
+		return Request(device, path, false);
+	}
+
+	std::shared_ptr<const AssetRequest> RequestFont(ID3D11Device* device, const std::string& path)
+	{
+		return Request(device, path, true);
+	}
+
+	// Called by the renderer once per frame, before the overlays render and resume their tasks.
+	void LoadRequested(size_t maxLoads = MaxLoadsPerFrame)
+	{
+		for (size_t i = 0; i < maxLoads && !m_requests.empty(); i++)
+		{
+			Load(*m_requests.front());
+			m_requests.pop_front();
+		}
+	}
+
+private:
+	Logger m_logger{ "AssetCache" };
+	ID3D11Device* m_device = nullptr;
+	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> m_textures;
+	std::unordered_map<std::string, std::shared_ptr<DirectX::SpriteFont>> m_fonts;
+	std::deque<std::shared_ptr<AssetRequest>> m_requests;
+
+	std::shared_ptr<const AssetRequest> Request(ID3D11Device* device, const std::string& path, bool font)
+	{
+		std::shared_ptr<AssetRequest> request = std::make_shared<AssetRequest>();
+		request->path = path;
+		request->device = device;
+		request->font = font;
+
+		bool cached = device == m_device && (font ? m_fonts.count(Key(path)) != 0 : m_textures.count(Key(path)) != 0);
+		if (cached)
+		{
+			Load(*request);
+		}
+		else
+		{
+			m_requests.push_back(request);
+		}
+		return request;
+	}
+
+	void Load(AssetRequest& request)
+	{
+		if (request.font)
+		{
+			request.spriteFont = Font(request.device, request.path);
+		}
+		else
+		{
+			request.texture = Texture(request.device, request.path);
+		}
+		request.done = true;
+	}
+
+	AssetCache() { }
+
+	static std::string Key(const std::string& path)
+	{
+		char buffer[MAX_PATH];
+		return std::string(AssetArchive::NormalizeName(path, buffer, sizeof(buffer)));
+	}
+
+	// Assets belong to one device, a new device starts over.
+	void UseDevice(ID3D11Device* device)
+	{
+		if (device != m_device)
+		{
+			m_textures.clear();
+			m_fonts.clear();
+			m_device = device;
+		}
+	}
+
+	// The pixels are uploaded straight from the mapped archive.
+	static HRESULT CreateFromPixels(ID3D11Device* device, const AssetView& asset, ID3D11ShaderResourceView** view)
+	{
+		if ((uint64_t)asset.rowPitch * asset.height > asset.size)
+		{
+			return E_INVALIDARG;
+		}
+
+		D3D11_TEXTURE2D_DESC description = {};
+		description.Width = asset.width;
+		description.Height = asset.height;
+		description.MipLevels = 1;
+		description.ArraySize = 1;
+		description.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		description.SampleDesc.Count = 1;
+		description.Usage = D3D11_USAGE_IMMUTABLE;
+		description.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		D3D11_SUBRESOURCE_DATA data = {};
+		data.pSysMem = asset.data;
+		data.SysMemPitch = asset.rowPitch;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture = nullptr;
+		HRESULT result = device->CreateTexture2D(&description, &data, texture.GetAddressOf());
+		if (FAILED(result))
+		{
+			return result;
+		}
+		return device->CreateShaderResourceView(texture.Get(), nullptr, view);
+	}
+};
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "InputQueue.h"
+#include "Varint.h"
+#include "Logger.h"
+
+/*
+* Append-only binary log of hunts and damage samples for offline analysis.
+* Records are pushed into a lock-free queue by one producer (an overlay's update thread)
+* and encoded and written by a background thread, so the producer never touches the file.
+*
+* File layout: the "DXCL" magic and a version byte, followed by blocks. Every flush writes one block,
+* the "DXCB" magic, the payload size (4 bytes, little endian) and whole records. Every record starts with a type byte.
+*	HuntStart: varint wall clock time (milliseconds since the Unix epoch)
+*	Damage: zigzag varint timestamp delta, player byte, zigzag varint delta of that player's total damage
+*	HuntEnd: zigzag varint timestamp delta
+* Deltas are steady clock milliseconds relative to the previous record of the same hunt, every HuntStart resets them,
+* so a reader can start decoding at any hunt and a wall clock change mid-hunt doesn't skew it.
+* Logs of several sessions are appended to the same file, every session starts with a HuntStart. A block cut off
+* by the game closing mid-write is found by its size and skipped, the hunt it belonged to ends there.
+*/
+namespace CombatLogFormat
+{
+	static constexpr char Magic[4] = { 'D', 'X', 'C', 'L' };
+	static constexpr uint8_t Version = 2;
+	static constexpr size_t HeaderSize = 5;
+	static constexpr char BlockMagic[4] = { 'D', 'X', 'C', 'B' };
+	static constexpr size_t BlockHeaderSize = 8;
+	static constexpr int MaxPlayers = 8;
+
+	enum RecordType : uint8_t
+	{
+		HuntStart = 1,
+		Damage = 2,
+		HuntEnd = 3
+	};
+}
+
+class CombatLog
+{
+public:
+	CombatLog(const std::string& fileName)
+	{
+		m_fileName = fileName;
+	}
+
+	~CombatLog()
+	{
+		m_running.store(false);
+		if (m_thread.joinable())
+		{
+			m_thread.join();
+		}
+	}
+
+	// Timestamps are steady clock milliseconds, the log stores the hunt's wall clock start time and steady deltas from there.
+	void HuntStart(uint64_t timestamp)
+	{
+		Push({ CombatLogFormat::HuntStart, 0, timestamp, 0, WallClockMillis() });
+	}
+
+	void Damage(uint64_t timestamp, int player, uint64_t totalDamage)
+	{
+		Push({ CombatLogFormat::Damage, (uint8_t)player, timestamp, totalDamage, 0 });
+	}
+
+	void HuntEnd(uint64_t timestamp)
+	{
+		Push({ CombatLogFormat::HuntEnd, 0, timestamp, 0, 0 });
+	}
+
+	static uint64_t WallClockMillis()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+private:
+	static constexpr size_t FlushBytes = 64 * 1024;
+	static constexpr int FlushIntervalMillis = 1000;
+
+	struct Record
+	{
+		CombatLogFormat::RecordType type = CombatLogFormat::HuntStart;
+		uint8_t player = 0;
+		uint64_t timestamp = 0;
+		uint64_t totalDamage = 0;
+		uint64_t wallClock = 0; // HuntStart only
+	};
+
+	Logger m_logger{ "CombatLog" };
+	std::string m_fileName = "";
+	SpscQueue<Record, 4096> m_queue;
+	std::atomic<uint64_t> m_droppedRecords{ 0 };
+	std::thread m_thread;
+	std::atomic<bool> m_running{ false };
+	std::atomic<bool> m_failed{ false }; // the file couldn't be opened, records are ignored
+
+	// Only used by the writer thread
+	std::vector<uint8_t> m_buffer;
+	uint64_t m_lastTimestamp = 0;
+	uint64_t m_lastDamage[CombatLogFormat::MaxPlayers] = { 0 };
+	bool m_huntOpen = false;
+
+	void Push(const Record& record)
+	{
+		if (m_failed.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		if (!m_running.exchange(true))
+		{
+			m_thread = std::thread(&CombatLog::Run, this);
+		}
+
+		if (!m_queue.Push(record))
+		{
+			m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void Encode(const Record& record)
+	{
+		// Deltas are only valid after a HuntStart, a sample outside of a hunt opens one.
+		if (record.type != CombatLogFormat::HuntStart && !m_huntOpen)
+		{
+			if (record.type == CombatLogFormat::HuntEnd)
+			{
+				return;
+			}
+			// The record was queued moments ago, the wall clock now is close enough.
+			Encode({ CombatLogFormat::HuntStart, 0, record.timestamp, 0, WallClockMillis() });
+		}
+		m_huntOpen = record.type != CombatLogFormat::HuntEnd;
+
+		uint8_t encoded[2 + 2 * Varint::MaxSize];
+		size_t size = 0;
+		encoded[size++] = record.type;
+
+		if (record.type == CombatLogFormat::HuntStart)
+		{
+			size += Varint::Put(encoded + size, record.wallClock);
+			for (uint64_t& damage : m_lastDamage)
+			{
+				damage = 0;
+			}
+		}
+		else
+		{
+			size += Varint::Put(encoded + size, Varint::ZigZag((int64_t)(record.timestamp - m_lastTimestamp)));
+		}
+		m_lastTimestamp = record.timestamp;
+
+		if (record.type == CombatLogFormat::Damage)
+		{
+			uint8_t player = record.player < CombatLogFormat::MaxPlayers ? record.player : CombatLogFormat::MaxPlayers - 1;
+			encoded[size++] = player;
+			size += Varint::Put(encoded + size, Varint::ZigZag((int64_t)(record.totalDamage - m_lastDamage[player])));
+			m_lastDamage[player] = record.totalDamage;
+		}
+
+		m_buffer.insert(m_buffer.end(), encoded, encoded + size);
+	}
+
+	bool Write(FILE* file)
+	{
+		if (m_buffer.empty())
+		{
+			return true;
+		}
+
+		uint8_t header[CombatLogFormat::BlockHeaderSize];
+		uint32_t size = (uint32_t)m_buffer.size();
+		memcpy(header, CombatLogFormat::BlockMagic, sizeof(CombatLogFormat::BlockMagic));
+		for (int i = 0; i < 4; i++)
+		{
+			header[sizeof(CombatLogFormat::BlockMagic) + i] = (uint8_t)(size >> (8 * i));
+		}
+
+		bool written = fwrite(header, 1, sizeof(header), file) == sizeof(header)
+			&& fwrite(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size() && fflush(file) == 0;
+		m_buffer.clear();
+
+		// Readers skip a torn block, the next record can't be a delta to what was lost.
+		if (!written)
+		{
+			m_huntOpen = false;
+		}
+		return written;
+	}
+
+	// Appends to the log, a log in another format is moved aside to <name>.old first.
+	FILE* Open()
+	{
+		FILE* file = nullptr;
+		fopen_s(&file, m_fileName.c_str(), "rb");
+		if (file != nullptr)
+		{
+			uint8_t header[CombatLogFormat::HeaderSize] = { 0 };
+			size_t size = fread(header, 1, sizeof(header), file);
+			fclose(file);
+			if (size != 0 && (size != sizeof(header) || memcmp(header, CombatLogFormat::Magic, sizeof(CombatLogFormat::Magic)) != 0
+				|| header[sizeof(CombatLogFormat::Magic)] != CombatLogFormat::Version))
+			{
+				std::string oldFileName = m_fileName + ".old";
+				m_logger.Log("%s has another format, moving it to %s", m_fileName.c_str(), oldFileName.c_str());
+				remove(oldFileName.c_str());
+				rename(m_fileName.c_str(), oldFileName.c_str());
+			}
+		}
+
+		file = nullptr;
+		fopen_s(&file, m_fileName.c_str(), "ab");
+		if (file == nullptr)
+		{
+			return nullptr;
+		}
+
+		fseek(file, 0, SEEK_END);
+		if (ftell(file) == 0)
+		{
+			fwrite(CombatLogFormat::Magic, 1, sizeof(CombatLogFormat::Magic), file);
+			fwrite(&CombatLogFormat::Version, 1, 1, file);
+		}
+		return file;
+	}
+
+	void Run()
+	{
+		FILE* file = Open();
+		if (file == nullptr)
+		{
+			m_logger.Log("Could not open %s, combat logging is off", m_fileName.c_str());
+			m_failed.store(true);
+			return;
+		}
+
+		auto lastFlush = std::chrono::steady_clock::now();
+		bool running = true;
+		while (running)
+		{
+			running = m_running.load();
+
+			Record record;
+			while (m_queue.Pop(&record))
+			{
+				Encode(record);
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (m_buffer.size() >= FlushBytes || now - lastFlush >= std::chrono::milliseconds(FlushIntervalMillis) || !running)
+			{
+				if (!Write(file))
+				{
+					m_logger.Log("Could not write to %s", m_fileName.c_str());
+				}
+				lastFlush = now;
+			}
+
+			if (running)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+
+		uint64_t dropped = m_droppedRecords.load();
+		if (dropped != 0)
+		{
+			m_logger.Log("%llu records were dropped because the queue was full", (unsigned long long)dropped);
+		}
+		fclose(file);
+	}
+};
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CombatLog.h"
+
+/*
+* Reads combat logs written by CombatLog. The file is memory mapped and indexed once (where each hunt starts and ends),
+* after that any hunt can be decoded on its own without reading the rest of the file.
+* A block cut off by the game closing mid-write is skipped, decoding resumes at the next intact block.
+*/
+
+struct CombatLogSample
+{
+	uint64_t timestamp = 0;
+	int player = 0;
+	uint64_t totalDamage = 0; // the player's damage counter at that time
+};
+
+struct CombatLogHunt
+{
+	uint64_t startTime = 0; // wall clock, milliseconds since the Unix epoch, like sample timestamps
+	uint64_t endTime = 0; // the last record's time if the hunt never ended
+	bool ended = false;
+	size_t numSamples = 0;
+	size_t firstBlock = 0;
+	size_t offset = 0; // of the HuntStart record
+	size_t lastBlock = 0;
+	size_t end = 0; // just past the hunt's last record
+};
+
+class CombatLogReader
+{
+public:
+	CombatLogReader() { }
+
+	CombatLogReader(const CombatLogReader&) = delete;
+	CombatLogReader& operator=(const CombatLogReader&) = delete;
+
+	~CombatLogReader()
+	{
+		Close();
+	}
+
+	bool Open(const std::string& fileName)
+	{
+		Close();
+
+		m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart < (LONGLONG)CombatLogFormat::HeaderSize)
+		{
+			Close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		m_view = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (m_view == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		if (!Attach((const uint8_t*)m_view, (size_t)fileSize.QuadPart))
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	// Reads a log that is already in memory, the data must outlive the reader.
+	bool Attach(const uint8_t* data, size_t size)
+	{
+		m_blocks.clear();
+		m_hunts.clear();
+		if (size < CombatLogFormat::HeaderSize || memcmp(data, CombatLogFormat::Magic, sizeof(CombatLogFormat::Magic)) != 0
+			|| data[sizeof(CombatLogFormat::Magic)] != CombatLogFormat::Version)
+		{
+			m_data = nullptr;
+			m_size = 0;
+			return false;
+		}
+
+		m_data = data;
+		m_size = size;
+		BuildIndex();
+		return true;
+	}
+
+	void Close()
+	{
+		if (m_view != nullptr)
+		{
+			UnmapViewOfFile(m_view);
+			m_view = nullptr;
+		}
+		if (m_mapping != nullptr)
+		{
+			CloseHandle(m_mapping);
+			m_mapping = nullptr;
+		}
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_blocks.clear();
+		m_hunts.clear();
+	}
+
+	const std::vector<CombatLogHunt>& Hunts() const
+	{
+		return m_hunts;
+	}
+
+	// Calls callback(const CombatLogSample&) for every damage sample of a hunt, oldest first.
+	template<typename Callback>
+	void ForEachSample(const CombatLogHunt& hunt, Callback callback) const
+	{
+		DecodeState state;
+		for (size_t block = hunt.firstBlock; block <= hunt.lastBlock && block < m_blocks.size(); block++)
+		{
+			size_t position = block == hunt.firstBlock ? hunt.offset : m_blocks[block].offset;
+			size_t end = block == hunt.lastBlock ? hunt.end : m_blocks[block].offset + m_blocks[block].size;
+			while (position < end)
+			{
+				CombatLogFormat::RecordType type;
+				CombatLogSample sample;
+				if (!DecodeRecord(&position, end, &state, &type, &sample))
+				{
+					return;
+				}
+				if (type == CombatLogFormat::Damage)
+				{
+					callback(sample);
+				}
+			}
+		}
+	}
+
+	// Total damage per player at the end of a hunt, players that never hit stay 0.
+	std::vector<uint64_t> FinalDamage(const CombatLogHunt& hunt) const
+	{
+		std::vector<uint64_t> damage(CombatLogFormat::MaxPlayers, 0);
+		ForEachSample(hunt, [&](const CombatLogSample& sample)
+		{
+			damage[sample.player] = sample.totalDamage;
+		});
+		return damage;
+	}
+
+private:
+	struct Block
+	{
+		size_t offset = 0; // of the payload
+		size_t size = 0;
+		bool afterGap = false; // a torn block comes before it
+	};
+
+	struct DecodeState
+	{
+		uint64_t timestamp = 0;
+		uint64_t damage[CombatLogFormat::MaxPlayers] = { 0 };
+	};
+
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+	void* m_view = nullptr;
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+	std::vector<Block> m_blocks;
+	std::vector<CombatLogHunt> m_hunts;
+
+	// Decodes the record at *position and moves past it, the timestamp (and damage for samples) comes from the hunt's state.
+	// Returns false if there's no whole record there.
+	bool DecodeRecord(size_t* position, size_t end, DecodeState* state, CombatLogFormat::RecordType* type, CombatLogSample* sample) const
+	{
+		if (*position >= end)
+		{
+			return false;
+		}
+
+		uint8_t recordType = m_data[(*position)++];
+		uint64_t value;
+		if (!Varint::Get(m_data, end, position, &value))
+		{
+			return false;
+		}
+
+		if (recordType == CombatLogFormat::HuntStart)
+		{
+			state->timestamp = value;
+			memset(state->damage, 0, sizeof(state->damage));
+		}
+		else if (recordType == CombatLogFormat::Damage || recordType == CombatLogFormat::HuntEnd)
+		{
+			state->timestamp += Varint::UnZigZag(value);
+		}
+		else
+		{
+			return false;
+		}
+		*type = (CombatLogFormat::RecordType)recordType;
+		sample->timestamp = state->timestamp;
+
+		if (recordType == CombatLogFormat::Damage)
+		{
+			uint64_t delta;
+			if (*position >= end || m_data[*position] >= CombatLogFormat::MaxPlayers)
+			{
+				return false;
+			}
+			sample->player = m_data[(*position)++];
+			if (!Varint::Get(m_data, end, position, &delta))
+			{
+				return false;
+			}
+			state->damage[sample->player] += Varint::UnZigZag(delta);
+			sample->totalDamage = state->damage[sample->player];
+		}
+		return true;
+	}
+
+	// A block is intact if its size fits in the file and its payload is whole records.
+	bool IsIntactBlock(size_t offset, size_t size) const
+	{
+		DecodeState state;
+		size_t position = offset;
+		CombatLogFormat::RecordType type;
+		CombatLogSample sample;
+		while (position < offset + size)
+		{
+			if (!DecodeRecord(&position, offset + size, &state, &type, &sample))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Torn blocks are skipped by scanning for the next block magic.
+	void FindBlocks()
+	{
+		size_t position = CombatLogFormat::HeaderSize;
+		bool gap = false;
+		while (position + CombatLogFormat::BlockHeaderSize <= m_size)
+		{
+			if (memcmp(m_data + position, CombatLogFormat::BlockMagic, sizeof(CombatLogFormat::BlockMagic)) == 0)
+			{
+				size_t size = 0;
+				for (int i = 0; i < 4; i++)
+				{
+					size |= (size_t)m_data[position + sizeof(CombatLogFormat::BlockMagic) + i] << (8 * i);
+				}
+
+				size_t payload = position + CombatLogFormat::BlockHeaderSize;
+				if (size <= m_size - payload && IsIntactBlock(payload, size))
+				{
+					m_blocks.push_back({ payload, size, gap });
+					gap = false;
+					position = payload + size;
+					continue;
+				}
+			}
+			gap = true;
+			position++;
+		}
+	}
+
+	void BuildIndex()
+	{
+		FindBlocks();
+
+		DecodeState state;
+		bool inHunt = false;
+		for (size_t block = 0; block < m_blocks.size(); block++)
+		{
+			// Records after a gap are deltas to what was lost, the hunt ends at the gap.
+			if (m_blocks[block].afterGap)
+			{
+				inHunt = false;
+			}
+
+			size_t position = m_blocks[block].offset;
+			size_t end = position + m_blocks[block].size;
+			while (position < end)
+			{
+				size_t recordStart = position;
+				CombatLogFormat::RecordType type;
+				CombatLogSample sample;
+				if (!DecodeRecord(&position, end, &state, &type, &sample))
+				{
+					break; // can't happen, the block was checked by FindBlocks()
+				}
+
+				if (type == CombatLogFormat::HuntStart)
+				{
+					m_hunts.push_back(CombatLogHunt());
+					m_hunts.back().startTime = sample.timestamp;
+					m_hunts.back().firstBlock = block;
+					m_hunts.back().offset = recordStart;
+					inHunt = true;
+				}
+
+				// Records between a gap and the next HuntStart have nothing to be deltas to.
+				if (!inHunt)
+				{
+					continue;
+				}
+
+				CombatLogHunt& hunt = m_hunts.back();
+				hunt.endTime = sample.timestamp;
+				hunt.lastBlock = block;
+				hunt.end = position;
+				if (type == CombatLogFormat::HuntEnd)
+				{
+					hunt.ended = true;
+				}
+				else if (type == CombatLogFormat::Damage)
+				{
+					hunt.numSamples++;
+				}
+			}
+		}
+	}
+};
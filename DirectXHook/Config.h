@@ -0,0 +1,700 @@
+#pragma once
+
+#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+/*
+* Configuration files in a small INI subset:
+*
+*	# comment (or ;)
+*	[window]
+*	x = 100
+*	title = "quoted values keep their spaces"
+*
+* Keys before the first section are in the "" section. Names and values are trimmed, later duplicates win.
+* A snapshot owns one copy of the file's text, all names and values are views into it.
+*/
+class ConfigSnapshot
+{
+public:
+	ConfigSnapshot(std::string text, uint64_t version, bool loaded)
+	{
+		m_text = std::move(text);
+		m_version = version;
+		m_loaded = loaded;
+		Parse();
+	}
+
+	ConfigSnapshot(const ConfigSnapshot&) = delete;
+	ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+
+	// Maps the file and copies it into a snapshot in one go, the file isn't kept open so editors can replace it.
+	// Settings that are only read once can use this directly instead of a ConfigStore.
+	static std::shared_ptr<const ConfigSnapshot> FromFile(const std::string& fileName, uint64_t version = 0)
+	{
+		std::string text;
+		bool loaded = false;
+
+		HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER fileSize;
+			if (GetFileSizeEx(file, &fileSize))
+			{
+				loaded = fileSize.QuadPart == 0;
+				HANDLE mapping = fileSize.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+				if (mapping != nullptr)
+				{
+					const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					if (view != nullptr)
+					{
+						text.assign((const char*)view, (size_t)fileSize.QuadPart);
+						UnmapViewOfFile(view);
+						loaded = true;
+					}
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+		}
+
+		return std::make_shared<const ConfigSnapshot>(std::move(text), version, loaded);
+	}
+
+	// Counts reloads, overlays compare it to see whether anything changed.
+	uint64_t Version() const
+	{
+		return m_version;
+	}
+
+	// False when the file didn't exist or couldn't be read.
+	bool Loaded() const
+	{
+		return m_loaded;
+	}
+
+	// The file as it was read, for recognizing files written before they were in this format.
+	std::string_view Text() const
+	{
+		return m_text;
+	}
+
+	size_t NumEntries() const
+	{
+		return m_entries.size();
+	}
+
+	bool Has(std::string_view section, std::string_view key) const
+	{
+		return Find(section, key) != nullptr;
+	}
+
+	std::string_view GetString(std::string_view section, std::string_view key, std::string_view defaultValue = std::string_view()) const
+	{
+		const Entry* entry = Find(section, key);
+		return entry != nullptr ? entry->value : defaultValue;
+	}
+
+	// Decimal, or hexadecimal with a 0x prefix.
+	int64_t GetInt(std::string_view section, std::string_view key, int64_t defaultValue = 0) const
+	{
+		const Entry* entry = Find(section, key);
+		if (entry == nullptr)
+		{
+			return defaultValue;
+		}
+
+		std::string_view value = entry->value;
+		bool negative = !value.empty() && value[0] == '-';
+		if (negative || (!value.empty() && value[0] == '+'))
+		{
+			value.remove_prefix(1);
+		}
+
+		int base = 10;
+		if (value.size() > 2 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X'))
+		{
+			value.remove_prefix(2);
+			base = 16;
+		}
+
+		uint64_t result = 0;
+		std::from_chars_result parsed = std::from_chars(value.data(), value.data() + value.size(), result, base);
+		if (parsed.ec != std::errc() || parsed.ptr != value.data() + value.size())
+		{
+			return defaultValue;
+		}
+		return negative ? -(int64_t)result : (int64_t)result;
+	}
+
+	double GetFloat(std::string_view section, std::string_view key, double defaultValue = 0) const
+	{
+		const Entry* entry = Find(section, key);
+		if (entry == nullptr)
+		{
+			return defaultValue;
+		}
+
+		double result = 0;
+		std::from_chars_result parsed = std::from_chars(entry->value.data(), entry->value.data() + entry->value.size(), result);
+		if (parsed.ec != std::errc() || parsed.ptr != entry->value.data() + entry->value.size())
+		{
+			return defaultValue;
+		}
+		return result;
+	}
+
+	// true/false, yes/no, on/off or 1/0
+	bool GetBool(std::string_view section, std::string_view key, bool defaultValue = false) const
+	{
+		const Entry* entry = Find(section, key);
+		if (entry == nullptr)
+		{
+			return defaultValue;
+		}
+
+		std::string_view value = entry->value;
+		if (value == "true" || value == "yes" || value == "on" || value == "1")
+		{
+			return true;
+		}
+		if (value == "false" || value == "no" || value == "off" || value == "0")
+		{
+			return false;
+		}
+		return defaultValue;
+	}
+
+private:
+	struct Entry
+	{
+		std::string_view section;
+		std::string_view key;
+		std::string_view value;
+	};
+
+	std::string m_text;
+	std::vector<Entry> m_entries; // sorted by section, then key
+	uint64_t m_version = 0;
+	bool m_loaded = false;
+
+	static std::string_view Trim(std::string_view text)
+	{
+		size_t begin = text.find_first_not_of(" \t\r");
+		if (begin == std::string_view::npos)
+		{
+			return std::string_view();
+		}
+		size_t end = text.find_last_not_of(" \t\r");
+		return text.substr(begin, end - begin + 1);
+	}
+
+	void Parse()
+	{
+		std::string_view text = m_text;
+		std::string_view section;
+
+		size_t position = 0;
+		while (position < text.size())
+		{
+			size_t lineEnd = text.find('\n', position);
+			if (lineEnd == std::string_view::npos)
+			{
+				lineEnd = text.size();
+			}
+			std::string_view line = Trim(text.substr(position, lineEnd - position));
+			position = lineEnd + 1;
+
+			if (line.empty() || line[0] == '#' || line[0] == ';')
+			{
+				continue;
+			}
+
+			if (line[0] == '[')
+			{
+				size_t close = line.find(']');
+				if (close != std::string_view::npos)
+				{
+					section = Trim(line.substr(1, close - 1));
+				}
+				continue;
+			}
+
+			size_t equals = line.find('=');
+			if (equals == std::string_view::npos)
+			{
+				continue;
+			}
+
+			Entry entry;
+			entry.section = section;
+			entry.key = Trim(line.substr(0, equals));
+			entry.value = Trim(line.substr(equals + 1));
+			if (entry.value.size() >= 2 && entry.value.front() == '"' && entry.value.back() == '"')
+			{
+				entry.value = entry.value.substr(1, entry.value.size() - 2);
+			}
+			else
+			{
+				size_t comment = entry.value.find_first_of("#;");
+				if (comment != std::string_view::npos)
+				{
+					entry.value = Trim(entry.value.substr(0, comment));
+				}
+			}
+
+			if (!entry.key.empty())
+			{
+				m_entries.push_back(entry);
+			}
+		}
+
+		// A stable sort keeps duplicates in file order, Find() picks the last one.
+		std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b)
+		{
+			return a.section != b.section ? a.section < b.section : a.key < b.key;
+		});
+	}
+
+	const Entry* Find(std::string_view section, std::string_view key) const
+	{
+		auto end = std::upper_bound(m_entries.begin(), m_entries.end(), std::make_pair(section, key),
+			[](const std::pair<std::string_view, std::string_view>& wanted, const Entry& entry)
+		{
+			return wanted.first != entry.section ? wanted.first < entry.section : wanted.second < entry.key;
+		});
+
+		if (end == m_entries.begin())
+		{
+			return nullptr;
+		}
+
+		const Entry& entry = *(end - 1);
+		return entry.section == section && entry.key == key ? &entry : nullptr;
+	}
+};
+
+/*
+* Watches the files of every ConfigStore from one thread. Each directory with watched files gets one ReadDirectoryChangesW
+* request and changes are matched by file name, so writes to other files there (like the hook's own log) don't wake any store.
+* Directories that can't be watched are polled.
+* The thread stops with the last file and is never waited for, it keeps what it uses alive itself.
+*/
+class ConfigWatcher
+{
+public:
+	typedef std::function<void()> Callback;
+
+	static ConfigWatcher& Instance()
+	{
+		static ConfigWatcher watcher;
+		return watcher;
+	}
+
+	ConfigWatcher(const ConfigWatcher&) = delete;
+	ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+	// Runs at unload under the loader lock, where joining would deadlock, so the thread is only told to stop.
+	~ConfigWatcher()
+	{
+		if (m_state != nullptr)
+		{
+			m_state->running.store(false);
+			SetEvent(m_state->wakeEvent);
+		}
+	}
+
+	// The callback runs on the watcher thread whenever the file may have changed, it has to check for itself.
+	int Add(const std::string& fileName, Callback callback)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_state == nullptr)
+		{
+			m_state = std::make_shared<State>();
+			std::thread(&ConfigWatcher::Run, m_state).detach();
+		}
+
+		int id = m_nextId++;
+		{
+			std::lock_guard<std::mutex> filesLock(m_state->mutex);
+			m_state->files.push_back({ id, Directory(fileName), FileName(fileName), std::move(callback) });
+			m_state->filesChanged = true;
+		}
+		SetEvent(m_state->wakeEvent);
+		return id;
+	}
+
+	// Doesn't wait for the thread, so a callback that was already started may still be running when this returns.
+	// Callbacks have to own what they use. The thread stops with the last file.
+	void Remove(int id)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_state == nullptr)
+		{
+			return;
+		}
+
+		bool empty = false;
+		{
+			std::lock_guard<std::mutex> filesLock(m_state->mutex);
+			std::vector<WatchedFile>& files = m_state->files;
+			files.erase(std::remove_if(files.begin(), files.end(), [id](const WatchedFile& file) { return file.id == id; }), files.end());
+			m_state->filesChanged = true;
+			empty = files.empty();
+		}
+
+		// A file added later starts a new thread with its own state, the old one exits on its own.
+		if (empty)
+		{
+			m_state->running.store(false);
+			SetEvent(m_state->wakeEvent);
+			m_state.reset();
+			return;
+		}
+		SetEvent(m_state->wakeEvent);
+	}
+
+private:
+	static constexpr DWORD PollMillis = 250;
+	static constexpr DWORD SettleMillis = 50; // editors often write a file in several steps
+
+	struct WatchedFile
+	{
+		int id = 0;
+		std::string directory;
+		std::wstring name;
+		Callback callback;
+	};
+
+	// The kernel writes into the buffer and the OVERLAPPED while a read is pending, so a watch never moves.
+	struct DirectoryWatch
+	{
+		std::string path;
+		HANDLE handle = INVALID_HANDLE_VALUE;
+		OVERLAPPED overlapped = {};
+		bool pending = false;
+		DWORD buffer[1024]; // FILE_NOTIFY_INFORMATION records, which are DWORD aligned
+	};
+
+	// Shared by a thread and the watcher while it runs, the thread may outlive the watcher.
+	struct State
+	{
+		Logger logger{ "ConfigWatcher" };
+		std::mutex mutex; // guards the files, callbacks run without it
+		std::vector<WatchedFile> files;
+		bool filesChanged = false;
+		std::atomic<bool> running{ true };
+		HANDLE wakeEvent = nullptr;
+
+		State()
+		{
+			wakeEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+		}
+
+		~State()
+		{
+			CloseHandle(wakeEvent);
+		}
+	};
+
+	std::mutex m_mutex; // serializes Add() and Remove()
+	std::shared_ptr<State> m_state; // of the running thread, null while no file is watched
+	int m_nextId = 1;
+
+	ConfigWatcher() = default;
+
+	static std::string Directory(const std::string& fileName)
+	{
+		size_t separator = fileName.find_last_of("\\/");
+		return separator == std::string::npos ? "." : fileName.substr(0, separator);
+	}
+
+	static std::wstring FileName(const std::string& fileName)
+	{
+		size_t separator = fileName.find_last_of("\\/");
+		std::string name = separator == std::string::npos ? fileName : fileName.substr(separator + 1);
+		std::wstring wideName(name.size(), L'\0');
+		int length = MultiByteToWideChar(CP_ACP, 0, name.data(), (int)name.size(), wideName.data(), (int)wideName.size());
+		wideName.resize(length > 0 ? length : 0);
+		return wideName;
+	}
+
+	static bool Arm(DirectoryWatch& watch)
+	{
+		watch.pending = false;
+		if (watch.handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		ResetEvent(watch.overlapped.hEvent);
+		watch.pending = ReadDirectoryChangesW(watch.handle, watch.buffer, sizeof(watch.buffer), FALSE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE, nullptr, &watch.overlapped, nullptr) != FALSE;
+		return watch.pending;
+	}
+
+	static std::unique_ptr<DirectoryWatch> OpenDirectory(State& state, const std::string& path)
+	{
+		std::unique_ptr<DirectoryWatch> watch = std::make_unique<DirectoryWatch>();
+		watch->path = path;
+		watch->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		watch->handle = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (!Arm(*watch))
+		{
+			state.logger.Log("Can't watch %s for changes, polling it instead", path.c_str());
+		}
+		return watch;
+	}
+
+	static void CloseDirectory(DirectoryWatch& watch)
+	{
+		if (watch.pending)
+		{
+			DWORD bytes = 0;
+			CancelIoEx(watch.handle, &watch.overlapped);
+			GetOverlappedResult(watch.handle, &watch.overlapped, &bytes, TRUE);
+		}
+		if (watch.handle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(watch.handle);
+		}
+		CloseHandle(watch.overlapped.hEvent);
+	}
+
+	// Opens a watch for every directory with files in it and closes the rest, with the state's mutex held.
+	static void UpdateDirectories(State& state, std::vector<std::unique_ptr<DirectoryWatch>>& directories)
+	{
+		for (auto it = directories.begin(); it != directories.end();)
+		{
+			bool used = std::any_of(state.files.begin(), state.files.end(), [&](const WatchedFile& file) { return file.directory == (*it)->path; });
+			if (used)
+			{
+				it++;
+				continue;
+			}
+			CloseDirectory(**it);
+			it = directories.erase(it);
+		}
+
+		for (const WatchedFile& file : state.files)
+		{
+			bool watched = std::any_of(directories.begin(), directories.end(), [&](const std::unique_ptr<DirectoryWatch>& watch) { return watch->path == file.directory; });
+			if (!watched)
+			{
+				directories.push_back(OpenDirectory(state, file.directory));
+			}
+		}
+	}
+
+	// Names of the files that changed, or nothing if the buffer overflowed and any file might have.
+	static bool ChangedNames(DirectoryWatch& watch, std::vector<std::wstring>& names)
+	{
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(watch.handle, &watch.overlapped, &bytes, FALSE) || bytes == 0)
+		{
+			return false;
+		}
+
+		const uint8_t* record = (const uint8_t*)watch.buffer;
+		while (true)
+		{
+			const FILE_NOTIFY_INFORMATION* information = (const FILE_NOTIFY_INFORMATION*)record;
+			names.emplace_back(information->FileName, information->FileNameLength / sizeof(WCHAR));
+			if (information->NextEntryOffset == 0)
+			{
+				return true;
+			}
+			record += information->NextEntryOffset;
+		}
+	}
+
+	static bool SameName(const std::wstring& a, const std::wstring& b)
+	{
+		return CompareStringOrdinal(a.data(), (int)a.size(), b.data(), (int)b.size(), TRUE) == CSTR_EQUAL;
+	}
+
+	// Runs the callbacks of the files in a directory, all of them if names is null.
+	// They are copied out first and run without the lock, so a slow reload doesn't hold up Add() or Remove().
+	static void Notify(State& state, const std::string& directory, const std::vector<std::wstring>* names, std::vector<Callback>& callbacks)
+	{
+		callbacks.clear();
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			for (const WatchedFile& file : state.files)
+			{
+				if (file.directory != directory)
+				{
+					continue;
+				}
+
+				bool changed = names == nullptr || std::any_of(names->begin(), names->end(), [&](const std::wstring& name) { return SameName(name, file.name); });
+				if (changed)
+				{
+					callbacks.push_back(file.callback);
+				}
+			}
+		}
+
+		for (Callback& callback : callbacks)
+		{
+			callback();
+		}
+	}
+
+	static void Run(std::shared_ptr<State> statePointer)
+	{
+		State& state = *statePointer;
+		std::vector<std::unique_ptr<DirectoryWatch>> directories;
+		std::vector<HANDLE> handles;
+		std::vector<DirectoryWatch*> waiting;
+		std::vector<std::wstring> names;
+		std::vector<Callback> callbacks;
+
+		while (state.running.load())
+		{
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				if (state.filesChanged)
+				{
+					state.filesChanged = false;
+					UpdateDirectories(state, directories);
+				}
+			}
+
+			handles.assign(1, state.wakeEvent);
+			waiting.assign(1, nullptr);
+			bool polling = false;
+			for (auto& directory : directories)
+			{
+				if (directory->pending && handles.size() < MAXIMUM_WAIT_OBJECTS)
+				{
+					handles.push_back(directory->overlapped.hEvent);
+					waiting.push_back(directory.get());
+				}
+				else
+				{
+					polling = true;
+				}
+			}
+
+			DWORD result = WaitForMultipleObjects((DWORD)handles.size(), handles.data(), FALSE, polling ? PollMillis : INFINITE);
+			if (result == WAIT_TIMEOUT)
+			{
+				for (auto& directory : directories)
+				{
+					if (!directory->pending || std::find(waiting.begin(), waiting.end(), directory.get()) == waiting.end())
+					{
+						Notify(state, directory->path, nullptr, callbacks);
+					}
+				}
+				continue;
+			}
+
+			if (result <= WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + handles.size())
+			{
+				continue;
+			}
+
+			// The names are copied out before the buffer is handed back to the next read.
+			DirectoryWatch& directory = *waiting[result - WAIT_OBJECT_0];
+			names.clear();
+			bool named = ChangedNames(directory, names);
+			Arm(directory);
+
+			Sleep(SettleMillis);
+			Notify(state, directory.path, named ? &names : nullptr, callbacks);
+		}
+
+		for (auto& directory : directories)
+		{
+			CloseDirectory(*directory);
+		}
+	}
+};
+
+/*
+* One config file, loaded once when constructed and reloaded by the shared ConfigWatcher whenever the file changes.
+* Readers get the current snapshot with one atomic load, they never wait for the file.
+*/
+class ConfigStore
+{
+public:
+	ConfigStore(const std::string& fileName)
+	{
+		m_source->fileName = fileName;
+		m_source->lastWrite = m_source->LastWrite();
+		m_source->snapshot.store(ConfigSnapshot::FromFile(fileName));
+		m_watchId = ConfigWatcher::Instance().Add(fileName, [source = m_source] { source->Reload(); });
+	}
+
+	ConfigStore(const ConfigStore&) = delete;
+	ConfigStore& operator=(const ConfigStore&) = delete;
+
+	// Doesn't wait for a reload that is running, the reload keeps the source alive.
+	~ConfigStore()
+	{
+		ConfigWatcher::Instance().Remove(m_watchId);
+	}
+
+	std::shared_ptr<const ConfigSnapshot> Snapshot() const
+	{
+		return m_source->snapshot.load();
+	}
+
+	const std::string& FileName() const
+	{
+		return m_source->fileName;
+	}
+
+private:
+	// Shared with the watcher's callback, which may still run after the store is gone.
+	struct Source
+	{
+		Logger logger{ "ConfigStore" };
+		std::string fileName = "";
+		std::atomic<std::shared_ptr<const ConfigSnapshot>> snapshot;
+
+		// Only used by the watcher thread after construction
+		uint64_t lastWrite = 0;
+		uint64_t version = 0;
+
+		uint64_t LastWrite() const
+		{
+			WIN32_FILE_ATTRIBUTE_DATA attributes;
+			if (!GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &attributes))
+			{
+				return 0;
+			}
+			return ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32 | attributes.ftLastWriteTime.dwLowDateTime) ^ ((uint64_t)attributes.nFileSizeLow << 1);
+		}
+
+		void Reload()
+		{
+			uint64_t write = LastWrite();
+			if (write == lastWrite)
+			{
+				return;
+			}
+
+			lastWrite = write;
+			snapshot.store(ConfigSnapshot::FromFile(fileName, ++version));
+			logger.Log("Reloaded %s", fileName.c_str());
+		}
+	};
+
+	std::shared_ptr<Source> m_source = std::make_shared<Source>();
+	int m_watchId = 0;
+};
@@ -1,10 +1,19 @@
 #include "DirectXHook.h"
 #include "Overlays/PauseEldenRing/PauseEldenRing.h"
+#include "Overlays/ProfilerHud/ProfilerHud.h"
 
+// Overlays are rendered in the order they are added here.
 DirectXHook::DirectXHook()
 {
 	static PauseEldenRing pauseEldenRing;
-	SetRenderCallback(&pauseEldenRing);
+	AddRenderCallback(&pauseEldenRing);
+
+	// Enabled by hook_enable_profiler.txt
+	if (Profiler::Instance().IsEnabled())
+	{
+		static ProfilerHud profilerHud;
+		AddRenderCallback(&profilerHud);
+	}
 }
 
 void DirectXHook::Hook()
@@ -27,6 +36,9 @@ void DirectXHook::Hook()
 	}
 	Sleep(25000);
 
+	// Map the packed assets before overlays start loading them.
+	AssetArchive::Instance();
+
 	m_dummySwapChain = CreateDummySwapChain();
 	HookSwapChainVmt(m_dummySwapChain, &originalPresentAddress, &originalResizeBuffersAddress, (uintptr_t)&OnPresent, (uintptr_t)&OnResizeBuffers);
 
@@ -47,6 +59,49 @@ void DirectXHook::SetRenderCallback(IRenderCallback* object)
 	renderer.SetRenderCallback(object);
 }
 
+void DirectXHook::AddRenderCallback(IRenderCallback* object, int priority, unsigned int budgetMicros)
+{
+	renderer.AddRenderCallback(object, priority, budgetMicros);
+}
+
+void DirectXHook::SetOverlayFrameBudget(unsigned int budgetMicros)
+{
+	renderer.SetOverlayFrameBudget(budgetMicros);
+}
+
+// The frame rate cap is off by default.
+void DirectXHook::SetFrameRateLimit(double fps, bool lowLatency)
+{
+	framePacer.SetTargetFps(fps);
+	framePacer.SetLowLatency(lowLatency);
+}
+
+// Called every frame, hook_frame_limit.cfg is reloaded in the background when it changes.
+void DirectXHook::ApplyFrameLimitConfig()
+{
+	std::shared_ptr<const ConfigSnapshot> config = m_frameLimitConfig.Snapshot();
+	if (config->Version() == m_frameLimitConfigVersion)
+	{
+		return;
+	}
+
+	m_frameLimitConfigVersion = config->Version();
+	if (config->Loaded())
+	{
+		double fps = config->GetFloat("", "fps", 0);
+		bool lowLatency = config->GetBool("", "low_latency", false);
+		SetFrameRateLimit(fps, lowLatency);
+		if (lowLatency)
+		{
+			m_logger.Log("Frame rate limit: %.1f fps, low latency", fps);
+		}
+		else
+		{
+			m_logger.Log("Frame rate limit: %.1f fps", fps);
+		}
+	}
+}
+
 bool DirectXHook::IsDllLoaded(std::string dllName)
 {
 	std::vector<HMODULE> modules(0, 0);
@@ -61,7 +116,7 @@ bool DirectXHook::IsDllLoaded(std::string dllName)
 		GetModuleBaseName(GetCurrentProcess(), module, &lpBaseName[0], lpBaseName.length() + 1);
 		if (lpBaseName == dllName)
 		{
-			m_logger.Log("%s is loaded", dllName);
+			m_logger.Log("%s is loaded", dllName.c_str());
 			return true;
 		}
 	}
@@ -150,9 +205,9 @@ void DirectXHook::HookSwapChainVmt(IDXGISwapChain* dummySwapChain, uintptr_t* or
 	uintptr_t vmtPresentIndex = (vmtBaseAddress + (size * 8));
 	uintptr_t vmtResizeBuffersIndex = (vmtBaseAddress + (size * 13));
 
-	m_logger.Log("SwapChain VMT base address: %p", vmtBaseAddress);
-	m_logger.Log("SwapChain VMT Present index: %p", vmtPresentIndex);
-	m_logger.Log("SwapChain VMT ResizeBuffers index: %p", vmtResizeBuffersIndex);
+	m_logger.Log("SwapChain VMT base address: %p", (void*)vmtBaseAddress);
+	m_logger.Log("SwapChain VMT Present index: %p", (void*)vmtPresentIndex);
+	m_logger.Log("SwapChain VMT ResizeBuffers index: %p", (void*)vmtResizeBuffersIndex);
 
 	DWORD oldProtection;
 	DWORD oldProtection2;
@@ -181,8 +236,8 @@ void DirectXHook::HookCommandQueueVmt(ID3D12CommandQueue* dummyCommandQueue, uin
 	uintptr_t vmtBaseAddress = (*(uintptr_t*)dummyCommandQueue);
 	uintptr_t vmtExecuteCommandListsIndex = (vmtBaseAddress + (8 * 10));
 
-	m_logger.Log("CommandQueue VMT base address: %p", vmtBaseAddress);
-	m_logger.Log("ExecuteCommandLists index: %p", vmtExecuteCommandListsIndex);
+	m_logger.Log("CommandQueue VMT base address: %p", (void*)vmtBaseAddress);
+	m_logger.Log("ExecuteCommandLists index: %p", (void*)vmtExecuteCommandListsIndex);
 
 	DWORD oldProtection;
 
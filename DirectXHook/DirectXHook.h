@@ -6,13 +6,18 @@
 #include <Psapi.h>
 
 #include "Renderer.h"
+#include "FramePacer.h"
+#include "Config.h"
+#include "AssetArchive.h"
 #include "IRenderCallback.h"
 #include "Logger.h"
+#include "Trace.h"
 
 class DirectXHook
 {
 public:
 	Renderer renderer;
+	FramePacer framePacer;
 	uintptr_t originalPresentAddress = 0;
 	uintptr_t originalResizeBuffersAddress = 0;
 	uintptr_t originalExecuteCommandListsAddress = 0;
@@ -21,8 +26,14 @@ public:
 	void Hook();
 	void DrawExampleTriangle(bool doDraw);
 	void SetRenderCallback(IRenderCallback* object);
+	void AddRenderCallback(IRenderCallback* object, int priority = 0, unsigned int budgetMicros = 0);
+	void SetOverlayFrameBudget(unsigned int budgetMicros);
+	void SetFrameRateLimit(double fps, bool lowLatency = false);
+	void ApplyFrameLimitConfig();
 private:
 	Logger m_logger{ "DirectXHook" };
+	ConfigStore m_frameLimitConfig{ "hook_frame_limit.cfg" }; // fps = 60, low_latency = true
+	uint64_t m_frameLimitConfigVersion = UINT64_MAX;
 	IDXGISwapChain* m_dummySwapChain = nullptr;
 	ID3D12CommandQueue* m_dummyCommandQueue = nullptr;
 	std::vector<std::vector<unsigned char>> m_functionHeaders;
@@ -56,8 +67,13 @@ typedef void(__stdcall* ExecuteCommandLists)(ID3D12CommandQueue* This, UINT NumC
 */
 inline HRESULT __stdcall OnPresent(IDXGISwapChain* pThis, UINT syncInterval, UINT flags)
 {
+	TRACE_SCOPE("Present hook");
 	hookInstance->renderer.OnPresent(pThis, syncInterval, flags);
-	return ((Present)hookInstance->originalPresentAddress)(pThis, syncInterval, flags);
+	hookInstance->ApplyFrameLimitConfig();
+	hookInstance->framePacer.BeforePresent();
+	HRESULT result = ((Present)hookInstance->originalPresentAddress)(pThis, syncInterval, flags);
+	hookInstance->framePacer.AfterPresent();
+	return result;
 }
 
 /*
@@ -69,6 +85,7 @@ inline HRESULT __stdcall OnPresent(IDXGISwapChain* pThis, UINT syncInterval, UIN
 */
 inline HRESULT __stdcall OnResizeBuffers(IDXGISwapChain* pThis, UINT bufferCount, UINT width, UINT height, DXGI_FORMAT newFormat, UINT swapChainFlags)
 {
+	TRACE_SCOPE("ResizeBuffers hook");
 	hookInstance->renderer.OnResizeBuffers(pThis, bufferCount, width, height, newFormat, swapChainFlags);
 	return ((ResizeBuffers)hookInstance->originalResizeBuffersAddress)(pThis, bufferCount, width, height, newFormat, swapChainFlags);
 }
@@ -80,6 +97,7 @@ inline HRESULT __stdcall OnResizeBuffers(IDXGISwapChain* pThis, UINT bufferCount
 */
 inline void __stdcall OnExecuteCommandLists(ID3D12CommandQueue* pThis, UINT numCommandLists, const ID3D12CommandList** ppCommandLists)
 {
+	TRACE_SCOPE("ExecuteCommandLists hook");
 	if (hookInstance->renderer.missingCommandQueue && pThis->GetDesc().Type == D3D12_COMMAND_LIST_TYPE_DIRECT)
 	{
 		hookInstance->renderer.SetCommandQueue(pThis);
@@ -58,6 +58,22 @@ DWORD WINAPI HookThread(LPVOID lpParam)
 		terminalEnableFile.close();
 	}
 
+	std::fstream traceEnableFile;
+	traceEnableFile.open("hook_enable_trace.txt", std::fstream::in);
+	if (traceEnableFile.is_open())
+	{
+		Trace::Instance().Enable(true);
+		traceEnableFile.close();
+	}
+
+	std::fstream profilerEnableFile;
+	profilerEnableFile.open("hook_enable_profiler.txt", std::fstream::in);
+	if (profilerEnableFile.is_open())
+	{
+		Profiler::Instance().Enable(true);
+		profilerEnableFile.close();
+	}
+
 	static DirectXHook dxHook;
 	dxHook.Hook();
 	return S_OK;
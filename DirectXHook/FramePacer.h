@@ -0,0 +1,320 @@
+#pragma once
+
+#include <Windows.h>
+#include <intrin.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include "HdrHistogram.h"
+#include "Logger.h"
+#include "Trace.h"
+
+/*
+* Waits until a deadline with a coarse sleep followed by a spin.
+* Timer wakeups are late by a varying amount, so the sleep ends a margin before the deadline and the rest is spun.
+* The margin follows the worst recent oversleep: it grows at once when a wakeup is late and shrinks slowly afterwards.
+* Tests pass their own clock and sleep.
+*/
+class HybridWaiter
+{
+public:
+	static constexpr double MinSpinMicros = 50;
+	static constexpr double MaxSpinMicros = 4000;
+
+	typedef uint64_t(*Clock)(); // monotonic QueryPerformanceCounter ticks
+	typedef void(*SleepFunction)(double micros); // null sleeps on a waitable timer
+
+	static uint64_t PerformanceCounterTicks()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return (uint64_t)counter.QuadPart;
+	}
+
+	HybridWaiter(Clock clock = &PerformanceCounterTicks, SleepFunction sleep = nullptr)
+	{
+		m_clock = clock;
+		m_sleep = sleep;
+
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		m_ticksPerMicro = (double)frequency.QuadPart / 1000000.0;
+		if (m_sleep != nullptr)
+		{
+			return;
+		}
+
+		// Without a high resolution timer waits are rounded up to the scheduler tick.
+		m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (m_timer == nullptr)
+		{
+			m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+			m_oversleepPeakMicros = 2000;
+		}
+	}
+
+	HybridWaiter(const HybridWaiter&) = delete;
+	HybridWaiter& operator=(const HybridWaiter&) = delete;
+
+	~HybridWaiter()
+	{
+		if (m_timer != nullptr)
+		{
+			CloseHandle(m_timer);
+		}
+	}
+
+	uint64_t Now() const
+	{
+		return m_clock();
+	}
+
+	double TicksPerMicro() const
+	{
+		return m_ticksPerMicro;
+	}
+
+	// Deadline in QueryPerformanceCounter ticks
+	void WaitUntil(uint64_t deadline)
+	{
+		uint64_t now = Now();
+		if (now >= deadline)
+		{
+			return;
+		}
+
+		double remainingMicros = (deadline - now) / m_ticksPerMicro;
+		double spinMicros = SpinMicros();
+		if (remainingMicros > spinMicros)
+		{
+			double sleepMicros = remainingMicros - spinMicros;
+			Sleep(sleepMicros);
+
+			uint64_t woke = Now();
+			double oversleepMicros = (woke - now) / m_ticksPerMicro - sleepMicros;
+			m_oversleepPeakMicros = std::max(oversleepMicros, m_oversleepPeakMicros * PeakDecay);
+			if (woke > deadline)
+			{
+				m_lateWakes++;
+			}
+		}
+
+		while (Now() < deadline)
+		{
+			_mm_pause();
+		}
+	}
+
+	// How early the sleep ends, the rest of a wait is spun
+	double SpinMicros() const
+	{
+		return std::clamp(m_oversleepPeakMicros * 1.25 + MinSpinMicros, MinSpinMicros, MaxSpinMicros);
+	}
+
+	// Sleeps that woke up after the deadline
+	uint64_t LateWakes() const
+	{
+		return m_lateWakes;
+	}
+
+private:
+	static constexpr double PeakDecay = 0.99; // per sleep
+
+	Clock m_clock = nullptr;
+	SleepFunction m_sleep = nullptr;
+	HANDLE m_timer = nullptr;
+	double m_ticksPerMicro = 1;
+	double m_oversleepPeakMicros = 200;
+	uint64_t m_lateWakes = 0;
+
+	void Sleep(double micros)
+	{
+		if (m_sleep != nullptr)
+		{
+			m_sleep(micros);
+			return;
+		}
+
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(LONGLONG)(micros * 10); // relative, in 100 ns units
+		if (m_timer != nullptr && SetWaitableTimer(m_timer, &dueTime, 0, nullptr, nullptr, FALSE))
+		{
+			WaitForSingleObject(m_timer, INFINITE);
+		}
+		else
+		{
+			::Sleep((DWORD)(micros / 1000));
+		}
+	}
+};
+
+/*
+* Optional frame rate cap around the game's Present call.
+*
+* By default the wait comes before Present and ends the measured duration of Present early,
+* so Present returns on the frame boundary. In low latency mode Present goes out as soon as the frame is done
+* and the wait comes after it instead, which delays the start of the next frame: the game reads input and simulates
+* later, closer to when its frame is shown.
+*
+* The frame boundary is when AfterPresent() returns, frame times are measured between boundaries.
+* Settings can be changed from any thread, everything else runs on the present thread.
+*/
+class FramePacer
+{
+public:
+	struct Stats
+	{
+		double targetMicros = 0; // 0 = uncapped
+		double meanMicros = 0;
+		double stdDevMicros = 0;
+		double p99Micros = 0;
+		double maxMicros = 0;
+		double presentMicros = 0; // smoothed duration of the original Present
+		double spinMicros = 0;
+		uint64_t frames = 0;
+		uint64_t missedFrames = 0; // frames that ended later than their boundary plus half an interval
+	};
+
+	static constexpr uint64_t StatsWindowMillis = 2000;
+
+	FramePacer(HybridWaiter::Clock clock = &HybridWaiter::PerformanceCounterTicks, HybridWaiter::SleepFunction sleep = nullptr)
+		: m_waiter(clock, sleep)
+	{
+		m_microsPerTick = 1.0 / m_waiter.TicksPerMicro();
+	}
+
+	// 0 removes the cap
+	void SetTargetFps(double fps)
+	{
+		uint64_t interval = fps > 0 ? (uint64_t)(m_waiter.TicksPerMicro() * 1000000.0 / fps) : 0;
+		m_intervalTicks.store(interval, std::memory_order_relaxed);
+	}
+
+	void SetLowLatency(bool lowLatency)
+	{
+		m_lowLatency.store(lowLatency, std::memory_order_relaxed);
+	}
+
+	// Right before the original Present
+	void BeforePresent()
+	{
+		uint64_t interval = m_intervalTicks.load(std::memory_order_relaxed);
+		if (interval != 0 && m_nextBoundary != 0 && !m_lowLatency.load(std::memory_order_relaxed))
+		{
+			TRACE_SCOPE("FramePacer::Wait");
+			uint64_t lead = std::min((uint64_t)m_presentTicks, interval / 2);
+			m_waiter.WaitUntil(m_nextBoundary - lead);
+		}
+		m_presentStart = m_waiter.Now();
+	}
+
+	// Right after the original Present returned
+	void AfterPresent()
+	{
+		uint64_t now = m_waiter.Now();
+		double presentTicks = (double)(now - m_presentStart);
+		m_presentTicks = m_presentTicks == 0 ? presentTicks : m_presentTicks + (presentTicks - m_presentTicks) * PresentSmoothing;
+
+		uint64_t interval = m_intervalTicks.load(std::memory_order_relaxed);
+		if (interval == 0)
+		{
+			m_nextBoundary = 0;
+		}
+		else
+		{
+			if (m_nextBoundary != 0 && m_lowLatency.load(std::memory_order_relaxed))
+			{
+				TRACE_SCOPE("FramePacer::Wait");
+				m_waiter.WaitUntil(m_nextBoundary);
+				now = m_waiter.Now();
+			}
+
+			if (m_nextBoundary != 0 && now > m_nextBoundary + interval / 2)
+			{
+				m_window.missedFrames++;
+			}
+
+			// Boundaries stay on a fixed grid unless a frame fell more than one interval behind.
+			m_nextBoundary = m_nextBoundary == 0 || now > m_nextBoundary + interval ? now + interval : m_nextBoundary + interval;
+		}
+
+		RecordFrame(now, interval);
+	}
+
+	// The last completed statistics window
+	const Stats& LastStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	static constexpr double PresentSmoothing = 0.1;
+
+	struct Window
+	{
+		uint64_t start = 0;
+		uint64_t frames = 0;
+		uint64_t missedFrames = 0;
+		double sum = 0;
+		double sumOfSquares = 0;
+	};
+
+	Logger m_logger{ "FramePacer" };
+	HybridWaiter m_waiter;
+	std::atomic<uint64_t> m_intervalTicks{ 0 };
+	std::atomic<bool> m_lowLatency{ false };
+	double m_microsPerTick = 1;
+	uint64_t m_nextBoundary = 0;
+	uint64_t m_presentStart = 0;
+	double m_presentTicks = 0;
+	uint64_t m_lastBoundary = 0;
+	Window m_window;
+	HdrHistogram m_frameTimes; // microseconds, current window
+	Stats m_stats;
+
+	void RecordFrame(uint64_t now, uint64_t interval)
+	{
+		if (m_lastBoundary != 0)
+		{
+			double frameMicros = (now - m_lastBoundary) * m_microsPerTick;
+			m_frameTimes.Record((uint64_t)frameMicros);
+			m_window.frames++;
+			m_window.sum += frameMicros;
+			m_window.sumOfSquares += frameMicros * frameMicros;
+			TRACE_COUNTER("Frame time (us)", frameMicros);
+		}
+		else
+		{
+			m_window.start = now;
+		}
+		m_lastBoundary = now;
+
+		if ((now - m_window.start) * m_microsPerTick < StatsWindowMillis * 1000.0 || m_window.frames == 0)
+		{
+			return;
+		}
+
+		double mean = m_window.sum / m_window.frames;
+		m_stats.targetMicros = interval * m_microsPerTick;
+		m_stats.meanMicros = mean;
+		m_stats.stdDevMicros = std::sqrt(std::max(0.0, m_window.sumOfSquares / m_window.frames - mean * mean));
+		m_stats.p99Micros = (double)m_frameTimes.ValueAtPercentile(99);
+		m_stats.maxMicros = (double)m_frameTimes.Max();
+		m_stats.presentMicros = m_presentTicks * m_microsPerTick;
+		m_stats.spinMicros = m_waiter.SpinMicros();
+		m_stats.frames = m_window.frames;
+		m_stats.missedFrames = m_window.missedFrames;
+
+		if (interval != 0)
+		{
+			LOG_DEBUG(m_logger, Render, "Frame time %.0f us (target %.0f), std dev %.0f us, 99th %.0f us, missed %llu of %llu",
+				m_stats.meanMicros, m_stats.targetMicros, m_stats.stdDevMicros, m_stats.p99Micros, m_stats.missedFrames, m_stats.frames);
+		}
+
+		m_frameTimes.Reset();
+		m_window = Window();
+		m_window.start = now;
+	}
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+* Histogram over the whole uint64_t range with a fixed relative precision (HDR histogram style).
+* Values below 128 get their own bucket, above that every power of two is split into 64 linear buckets,
+* so any recorded value is off by less than 1/64 (about 1.6%). Recording is O(1), memory is fixed at about 30 KB.
+*/
+class HdrHistogram
+{
+public:
+	HdrHistogram()
+	{
+		m_counts.resize((size_t)NumBuckets, 0);
+	}
+
+	void Record(uint64_t value, uint64_t count = 1)
+	{
+		m_counts[BucketOf(value)] += count;
+		if (m_totalCount == 0 || value < m_min)
+		{
+			m_min = value;
+		}
+		if (value > m_max)
+		{
+			m_max = value;
+		}
+		m_totalCount += count;
+		m_sum += (double)value * count;
+	}
+
+	void Reset()
+	{
+		std::fill(m_counts.begin(), m_counts.end(), 0);
+		m_totalCount = 0;
+		m_min = 0;
+		m_max = 0;
+		m_sum = 0;
+	}
+
+	uint64_t Count() const
+	{
+		return m_totalCount;
+	}
+
+	uint64_t Min() const
+	{
+		return m_min;
+	}
+
+	uint64_t Max() const
+	{
+		return m_max;
+	}
+
+	double Mean() const
+	{
+		return m_totalCount != 0 ? m_sum / m_totalCount : 0;
+	}
+
+	// The value below which the given percentage (0-100) of recorded values fall, within the histogram's precision.
+	uint64_t ValueAtPercentile(double percentile) const
+	{
+		if (m_totalCount == 0)
+		{
+			return 0;
+		}
+
+		uint64_t target = (uint64_t)(percentile / 100.0 * m_totalCount + 0.5);
+		if (target < 1)
+		{
+			target = 1;
+		}
+
+		uint64_t seen = 0;
+		for (int bucket = 0; bucket < NumBuckets; bucket++)
+		{
+			seen += m_counts[bucket];
+			if (seen >= target)
+			{
+				// The highest value the bucket stands for, but never past what was actually recorded
+				uint64_t value = HighestValueOf(bucket);
+				return value < m_max ? value : m_max;
+			}
+		}
+		return m_max;
+	}
+
+private:
+	static constexpr int SubBucketBits = 6;
+	static constexpr int NumLinear = 2 << SubBucketBits; // 128 values with their own bucket
+	static constexpr int SubBuckets = 1 << SubBucketBits;
+	static constexpr int NumBuckets = NumLinear + (64 - SubBucketBits - 1) * SubBuckets;
+
+	std::vector<uint64_t> m_counts;
+	uint64_t m_totalCount = 0;
+	uint64_t m_min = 0;
+	uint64_t m_max = 0;
+	double m_sum = 0;
+
+	static int HighestBit(uint64_t value)
+	{
+		int bit = 0;
+		while (value >>= 1)
+		{
+			bit++;
+		}
+		return bit;
+	}
+
+	static int BucketOf(uint64_t value)
+	{
+		if (value < NumLinear)
+		{
+			return (int)value;
+		}
+
+		int shift = HighestBit(value) - SubBucketBits;
+		int subBucket = (int)(value >> shift) - SubBuckets;
+		return NumLinear + (shift - 1) * SubBuckets + subBucket;
+	}
+
+	static uint64_t HighestValueOf(int bucket)
+	{
+		if (bucket < NumLinear)
+		{
+			return (uint64_t)bucket;
+		}
+
+		int shift = (bucket - NumLinear) / SubBuckets + 1;
+		uint64_t subBucket = (uint64_t)((bucket - NumLinear) % SubBuckets + SubBuckets);
+		return ((subBucket + 1) << shift) - 1;
+	}
+};
@@ -5,11 +5,22 @@
 #include <SpriteBatch.h>
 #include <SpriteFont.h>
 
+#include "OverlayTask.h"
+
 class IRenderCallback
 {
 public:
 	virtual void Setup() { };
+	// Runs every frame. On frames a decimated overlay's cached image is shown, its draw calls are skipped (OF::SkipDrawing).
 	virtual void Render() = 0;
+	// Runs on the update thread every m_updateInterval milliseconds, after Setup() has finished.
+	// Must not draw or touch boxes, publish results for Render() through a TripleBuffer instead.
+	virtual void Update() { };
+	// With m_parallelPrepare set, runs on the job system every frame the overlay draws, before any overlay draws.
+	// Overlays prepare concurrently with each other and the present thread: prepare data for Render() here,
+	// using JobSystem::Instance() for more jobs if needed (jobs started from Update() just run inline),
+	// but don't draw or touch the device context.
+	virtual void Prepare() { };
 	void Init(
 		Microsoft::WRL::ComPtr<ID3D11Device> device,
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
@@ -22,9 +33,34 @@ public:
 		m_window = window;
 	}
 
+	unsigned int UpdateInterval() const
+	{
+		return m_updateInterval;
+	}
+
+	bool ParallelPrepare() const
+	{
+		return m_parallelPrepare;
+	}
+
+	// Called by the renderer right after Render(), drawing is skipped or not just like for Render().
+	void ResumeTasks()
+	{
+		m_tasks.Resume();
+	}
+
 protected:
 	Microsoft::WRL::ComPtr<ID3D11Device> m_device = nullptr;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_context = nullptr;
 	std::shared_ptr<DirectX::SpriteBatch> m_spriteBatch = nullptr;
 	HWND m_window;
+	unsigned int m_updateInterval = 0; // Update() is never called when this is 0
+	bool m_parallelPrepare = false; // Prepare() is never called when this is false
+	TaskScheduler m_tasks;
+
+	// Tasks resume every frame after Render(), see OverlayTask.h
+	void StartTask(OverlayTask task)
+	{
+		m_tasks.Start(std::move(task));
+	}
 };
\ No newline at end of file
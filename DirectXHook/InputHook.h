@@ -0,0 +1,308 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+
+#include "InputQueue.h"
+#include "PresentGate.h"
+#include "Logger.h"
+
+/*
+* Subclasses the game window's message procedure so keyboard and mouse input arrive as events
+* instead of being polled every frame with GetAsyncKeyState/GetCursorPos.
+* The window procedure (game window thread) pushes events into a lock-free queue,
+* the render thread drains it once per frame in ProcessEvents().
+* There is only one instance for the whole DLL so every overlay sees the same key state.
+*/
+class InputHook
+{
+public:
+	static InputHook& Instance()
+	{
+		static InputHook instance;
+		return instance;
+	}
+
+	// Called by the renderer whenever it (re)initializes with the game window.
+	// The window's original procedure is stored in a window property before the swap, so messages that arrive
+	// on the window thread while this runs always find something to forward to.
+	void Install(HWND window)
+	{
+		if (window == m_window.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		Uninstall();
+
+		bool unicode = IsWindowUnicode(window);
+		m_focused = GetForegroundWindow() == window;
+
+		// Only the render thread touches the key state, so the starting cursor position can go straight in.
+		POINT cursorPos;
+		GetCursorPos(&cursorPos);
+		ScreenToClient(window, &cursorPos);
+		m_keys.Apply({ InputEventType::MouseMove, 0, (int16_t)cursorPos.x, (int16_t)cursorPos.y });
+
+		LONG_PTR original = unicode ? GetWindowLongPtrW(window, GWLP_WNDPROC) : GetWindowLongPtrA(window, GWLP_WNDPROC);
+		if (original == 0 || !SetPropA(window, OriginalProcProperty, (HANDLE)original))
+		{
+			m_logger.Log("Failed to read the window procedure: %lu", GetLastError());
+			return;
+		}
+
+		m_window.store(window, std::memory_order_release);
+		LONG_PTR previous = unicode
+			? SetWindowLongPtrW(window, GWLP_WNDPROC, (LONG_PTR)&InputHook::WndProc)
+			: SetWindowLongPtrA(window, GWLP_WNDPROC, (LONG_PTR)&InputHook::WndProc);
+
+		if (previous == 0)
+		{
+			m_logger.Log("Failed to subclass the window procedure: %lu", GetLastError());
+			m_window.store(0, std::memory_order_release);
+			RemovePropA(window, OriginalProcProperty);
+			return;
+		}
+
+		// Someone else subclassed the window between the read and the swap, theirs is the one to call.
+		if (previous != original)
+		{
+			SetPropA(window, OriginalProcProperty, (HANDLE)previous);
+		}
+
+		m_logger.Log("Subclassed window procedure of %p", window);
+	}
+
+	// Restores the original procedure if ours is still the window's procedure. If another hook (Steam, RTSS ...)
+	// subclassed the window after us, restoring would cut it out of the chain, so ours stays and only forwards.
+	void Uninstall()
+	{
+		HWND window = m_window.exchange(0, std::memory_order_acq_rel);
+		if (window == 0)
+		{
+			return;
+		}
+
+		bool unicode = IsWindowUnicode(window);
+		LONG_PTR current = unicode ? GetWindowLongPtrW(window, GWLP_WNDPROC) : GetWindowLongPtrA(window, GWLP_WNDPROC);
+		if (current != (LONG_PTR)&InputHook::WndProc)
+		{
+			m_logger.Log("The window procedure of %p was subclassed after us, leaving ours in the chain", window);
+			return;
+		}
+
+		LONG_PTR original = (LONG_PTR)GetPropA(window, OriginalProcProperty);
+		if (unicode)
+		{
+			SetWindowLongPtrW(window, GWLP_WNDPROC, original);
+		}
+		else
+		{
+			SetWindowLongPtrA(window, GWLP_WNDPROC, original);
+		}
+		RemovePropA(window, OriginalProcProperty);
+	}
+
+	// Starts a new input frame and applies every event received since the last call.
+	// Must only be called from the render thread.
+	void ProcessEvents()
+	{
+		m_keys.BeginFrame();
+
+		InputEvent event;
+		while (m_queue.Pop(&event))
+		{
+			m_keys.Apply(event);
+		}
+
+		// Events were dropped, the key state can't be trusted so rebuild it from the async key state.
+		if (m_overflow.exchange(false, std::memory_order_acquire))
+		{
+			m_logger.Log("Input queue overflowed, resynchronizing key state");
+			for (int key = 1; key < 256; key++)
+			{
+				bool down = GetAsyncKeyState(key) & 0x8000;
+				m_keys.Apply({ down ? InputEventType::KeyDown : InputEventType::KeyUp, (uint8_t)key });
+			}
+		}
+	}
+
+	const KeyState& Keys() const
+	{
+		return m_keys;
+	}
+
+	bool HasFocus() const
+	{
+		return m_focused.load(std::memory_order_relaxed);
+	}
+
+	// When captured, keyboard and/or mouse button messages are not forwarded to the game.
+	void SetCapture(bool keyboard, bool mouse)
+	{
+		m_captureKeyboard.store(keyboard, std::memory_order_relaxed);
+		m_captureMouse.store(mouse, std::memory_order_relaxed);
+	}
+
+	typedef void(*WindowDestroyedCallback)(void* context);
+
+	// Called on the window thread when the game destroys its window, the last chance to stop our threads
+	// while the game is shutting down normally (not under the loader lock). Set it before Install().
+	void OnWindowDestroyed(WindowDestroyedCallback callback, void* context)
+	{
+		m_windowDestroyed = callback;
+		m_windowDestroyedContext = context;
+	}
+
+private:
+	static constexpr const char* OriginalProcProperty = "DirectXHook.OriginalWndProc";
+
+	Logger m_logger{ "InputHook" };
+	std::atomic<HWND> m_window{ 0 }; // the window whose messages become events
+	SpscQueue<InputEvent, 1024> m_queue;
+	std::atomic<bool> m_overflow{ false };
+	std::atomic<bool> m_focused{ false };
+	std::atomic<bool> m_captureKeyboard{ false };
+	std::atomic<bool> m_captureMouse{ false };
+	KeyState m_keys;
+	WindowDestroyedCallback m_windowDestroyed = nullptr;
+	void* m_windowDestroyedContext = nullptr;
+
+	InputHook() { }
+
+	void Push(InputEvent event)
+	{
+		if (!m_queue.Push(event))
+		{
+			m_overflow.store(true, std::memory_order_release);
+		}
+	}
+
+	// Keyboard messages only report the generic VK_SHIFT/VK_CONTROL/VK_MENU,
+	// so the left/right specific key is pushed as well.
+	void PushKeyEvent(InputEventType type, WPARAM wParam, LPARAM lParam)
+	{
+		uint8_t key = (uint8_t)wParam;
+		uint8_t sideKey = 0;
+		bool extended = (lParam >> 24) & 1;
+
+		switch (key)
+		{
+		case VK_SHIFT:
+			sideKey = (uint8_t)MapVirtualKey((lParam >> 16) & 0xFF, MAPVK_VSC_TO_VK_EX);
+			break;
+		case VK_CONTROL:
+			sideKey = extended ? VK_RCONTROL : VK_LCONTROL;
+			break;
+		case VK_MENU:
+			sideKey = extended ? VK_RMENU : VK_LMENU;
+			break;
+		}
+
+		Push({ type, key });
+		if (sideKey != 0)
+		{
+			Push({ type, sideKey });
+		}
+	}
+
+	void PushMouseButton(InputEventType type, uint8_t button, LPARAM lParam)
+	{
+		Push({ InputEventType::MouseMove, 0, (int16_t)LOWORD(lParam), (int16_t)HIWORD(lParam) });
+		Push({ type, button });
+	}
+
+	// Also called for a window we were uninstalled from but couldn't unhook, it then only forwards.
+	static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		InputHook& hook = Instance();
+		WNDPROC original = (WNDPROC)GetPropA(hWnd, OriginalProcProperty);
+		bool unicode = IsWindowUnicode(hWnd);
+		if (hWnd != hook.m_window.load(std::memory_order_acquire))
+		{
+			return Forward(original, unicode, hWnd, msg, wParam, lParam);
+		}
+
+		bool swallow = false;
+
+		switch (msg)
+		{
+		case WM_KEYDOWN:
+		case WM_SYSKEYDOWN:
+			hook.PushKeyEvent(InputEventType::KeyDown, wParam, lParam);
+			if (!((lParam >> 30) & 1)) // not an auto repeat
+			{
+				PresentGate::Instance().OnKeyDown((uint8_t)wParam);
+			}
+			swallow = hook.m_captureKeyboard.load(std::memory_order_relaxed);
+			break;
+		case WM_KEYUP:
+		case WM_SYSKEYUP:
+			hook.PushKeyEvent(InputEventType::KeyUp, wParam, lParam);
+			swallow = hook.m_captureKeyboard.load(std::memory_order_relaxed);
+			break;
+		case WM_MOUSEMOVE:
+			hook.Push({ InputEventType::MouseMove, 0, (int16_t)LOWORD(lParam), (int16_t)HIWORD(lParam) });
+			break;
+		case WM_LBUTTONDOWN:
+		case WM_LBUTTONDBLCLK:
+			hook.PushMouseButton(InputEventType::KeyDown, VK_LBUTTON, lParam);
+			swallow = hook.m_captureMouse.load(std::memory_order_relaxed);
+			break;
+		case WM_LBUTTONUP:
+			hook.PushMouseButton(InputEventType::KeyUp, VK_LBUTTON, lParam);
+			swallow = hook.m_captureMouse.load(std::memory_order_relaxed);
+			break;
+		case WM_RBUTTONDOWN:
+		case WM_RBUTTONDBLCLK:
+			hook.PushMouseButton(InputEventType::KeyDown, VK_RBUTTON, lParam);
+			swallow = hook.m_captureMouse.load(std::memory_order_relaxed);
+			break;
+		case WM_RBUTTONUP:
+			hook.PushMouseButton(InputEventType::KeyUp, VK_RBUTTON, lParam);
+			swallow = hook.m_captureMouse.load(std::memory_order_relaxed);
+			break;
+		case WM_MBUTTONDOWN:
+		case WM_MBUTTONDBLCLK:
+			hook.PushMouseButton(InputEventType::KeyDown, VK_MBUTTON, lParam);
+			swallow = hook.m_captureMouse.load(std::memory_order_relaxed);
+			break;
+		case WM_MBUTTONUP:
+			hook.PushMouseButton(InputEventType::KeyUp, VK_MBUTTON, lParam);
+			swallow = hook.m_captureMouse.load(std::memory_order_relaxed);
+			break;
+		case WM_MOUSEWHEEL:
+			swallow = hook.m_captureMouse.load(std::memory_order_relaxed);
+			break;
+		case WM_SETFOCUS:
+			hook.m_focused.store(true, std::memory_order_relaxed);
+			break;
+		case WM_KILLFOCUS:
+			hook.m_focused.store(false, std::memory_order_relaxed);
+			hook.Push({ InputEventType::FocusLost });
+			break;
+		case WM_DESTROY:
+			if (hook.m_windowDestroyed != nullptr)
+			{
+				hook.m_windowDestroyed(hook.m_windowDestroyedContext);
+			}
+			break;
+		}
+
+		if (swallow)
+		{
+			return 0;
+		}
+
+		return Forward(original, unicode, hWnd, msg, wParam, lParam);
+	}
+
+	static LRESULT Forward(WNDPROC original, bool unicode, HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		if (original == nullptr)
+		{
+			return unicode ? DefWindowProcW(hWnd, msg, wParam, lParam) : DefWindowProcA(hWnd, msg, wParam, lParam);
+		}
+		return unicode ? CallWindowProcW(original, hWnd, msg, wParam, lParam) : CallWindowProcA(original, hWnd, msg, wParam, lParam);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Input events are produced by the subclassed window procedure (the game's window thread)
+* and consumed by the render thread once per frame.
+* This file has no Windows dependencies so the queue and the edge detection can be driven by any event source.
+*/
+
+enum class InputEventType : uint8_t
+{
+	KeyDown,
+	KeyUp,
+	MouseMove,
+	FocusLost
+};
+
+struct InputEvent
+{
+	InputEventType type = InputEventType::KeyDown;
+	uint8_t key = 0;
+	int16_t x = 0;
+	int16_t y = 0;
+};
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity must be a power of two.
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	bool Push(const T& item)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_cachedTail == Capacity)
+		{
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head - m_cachedTail == Capacity)
+			{
+				return false;
+			}
+		}
+
+		m_items[head & (Capacity - 1)] = item;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(T* item)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_cachedHead)
+		{
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail == m_cachedHead)
+			{
+				return false;
+			}
+		}
+
+		*item = m_items[tail & (Capacity - 1)];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Empty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+private:
+	// Producer and consumer indices live on separate cache lines so the two threads don't fight over them.
+	alignas(64) std::atomic<size_t> m_head{ 0 };
+	size_t m_cachedTail = 0;
+	alignas(64) std::atomic<size_t> m_tail{ 0 };
+	size_t m_cachedHead = 0;
+	alignas(64) T m_items[Capacity];
+};
+
+// 256-bit key set, one bit per virtual key code.
+struct KeyMask
+{
+	uint64_t words[4] = { 0, 0, 0, 0 };
+
+	bool Test(uint8_t key) const
+	{
+		return (words[key >> 6] >> (key & 63)) & 1;
+	}
+
+	void Set(uint8_t key)
+	{
+		words[key >> 6] |= (uint64_t)1 << (key & 63);
+	}
+
+	void Clear(uint8_t key)
+	{
+		words[key >> 6] &= ~((uint64_t)1 << (key & 63));
+	}
+
+	void Reset()
+	{
+		words[0] = words[1] = words[2] = words[3] = 0;
+	}
+};
+
+/*
+* Keeps the current key state plus the keys that went down or up during the last frame.
+* Events are applied as they are drained from the queue, BeginFrame() starts a new frame.
+* A key that is pressed and released within the same frame shows up in both edge masks,
+* so presses shorter than a frame are never lost.
+*/
+class KeyState
+{
+public:
+	void BeginFrame()
+	{
+		m_pressed.Reset();
+		m_released.Reset();
+	}
+
+	void Apply(const InputEvent& event)
+	{
+		switch (event.type)
+		{
+		case InputEventType::KeyDown:
+			if (!m_down.Test(event.key))
+			{
+				m_down.Set(event.key);
+				m_pressed.Set(event.key);
+			}
+			break;
+		case InputEventType::KeyUp:
+			if (m_down.Test(event.key))
+			{
+				m_down.Clear(event.key);
+				m_released.Set(event.key);
+			}
+			break;
+		case InputEventType::MouseMove:
+			m_mouseX = event.x;
+			m_mouseY = event.y;
+			break;
+		case InputEventType::FocusLost:
+			ReleaseAll();
+			break;
+		}
+	}
+
+	void ReleaseAll()
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			m_released.words[i] |= m_down.words[i];
+		}
+		m_down.Reset();
+	}
+
+	bool IsDown(uint8_t key) const { return m_down.Test(key); }
+	bool WasPressed(uint8_t key) const { return m_pressed.Test(key); }
+	bool WasReleased(uint8_t key) const { return m_released.Test(key); }
+	int MouseX() const { return m_mouseX; }
+	int MouseY() const { return m_mouseY; }
+
+private:
+	KeyMask m_down;
+	KeyMask m_pressed;
+	KeyMask m_released;
+	int m_mouseX = 0;
+	int m_mouseY = 0;
+};
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <Windows.h>
+#include <intrin.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// Counts the unfinished jobs of a fork/join group. Must outlive its jobs.
+class JobCounter
+{
+public:
+	JobCounter() { }
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const
+	{
+		return m_pending.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+	std::atomic<int> m_pending{ 0 };
+};
+
+/*
+* Small work-stealing job system for work the present thread would otherwise do alone.
+* Every worker owns a Chase-Lev deque: the owner pushes and pops at the bottom, idle workers steal from the top.
+* The present thread owns one as well once it called RegisterThread(), it starts jobs and helps running them while it waits.
+*
+*	JobCounter counter;
+*	jobs.Run(counter, [&] { FormatLines(0, 32); });
+*	jobs.Run(counter, [&] { FormatLines(32, 64); });
+*	jobs.Wait(counter);
+*
+* A job's callable is copied into the job, it must be trivially copyable and at most Job::StorageSize bytes
+* (a lambda capturing a few references or pointers). Jobs are started from the registered thread or from inside jobs,
+* any other thread (the update thread, watchers ...) runs its jobs inline.
+*
+* Idle workers sleep at below normal priority and can be kept to some cores, both so they stay out of the game's way.
+* A worker runs a job at the priority of the thread that started it, so a job the present thread waits for
+* isn't starved by the game's own threads.
+* hook_jobs.cfg sets the worker count and a core mask, for example:
+*
+*	workers = 3
+*	affinity = 0xF0
+*/
+class JobSystem
+{
+public:
+	static constexpr int MaxWorkers = 16;
+	static constexpr int64_t QueueCapacity = 1024; // per thread, a power of two
+	static constexpr int SpinsBeforeSleep = 2000;
+	static constexpr int SpinsBeforeYield = 64; // in Wait(), while the jobs left run on other threads
+
+	struct Job
+	{
+		static constexpr size_t StorageSize = 48;
+
+		void(*invoke)(void* storage) = nullptr;
+		JobCounter* counter = nullptr;
+		int priority = THREAD_PRIORITY_NORMAL; // of the thread that started it
+		std::atomic<bool> inFlight{ false };
+		alignas(std::max_align_t) unsigned char storage[StorageSize];
+	};
+
+	static JobSystem& Instance()
+	{
+		static JobSystem jobSystem(ConfiguredWorkers(), ConfiguredAffinity());
+		return jobSystem;
+	}
+
+	// 0 workers runs every job on the thread that waits for it.
+	JobSystem(int numWorkers, uint64_t affinityMask = 0)
+	{
+		numWorkers = std::clamp(numWorkers, 0, MaxWorkers);
+		m_numQueues = numWorkers + 1;
+		m_threads.reset(new ThreadState[m_numQueues]);
+
+		m_wake = CreateSemaphoreA(nullptr, 0, MaxWorkers, nullptr);
+		if (m_wake == nullptr)
+		{
+			m_logger.Log("Failed to create the wake semaphore, workers will not sleep: %lu", GetLastError());
+		}
+
+		for (int i = 1; i <= numWorkers; i++)
+		{
+			m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+			HANDLE thread = (HANDLE)m_workers.back().native_handle();
+			SetThreadPriority(thread, IdlePriority);
+			if (affinityMask != 0 && SetThreadAffinityMask(thread, (DWORD_PTR)affinityMask) == 0)
+			{
+				m_logger.Log("Could not set the affinity of worker %i to 0x%llx", i, (unsigned long long)affinityMask);
+			}
+		}
+
+		m_logger.Log("Started %i job worker(s)", numWorkers);
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	~JobSystem()
+	{
+		m_running.store(false);
+		if (m_wake != nullptr)
+		{
+			ReleaseSemaphore(m_wake, (LONG)m_workers.size(), nullptr);
+		}
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+		if (m_wake != nullptr)
+		{
+			CloseHandle(m_wake);
+		}
+	}
+
+	int NumWorkers() const
+	{
+		return m_numQueues - 1;
+	}
+
+	// Gives the calling thread the one queue that isn't a worker's. The renderer registers the present thread.
+	// Only one thread can be registered, false for any other.
+	bool RegisterThread()
+	{
+		if (ThreadIndexSlot() == 0)
+		{
+			return true;
+		}
+
+		DWORD self = GetCurrentThreadId();
+		DWORD expected = 0;
+		if (ThreadIndexSlot() > 0 || !m_registeredThread.compare_exchange_strong(expected, self))
+		{
+			m_logger.Log("Thread %lu can't be registered, thread %lu already is", self, m_registeredThread.load());
+			return false;
+		}
+
+		ThreadIndexSlot() = 0;
+		m_threads[0].priority = GetThreadPriority(GetCurrentThread());
+		return true;
+	}
+
+	template<typename Function>
+	void Run(JobCounter& counter, const Function& function)
+	{
+		static_assert(sizeof(Function) <= Job::StorageSize, "Job too large, capture less or capture a pointer to the data");
+		static_assert(std::is_trivially_copyable_v<Function>, "Jobs must be trivially copyable");
+
+		int self = ThreadIndex();
+		if (self == Unregistered)
+		{
+			function();
+			return;
+		}
+
+		Job* job = AllocateJob(self);
+		new (job->storage) Function(function);
+		job->invoke = [](void* storage)
+		{
+			(*(Function*)storage)();
+		};
+		job->counter = &counter;
+		job->priority = m_threads[self].priority;
+		counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+		if (!m_threads[self].queue.Push(job))
+		{
+			Execute(job);
+			return;
+		}
+
+		if (m_sleepers.load(std::memory_order_seq_cst) > 0 && m_wake != nullptr)
+		{
+			ReleaseSemaphore(m_wake, 1, nullptr);
+		}
+	}
+
+	// Splits [0, count) into chunks of at most grain items, function(begin, end) runs once per chunk.
+	template<typename Function>
+	void ParallelFor(JobCounter& counter, size_t count, size_t grain, const Function& function)
+	{
+		grain = std::max<size_t>(grain, 1);
+		for (size_t begin = 0; begin < count; begin += grain)
+		{
+			size_t end = std::min(begin + grain, count);
+			Run(counter, [function, begin, end] { function(begin, end); });
+		}
+	}
+
+	// Runs jobs (any jobs, not only the counter's) until all of the counter's jobs have finished.
+	// When the jobs left are running elsewhere it spins briefly and then yields, a busy machine may need
+	// this core to run them.
+	void Wait(JobCounter& counter)
+	{
+		int self = ThreadIndex();
+		int idleSpins = 0;
+		while (!counter.IsDone())
+		{
+			Job* job = FindJob(self);
+			if (job != nullptr)
+			{
+				Execute(job);
+				idleSpins = 0;
+			}
+			else if (++idleSpins < SpinsBeforeYield)
+			{
+				_mm_pause();
+			}
+			else
+			{
+				SwitchToThread();
+			}
+		}
+	}
+
+private:
+	/*
+	* Chase-Lev deque of job pointers with a fixed capacity (Le, Pop, Cohen and Zappa Nardelli, 2013).
+	*/
+	class Deque
+	{
+	public:
+		// Owner only, false when full.
+		bool Push(Job* job)
+		{
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			int64_t top = m_top.load(std::memory_order_acquire);
+			if (bottom - top >= QueueCapacity)
+			{
+				return false;
+			}
+
+			m_slots[bottom & (QueueCapacity - 1)].store(job, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// Owner only, newest job first.
+		Job* Pop()
+		{
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_top.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			Job* job = m_slots[bottom & (QueueCapacity - 1)].load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// The last job, a thief might be taking it as well.
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					job = nullptr;
+				}
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		// Any thread, oldest job first.
+		Job* Steal()
+		{
+			int64_t top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t bottom = m_bottom.load(std::memory_order_acquire);
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+
+			Job* job = m_slots[top & (QueueCapacity - 1)].load(std::memory_order_relaxed);
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return job;
+		}
+
+	private:
+		alignas(64) std::atomic<int64_t> m_top{ 0 };
+		alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+		std::atomic<Job*> m_slots[QueueCapacity] = {};
+	};
+
+	// Jobs are taken round robin from their thread's pool, a slot is reused once its job has finished.
+	struct ThreadState
+	{
+		Deque queue;
+		Job jobs[QueueCapacity];
+		uint64_t nextJob = 0;
+		uint32_t random = 0;
+		int priority = THREAD_PRIORITY_NORMAL;
+	};
+
+	static constexpr int Unregistered = -1;
+	static constexpr int IdlePriority = THREAD_PRIORITY_BELOW_NORMAL;
+
+	Logger m_logger{ "JobSystem" };
+	int m_numQueues = 1;
+	std::unique_ptr<ThreadState[]> m_threads;
+	std::vector<std::thread> m_workers;
+	std::atomic<bool> m_running{ true };
+	std::atomic<int> m_sleepers{ 0 };
+	std::atomic<DWORD> m_registeredThread{ 0 };
+	HANDLE m_wake = nullptr;
+
+	static int& ThreadIndexSlot()
+	{
+		static thread_local int index = Unregistered;
+		return index;
+	}
+
+	static int ThreadIndex()
+	{
+		return ThreadIndexSlot();
+	}
+
+	static int ConfiguredWorkers()
+	{
+		int cores = (int)std::thread::hardware_concurrency();
+		int defaultWorkers = std::clamp(cores / 4, 1, 4);
+		return (int)ConfigSnapshot::FromFile("hook_jobs.cfg")->GetInt("", "workers", defaultWorkers);
+	}
+
+	static uint64_t ConfiguredAffinity()
+	{
+		return (uint64_t)ConfigSnapshot::FromFile("hook_jobs.cfg")->GetInt("", "affinity", 0);
+	}
+
+	Job* AllocateJob(int self)
+	{
+		ThreadState& thread = m_threads[self];
+		Job* job = &thread.jobs[thread.nextJob++ & (QueueCapacity - 1)];
+		while (job->inFlight.load(std::memory_order_acquire))
+		{
+			Job* other = FindJob(self);
+			if (other != nullptr)
+			{
+				Execute(other);
+			}
+		}
+		job->inFlight.store(true, std::memory_order_relaxed);
+		return job;
+	}
+
+	void Execute(Job* job)
+	{
+		job->invoke(job->storage);
+		JobCounter* counter = job->counter;
+		job->inFlight.store(false, std::memory_order_release);
+		counter->m_pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	// Own queue first, then steal starting from a random thread. Threads that aren't registered only steal.
+	Job* FindJob(int self)
+	{
+		Job* job = self != Unregistered ? m_threads[self].queue.Pop() : nullptr;
+		if (job != nullptr || (m_numQueues == 1 && self == 0))
+		{
+			return job;
+		}
+
+		static thread_local uint32_t unregisteredRandom = 1;
+		uint32_t& random = self != Unregistered ? m_threads[self].random : unregisteredRandom;
+		random = random * 1664525 + 1013904223;
+		int start = (int)((random >> 16) % (uint32_t)m_numQueues);
+		for (int i = 0; i < m_numQueues; i++)
+		{
+			int victim = (start + i) % m_numQueues;
+			if (victim != self)
+			{
+				job = m_threads[victim].queue.Steal();
+				if (job != nullptr)
+				{
+					return job;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	// A worker takes on the priority of the jobs it runs and goes back to the idle priority when it runs out of work.
+	// Only changes of priority cost a call, a batch of jobs from the same thread doesn't.
+	void RunAtPriority(ThreadState& thread, Job* job)
+	{
+		if (job->priority != thread.priority)
+		{
+			SetThreadPriority(GetCurrentThread(), job->priority);
+			thread.priority = job->priority;
+		}
+
+		TRACE_SCOPE("Job");
+		Execute(job);
+	}
+
+	void WorkerLoop(int index)
+	{
+		ThreadIndexSlot() = index;
+		ThreadState& thread = m_threads[index];
+		thread.random = (uint32_t)index * 2654435761u;
+		thread.priority = IdlePriority;
+
+		int idleSpins = 0;
+		while (m_running.load(std::memory_order_relaxed))
+		{
+			Job* job = FindJob(index);
+			if (job != nullptr)
+			{
+				RunAtPriority(thread, job);
+				idleSpins = 0;
+				continue;
+			}
+
+			if (thread.priority != IdlePriority)
+			{
+				SetThreadPriority(GetCurrentThread(), IdlePriority);
+				thread.priority = IdlePriority;
+			}
+
+			if (++idleSpins < SpinsBeforeSleep || m_wake == nullptr)
+			{
+				_mm_pause();
+				continue;
+			}
+
+			// Announce the sleep before looking one last time, a job started after that look wakes us.
+			m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+			job = FindJob(index);
+			if (job != nullptr)
+			{
+				m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+				RunAtPriority(thread, job);
+				idleSpins = 0;
+				continue;
+			}
+
+			WaitForSingleObject(m_wake, INFINITE);
+			m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+			idleSpins = 0;
+		}
+	}
+};
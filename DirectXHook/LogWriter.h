@@ -0,0 +1,560 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+/*
+* Backend of Logger. A logging thread only copies the prefix and format pointers and a binary encoding of the arguments
+* into a lock-free ring, formatting and console/file output happen on a background thread that writes in batches.
+* The thread sleeps on an event while the ring is empty, the first record committed to an empty ring wakes it.
+* The thread is started by the first message and creates the log file when it first writes.
+* Prefixes and format strings must be string literals (or otherwise outlive the program), string arguments are copied.
+*/
+
+enum class LogArgType : uint8_t
+{
+	Signed,
+	Unsigned,
+	Double,
+	Pointer,
+	String
+};
+
+struct LogRecord
+{
+	static constexpr size_t PayloadSize = 224;
+
+	const char* prefix = "";
+	const char* format = "";
+	uint16_t size = 0; // payload bytes used
+	uint8_t payload[PayloadSize];
+};
+
+// Appends typed arguments to a record's payload. Strings that don't fit are cut short, other arguments are dropped.
+class LogArgWriter
+{
+public:
+	LogArgWriter(uint8_t* data, size_t capacity) : m_data(data), m_capacity(capacity) { }
+
+	void Put(LogArgType type, uint64_t value)
+	{
+		if (m_size + 1 + sizeof(value) > m_capacity)
+		{
+			return;
+		}
+
+		m_data[m_size++] = (uint8_t)type;
+		memcpy(m_data + m_size, &value, sizeof(value));
+		m_size += sizeof(value);
+	}
+
+	void PutString(const char* text, size_t length)
+	{
+		if (m_size + 1 + sizeof(uint16_t) > m_capacity)
+		{
+			return;
+		}
+
+		size_t space = m_capacity - m_size - 1 - sizeof(uint16_t);
+		uint16_t stored = (uint16_t)(length < space ? length : space);
+		m_data[m_size++] = (uint8_t)LogArgType::String;
+		memcpy(m_data + m_size, &stored, sizeof(stored));
+		m_size += sizeof(stored);
+		memcpy(m_data + m_size, text, stored);
+		m_size += stored;
+	}
+
+	size_t Size() const
+	{
+		return m_size;
+	}
+
+private:
+	uint8_t* m_data = nullptr;
+	size_t m_capacity = 0;
+	size_t m_size = 0;
+};
+
+inline void EncodeLogArg(LogArgWriter& writer, const char* text)
+{
+	if (text == nullptr)
+	{
+		text = "(null)";
+	}
+	writer.PutString(text, strlen(text));
+}
+
+inline void EncodeLogArg(LogArgWriter& writer, char* text)
+{
+	EncodeLogArg(writer, (const char*)text);
+}
+
+inline void EncodeLogArg(LogArgWriter& writer, std::nullptr_t)
+{
+	writer.Put(LogArgType::Pointer, 0);
+}
+
+template<typename T>
+inline void EncodeLogArg(LogArgWriter& writer, T* pointer)
+{
+	writer.Put(LogArgType::Pointer, (uint64_t)(uintptr_t)pointer);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type EncodeLogArg(LogArgWriter& writer, T value)
+{
+	if (std::is_signed<T>::value)
+	{
+		writer.Put(LogArgType::Signed, (uint64_t)(int64_t)value);
+	}
+	else
+	{
+		writer.Put(LogArgType::Unsigned, (uint64_t)value);
+	}
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type EncodeLogArg(LogArgWriter& writer, T value)
+{
+	double converted = (double)value;
+	uint64_t bits;
+	memcpy(&bits, &converted, sizeof(bits));
+	writer.Put(LogArgType::Double, bits);
+}
+
+// Bounded multi-producer, single-consumer ring (Vyukov style). Producers claim a cell, fill it in place and commit it.
+template<size_t Capacity>
+class LogQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "LogQueue capacity must be a power of two");
+
+public:
+	LogQueue()
+	{
+		for (size_t i = 0; i < Capacity; i++)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Returns nullptr when the queue is full.
+	LogRecord* Claim(size_t* position)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Cell& cell = m_cells[head & (Capacity - 1)];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)head;
+			if (difference == 0)
+			{
+				if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+				{
+					*position = head;
+					return &cell.record;
+				}
+			}
+			else if (difference < 0)
+			{
+				return nullptr;
+			}
+			else
+			{
+				head = m_head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void Commit(size_t position)
+	{
+		m_cells[position & (Capacity - 1)].sequence.store(position + 1, std::memory_order_release);
+	}
+
+	// Only called by the consumer. A claimed record that isn't committed yet doesn't count.
+	bool Empty() const
+	{
+		return m_cells[m_tail & (Capacity - 1)].sequence.load(std::memory_order_acquire) != m_tail + 1;
+	}
+
+	// Only called by the consumer.
+	bool Pop(LogRecord* record)
+	{
+		Cell& cell = m_cells[m_tail & (Capacity - 1)];
+		if (cell.sequence.load(std::memory_order_acquire) != m_tail + 1)
+		{
+			return false;
+		}
+
+		record->prefix = cell.record.prefix;
+		record->format = cell.record.format;
+		record->size = cell.record.size;
+		memcpy(record->payload, cell.record.payload, cell.record.size);
+		cell.sequence.store(m_tail + Capacity, std::memory_order_release);
+		m_tail++;
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence{ 0 };
+		LogRecord record;
+	};
+
+	alignas(64) std::atomic<size_t> m_head{ 0 };
+	alignas(64) size_t m_tail = 0;
+	Cell m_cells[Capacity];
+};
+
+class LogWriter
+{
+public:
+	static LogWriter& Instance()
+	{
+		static LogWriter writer;
+		return writer;
+	}
+
+	LogWriter(const LogWriter&) = delete;
+	LogWriter& operator=(const LogWriter&) = delete;
+
+	// Runs at unload under the loader lock, where joining would deadlock (a thread can't exit without that lock),
+	// and at process exit the thread has already been terminated. So what's still queued is written here
+	// and a thread that still runs is left to exit on its own, it keeps the state alive until then.
+	~LogWriter()
+	{
+		State& state = *m_state;
+		state.running.store(false);
+		SetEvent(state.wakeEvent);
+
+		// Skipped if the thread owns the ring, or was terminated while it did.
+		if (!state.consuming.exchange(true))
+		{
+			Drain(state);
+			if (state.file != nullptr)
+			{
+				fclose(state.file);
+				state.file = nullptr;
+			}
+		}
+	}
+
+	template<typename... Args>
+	void Write(const char* prefix, const char* format, const Args&... args)
+	{
+		State& state = *m_state;
+		size_t position;
+		LogRecord* record = state.queue.Claim(&position);
+		if (record == nullptr)
+		{
+			state.droppedRecords.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		record->prefix = prefix;
+		record->format = format;
+		LogArgWriter writer(record->payload, LogRecord::PayloadSize);
+		int expand[] = { 0, (EncodeLogArg(writer, args), 0)... };
+		(void)expand;
+		record->size = (uint16_t)writer.Size();
+		state.queue.Commit(position);
+
+		// The thread drains the ring when it starts, so records written before that aren't missed.
+		if (!m_started.load(std::memory_order_relaxed) && !m_started.exchange(true))
+		{
+			std::thread(&LogWriter::Run, m_state).detach();
+			return;
+		}
+
+		// Pairs with the fence in WaitForRecords(), either the writer sees this record or this sees it sleeping.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (state.sleeping.load(std::memory_order_relaxed) && state.sleeping.exchange(false))
+		{
+			SetEvent(state.wakeEvent);
+		}
+	}
+
+private:
+	static constexpr size_t BatchBytes = 64 * 1024;
+
+	// Shared with the writer thread, which may outlive the writer.
+	struct State
+	{
+		LogQueue<1024> queue;
+		std::atomic<uint64_t> droppedRecords{ 0 };
+		std::atomic<bool> running{ true };
+		std::atomic<bool> sleeping{ false }; // the writer thread is about to wait or waiting for wakeEvent
+		std::atomic<bool> consuming{ false }; // held by whoever pops the ring, the writer thread or the destructor
+		HANDLE wakeEvent = nullptr;
+		FILE* file = nullptr; // opened by the first Flush()
+		bool fileOpened = false; // only used by the consumer
+		std::string batch; // only used by the consumer
+
+		State()
+		{
+			batch.reserve(BatchBytes + 1024);
+			wakeEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+		}
+
+		~State()
+		{
+			if (file != nullptr)
+			{
+				fclose(file);
+			}
+			CloseHandle(wakeEvent);
+		}
+	};
+
+	std::shared_ptr<State> m_state = std::make_shared<State>();
+	std::atomic<bool> m_started{ false };
+
+	// Nothing is started here: loggers are constructed while the DLL is being loaded, the thread and the file
+	// wait for the first message.
+	LogWriter() = default;
+
+	static void Run(std::shared_ptr<State> state)
+	{
+		while (state->running.load())
+		{
+			if (state->consuming.exchange(true))
+			{
+				return;
+			}
+			Drain(*state);
+			state->consuming.store(false);
+
+			WaitForRecords(*state);
+		}
+	}
+
+	static void WaitForRecords(State& state)
+	{
+		state.sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (state.queue.Empty() && state.droppedRecords.load(std::memory_order_relaxed) == 0 && state.running.load())
+		{
+			WaitForSingleObject(state.wakeEvent, INFINITE);
+		}
+		state.sleeping.store(false, std::memory_order_relaxed);
+	}
+
+	static void Drain(State& state)
+	{
+		LogRecord record;
+		while (state.queue.Pop(&record))
+		{
+			Format(record, &state.batch);
+			if (state.batch.size() >= BatchBytes)
+			{
+				Flush(state);
+			}
+		}
+
+		uint64_t dropped = state.droppedRecords.exchange(0, std::memory_order_relaxed);
+		if (dropped != 0)
+		{
+			char text[96];
+			snprintf(text, sizeof(text), "Logger > %llu messages were dropped because the queue was full\n", (unsigned long long)dropped);
+			state.batch += text;
+		}
+		Flush(state);
+	}
+
+	static void Flush(State& state)
+	{
+		if (state.batch.empty())
+		{
+			return;
+		}
+
+		if (!state.fileOpened)
+		{
+			fopen_s(&state.file, "directx_hook_log.txt", "w");
+			state.fileOpened = true;
+		}
+
+		fwrite(state.batch.data(), 1, state.batch.size(), stdout);
+		fflush(stdout);
+		if (state.file != nullptr)
+		{
+			fwrite(state.batch.data(), 1, state.batch.size(), state.file);
+			fflush(state.file);
+		}
+		state.batch.clear();
+	}
+
+	struct DecodedArg
+	{
+		LogArgType type = LogArgType::Signed;
+		uint64_t value = 0;
+		const char* text = nullptr;
+		uint16_t length = 0;
+	};
+
+	static bool NextArg(const LogRecord& record, size_t* position, DecodedArg* arg)
+	{
+		if (*position >= record.size)
+		{
+			return false;
+		}
+
+		arg->type = (LogArgType)record.payload[(*position)++];
+		if (arg->type == LogArgType::String)
+		{
+			memcpy(&arg->length, record.payload + *position, sizeof(arg->length));
+			*position += sizeof(arg->length);
+			arg->text = (const char*)record.payload + *position;
+			*position += arg->length;
+		}
+		else
+		{
+			memcpy(&arg->value, record.payload + *position, sizeof(arg->value));
+			*position += sizeof(arg->value);
+		}
+		return true;
+	}
+
+	static double AsDouble(const DecodedArg& arg)
+	{
+		if (arg.type == LogArgType::Double)
+		{
+			double value;
+			memcpy(&value, &arg.value, sizeof(value));
+			return value;
+		}
+		return arg.type == LogArgType::Signed ? (double)(int64_t)arg.value : (double)arg.value;
+	}
+
+	static uint64_t AsInteger(const DecodedArg& arg)
+	{
+		return arg.type == LogArgType::Double ? (uint64_t)(int64_t)AsDouble(arg) : arg.value;
+	}
+
+	// printf for the decoded arguments: every conversion is formatted on its own with the argument widened
+	// to a 64 bit integer, a double, a pointer or a string. Length modifiers in the format are ignored.
+	static void Format(const LogRecord& record, std::string* out)
+	{
+		out->append(record.prefix);
+		out->append(" > ");
+
+		size_t position = 0;
+		const char* format = record.format;
+		while (*format != '\0')
+		{
+			if (*format != '%')
+			{
+				const char* next = strchr(format, '%');
+				size_t length = next != nullptr ? (size_t)(next - format) : strlen(format);
+				out->append(format, length);
+				format += length;
+				continue;
+			}
+
+			format++;
+			if (*format == '%')
+			{
+				out->push_back('%');
+				format++;
+				continue;
+			}
+
+			char spec[32] = "%";
+			size_t specLength = 1;
+			while (*format != '\0' && strchr("-+ #0123456789.", *format) != nullptr && specLength < sizeof(spec) - 4)
+			{
+				spec[specLength++] = *format++;
+			}
+			while (*format != '\0' && strchr("hlzjtLIq", *format) != nullptr)
+			{
+				format++;
+				if (format[-1] == 'I' && (strncmp(format, "64", 2) == 0 || strncmp(format, "32", 2) == 0))
+				{
+					format += 2;
+				}
+			}
+
+			char conversion = *format;
+			if (conversion == '\0')
+			{
+				break;
+			}
+			format++;
+
+			DecodedArg arg;
+			if (!NextArg(record, &position, &arg))
+			{
+				out->append("<?>");
+				continue;
+			}
+
+			char text[512];
+			int length = -1;
+			switch (conversion)
+			{
+			case 'd':
+			case 'i':
+				memcpy(spec + specLength, "lld", 4);
+				length = snprintf(text, sizeof(text), spec, (long long)AsInteger(arg));
+				break;
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+				spec[specLength] = 'l';
+				spec[specLength + 1] = 'l';
+				spec[specLength + 2] = conversion;
+				spec[specLength + 3] = '\0';
+				length = snprintf(text, sizeof(text), spec, (unsigned long long)AsInteger(arg));
+				break;
+			case 'c':
+				memcpy(spec + specLength, "c", 2);
+				length = snprintf(text, sizeof(text), spec, (int)AsInteger(arg));
+				break;
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				spec[specLength] = conversion;
+				spec[specLength + 1] = '\0';
+				length = snprintf(text, sizeof(text), spec, AsDouble(arg));
+				break;
+			case 'p':
+				memcpy(spec + specLength, "p", 2);
+				length = snprintf(text, sizeof(text), spec, (void*)(uintptr_t)AsInteger(arg));
+				break;
+			case 's':
+				if (arg.type == LogArgType::String)
+				{
+					std::string copy(arg.text, arg.length);
+					memcpy(spec + specLength, "s", 2);
+					length = snprintf(text, sizeof(text), spec, copy.c_str());
+				}
+				break;
+			}
+
+			if (length < 0)
+			{
+				out->append("<?>");
+			}
+			else
+			{
+				out->append(text, (size_t)length < sizeof(text) ? (size_t)length : sizeof(text) - 1);
+			}
+		}
+
+		out->push_back('\n');
+	}
+};
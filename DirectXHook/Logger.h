@@ -1,46 +1,250 @@
 #pragma once
 
-#include <string>
-#include <cstdarg>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
 
-class Logger
+#include "LogWriter.h"
+
+/*
+* Log calls only queue the message, it is formatted and written to the console and directx_hook_log.txt
+* by a background thread, so logging from the render thread doesn't wait on I/O.
+* The prefix and format must be string literals, the format is checked against the arguments at compile time.
+*
+* Logger::Log always logs. The LOG_* macros take a level and a category and compile to nothing
+* (arguments included) when the level is below LOG_MIN_LEVEL or the category is in LOG_DISABLED_CATEGORIES:
+*
+*	LOG_DEBUG(m_logger, Render, "Overlay %zu took %.1f us", index, micros);
+*	LOG_EVERY_MS(m_logger, Debug, Input, 1000, "Mouse at %i, %i", x, y); // at most once a second from this line
+*/
+
+enum class LogLevel : int
 {
-public:
-	Logger(const char* prefix)
+	Trace = 0,
+	Debug = 1,
+	Info = 2,
+	Warning = 3,
+	Error = 4
+};
+
+enum class LogCategory : uint32_t
+{
+	General = 1 << 0,
+	Hook = 1 << 1,
+	Render = 1 << 2,
+	Overlay = 1 << 3,
+	Input = 1 << 4,
+	Memory = 1 << 5
+};
+
+#ifndef LOG_MIN_LEVEL
+#ifdef _DEBUG
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 2
+#endif
+#endif
+
+// Bit mask of LogCategory values
+#ifndef LOG_DISABLED_CATEGORIES
+#define LOG_DISABLED_CATEGORIES 0
+#endif
+
+constexpr bool LogEnabled(LogLevel level, LogCategory category)
+{
+	return (int)level >= LOG_MIN_LEVEL && ((uint32_t)category & (uint32_t)(LOG_DISABLED_CATEGORIES)) == 0;
+}
+
+namespace LogFormatCheck
+{
+	enum class Kind
 	{
-		m_printPrefix = prefix;
+		Integer,
+		Float,
+		String,
+		Pointer,
+		Unsupported
+	};
+
+	template<typename T>
+	constexpr Kind KindOf()
+	{
+		typedef std::remove_cv_t<std::decay_t<T>> Decayed;
+		if constexpr (std::is_same_v<Decayed, char*> || std::is_same_v<Decayed, const char*>)
+		{
+			return Kind::String;
+		}
+		else if constexpr (std::is_pointer_v<Decayed> || std::is_null_pointer_v<Decayed>)
+		{
+			return Kind::Pointer;
+		}
+		else if constexpr (std::is_integral_v<Decayed> || std::is_enum_v<Decayed>)
+		{
+			return Kind::Integer;
+		}
+		else if constexpr (std::is_floating_point_v<Decayed>)
+		{
+			return Kind::Float;
+		}
+		else
+		{
+			return Kind::Unsupported;
+		}
+	}
 
-		FILE* logFile = LogFile(nullptr);
-		if (logFile == nullptr)
+	constexpr bool Contains(const char* characters, char c)
+	{
+		for (; *characters != '\0'; characters++)
 		{
-			fopen_s(&logFile, "directx_hook_log.txt", "w");
-			LogFile(logFile);
+			if (*characters == c)
+			{
+				return true;
+			}
 		}
+		return false;
 	}
 
-	void Log(std::string msg, ...)
+	constexpr bool Accepts(char conversion, Kind kind)
 	{
-		va_list args;
-		va_start(args, msg);
-		vprintf(std::string(m_printPrefix + " > " + msg + "\n").c_str(), args);
-		if (LogFile(nullptr) != nullptr)
+		if (Contains("diouxXc", conversion))
+		{
+			return kind == Kind::Integer;
+		}
+		if (Contains("fFeEgGaA", conversion))
+		{
+			return kind == Kind::Float;
+		}
+		if (conversion == 's')
 		{
-			vfprintf(LogFile(nullptr), std::string(m_printPrefix + " > " + msg + "\n").c_str(), args);
-			fflush(LogFile(nullptr));
+			return kind == Kind::String;
 		}
-		va_end(args);
+		if (conversion == 'p')
+		{
+			return kind == Kind::Pointer || kind == Kind::String;
+		}
+		return false;
 	}
 
-private:
-	std::string m_printPrefix = "";
+	// Same rules as LogWriter::Format: flags, width and precision are digits only, length modifiers are ignored.
+	constexpr bool Matches(const char* format, const Kind* kinds, size_t numArgs)
+	{
+		size_t arg = 0;
+		while (*format != '\0')
+		{
+			if (*format++ != '%')
+			{
+				continue;
+			}
+			if (*format == '%')
+			{
+				format++;
+				continue;
+			}
+
+			while (*format != '\0' && Contains("-+ #0123456789.", *format))
+			{
+				format++;
+			}
+			while (*format != '\0' && Contains("hlzjtLIq346", *format))
+			{
+				format++;
+			}
+
+			if (*format == '\0' || arg >= numArgs || !Accepts(*format, kinds[arg]))
+			{
+				return false;
+			}
+			format++;
+			arg++;
+		}
+		return arg == numArgs;
+	}
 
-	static FILE* LogFile(FILE* newLogFile)
+	// Not constexpr, calling it from the consteval constructor is what turns a mismatch into a compile error.
+	inline void FormatDoesNotMatchArguments() { }
+}
+
+template<typename... Args>
+class LogFormat
+{
+public:
+	consteval LogFormat(const char* format) : m_format(format)
 	{
-		static FILE* logFile = nullptr;
-		if (newLogFile != nullptr)
+		constexpr LogFormatCheck::Kind kinds[sizeof...(Args) + 1] = { LogFormatCheck::KindOf<Args>()..., LogFormatCheck::Kind::Unsupported };
+		if (!LogFormatCheck::Matches(format, kinds, sizeof...(Args)))
 		{
-			logFile = newLogFile;
+			LogFormatCheck::FormatDoesNotMatchArguments();
 		}
-		return logFile;
 	}
-};
\ No newline at end of file
+
+	const char* Get() const
+	{
+		return m_format;
+	}
+
+private:
+	const char* m_format = "";
+};
+
+// Lets one message through per interval, for the rate limited macros (one per call site).
+class LogRateLimit
+{
+public:
+	bool Allow(uint64_t intervalMillis)
+	{
+		uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		uint64_t next = m_next.load(std::memory_order_relaxed);
+		return now >= next && m_next.compare_exchange_strong(next, now + intervalMillis, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> m_next{ 0 };
+};
+
+class Logger
+{
+public:
+	Logger(const char* prefix)
+	{
+		m_printPrefix = prefix;
+		LogWriter::Instance();
+	}
+
+	template<typename... Args>
+	void Log(LogFormat<std::type_identity_t<Args>...> format, const Args&... args)
+	{
+		LogWriter::Instance().Write(m_printPrefix, format.Get(), args...);
+	}
+
+private:
+	const char* m_printPrefix = "";
+};
+
+#define LOG_AT(logger, level, category, ...) \
+	do \
+	{ \
+		if constexpr (LogEnabled(LogLevel::level, LogCategory::category)) \
+		{ \
+			(logger).Log(__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_TRACE(logger, category, ...) LOG_AT(logger, Trace, category, __VA_ARGS__)
+#define LOG_DEBUG(logger, category, ...) LOG_AT(logger, Debug, category, __VA_ARGS__)
+#define LOG_INFO(logger, category, ...) LOG_AT(logger, Info, category, __VA_ARGS__)
+#define LOG_WARNING(logger, category, ...) LOG_AT(logger, Warning, category, __VA_ARGS__)
+#define LOG_ERROR(logger, category, ...) LOG_AT(logger, Error, category, __VA_ARGS__)
+
+#define LOG_EVERY_MS(logger, level, category, intervalMillis, ...) \
+	do \
+	{ \
+		if constexpr (LogEnabled(LogLevel::level, LogCategory::category)) \
+		{ \
+			static LogRateLimit logRateLimit; \
+			if (logRateLimit.Allow(intervalMillis)) \
+			{ \
+				(logger).Log(__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Access to the game's memory goes through this interface so the code that walks and caches
+* pointers doesn't care where the memory lives (this process, another process or a synthetic image).
+*/
+
+struct MemoryRegion
+{
+	uintptr_t base = 0;
+	size_t size = 0;
+	bool readable = false;
+};
+
+class IMemoryAccess
+{
+public:
+	virtual ~IMemoryAccess() { }
+
+	// Describes the region containing the address. This is the expensive call (a syscall on Windows).
+	virtual bool Query(uintptr_t address, MemoryRegion* region) = 0;
+
+	// Copies memory, returns false instead of crashing if the memory can't be read.
+	virtual bool Read(uintptr_t address, void* buffer, size_t size) = 0;
+
+	template<typename T>
+	bool Read(uintptr_t address, T* value)
+	{
+		return Read(address, value, sizeof(T));
+	}
+};
+
+/*
+* Remembers which regions are readable so walking the same pointers every frame doesn't query the OS every time.
+* Entries are tagged with a generation, Invalidate() drops all of them at once.
+*/
+class PageCache
+{
+public:
+	PageCache(IMemoryAccess& memory) : m_memory(memory) { }
+
+	bool IsReadable(uintptr_t address, size_t size)
+	{
+		uintptr_t end = address + size;
+		while (address < end)
+		{
+			const Entry* entry = Find(address);
+			if (entry == nullptr || !entry->readable)
+			{
+				return false;
+			}
+			address = entry->end;
+		}
+		return true;
+	}
+
+	void Invalidate()
+	{
+		m_generation++;
+	}
+
+	size_t QueryCount() const
+	{
+		return m_queryCount;
+	}
+
+private:
+	static constexpr int NumEntries = 64;
+	static constexpr int PageShift = 12;
+
+	struct Entry
+	{
+		uintptr_t base = 0;
+		uintptr_t end = 0;
+		uint32_t generation = 0;
+		bool readable = false;
+	};
+
+	IMemoryAccess& m_memory;
+	Entry m_entries[NumEntries];
+	uint32_t m_generation = 1;
+	size_t m_queryCount = 0;
+
+	const Entry* Find(uintptr_t address)
+	{
+		Entry& entry = m_entries[(address >> PageShift) & (NumEntries - 1)];
+		if (entry.generation == m_generation && address >= entry.base && address < entry.end)
+		{
+			return &entry;
+		}
+
+		MemoryRegion region;
+		m_queryCount++;
+		if (!m_memory.Query(address, &region) || region.size == 0)
+		{
+			return nullptr;
+		}
+
+		entry.base = region.base;
+		entry.end = region.base + region.size;
+		entry.readable = region.readable;
+		entry.generation = m_generation;
+		return &entry;
+	}
+};
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "MemoryAccess.h"
+#include "PointerChainResolver.h"
+#include "StructView.h"
+#include "Logger.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+/*
+* Samples declared game values on a dedicated thread so overlays never touch game memory on the render path.
+* A watch is a typed value or a StructView at a fixed address or at the end of a pointer chain, sampled at its own rate.
+* Every wake-up samples all watches that are due in one batch, with one timestamp for the batch.
+* Samples go into a lock-free ring per watch, readers get the latest value or a window of history.
+* A watch can be paused or slowed down with SetSampleRate(), with no watch running the thread sleeps until one is.
+*/
+
+struct WatchSample
+{
+	static constexpr size_t MaxWords = 4;
+	static constexpr size_t MaxBytes = MaxWords * sizeof(uint64_t);
+
+	uint64_t timestamp = 0; // microseconds on the steady clock
+	uint64_t raw[MaxWords] = { 0 };
+	bool valid = false; // false when the address couldn't be resolved or read
+
+	template<typename T>
+	T As() const
+	{
+		T value;
+		memcpy(&value, raw, sizeof(T));
+		return value;
+	}
+
+	// For samples of MemoryWatch::WatchStruct<View>()
+	template<typename View>
+	View AsView() const
+	{
+		View view;
+		view.AssignRange(raw);
+		return view;
+	}
+};
+
+class MemoryWatch
+{
+public:
+	typedef int WatchId; // -1 is invalid
+	static constexpr size_t HistorySize = 1024; // samples kept per watch
+	static constexpr int MaxWatches = 64;
+
+	// The memory access is shared with the sampling thread, which can outlive the watch (see the destructor).
+	MemoryWatch(std::shared_ptr<IMemoryAccess> memory) : m_state(std::make_shared<State>(std::move(memory))) { }
+
+	MemoryWatch(const MemoryWatch&) = delete;
+	MemoryWatch& operator=(const MemoryWatch&) = delete;
+
+	// Runs at unload, under the loader lock where joining would deadlock. The thread is told to stop and let go,
+	// it only touches the shared state, which lives until the thread is done with it.
+	~MemoryWatch()
+	{
+		m_state->running.store(false);
+		SetEvent(m_state->wakeUp);
+		if (m_thread.joinable())
+		{
+			m_thread.detach();
+		}
+	}
+
+	template<typename T>
+	WatchId Watch(const std::vector<uintptr_t>& pointerChain, unsigned int sampleRateHz)
+	{
+		static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= WatchSample::MaxBytes, "Watched values must be trivially copyable and at most 32 bytes");
+		return Add(pointerChain, sizeof(T), sampleRateHz);
+	}
+
+	// Samples all of the view's fields of the structure at the end of the chain in one read, see WatchSample::AsView().
+	template<typename View>
+	WatchId WatchStruct(const std::vector<uintptr_t>& pointerChain, unsigned int sampleRateHz)
+	{
+		static_assert(View::Size <= WatchSample::MaxBytes, "The fields of a watched view must span at most 32 bytes");
+		std::vector<uintptr_t> fieldsChain = pointerChain;
+		if (!fieldsChain.empty())
+		{
+			fieldsChain.back() += View::Begin;
+		}
+		return Add(fieldsChain, View::Size, sampleRateHz);
+	}
+
+	template<typename T>
+	WatchId Watch(uintptr_t address, unsigned int sampleRateHz)
+	{
+		return Watch<T>(std::vector<uintptr_t>{ address }, sampleRateHz);
+	}
+
+	// A rate of 0 pauses the watch. Can be called from any thread, the next sample is taken right away.
+	void SetSampleRate(WatchId id, unsigned int sampleRateHz)
+	{
+		uint32_t period = sampleRateHz == 0 ? 0 : 1000000 / sampleRateHz;
+		if (m_state->watches[id]->periodMicros.exchange(period) != period)
+		{
+			SetEvent(m_state->wakeUp);
+		}
+	}
+
+	// The most recent sample, returns false if there is none yet.
+	bool Latest(WatchId id, WatchSample* sample) const
+	{
+		const Ring& ring = m_state->watches[id]->ring;
+		uint64_t head = ring.head.load(std::memory_order_acquire);
+		while (head != 0)
+		{
+			if (ring.Load(head - 1, sample))
+			{
+				return true;
+			}
+			head = ring.head.load(std::memory_order_acquire);
+		}
+		return false;
+	}
+
+	// Copies up to maxSamples of the most recent samples, oldest first. Returns how many were copied.
+	size_t History(WatchId id, WatchSample* samples, size_t maxSamples) const
+	{
+		const Ring& ring = m_state->watches[id]->ring;
+		uint64_t head = ring.head.load(std::memory_order_acquire);
+		uint64_t count = head < maxSamples ? head : maxSamples;
+		if (count > HistorySize - 1)
+		{
+			count = HistorySize - 1; // the oldest slot may be getting overwritten right now
+		}
+
+		size_t copied = 0;
+		for (uint64_t sequence = head - count; sequence < head; sequence++)
+		{
+			if (ring.Load(sequence, &samples[copied]))
+			{
+				copied++;
+			}
+		}
+		return copied;
+	}
+
+	// Sequence number of the next sample, readers can use it to consume every sample exactly once.
+	uint64_t SampleCount(WatchId id) const
+	{
+		return m_state->watches[id]->ring.head.load(std::memory_order_acquire);
+	}
+
+	// Reads the sample with the given sequence number, fails if it was overwritten or not written yet.
+	bool Sample(WatchId id, uint64_t sequence, WatchSample* sample) const
+	{
+		return m_state->watches[id]->ring.Load(sequence, sample);
+	}
+
+private:
+	// Single writer (the sampling thread), any number of readers. Each slot is a small seqlock.
+	struct Ring
+	{
+		struct Slot
+		{
+			std::atomic<uint64_t> sequence{ 0 }; // 2 * n + 2 once sample n is complete, odd while being written
+			std::atomic<uint64_t> timestamp{ 0 };
+			std::atomic<uint64_t> raw[WatchSample::MaxWords] = {};
+			std::atomic<bool> valid{ false };
+		};
+
+		Slot slots[HistorySize];
+		std::atomic<uint64_t> head{ 0 };
+		size_t numWords = 1; // of raw that are used, set before the thread starts sampling
+
+		void Store(const WatchSample& sample)
+		{
+			uint64_t sequence = head.load(std::memory_order_relaxed);
+			Slot& slot = slots[sequence % HistorySize];
+			slot.sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.timestamp.store(sample.timestamp, std::memory_order_relaxed);
+			for (size_t i = 0; i < numWords; i++)
+			{
+				slot.raw[i].store(sample.raw[i], std::memory_order_relaxed);
+			}
+			slot.valid.store(sample.valid, std::memory_order_relaxed);
+			slot.sequence.store(2 * sequence + 2, std::memory_order_release);
+			head.store(sequence + 1, std::memory_order_release);
+		}
+
+		bool Load(uint64_t sequence, WatchSample* sample) const
+		{
+			const Slot& slot = slots[sequence % HistorySize];
+			uint64_t before = slot.sequence.load(std::memory_order_acquire);
+			sample->timestamp = slot.timestamp.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < numWords; i++)
+			{
+				sample->raw[i] = slot.raw[i].load(std::memory_order_relaxed);
+			}
+			sample->valid = slot.valid.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+			return before == after && before == 2 * sequence + 2;
+		}
+	};
+
+	struct WatchEntry
+	{
+		std::unique_ptr<PointerChainResolver> resolver; // only used by the sampling thread
+		size_t size = 0;
+		std::atomic<uint32_t> periodMicros{ 0 }; // 0 while paused
+		uint32_t activePeriod = 0; // the period nextSample was scheduled with, only used by the sampling thread
+		std::chrono::steady_clock::time_point nextSample;
+		Ring ring;
+	};
+
+	// Everything the sampling thread touches.
+	struct State
+	{
+		std::shared_ptr<IMemoryAccess> memory;
+		PageCache pages; // only used by the sampling thread
+		std::unique_ptr<WatchEntry> watches[MaxWatches];
+		std::atomic<int> numWatches{ 0 };
+		std::atomic<bool> running{ false };
+		HANDLE wakeUp = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+
+		State(std::shared_ptr<IMemoryAccess> memory) : memory(std::move(memory)), pages(*this->memory) { }
+
+		~State()
+		{
+			CloseHandle(wakeUp);
+		}
+	};
+
+	Logger m_logger{ "MemoryWatch" };
+	std::shared_ptr<State> m_state;
+	std::mutex m_addMutex;
+	std::thread m_thread;
+
+	WatchId Add(const std::vector<uintptr_t>& pointerChain, size_t size, unsigned int sampleRateHz)
+	{
+		std::lock_guard<std::mutex> lock(m_addMutex);
+
+		int id = m_state->numWatches.load(std::memory_order_relaxed);
+		if (id >= MaxWatches || pointerChain.empty() || sampleRateHz == 0)
+		{
+			m_logger.Log("Could not add watch");
+			return -1;
+		}
+
+		std::unique_ptr<WatchEntry> watch(new WatchEntry());
+		watch->resolver.reset(new PointerChainResolver(*m_state->memory, m_state->pages, pointerChain));
+		watch->size = size;
+		watch->ring.numWords = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		watch->periodMicros.store(1000000 / sampleRateHz, std::memory_order_relaxed);
+		m_state->watches[id] = std::move(watch);
+		m_state->numWatches.store(id + 1, std::memory_order_release);
+
+		if (!m_state->running.exchange(true))
+		{
+			m_thread = std::thread(&MemoryWatch::Run, m_state);
+		}
+		SetEvent(m_state->wakeUp);
+
+		return id;
+	}
+
+	static void SampleWatch(State& state, WatchEntry& watch, uint64_t timestamp)
+	{
+		WatchSample sample;
+		sample.timestamp = timestamp;
+
+		uintptr_t address = watch.resolver->Resolve();
+		if (address != 0 && state.pages.IsReadable(address, watch.size))
+		{
+			sample.valid = state.memory->Read(address, sample.raw, watch.size);
+		}
+
+		watch.ring.Store(sample);
+	}
+
+	static void Run(std::shared_ptr<State> state)
+	{
+		// A high resolution timer lets watches sample faster than the default 15.6 ms scheduler tick.
+		HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (timer == nullptr)
+		{
+			timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		}
+
+		while (state->running.load(std::memory_order_relaxed))
+		{
+			auto now = std::chrono::steady_clock::now();
+			uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+			auto earliest = now + std::chrono::milliseconds(100);
+			bool active = false;
+
+			int numWatches = state->numWatches.load(std::memory_order_acquire);
+			for (int i = 0; i < numWatches; i++)
+			{
+				WatchEntry& watch = *state->watches[i];
+				uint32_t period = watch.periodMicros.load(std::memory_order_relaxed);
+				if (period == 0)
+				{
+					watch.activePeriod = 0;
+					continue;
+				}
+
+				// Resumed or changed rate, the old schedule could be far off.
+				if (period != watch.activePeriod)
+				{
+					watch.activePeriod = period;
+					watch.nextSample = now;
+				}
+
+				active = true;
+				if (watch.nextSample <= now)
+				{
+					SampleWatch(*state, watch, timestamp);
+					watch.nextSample += std::chrono::microseconds(period);
+					if (watch.nextSample < now)
+					{
+						watch.nextSample = now + std::chrono::microseconds(period);
+					}
+				}
+
+				if (watch.nextSample < earliest)
+				{
+					earliest = watch.nextSample;
+				}
+			}
+
+			if (!active)
+			{
+				WaitForSingleObject(state->wakeUp, INFINITE);
+				continue;
+			}
+
+			auto wait = std::chrono::duration_cast<std::chrono::microseconds>(earliest - std::chrono::steady_clock::now());
+			if (wait.count() > 0)
+			{
+				LARGE_INTEGER dueTime;
+				dueTime.QuadPart = -(LONGLONG)wait.count() * 10; // relative, in 100 ns units
+				if (timer != nullptr && SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE))
+				{
+					WaitForSingleObject(timer, INFINITE);
+				}
+				else
+				{
+					Sleep((DWORD)(wait.count() / 1000));
+				}
+			}
+		}
+
+		if (timer != nullptr)
+		{
+			CloseHandle(timer);
+		}
+	}
+};
@@ -11,7 +11,10 @@
 #include <chrono>
 #include <string>
 
+#include "AssetCache.h"
 #include "Logger.h"
+#include "InputHook.h"
+#include "Trace.h"
 
 #undef DrawText
 
@@ -41,6 +44,7 @@ namespace OF
 	static int ofMouseX = 0, ofMouseY = 0;
 	static int ofDeltaMouseX = 0, ofDeltaMouseY = 0;
 	static bool ofMousePressed = false;
+	static bool ofCaptureMouseOverBoxes = false;
 	static Box* ofClickedBox = nullptr;
 	constexpr unsigned char HK_NONE = 0x07;
 
@@ -51,6 +55,16 @@ namespace OF
 	static std::vector<std::shared_ptr<DirectX::SpriteFont>> ofFonts = std::vector<std::shared_ptr<DirectX::SpriteFont>>();
 	static std::shared_ptr<DirectX::SpriteFont> ofActiveFont = nullptr;
 
+	// Set by the renderer while an overlay runs on a frame its cached image is composited instead of drawn.
+	// Shared by every overlay (inline, unlike the per overlay state above).
+	inline bool ofSkipDrawing = false;
+
+	// Overlays still handle input and run their tasks while drawing is skipped, draw calls only mark boxes visible.
+	inline void SkipDrawing(bool skip)
+	{
+		ofSkipDrawing = skip;
+	}
+
 	// Gives the framework the required DirectX objects to draw
 	inline void InitFramework(Microsoft::WRL::ComPtr<ID3D11Device> device, std::shared_ptr<DirectX::SpriteBatch> spriteBatch, HWND window)
 	{
@@ -78,6 +92,7 @@ namespace OF
 
 	inline int LoadTexture(std::string filepath)
 	{
+		TRACE_SCOPE("OF::LoadTexture");
 		if (ofDevice == nullptr)
 		{
 			ofLogger.Log("Could not load texture, ofDevice is nullptr! Run InitFramework before attempting to load textures!");
@@ -92,27 +107,10 @@ namespace OF
 			filepath = "hook_textures\\blank.jpg";
 		}
 
-		ofLogger.Log("Loading texture: %s", filepath.c_str());
-
-		std::wstring wideString(filepath.length(), ' ');
-		std::copy(filepath.begin(), filepath.end(), wideString.begin());
-		std::fstream file = std::fstream(filepath);
-		if (file.fail())
-		{
-			ofLogger.Log("Texture loading failed, file was not found at: %s", filepath.c_str());
-			file.close();
-			return -1;
-		}
-		file.close();
-
-		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture = nullptr;
-		HRESULT texResult = DirectX::CreateWICTextureFromFile(ofDevice, wideString.c_str(), nullptr, texture.GetAddressOf());
-
-		_com_error texErr(texResult);
-		ofLogger.Log("Texture HRESULT: %s", texErr.ErrorMessage());
-		if (FAILED(texResult))
+		// Shared with every other overlay, the file is only read the first time.
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture = AssetCache::Instance().Texture(ofDevice, filepath);
+		if (texture == nullptr)
 		{
-			ofLogger.Log("Texture loading failed: %s", filepath.c_str());
 			return -1;
 		}
 
@@ -123,28 +121,20 @@ namespace OF
 
 	inline int LoadFont(std::string filepath)
 	{
+		TRACE_SCOPE("OF::LoadFont");
 		if (ofDevice == nullptr)
 		{
 			ofLogger.Log("Could not load font, ofDevice is nullptr! Run InitFramework before attempting to load fonts!");
 			return -1;
 		}
 
-		ofLogger.Log("Loading font: %s", filepath.c_str());
-
-		std::fstream file = std::fstream(filepath);
-		std::wstring wideString(filepath.length(), ' ');
-		std::copy(filepath.begin(), filepath.end(), wideString.begin());
-		if (file.fail())
+		std::shared_ptr<DirectX::SpriteFont> font = AssetCache::Instance().Font(ofDevice, filepath);
+		if (font == nullptr)
 		{
-			ofLogger.Log("Font loading failed: %s", filepath.c_str());
-			file.close();
 			return -1;
 		}
 
-		file.close();
-
-		ofLogger.Log("Font was loaded successfully");
-		ofFonts.push_back(std::make_shared<DirectX::SpriteFont>(ofDevice, wideString.c_str()));
+		ofFonts.push_back(font);
 
 		return ofFonts.size() - 1;
 	}
@@ -240,13 +230,13 @@ namespace OF
 	{
 		if (box == nullptr) 
 		{
-			ofLogger.Log("Attempted to render a nullptr Box!");
+			LOG_EVERY_MS(ofLogger, Warning, Overlay, 1000, "Attempted to render a nullptr Box!");
 			return;
 		}
 
 		if (ofSpriteBatch == nullptr)
 		{
-			ofLogger.Log("Attempted to render with ofSpriteBatch as nullptr! Run InitFramework before attempting to draw!");
+			LOG_EVERY_MS(ofLogger, Warning, Overlay, 1000, "Attempted to render with ofSpriteBatch as nullptr! Run InitFramework before attempting to draw!");
 			return;
 		}
 
@@ -268,7 +258,7 @@ namespace OF
 
 		if (textureID < 0 || textureID > ofTextures.size() - 1) 
 		{
-			ofLogger.Log("'%i' is an invalid texture ID!", textureID);
+			LOG_EVERY_MS(ofLogger, Warning, Overlay, 1000, "'%i' is an invalid texture ID!", textureID);
 			return;
 		}
 	
@@ -281,6 +271,10 @@ namespace OF
 		rect.right = position.x + box->width;
 
 		box->visible = true;
+		if (ofSkipDrawing)
+		{
+			return;
+		}
 		ofSpriteBatch->Draw(ofTextures[textureID].Get(), rect, nullptr, color, 0.0f, DirectX::XMFLOAT2(0.0f, 0.0f), DirectX::SpriteEffects_None, box->z);
 	}
 
@@ -301,9 +295,14 @@ namespace OF
 	inline void DrawText(Box* box, std::string text, int offsetX = 0, int offsetY = 0, float scale = 1.0f,
 		int r = 255, int g = 255, int b = 255, int a = 255, float rotation = 0.0f)
 	{
+		if (ofSkipDrawing)
+		{
+			return;
+		}
+
 		if (ofActiveFont == nullptr)
 		{
-			ofLogger.Log("Attempted to render text with an invalid font, make sure to run SetFont first!");
+			LOG_EVERY_MS(ofLogger, Warning, Overlay, 1000, "Attempted to render text with an invalid font, make sure to run SetFont first!");
 			return;
 		}
 
@@ -339,56 +338,41 @@ namespace OF
 		return false;
 	}
 
+	// Returns true on the frame the key went down (with the modifier held), even if it was released again within that frame.
+	// Passing HK_NONE as the key returns whether the modifier is currently held.
 	inline bool CheckHotkey(unsigned char key, unsigned char modifier = HK_NONE)
 	{
-		static std::vector<unsigned char> notReleasedKeys;
-
-		if (ofWindow != GetForegroundWindow())
-		{
-			return false;
-		}
-
-		bool keyPressed = GetAsyncKeyState(key) & 0x8000;
-		bool modifierPressed = GetAsyncKeyState(modifier) & 0x8000;
+		const KeyState& keys = InputHook::Instance().Keys();
 
 		if (key == HK_NONE)
 		{
-			return modifierPressed;
+			return keys.IsDown(modifier);
 		}
 
-		auto iterator = std::find(notReleasedKeys.begin(), notReleasedKeys.end(), key);
-		bool keyNotReleased = iterator != notReleasedKeys.end();
-
-		if (keyPressed && keyNotReleased)
-		{
-			return false;
-		} 
-		
-		if(!keyPressed)
+		if (!keys.WasPressed(key))
 		{
-			if (keyNotReleased)
-			{
-				notReleasedKeys.erase(iterator);
-			}
 			return false;
 		}
 
-		if (modifier != HK_NONE && !modifierPressed)
+		return modifier == HK_NONE || keys.IsDown(modifier) || keys.WasPressed(modifier);
+	}
+
+	// Stops mouse button messages from reaching the game while the cursor is over a visible box or dragging one.
+	inline void CaptureMouseOverBoxes(bool capture)
+	{
+		ofCaptureMouseOverBoxes = capture;
+		if (!capture)
 		{
-			return false;
+			InputHook::Instance().SetCapture(false, false);
 		}
-
-		notReleasedKeys.push_back(key);
-		return true;
 	}
 
 	inline void CheckMouseEvents()
 	{
-		if (ofWindow == GetForegroundWindow())
+		const KeyState& keys = InputHook::Instance().Keys();
+		if (InputHook::Instance().HasFocus())
 		{
-			POINT cursorPos;
-			GetCursorPos(&cursorPos);
-			ScreenToClient(ofWindow, &cursorPos);
+			POINT cursorPos = { keys.MouseX(), keys.MouseY() };
 
 			ofDeltaMouseX = ofMouseX;
 			ofDeltaMouseY = ofMouseY;
@@ -431,7 +415,12 @@ namespace OF
 				topMostBox->hover = true;
 			}
 
-			if (GetAsyncKeyState(VK_LBUTTON) & 0x8000)
+			if (ofCaptureMouseOverBoxes)
+			{
+				InputHook::Instance().SetCapture(false, topMostBox != nullptr || ofClickedBox != nullptr);
+			}
+
+			if (keys.IsDown(VK_LBUTTON) || keys.WasPressed(VK_LBUTTON))
 			{
 				if (topMostBox != nullptr && !ofMousePressed)
 				{
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Decides which overlays in the renderer's chain get to render on a given frame.
+* Every overlay has a CPU budget in microseconds (0 = unlimited) and a priority (higher = more important).
+* The measured cost of an overlay's Render() is smoothed, and an overlay that overruns its budget is decimated:
+* it only draws every Nth frame and the renderer shows its cached output in between. Render() still runs on those
+* frames with drawing skipped, that cost is measured separately and counted for every frame.
+* If the sum of all overlays still exceeds the frame budget, the lowest priority overlays are decimated further.
+* No Windows dependencies, the renderer feeds it measured times.
+*/
+class OverlayScheduler
+{
+public:
+	static constexpr unsigned int MaxInterval = 8;
+
+	size_t Add(int priority, unsigned int budgetMicros)
+	{
+		Slot slot;
+		slot.priority = priority;
+		slot.budgetMicros = budgetMicros;
+		m_slots.push_back(slot);
+
+		// Keep a lowest-priority-first order around so EndFrame() doesn't have to sort.
+		size_t index = m_slots.size() - 1;
+		size_t position = 0;
+		while (position < m_priorityOrder.size() && m_slots[m_priorityOrder[position]].priority <= priority)
+		{
+			position++;
+		}
+		m_priorityOrder.insert(m_priorityOrder.begin() + position, index);
+
+		return index;
+	}
+
+	void Clear()
+	{
+		m_slots.clear();
+		m_priorityOrder.clear();
+	}
+
+	// Total budget for all overlays combined, 0 disables it.
+	void SetFrameBudget(unsigned int budgetMicros)
+	{
+		m_frameBudgetMicros = budgetMicros;
+	}
+
+	void SetBudget(size_t index, unsigned int budgetMicros)
+	{
+		m_slots[index].budgetMicros = budgetMicros;
+	}
+
+	// Whether the overlay should run its Render() this frame.
+	// Decimated overlays are staggered by their index so they don't all land on the same frame.
+	bool IsDue(size_t index) const
+	{
+		unsigned int interval = m_slots[index].interval;
+		return interval == 1 || (m_frame + index) % interval == 0;
+	}
+
+	bool IsDecimated(size_t index) const
+	{
+		return m_slots[index].interval > 1;
+	}
+
+	unsigned int Interval(size_t index) const
+	{
+		return m_slots[index].interval;
+	}
+
+	// Smoothed cost of a frame the overlay draws
+	double AverageMicros(size_t index) const
+	{
+		return m_slots[index].averageMicros;
+	}
+
+	// Smoothed cost of a frame its cached output is shown instead
+	double SkippedMicros(size_t index) const
+	{
+		return m_slots[index].skippedMicros;
+	}
+
+	// Reports how long the overlay took this frame, drawn is false on the frames its cached output was shown.
+	void Report(size_t index, double micros, bool drawn = true)
+	{
+		Slot& slot = m_slots[index];
+		double& average = drawn ? slot.averageMicros : slot.skippedMicros;
+		bool& measured = drawn ? slot.measured : slot.skippedMeasured;
+		if (!measured)
+		{
+			average = micros;
+			measured = true;
+		}
+		else
+		{
+			average += (micros - average) * SmoothingFactor;
+		}
+	}
+
+	// Recomputes every overlay's render interval from the smoothed costs, call once after all overlays are done.
+	void EndFrame()
+	{
+		double totalMicros = 0;
+		for (Slot& slot : m_slots)
+		{
+			slot.interval = 1;
+			if (slot.budgetMicros != 0 && slot.averageMicros > slot.budgetMicros)
+			{
+				// The smallest interval whose cost per frame fits the budget
+				slot.interval = MaxInterval;
+				if (slot.skippedMicros < slot.budgetMicros)
+				{
+					slot.interval = std::min((unsigned int)((slot.averageMicros - slot.skippedMicros) / (slot.budgetMicros - slot.skippedMicros)) + 1, MaxInterval);
+				}
+			}
+			totalMicros += FrameMicros(slot);
+		}
+
+		if (m_frameBudgetMicros != 0)
+		{
+			for (size_t index : m_priorityOrder)
+			{
+				Slot& slot = m_slots[index];
+				while (totalMicros > m_frameBudgetMicros && slot.interval < MaxInterval)
+				{
+					totalMicros -= FrameMicros(slot);
+					slot.interval = std::min(slot.interval * 2, MaxInterval);
+					totalMicros += FrameMicros(slot);
+				}
+
+				if (totalMicros <= m_frameBudgetMicros)
+				{
+					break;
+				}
+			}
+		}
+
+		m_frame++;
+	}
+
+private:
+	static constexpr double SmoothingFactor = 0.1;
+
+	struct Slot
+	{
+		int priority = 0;
+		unsigned int budgetMicros = 0;
+		unsigned int interval = 1;
+		double averageMicros = 0;
+		double skippedMicros = 0;
+		bool measured = false;
+		bool skippedMeasured = false;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<size_t> m_priorityOrder;
+	unsigned int m_frameBudgetMicros = 0;
+	uint64_t m_frame = 0;
+
+	// Average cost per frame at the slot's interval: one drawn frame and interval - 1 skipped ones
+	static double FrameMicros(const Slot& slot)
+	{
+		return slot.skippedMicros + (slot.averageMicros - slot.skippedMicros) / slot.interval;
+	}
+};
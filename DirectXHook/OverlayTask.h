@@ -0,0 +1,539 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "InputHook.h"
+
+/*
+* Free lists of coroutine frames in a few size classes. Blocks are carved from chunks that are never given back,
+* so once the pool has grown to the number of live tasks, starting and finishing tasks doesn't allocate.
+* Frames above the largest class come from the heap.
+*
+* Not thread safe: tasks are created, resumed and destroyed on the present thread.
+*/
+class TaskFramePool
+{
+public:
+	static constexpr size_t NumClasses = 6;
+	static constexpr size_t SmallestBlock = 128; // classes are 128, 256 ... 4096 bytes
+	static constexpr size_t BlocksPerChunk = 32;
+
+	static TaskFramePool& Instance()
+	{
+		static TaskFramePool pool;
+		return pool;
+	}
+
+	void* Allocate(size_t size)
+	{
+		size_t sizeClass = ClassOf(size);
+		if (sizeClass == NumClasses)
+		{
+			return ::operator new(size);
+		}
+
+		if (m_freeLists[sizeClass] == nullptr)
+		{
+			Grow(sizeClass);
+		}
+
+		FreeBlock* block = m_freeLists[sizeClass];
+		m_freeLists[sizeClass] = block->next;
+		return block;
+	}
+
+	void Free(void* pointer, size_t size)
+	{
+		size_t sizeClass = ClassOf(size);
+		if (sizeClass == NumClasses)
+		{
+			::operator delete(pointer);
+			return;
+		}
+
+		FreeBlock* block = (FreeBlock*)pointer;
+		block->next = m_freeLists[sizeClass];
+		m_freeLists[sizeClass] = block;
+	}
+
+	// Chunks taken from the heap so far
+	size_t NumChunks() const
+	{
+		return m_chunks.size();
+	}
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	FreeBlock* m_freeLists[NumClasses] = { nullptr };
+	std::vector<std::unique_ptr<char[]>> m_chunks;
+
+	TaskFramePool() { }
+
+	static size_t ClassOf(size_t size)
+	{
+		size_t sizeClass = 0;
+		size_t blockSize = SmallestBlock;
+		while (sizeClass < NumClasses && blockSize < size)
+		{
+			blockSize *= 2;
+			sizeClass++;
+		}
+		return sizeClass;
+	}
+
+	void Grow(size_t sizeClass)
+	{
+		size_t blockSize = SmallestBlock << sizeClass;
+		char* chunk = new char[blockSize * BlocksPerChunk];
+		m_chunks.emplace_back(chunk);
+
+		for (size_t i = 0; i < BlocksPerChunk; i++)
+		{
+			FreeBlock* block = (FreeBlock*)(chunk + i * blockSize);
+			block->next = m_freeLists[sizeClass];
+			m_freeLists[sizeClass] = block;
+		}
+	}
+};
+
+class TaskScheduler;
+
+/*
+* A coroutine that runs across frames, started with TaskScheduler::Start() (or IRenderCallback::StartTask()).
+* The body doesn't run until the scheduler first resumes it. Once started the scheduler owns the task,
+* it is destroyed when it finishes or when the scheduler goes away.
+*
+*	OverlayTask ShowBanner()
+*	{
+*		Deadline hide = co_await After(3000);
+*		while (!hide.Passed())
+*		{
+*			DrawText(m_banner, "Loaded");
+*			co_await NextFrame();
+*		}
+*	}
+*/
+class OverlayTask
+{
+public:
+	struct promise_type
+	{
+		TaskScheduler* scheduler = nullptr;
+
+		static void* operator new(size_t size)
+		{
+			return TaskFramePool::Instance().Allocate(size);
+		}
+
+		static void operator delete(void* pointer, size_t size)
+		{
+			TaskFramePool::Instance().Free(pointer, size);
+		}
+
+		OverlayTask get_return_object()
+		{
+			return OverlayTask(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		// The scheduler destroys finished tasks.
+		std::suspend_always final_suspend() noexcept
+		{
+			return {};
+		}
+
+		void return_void() { }
+
+		void unhandled_exception()
+		{
+			std::terminate();
+		}
+	};
+
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	OverlayTask(OverlayTask&& other) noexcept
+	{
+		m_handle = other.m_handle;
+		other.m_handle = nullptr;
+	}
+
+	OverlayTask& operator=(OverlayTask&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (m_handle)
+			{
+				m_handle.destroy();
+			}
+			m_handle = other.m_handle;
+			other.m_handle = nullptr;
+		}
+		return *this;
+	}
+
+	OverlayTask(const OverlayTask&) = delete;
+	OverlayTask& operator=(const OverlayTask&) = delete;
+
+	// A task that was never started is destroyed with its OverlayTask.
+	~OverlayTask()
+	{
+		if (m_handle)
+		{
+			m_handle.destroy();
+		}
+	}
+
+	Handle Release()
+	{
+		Handle handle = m_handle;
+		m_handle = nullptr;
+		return handle;
+	}
+
+private:
+	Handle m_handle = nullptr;
+
+	explicit OverlayTask(Handle handle)
+	{
+		m_handle = handle;
+	}
+};
+
+/*
+* Runs an overlay's tasks. Resume() is the only place tasks run, the renderer calls it once per frame
+* right after the overlay's Render(), with the same drawing state, so tasks can draw.
+* Waits are kept in two heaps (by frame and by time) and a list of conditions polled every frame.
+*/
+class TaskScheduler
+{
+public:
+	typedef uint64_t(*Clock)(); // monotonic milliseconds
+
+	static uint64_t SteadyClockMillis()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// A condition checked every frame, lives in the awaiting task's frame.
+	struct PolledWait
+	{
+		OverlayTask::Handle handle = nullptr;
+		virtual bool Ready() = 0;
+	};
+
+	TaskScheduler(Clock clock = &SteadyClockMillis)
+	{
+		m_clock = clock;
+	}
+
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+	~TaskScheduler()
+	{
+		CancelAll();
+	}
+
+	// The task first runs in the next Resume().
+	void Start(OverlayTask task)
+	{
+		OverlayTask::Handle handle = task.Release();
+		handle.promise().scheduler = this;
+		m_numTasks++;
+		WaitFrames(handle, 1);
+	}
+
+	void Resume()
+	{
+		m_frame++;
+		m_now = m_clock();
+
+		while (!m_frameWaits.empty() && m_frameWaits.front().due <= m_frame)
+		{
+			std::pop_heap(m_frameWaits.begin(), m_frameWaits.end(), Later);
+			m_resumeList.push_back(m_frameWaits.back().handle);
+			m_frameWaits.pop_back();
+		}
+
+		while (!m_timeWaits.empty() && m_timeWaits.front().due <= m_now)
+		{
+			std::pop_heap(m_timeWaits.begin(), m_timeWaits.end(), Later);
+			m_resumeList.push_back(m_timeWaits.back().handle);
+			m_timeWaits.pop_back();
+		}
+
+		for (size_t i = 0; i < m_polledWaits.size(); )
+		{
+			if (m_polledWaits[i]->Ready())
+			{
+				m_resumeList.push_back(m_polledWaits[i]->handle);
+				m_polledWaits[i] = m_polledWaits.back();
+				m_polledWaits.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		// Tasks resumed here wait again for a later frame, nothing they do adds to this list.
+		for (OverlayTask::Handle handle : m_resumeList)
+		{
+			handle.resume();
+			if (handle.done())
+			{
+				handle.destroy();
+				m_numTasks--;
+			}
+		}
+		m_resumeList.clear();
+	}
+
+	void CancelAll()
+	{
+		for (const Wait& wait : m_frameWaits)
+		{
+			wait.handle.destroy();
+		}
+		for (const Wait& wait : m_timeWaits)
+		{
+			wait.handle.destroy();
+		}
+		for (PolledWait* wait : m_polledWaits)
+		{
+			wait->handle.destroy();
+		}
+		m_frameWaits.clear();
+		m_timeWaits.clear();
+		m_polledWaits.clear();
+		m_numTasks = 0;
+	}
+
+	size_t NumTasks() const
+	{
+		return m_numTasks;
+	}
+
+	// Number of Resume() calls so far
+	uint64_t Frame() const
+	{
+		return m_frame;
+	}
+
+	// The clock as read at the start of the current Resume()
+	uint64_t Now() const
+	{
+		return m_now;
+	}
+
+	void WaitFrames(OverlayTask::Handle handle, uint64_t frames)
+	{
+		m_frameWaits.push_back({ m_frame + std::max<uint64_t>(frames, 1), handle });
+		std::push_heap(m_frameWaits.begin(), m_frameWaits.end(), Later);
+	}
+
+	void WaitUntilTime(OverlayTask::Handle handle, uint64_t millis)
+	{
+		m_timeWaits.push_back({ millis, handle });
+		std::push_heap(m_timeWaits.begin(), m_timeWaits.end(), Later);
+	}
+
+	void WaitFor(PolledWait* wait)
+	{
+		m_polledWaits.push_back(wait);
+	}
+
+private:
+	struct Wait
+	{
+		uint64_t due = 0;
+		OverlayTask::Handle handle = nullptr;
+	};
+
+	Clock m_clock = nullptr;
+	uint64_t m_frame = 0;
+	uint64_t m_now = 0;
+	size_t m_numTasks = 0;
+	std::vector<Wait> m_frameWaits; // min-heaps by due
+	std::vector<Wait> m_timeWaits;
+	std::vector<PolledWait*> m_polledWaits;
+	std::vector<OverlayTask::Handle> m_resumeList;
+
+	static bool Later(const Wait& a, const Wait& b)
+	{
+		return a.due > b.due;
+	}
+};
+
+/*
+* Awaitables for OverlayTask. Each one suspends the task and hands it to the task's scheduler.
+*/
+struct FramesAwaiter
+{
+	uint64_t frames = 1;
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	void await_suspend(OverlayTask::Handle handle)
+	{
+		handle.promise().scheduler->WaitFrames(handle, frames);
+	}
+
+	void await_resume() const noexcept { }
+};
+
+struct DelayAwaiter
+{
+	uint64_t millis = 0;
+
+	bool await_ready() const noexcept
+	{
+		return millis == 0;
+	}
+
+	void await_suspend(OverlayTask::Handle handle)
+	{
+		TaskScheduler* scheduler = handle.promise().scheduler;
+		scheduler->WaitUntilTime(handle, scheduler->Now() + millis);
+	}
+
+	void await_resume() const noexcept { }
+};
+
+// A point in time on the scheduler's clock, see After().
+struct Deadline
+{
+	TaskScheduler* scheduler = nullptr;
+	uint64_t due = 0;
+
+	// Turns true on the frame a Delay() started at the same time would resume.
+	bool Passed() const
+	{
+		return scheduler->Now() >= due;
+	}
+};
+
+// Doesn't suspend, the task gets a Deadline and keeps running (and drawing) every frame until it has passed.
+struct DeadlineAwaiter
+{
+	uint64_t millis = 0;
+	Deadline deadline;
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	bool await_suspend(OverlayTask::Handle handle)
+	{
+		deadline.scheduler = handle.promise().scheduler;
+		deadline.due = deadline.scheduler->Now() + millis;
+		return false;
+	}
+
+	Deadline await_resume() const noexcept
+	{
+		return deadline;
+	}
+};
+
+// Polled once per frame, the predicate is kept in the task's frame.
+// Without CheckNow the wait always lasts until a later frame, even if the predicate is already true.
+template<typename Predicate, bool CheckNow = true>
+struct UntilAwaiter : TaskScheduler::PolledWait
+{
+	Predicate predicate;
+
+	UntilAwaiter(Predicate predicate) : predicate(std::move(predicate)) { }
+
+	bool Ready() override
+	{
+		return predicate();
+	}
+
+	bool await_ready()
+	{
+		return CheckNow && predicate();
+	}
+
+	void await_suspend(OverlayTask::Handle handle)
+	{
+		this->handle = handle;
+		handle.promise().scheduler->WaitFor(this);
+	}
+
+	void await_resume() const noexcept { }
+};
+
+inline FramesAwaiter NextFrame()
+{
+	return FramesAwaiter{ 1 };
+}
+
+inline FramesAwaiter Frames(uint64_t frames)
+{
+	return FramesAwaiter{ frames };
+}
+
+// Resumes on the first frame at least the given number of milliseconds later.
+inline DelayAwaiter Delay(uint64_t millis)
+{
+	return DelayAwaiter{ millis };
+}
+
+// A deadline the given number of milliseconds from now on the scheduler's clock.
+inline DeadlineAwaiter After(uint64_t millis)
+{
+	return DeadlineAwaiter{ millis };
+}
+
+template<typename Predicate>
+UntilAwaiter<Predicate> Until(Predicate predicate)
+{
+	return UntilAwaiter<Predicate>(std::move(predicate));
+}
+
+// Waits for an asset queued with AssetCache::RequestTexture() or RequestFont(). The cache loads queued assets
+// before the overlays render, so the task resumes in the frame its asset was loaded in.
+//
+//	std::shared_ptr<const AssetRequest> icon = AssetCache::Instance().RequestTexture(m_device.Get(), "hook_textures\\icon.png");
+//	co_await AssetReady(icon);
+template<typename Request>
+auto AssetReady(std::shared_ptr<Request> request)
+{
+	return Until([request]
+	{
+		return request->Done();
+	});
+}
+
+// Resumes on the next frame the key is pressed, with the modifier held if one is given (0 for none).
+// A press in the frame the task started waiting doesn't count, so waiting on the same key in a loop is safe.
+inline auto Hotkey(uint8_t key, uint8_t modifier = 0)
+{
+	auto pressed = [key, modifier]
+	{
+		const KeyState& keys = InputHook::Instance().Keys();
+		return keys.WasPressed(key) && (modifier == 0 || keys.IsDown(modifier));
+	};
+	return UntilAwaiter<decltype(pressed), false>(pressed);
+}
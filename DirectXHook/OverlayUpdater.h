@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "IRenderCallback.h"
+#include "Logger.h"
+#include "Trace.h"
+
+/*
+* Runs the Update() phase of overlays on a background thread, each at its own interval,
+* so reading game memory and crunching numbers doesn't add to the game's frame time.
+* Overlays hand their results to Render() through a TripleBuffer.
+* Stop() ends and joins the thread. It must not be called from DllMain (the thread can't exit under the loader lock),
+* the renderer calls it when the game destroys its window.
+*/
+class OverlayUpdater
+{
+public:
+	OverlayUpdater() { }
+
+	OverlayUpdater(const OverlayUpdater&) = delete;
+	OverlayUpdater& operator=(const OverlayUpdater&) = delete;
+
+	// Only reached at unload or process exit when Stop() wasn't called, under the loader lock where joining would
+	// deadlock (at process exit the thread is already gone). The thread is told to stop and let go, it only
+	// touches the shared state, which lives until the thread is done with it.
+	~OverlayUpdater()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			m_state->stopping = true;
+		}
+		m_state->wakeUp.notify_one();
+		if (m_thread.joinable())
+		{
+			m_thread.detach();
+		}
+	}
+
+	void Add(IRenderCallback* overlay, unsigned int intervalMillis)
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		if (m_state->stopping)
+		{
+			return;
+		}
+
+		Entry entry;
+		entry.overlay = overlay;
+		entry.interval = std::chrono::milliseconds(intervalMillis);
+		entry.nextUpdate = std::chrono::steady_clock::now();
+		m_state->entries.push_back(entry);
+
+		if (!m_thread.joinable())
+		{
+			m_logger.Log("Starting update thread");
+			m_thread = std::thread(&OverlayUpdater::Run, m_state);
+		}
+
+		m_state->wakeUp.notify_one();
+	}
+
+	// Waits for a running Update() to return, no overlay is updated afterwards.
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			if (m_state->stopping)
+			{
+				return;
+			}
+			m_state->stopping = true;
+		}
+
+		m_state->wakeUp.notify_one();
+		if (m_thread.joinable())
+		{
+			m_thread.join();
+			m_logger.Log("Stopped update thread");
+		}
+	}
+
+private:
+	struct Entry
+	{
+		IRenderCallback* overlay = nullptr;
+		std::chrono::milliseconds interval{ 0 };
+		std::chrono::steady_clock::time_point nextUpdate;
+	};
+
+	// Shared with the thread, so a detached thread never touches a destroyed updater.
+	struct State
+	{
+		std::mutex mutex;
+		std::condition_variable wakeUp;
+		std::vector<Entry> entries;
+		bool stopping = false;
+	};
+
+	Logger m_logger{ "OverlayUpdater" };
+	std::shared_ptr<State> m_state = std::make_shared<State>();
+	std::thread m_thread;
+
+	static void Run(std::shared_ptr<State> state)
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		std::vector<Entry>& entries = state->entries;
+		while (!state->stopping)
+		{
+			auto earliest = entries[0].nextUpdate;
+			for (const Entry& entry : entries)
+			{
+				if (entry.nextUpdate < earliest)
+				{
+					earliest = entry.nextUpdate;
+				}
+			}
+
+			size_t numEntries = entries.size();
+			state->wakeUp.wait_until(lock, earliest, [&] { return state->stopping || entries.size() != numEntries; });
+
+			auto now = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < entries.size() && !state->stopping; i++)
+			{
+				if (entries[i].nextUpdate > now)
+				{
+					continue;
+				}
+
+				// Skip missed updates instead of running them back to back.
+				entries[i].nextUpdate += entries[i].interval;
+				if (entries[i].nextUpdate < now)
+				{
+					entries[i].nextUpdate = now + entries[i].interval;
+				}
+
+				IRenderCallback* overlay = entries[i].overlay;
+				lock.unlock();
+				{
+					TRACE_SCOPE("IRenderCallback::Update");
+					overlay->Update();
+				}
+				lock.lock();
+			}
+		}
+	}
+};
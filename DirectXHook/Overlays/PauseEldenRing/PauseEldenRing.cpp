@@ -15,29 +15,13 @@ void PauseEldenRing::Setup()
 	SetFont(m_font);
 }
 
+// The gate handles the keybind on the window's thread, so unpausing doesn't depend on this running.
 void PauseEldenRing::Render()
 {
-	while (m_gamePaused)
-	{
-		if (MsgWaitForMultipleObjects(0, nullptr, FALSE, 100, QS_ALLINPUT) == WAIT_OBJECT_0)
-		{
-			if (CheckHotkey(m_keybind))
-			{
-				m_gamePaused = false;
-				return;
-			}
-			MSG msg;
-			if (GetMessage(&msg, NULL, 0, 0) != -1)
-			{
-				TranslateMessage(&msg);
-				DispatchMessage(&msg);
-			}
-		}
-	}
+	CheckConfigChanges();
 
-	if (CheckHotkey(m_keybind))
+	if (PresentGate::Instance().IsHolding())
 	{
-		m_gamePaused = true;
 		DrawBox(m_pauseWindow, 0, 0, 0, 240);
 		DrawBox(m_topBar, m_barTexture);
 		DrawBox(m_bottomBar, m_rotatedBarTexture);
@@ -47,32 +31,68 @@ void PauseEldenRing::Render()
 
 void PauseEldenRing::ReadConfigFile(unsigned int* keybind)
 {
-	m_configFile.open(m_configFileName, std::fstream::in);
-	if (m_configFile.is_open())
+	std::shared_ptr<const ConfigSnapshot> config = m_config.Snapshot();
+	m_configVersion = config->Version();
+
+	if (config->Loaded() && config->NumEntries() == 0 && ReadLegacyConfigFile(config->Text(), keybind))
 	{
-		std::string line = "";
-		getline(m_configFile, line);
-		if (line.length() < 3)
-		{
-			*keybind = 'P';
-		}
-		else
-		{
-			std::stringstream stringStream(line.substr(2, line.length()));
-			m_logger.Log("Read keybind line: %s", line);
-			stringStream >> std::hex >> *keybind;
-			m_logger.Log("Keybind is: 0x%x", *keybind);
-		}
-		m_configFile.close();
+		m_logger.Log("Keybind is: 0x%x, converting %s to the key = value format", *keybind, m_config.FileName().c_str());
+		WriteConfigFile(*keybind);
+	}
+	else if (config->Loaded())
+	{
+		*keybind = (unsigned int)config->GetInt("", "keybind", 'P');
+		m_stepKeybind = (unsigned int)config->GetInt("", "step_keybind", 0);
+		m_logger.Log("Keybind is: 0x%x", *keybind);
 	}
 	else
 	{
 		m_logger.Log("Using default keybind");
-		m_configFile.open(m_configFileName, std::fstream::out);
-		if (m_configFile.is_open())
-		{
-			m_configFile << "0x50";
-			m_configFile.close();
-		}
+		WriteConfigFile('P');
 	}
+
+	PresentGate::Instance().BindKeys((uint8_t)*keybind, (uint8_t)m_stepKeybind);
 }
+
+// Older versions wrote only the keybind in hex on the first line, like 0x50.
+bool PauseEldenRing::ReadLegacyConfigFile(std::string_view text, unsigned int* keybind)
+{
+	std::string_view line = text.substr(0, text.find_first_of("\r\n"));
+	line = line.substr(0, line.find_last_not_of(" \t") + 1);
+	if (line.size() < 3 || line[0] != '0' || (line[1] != 'x' && line[1] != 'X'))
+	{
+		return false;
+	}
+
+	unsigned int value = 0;
+	std::from_chars_result parsed = std::from_chars(line.data() + 2, line.data() + line.size(), value, 16);
+	if (parsed.ec != std::errc() || parsed.ptr != line.data() + line.size())
+	{
+		return false;
+	}
+
+	*keybind = value;
+	return true;
+}
+
+void PauseEldenRing::WriteConfigFile(unsigned int keybind)
+{
+	std::ofstream configFile(m_config.FileName());
+	if (configFile.is_open())
+	{
+		configFile << "keybind = 0x" << std::hex << keybind << std::endl;
+	}
+	else
+	{
+		m_logger.Log("Failed to write %s", m_config.FileName().c_str());
+	}
+}
+
+// Picks up edits to the keybind without restarting the game.
+void PauseEldenRing::CheckConfigChanges()
+{
+	if (m_config.Snapshot()->Version() != m_configVersion)
+	{
+		ReadConfigFile(&m_keybind);
+	}
+}
\ No newline at end of file
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <charconv>
+#include <fstream>
+#include <string_view>
+
 #include "IRenderCallback.h"
 #include "OverlayFramework.h"
 #include "Logger.h"
+#include "Config.h"
+#include "PresentGate.h"
 
 class PauseEldenRing : public IRenderCallback
 {
@@ -12,16 +18,19 @@ public:
 
 private:
 	Logger m_logger{ "PauseEldenRing" };
-	std::fstream m_configFile;
-	std::string m_configFileName = "pause_keybind.txt";
+	ConfigStore m_config{ "pause_keybind.txt" }; // keybind = 0x50, step_keybind (optional, advances one frame while paused)
+	uint64_t m_configVersion = 0;
 	unsigned int m_keybind = 'P';
+	unsigned int m_stepKeybind = 0;
 	OF::Box* m_pauseWindow = nullptr;
 	OF::Box* m_topBar = nullptr;
 	OF::Box* m_bottomBar = nullptr;
 	int m_font = 0;
 	int m_barTexture = 0;
 	int m_rotatedBarTexture = 0;
-	bool m_gamePaused = false;
 
 	void ReadConfigFile(unsigned int* keybind);
+	bool ReadLegacyConfigFile(std::string_view text, unsigned int* keybind);
+	void WriteConfigFile(unsigned int keybind);
+	void CheckConfigChanges();
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "ProfilerHud.h"
+
+using namespace OF;
+
+void ProfilerHud::Setup()
+{
+	InitFramework(m_device, m_spriteBatch, m_window);
+	m_hudWindow = CreateBox(10, 10, 420, LineHeight + 8);
+	m_font = LoadFont("hook_fonts\\OpenSans-22.spritefont");
+	m_parallelPrepare = true;
+}
+
+// Reads the profiler's copy from the last EndFrame(), the live node table can grow on the present thread meanwhile.
+void ProfilerHud::Prepare()
+{
+	const Profiler::Snapshot& frame = Profiler::Instance().LastFrame();
+	m_numLines = SortNodes(frame, -1, 0);
+
+	double share = frame.frameMicros > 0 ? 100.0 * frame.hookMicros / frame.frameMicros : 0;
+	snprintf(m_header, sizeof(m_header), "Frame %.2f ms   Hook %.2f ms (%.1f%%)", frame.frameMicros / 1000.0, frame.hookMicros / 1000.0, share);
+
+	for (int i = 0; i < m_numLines; i++)
+	{
+		const Profiler::Snapshot::Entry& node = frame.nodes[m_order[i]];
+		snprintf(m_names[i], sizeof(m_names[i]), "%*s%s", node.depth * 3, "", node.name);
+		snprintf(m_timings[i], sizeof(m_timings[i]), "%7.1f us  %7.1f us  x%.0f", node.inclusiveMicros, node.exclusiveMicros, node.calls);
+	}
+}
+
+void ProfilerHud::Render()
+{
+	m_hudWindow->height = (m_numLines + 1) * LineHeight + 8;
+	DrawBox(m_hudWindow, 0, 0, 0, 160);
+	SetFont(m_font);
+
+	DrawText(m_hudWindow, m_header, 6, 2, 0.4f);
+	for (int i = 0; i < m_numLines; i++)
+	{
+		DrawText(m_hudWindow, m_names[i], 6, 2 + (i + 1) * LineHeight, 0.4f);
+		DrawText(m_hudWindow, m_timings[i], 220, 2 + (i + 1) * LineHeight, 0.4f);
+	}
+}
+
+// Depth first order of the scope tree, nodes are stored in the order they were first entered.
+int ProfilerHud::SortNodes(const Profiler::Snapshot& frame, int parent, int count)
+{
+	for (int i = 0; i < frame.numNodes; i++)
+	{
+		if (frame.nodes[i].parent == parent)
+		{
+			m_order[count++] = i;
+			count = SortNodes(frame, i, count);
+		}
+	}
+	return count;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "IRenderCallback.h"
+#include "OverlayFramework.h"
+#include "Profiler.h"
+
+// Shows the profiler's scope tree and the hook's share of the frame time. Added when the profiler is enabled.
+class ProfilerHud : public IRenderCallback
+{
+public:
+	void Setup();
+	void Prepare();
+	void Render();
+
+private:
+	static constexpr int LineHeight = 16;
+
+	OF::Box* m_hudWindow = nullptr;
+	int m_font = -1;
+	int m_order[Profiler::MaxNodes] = { 0 };
+
+	// Formatted in Prepare(), drawn in Render()
+	char m_header[128] = "";
+	char m_names[Profiler::MaxNodes][64] = { };
+	char m_timings[Profiler::MaxNodes][64] = { };
+	int m_numLines = 0;
+
+	int SortNodes(const Profiler::Snapshot& frame, int parent, int count);
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+* Multi-resolution summary of a damage series for drawing graphs of any time span at column resolution.
+* Level k holds min/max/sum of aligned buckets of 2^k ticks. Adding a tick completes at most one bucket per level,
+* so appending is O(levels) and nothing is ever rescanned.
+*
+* Every level keeps only its most recent LevelCapacity buckets, so memory is fixed. Recent ranges are answered exactly,
+* old range edges that fell out of the fine levels are rounded out to the enclosing coarser bucket.
+*/
+class DamagePyramid
+{
+public:
+	static constexpr int NumLevels = 16; // the top level has buckets of 2^15 ticks, about 9 hours of seconds
+	static constexpr size_t LevelCapacity = 1024;
+
+	struct Summary
+	{
+		uint64_t min = 0;
+		uint64_t max = 0;
+		uint64_t sum = 0;
+		uint64_t count = 0;
+
+		void Merge(const Summary& other)
+		{
+			if (other.count == 0)
+			{
+				return;
+			}
+
+			if (count == 0 || other.min < min)
+			{
+				min = other.min;
+			}
+			if (count == 0 || other.max > max)
+			{
+				max = other.max;
+			}
+			sum += other.sum;
+			count += other.count;
+		}
+	};
+
+	DamagePyramid()
+	{
+		m_levels.resize((size_t)NumLevels * LevelCapacity);
+	}
+
+	void Add(uint64_t value)
+	{
+		uint64_t tick = m_numTicks;
+		Summary& leaf = Node(0, tick);
+		leaf.min = value;
+		leaf.max = value;
+		leaf.sum = value;
+		leaf.count = 1;
+		m_numTicks++;
+
+		// Every level whose bucket ends with this tick combines its two children.
+		for (int level = 1; level < NumLevels && (m_numTicks & (((uint64_t)1 << level) - 1)) == 0; level++)
+		{
+			uint64_t bucket = (m_numTicks >> level) - 1;
+			Summary combined = Node(level - 1, bucket * 2);
+			combined.Merge(Node(level - 1, bucket * 2 + 1));
+			Node(level, bucket) = combined;
+		}
+	}
+
+	void Reset()
+	{
+		m_numTicks = 0;
+	}
+
+	uint64_t NumTicks() const
+	{
+		return m_numTicks;
+	}
+
+	// Summary of the ticks [begin, end)
+	Summary Range(uint64_t begin, uint64_t end) const
+	{
+		Summary result;
+		if (end > m_numTicks)
+		{
+			end = m_numTicks;
+		}
+
+		uint64_t tick = begin;
+		while (tick < end)
+		{
+			// The biggest aligned bucket starting here that doesn't go past the end
+			int level = 0;
+			while (level + 1 < NumLevels
+				&& (tick & (((uint64_t)2 << level) - 1)) == 0
+				&& tick + ((uint64_t)2 << level) <= end)
+			{
+				level++;
+			}
+
+			// Fine buckets this old were overwritten, fall back to the coarser bucket containing them.
+			while (level + 1 < NumLevels && !IsStored(level, tick >> level))
+			{
+				level++;
+			}
+
+			uint64_t bucket = tick >> level;
+			if (IsStored(level, bucket))
+			{
+				result.Merge(Node(level, bucket));
+			}
+			tick = (bucket + 1) << level;
+		}
+
+		return result;
+	}
+
+	// Splits the ticks [begin, end) into numColumns equal spans, oldest first.
+	// Spans shorter than one tick repeat the tick, so short ranges are stretched over all columns.
+	void Summarize(uint64_t begin, uint64_t end, size_t numColumns, std::vector<Summary>* columns) const
+	{
+		columns->resize(numColumns);
+		uint64_t length = end > begin ? end - begin : 0;
+		for (size_t column = 0; column < numColumns; column++)
+		{
+			uint64_t columnBegin = begin + length * column / numColumns;
+			uint64_t columnEnd = begin + length * (column + 1) / numColumns;
+			if (columnEnd == columnBegin && length != 0)
+			{
+				columnEnd = columnBegin + 1;
+			}
+			(*columns)[column] = Range(columnBegin, columnEnd);
+		}
+	}
+
+private:
+	std::vector<Summary> m_levels; // LevelCapacity buckets per level, a ring each
+	uint64_t m_numTicks = 0;
+
+	Summary& Node(int level, uint64_t bucket)
+	{
+		return m_levels[level * LevelCapacity + bucket % LevelCapacity];
+	}
+
+	const Summary& Node(int level, uint64_t bucket) const
+	{
+		return m_levels[level * LevelCapacity + bucket % LevelCapacity];
+	}
+
+	// Whether the bucket is complete and not overwritten yet
+	bool IsStored(int level, uint64_t bucket) const
+	{
+		uint64_t numBuckets = m_numTicks >> level;
+		return bucket < numBuckets && bucket + LevelCapacity >= numBuckets;
+	}
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+* Damage over a whole fight in a fixed number of time buckets, for the whole fight graph.
+* Add() puts damage into the bucket of its timestamp. When the fight outgrows the buckets, neighbouring buckets
+* are merged and the bucket length doubles, so memory is fixed and adding is O(1) amortized.
+* Columns() spreads the buckets over the graph's columns by overlap, which costs the same for any fight length.
+*/
+class DamageTimeline
+{
+public:
+	static constexpr size_t NumBuckets = 2048;
+
+	// The first bucket length, short fights keep detail down to it.
+	DamageTimeline(uint64_t bucketMillis = 50) : m_initialBucketMillis(bucketMillis)
+	{
+		m_buckets.resize(NumBuckets, 0);
+		m_bucketMillis = m_initialBucketMillis;
+	}
+
+	// The first call starts the fight, timestamps must not go backwards.
+	void Add(uint64_t timestamp, uint64_t damage)
+	{
+		if (m_empty)
+		{
+			m_start = timestamp;
+			m_empty = false;
+		}
+
+		uint64_t bucket = (timestamp - m_start) / m_bucketMillis;
+		while (bucket >= NumBuckets)
+		{
+			for (size_t i = 0; i < NumBuckets / 2; i++)
+			{
+				m_buckets[i] = m_buckets[2 * i] + m_buckets[2 * i + 1];
+			}
+			std::fill(m_buckets.begin() + NumBuckets / 2, m_buckets.end(), 0);
+			m_numUsed = (m_numUsed + 1) / 2;
+			m_bucketMillis *= 2;
+			bucket = (timestamp - m_start) / m_bucketMillis;
+		}
+
+		m_buckets[bucket] += damage;
+		m_numUsed = std::max(m_numUsed, (size_t)bucket + 1);
+	}
+
+	void Reset()
+	{
+		std::fill(m_buckets.begin(), m_buckets.end(), 0);
+		m_bucketMillis = m_initialBucketMillis;
+		m_numUsed = 0;
+		m_empty = true;
+	}
+
+	bool Empty() const
+	{
+		return m_empty;
+	}
+
+	uint64_t Start() const
+	{
+		return m_start;
+	}
+
+	uint64_t BucketMillis() const
+	{
+		return m_bucketMillis;
+	}
+
+	// Damage from the start of the fight until now in numColumns equal spans, oldest first.
+	// A bucket that straddles columns is shared between them by overlap.
+	void Columns(uint64_t now, size_t numColumns, std::vector<uint64_t>* columns) const
+	{
+		columns->assign(numColumns, 0);
+		if (m_empty || numColumns == 0)
+		{
+			return;
+		}
+
+		double span = (double)(now - m_start + 1);
+		m_columnDamage.assign(numColumns, 0);
+		for (size_t bucket = 0; bucket < m_numUsed; bucket++)
+		{
+			uint64_t damage = m_buckets[bucket];
+			if (damage == 0)
+			{
+				continue;
+			}
+
+			// Bucket extent in columns, clipped to now
+			double begin = std::min((double)(bucket * m_bucketMillis), span - 1) * numColumns / span;
+			double end = std::min((double)((bucket + 1) * m_bucketMillis), span) * numColumns / span;
+			if (end <= begin)
+			{
+				m_columnDamage[std::min((size_t)begin, numColumns - 1)] += (double)damage;
+				continue;
+			}
+
+			double perColumn = damage / (end - begin);
+			for (size_t column = (size_t)begin; column < numColumns && column < end; column++)
+			{
+				double overlap = std::min(end, (double)column + 1) - std::max(begin, (double)column);
+				m_columnDamage[column] += perColumn * overlap;
+			}
+		}
+
+		for (size_t column = 0; column < numColumns; column++)
+		{
+			(*columns)[column] = (uint64_t)(m_columnDamage[column] + 0.5);
+		}
+	}
+
+private:
+	std::vector<uint64_t> m_buckets;
+	mutable std::vector<double> m_columnDamage; // scratch for Columns()
+	uint64_t m_initialBucketMillis = 50;
+	uint64_t m_bucketMillis = 50;
+	uint64_t m_start = 0;
+	size_t m_numUsed = 0;
+	bool m_empty = true;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+* Damage statistics for a fight, fed one tick (one second of damage) at a time for every entity (party member) at once.
+* Every Add() is O(entities) and memory is fixed: the last Capacity ticks live in a ring,
+* windowed sums are kept running and "High" comes from a monotonic queue per entity over the ring.
+*
+* Stats are stored as structure of arrays, one row of entities per tick/window, so a tick updates
+* all entities in a few tight loops. The sum of all entities is tracked as one extra entity, Party().
+*/
+class DpsStatistics
+{
+public:
+	static constexpr size_t Capacity = 21600; // 6 hours of one second ticks
+	static constexpr int MaxEntities = 8;
+
+	enum Window
+	{
+		FiveSeconds,
+		ThirtySeconds,
+		OneMinute,
+		WholeFight
+	};
+
+	DpsStatistics(int numEntities = 1)
+	{
+		m_numEntities = numEntities;
+		if (m_numEntities > MaxEntities)
+		{
+			m_numEntities = MaxEntities;
+		}
+		m_stride = m_numEntities + 1;
+		m_ticks.resize((size_t)Capacity * m_stride, 0);
+		m_maxQueues.resize((size_t)Capacity * m_stride, 0);
+		m_maxHeads.resize(m_stride, 0);
+		m_maxTails.resize(m_stride, 0);
+		m_totals.resize(m_stride, 0);
+		m_windowSums.resize(NumSlidingWindows * m_stride, 0);
+	}
+
+	int NumEntities() const
+	{
+		return m_numEntities;
+	}
+
+	// Index of the party total, usable wherever an entity index is
+	int Party() const
+	{
+		return m_numEntities;
+	}
+
+	// Adds one tick, damage holds one value per entity.
+	void Add(const uint64_t* damage)
+	{
+		uint64_t tick = m_numTicks;
+
+		uint64_t values[MaxEntities + 1];
+		uint64_t party = 0;
+		for (int entity = 0; entity < m_numEntities; entity++)
+		{
+			values[entity] = damage[entity];
+			party += damage[entity];
+		}
+		values[m_numEntities] = party;
+
+		// Unsigned wrap-around makes "+ new - expired" exact even when the subtraction underflows on its own.
+		for (int window = 0; window < NumSlidingWindows; window++)
+		{
+			uint64_t* sums = &m_windowSums[window * m_stride];
+			if (tick >= WindowLength(window))
+			{
+				const uint64_t* expired = Row(tick - WindowLength(window));
+				for (int entity = 0; entity < m_stride; entity++)
+				{
+					sums[entity] += values[entity] - expired[entity];
+				}
+			}
+			else
+			{
+				for (int entity = 0; entity < m_stride; entity++)
+				{
+					sums[entity] += values[entity];
+				}
+			}
+		}
+
+		// Drop the tick that is about to be overwritten, then every tick that can never be the max again.
+		for (int entity = 0; entity < m_stride; entity++)
+		{
+			uint64_t* queue = &m_maxQueues[entity * Capacity];
+			uint64_t& head = m_maxHeads[entity];
+			uint64_t& tail = m_maxTails[entity];
+			if (head != tail && queue[head % Capacity] + Capacity <= tick)
+			{
+				head++;
+			}
+			while (head != tail && Row(queue[(tail - 1) % Capacity])[entity] <= values[entity])
+			{
+				tail--;
+			}
+			queue[tail % Capacity] = tick;
+			tail++;
+		}
+
+		uint64_t* row = &m_ticks[(tick % Capacity) * m_stride];
+		for (int entity = 0; entity < m_stride; entity++)
+		{
+			row[entity] = values[entity];
+			m_totals[entity] += values[entity];
+		}
+		m_numTicks++;
+	}
+
+	void Reset()
+	{
+		m_numTicks = 0;
+		std::fill(m_maxHeads.begin(), m_maxHeads.end(), 0);
+		std::fill(m_maxTails.begin(), m_maxTails.end(), 0);
+		std::fill(m_totals.begin(), m_totals.end(), 0);
+		std::fill(m_windowSums.begin(), m_windowSums.end(), 0);
+	}
+
+	double Dps(int entity, Window window) const
+	{
+		if (m_numTicks == 0)
+		{
+			return 0;
+		}
+
+		if (window == WholeFight)
+		{
+			return (double)m_totals[entity] / m_numTicks;
+		}
+
+		uint64_t length = WindowLength(window) < m_numTicks ? WindowLength(window) : m_numTicks;
+		return (double)m_windowSums[window * m_stride + entity] / length;
+	}
+
+	// Most damage in a single tick, over the ticks still in the ring (the whole fight for fights under 6 hours).
+	uint64_t High(int entity) const
+	{
+		if (m_maxHeads[entity] == m_maxTails[entity])
+		{
+			return 0;
+		}
+		return Row(m_maxQueues[entity * Capacity + m_maxHeads[entity] % Capacity])[entity];
+	}
+
+	uint64_t Total(int entity) const
+	{
+		return m_totals[entity];
+	}
+
+	uint64_t NumTicks() const
+	{
+		return m_numTicks;
+	}
+
+	// Number of ticks that can be read back with Ago()
+	size_t NumStored() const
+	{
+		if (m_numTicks < Capacity)
+		{
+			return (size_t)m_numTicks;
+		}
+		return (size_t)Capacity;
+	}
+
+	// Damage of the tick that many ticks ago, 0 is the latest.
+	uint64_t Ago(int entity, size_t ticks) const
+	{
+		return Row(m_numTicks - 1 - ticks)[entity];
+	}
+
+private:
+	static constexpr int NumSlidingWindows = 3;
+
+	static uint64_t WindowLength(int window)
+	{
+		switch (window)
+		{
+		case FiveSeconds:
+			return 5;
+		case ThirtySeconds:
+			return 30;
+		default:
+			return 60;
+		}
+	}
+
+	const uint64_t* Row(uint64_t tick) const
+	{
+		return &m_ticks[(tick % Capacity) * m_stride];
+	}
+
+	int m_numEntities = 1;
+	int m_stride = 2; // entities plus the party total
+	std::vector<uint64_t> m_ticks; // one row of m_stride values per tick
+	std::vector<uint64_t> m_maxQueues; // per entity: tick numbers with decreasing damage, front is the max
+	std::vector<uint64_t> m_maxHeads;
+	std::vector<uint64_t> m_maxTails;
+	std::vector<uint64_t> m_totals;
+	std::vector<uint64_t> m_windowSums; // one row of m_stride values per window
+	uint64_t m_numTicks = 0;
+};
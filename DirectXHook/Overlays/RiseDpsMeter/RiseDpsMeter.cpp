@@ -8,7 +8,7 @@ void RiseDpsMeter::Setup()
 
 	int defaultXPos = ofWindowWidth / 2;
 	int defaultYPos = ofWindowHeight / 2;
-	ReadConfigFile(&defaultXPos, &defaultYPos);
+	bool placed = ReadConfigFile(&defaultXPos, &defaultYPos);
 
 	m_dpsMeterWindow = CreateBox(defaultXPos, defaultYPos, 400, 180);
 	m_dpsMeterWindowDivider = CreateBox(m_dpsMeterWindow, 23, m_dpsMeterWindow->height - 40, m_dpsMeterWindow->width - 46, 1);
@@ -25,12 +25,30 @@ void RiseDpsMeter::Setup()
 	{
 		m_graphColumns.push_back(CreateBox(m_dpsMeterWindow, i + 25, m_dpsMeterWindow->height - 41, 1, 0));
 	}
+
+	m_graphHeights = std::vector<int>(numColumns, 0);
+	DpsSnapshot emptySnapshot;
+	emptySnapshot.graphHeights = m_graphHeights;
+	m_snapshots.Reset(emptySnapshot);
+	m_updateInterval = 50;
+
+	StartTask(ShowCornerText());
+	if (!placed)
+	{
+		StartTask(PlaceMeter());
+	}
 }
 
-void RiseDpsMeter::Render()
+// Runs on the update thread, reads the game's memory and prepares everything Render() shows.
+void RiseDpsMeter::Update()
 {
-	CheckMouseEvents();
-	CheckHotkeys();
+	if (!m_addressesResolved)
+	{
+		ResolveAddresses();
+		m_addressesResolved = true;
+	}
+
+	ExtractHits();
 
 	m_playerOneTotalDamage = ReadPlayerOneDamage();
 	if (m_playerOneTotalDamage == 0)
@@ -42,49 +60,95 @@ void RiseDpsMeter::Render()
 	}
 	else
 	{
-		if (m_timerUpdateDps.Check())
+		uint64_t now = TimerWheel::SteadyClockMillis();
+		if (m_wholeFightDamage.Empty())
 		{
-			UpdateDamageStats();
-			UpdateGraph();
+			m_combatLog.HuntStart(now);
 		}
 
-		if (!m_userDisabledDpsMeter)
+		// Only changes are recorded, which keeps the history small.
+		// A counter going down means the quest was left or restarted, like for ticks that's no damage.
+		int64_t previous = m_playerOneDamageHistory.Empty() ? 0 : m_playerOneDamageHistory.Last().value;
+		if (m_playerOneDamageHistory.Empty() || previous != (int64_t)m_playerOneTotalDamage)
 		{
-			DrawDpsMeter();
+			m_playerOneDamageHistory.Append(now, (int64_t)m_playerOneTotalDamage);
+			m_wholeFightDamage.Add(now, (int64_t)m_playerOneTotalDamage > previous ? m_playerOneTotalDamage - (uint64_t)previous : 0);
+		}
+
+		if (m_playerOneTotalDamage != m_playerOneLoggedDamage)
+		{
+			m_combatLog.Damage(now, 0, m_playerOneTotalDamage);
+			m_playerOneLoggedDamage = m_playerOneTotalDamage;
+		}
+
+		if (m_timerUpdateDps == 0)
+		{
+			m_timerUpdateDps = m_updateTimers.Every(1000, [this]
+			{
+				UpdateDamageStats();
+				UpdateGraph();
+			});
 		}
 	}
 
-	if (m_showPlaceholder)
+	UpdateSampleRate(m_playerOneTotalDamage != 0);
+	m_updateTimers.Advance();
+	PublishSnapshot();
+}
+
+// Hits need the full rate, out of combat a slow rate notices the fight starting and with the meter off nothing is sampled.
+void RiseDpsMeter::UpdateSampleRate(bool inCombat)
+{
+	unsigned int sampleRateHz = inCombat ? HitSampleRateHz : IdleSampleRateHz;
+	if (m_userDisabledDpsMeter.load(std::memory_order_relaxed))
 	{
-		DrawPlaceholder();
+		sampleRateHz = 0;
 	}
 
-	if (m_showCornerText)
+	if (sampleRateHz == m_sampleRateHz)
 	{
-		if (m_timerCornerText.Check())
-		{
-			m_showCornerText = false;
-		}
-		DrawCornerText();
+		return;
+	}
+
+	m_sampleRateHz = sampleRateHz;
+	if (m_playerOneDamageWatch != -1)
+	{
+		m_memoryWatch.SetSampleRate(m_playerOneDamageWatch, sampleRateHz);
 	}
 }
 
-void RiseDpsMeter::DrawDpsMeter()
+void RiseDpsMeter::Render()
 {
-	std::ostringstream playerOneAvgDpsString;
-	playerOneAvgDpsString << std::fixed << std::setprecision(1) << m_playerOneAvgDps;
+	CheckMouseEvents();
+	CheckHotkeys();
+	CheckConfigChanges();
+
+	const DpsSnapshot& snapshot = m_snapshots.Read();
+	if (snapshot.inCombat && !m_userDisabledDpsMeter)
+	{
+		DrawDpsMeter(snapshot);
+	}
 
+}
+
+void RiseDpsMeter::DrawDpsMeter(const DpsSnapshot& snapshot)
+{
 	DrawBox(m_dpsMeterWindow, 0, 0, 0, 130);
 	DrawBox(m_dpsMeterWindowDivider, 255, 255, 255, 255);
 
-	for (auto box : m_graphColumns)
+	for (size_t i = 0; i < m_graphColumns.size(); i++)
 	{
+		Box* box = m_graphColumns[i];
+		box->height = snapshot.graphHeights[i];
+		box->y = m_dpsMeterWindow->height - 41 - box->height;
 		DrawBox(box, 125, 125, 255, 255);
 	}
 
-	DrawText(m_dpsMeterWindow, "DPS: " + playerOneAvgDpsString.str(), 20, m_dpsMeterWindow->height - 32, 0.6f);
-	DrawText(m_dpsMeterWindow, "High: " + std::to_string(m_playerOneMostDmgInOneSecond), 162, m_dpsMeterWindow->height - 32, 0.6f);
-	DrawText(m_dpsMeterWindow, "Total: " + std::to_string(m_playerOneTotalDamage), 287, m_dpsMeterWindow->height - 32, 0.6f);
+	DrawText(m_dpsMeterWindow, snapshot.dpsText, 20, m_dpsMeterWindow->height - 32, 0.6f);
+	DrawText(m_dpsMeterWindow, snapshot.highText, 162, m_dpsMeterWindow->height - 32, 0.6f);
+	DrawText(m_dpsMeterWindow, snapshot.totalText, 287, m_dpsMeterWindow->height - 32, 0.6f);
+	DrawText(m_dpsMeterWindow, snapshot.windowText, 20, 2, 0.45f);
+	DrawText(m_dpsMeterWindow, snapshot.hitText, 20, 18, 0.45f);
 }
 
 void RiseDpsMeter::DrawPlaceholder()
@@ -105,14 +169,6 @@ void RiseDpsMeter::DrawPlaceholder()
 	DrawBox(m_placeholderOkButton, 0, 0, 0, 0);
 	DrawBox(m_placeholderOkButtonBorder, color, color, color, 255);
 	DrawText(m_placeholderOkButton, "Ok", 14, -3, 0.7f, color, color, color);
-
-	if (m_placeholderOkButton->clicked)
-	{
-		m_showPlaceholder = false;
-		m_dpsMeterWindow->x = m_placeholderWindow->x;
-		m_dpsMeterWindow->y = m_placeholderWindow->y;
-		m_dpsMeterConfigFile.open(m_configFileName, std::fstream::out);
-	}
 }
 
 void RiseDpsMeter::DrawCornerText()
@@ -120,85 +176,193 @@ void RiseDpsMeter::DrawCornerText()
 	DrawText(m_cornerWindow, "RiseDpsMeter v1.1 loaded", 0, 0, 0.5f);
 }
 
-void RiseDpsMeter::UpdateDamageStats()
+// Without a saved position the placeholder is shown until the user has moved it and clicked ok.
+OverlayTask RiseDpsMeter::PlaceMeter()
+{
+	while (!m_placeholderOkButton->clicked)
+	{
+		DrawPlaceholder();
+		co_await NextFrame();
+	}
+
+	m_dpsMeterWindow->x = m_placeholderWindow->x;
+	m_dpsMeterWindow->y = m_placeholderWindow->y;
+	m_savePosition = true;
+}
+
+OverlayTask RiseDpsMeter::ShowCornerText()
 {
-	if (m_dpsHistory.size() > 21600)
+	Deadline hide = co_await After(3000);
+	while (!hide.Passed())
 	{
-		m_dpsHistory.erase(m_dpsHistory.begin());
+		DrawCornerText();
+		co_await NextFrame();
 	}
+}
 
-	m_dpsHistory.push_back(m_playerOneTotalDamage - m_playerOnePreviousTotalDamage);
+void RiseDpsMeter::UpdateDamageStats()
+{
+	// A counter going down means the quest was left or restarted, that's no damage for this tick.
+	uint64_t damage = m_playerOneTotalDamage >= m_playerOnePreviousTotalDamage ? m_playerOneTotalDamage - m_playerOnePreviousTotalDamage : 0;
 	m_playerOnePreviousTotalDamage = m_playerOneTotalDamage;
+	m_playerOneStats.Add(&damage);
+	m_damagePyramid.Add(damage);
+}
 
-	if (m_dpsHistory.back() > m_playerOneMostDmgInOneSecond)
+// Consumes every sample the memory watch took since the last call. Samples that were already overwritten
+// (the update thread stalled for more than a second) are skipped, the hits in them are lost but the totals aren't.
+void RiseDpsMeter::ExtractHits()
+{
+	if (m_playerOneDamageWatch == -1)
 	{
-		m_playerOneMostDmgInOneSecond = m_dpsHistory.back();
+		return;
 	}
 
-	m_playerOneAvgDps = 0;
-	for (auto dps : m_dpsHistory)
+	uint64_t end = m_memoryWatch.SampleCount(m_playerOneDamageWatch);
+	uint64_t sequence = m_nextHitSample;
+	if (end - sequence > MemoryWatch::HistorySize - 1)
 	{
-		m_playerOneAvgDps += dps;
+		sequence = end - (MemoryWatch::HistorySize - 1);
+		m_lastHitSample.valid = false;
 	}
-	m_playerOneAvgDps /= m_dpsHistory.size();
-}
 
-void RiseDpsMeter::UpdateGraph()
-{
-	for (int i = m_graphColumns.size() - 1, j = m_dpsHistory.size() - 1;
-		i > -1 && j > -1;
-		i--, j--)
+	WatchSample& last = m_lastHitSample;
+	for (; sequence < end; sequence++)
 	{
-		if (m_dpsHistory[j] != 0)
+		WatchSample sample;
+		if (!m_memoryWatch.Sample(m_playerOneDamageWatch, sequence, &sample) || !sample.valid)
 		{
-			m_graphColumns[i]->height = MapIntToRange(m_dpsHistory[j], 0, m_playerOneMostDmgInOneSecond, 0, 130);
-			m_graphColumns[i]->y = m_dpsMeterWindow->height - 41 - m_graphColumns[i]->height;
+			last.valid = false;
+			continue;
 		}
 
-		if (i != m_graphColumns.size() - 1 && j != m_dpsHistory.size() - 1 && m_dpsHistory[j + 1] == 0)
+		if (last.valid)
 		{
-			m_graphColumns[i + 1]->height = m_graphColumns[i]->height * 0.8;
-			m_graphColumns[i + 1]->y = m_dpsMeterWindow->height - 41 - m_graphColumns[i + 1]->height;
+			uint64_t previous = last.AsView<DamageView>().Get<TotalDamage>();
+			uint64_t current = sample.AsView<DamageView>().Get<TotalDamage>();
+			if (previous != 0)
+			{
+				m_sampleIntervals.Record(sample.timestamp - last.timestamp); // out of combat the watch samples slowly
+			}
+			if (current > previous)
+			{
+				m_hitSizes.Record(current - previous);
+			}
 		}
+		last = sample;
 	}
+	m_nextHitSample = end;
 }
 
-uint64_t RiseDpsMeter::ReadPlayerOneDamage()
+// Column heights come from the damage pyramid, so any range costs about the same no matter how long the fight is.
+void RiseDpsMeter::UpdateGraph()
 {
-	m_playerOneDamageAddress = ReadPointerChain(m_playerOneDamagePointerChain);
-	if (m_playerOneDamageAddress != 0)
+	size_t numColumns = m_graphHeights.size();
+	uint64_t numTicks = m_damagePyramid.NumTicks();
+	GraphRange range = m_graphRange.load(std::memory_order_relaxed);
+	if (range == GraphRange::WholeFight)
 	{
-		return *(uintptr_t*)m_playerOneDamageAddress;
+		UpdateWholeFightGraph();
+		return;
+	}
+
+	uint64_t span = range == GraphRange::LastMinute ? 60 : numColumns;
+
+	if (span > numTicks)
+	{
+		span = numTicks;
+	}
+
+	// The default range scrolls one tick per column, the last minute is stretched over the whole graph.
+	size_t usedColumns = range == GraphRange::Recent ? (size_t)span : numColumns;
+	std::fill(m_graphHeights.begin(), m_graphHeights.end(), 0);
+	if (span == 0)
+	{
+		return;
+	}
+
+	m_damagePyramid.Summarize(numTicks - span, numTicks, usedColumns, &m_graphColumnSummaries);
+
+	uint64_t high = 0;
+	for (const DamagePyramid::Summary& summary : m_graphColumnSummaries)
+	{
+		high = summary.max > high ? summary.max : high;
+	}
+
+	if (high == 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < usedColumns; i++)
+	{
+		m_graphHeights[numColumns - usedColumns + i] = (int)(m_graphColumnSummaries[i].max * 130 / high);
 	}
-	return 0;
 }
 
-uintptr_t RiseDpsMeter::ReadPointerChain(std::vector<uintptr_t> pointerChain)
+// The whole fight comes from the damage timeline, which starts with buckets at the update rate instead of
+// one value per tick, so fights shorter than the graph is wide still fill it with detail.
+// Every column shows the damage dealt in its share of the fight, the cost doesn't grow with the fight.
+void RiseDpsMeter::UpdateWholeFightGraph()
 {
-	uintptr_t pointer = pointerChain[0];
-	MEMORY_BASIC_INFORMATION memoryInfo;
-	for (int i = 0; i < pointerChain.size() - 1; i++)
+	size_t numColumns = m_graphHeights.size();
+	std::fill(m_graphHeights.begin(), m_graphHeights.end(), 0);
+	if (m_wholeFightDamage.Empty() || numColumns == 0)
 	{
-		if (!VirtualQuery((void*)pointer, &memoryInfo, sizeof(MEMORY_BASIC_INFORMATION)))
-		{
-			return 0;
-		} 
-		else if (memoryInfo.Protect == PAGE_READWRITE && memoryInfo.State == MEM_COMMIT)
-		{
-			pointer = *(uintptr_t*)pointer;
-			if (pointer == 0)
-			{
-				return 0;
-			}
-		}
-		else
-		{
-			return 0;
-		}
+		return;
+	}
 
-		pointer += pointerChain[i + 1];
+	m_wholeFightDamage.Columns(TimerWheel::SteadyClockMillis(), numColumns, &m_graphColumnDamage);
+	uint64_t high = *std::max_element(m_graphColumnDamage.begin(), m_graphColumnDamage.end());
+	if (high == 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < numColumns; i++)
+	{
+		m_graphHeights[i] = (int)(m_graphColumnDamage[i] * 130 / high);
 	}
-	return pointer;
+}
+
+void RiseDpsMeter::PublishSnapshot()
+{
+	DpsSnapshot& snapshot = m_snapshots.WriteBuffer();
+	snapshot.inCombat = m_playerOneTotalDamage != 0;
+	snprintf(snapshot.dpsText, sizeof(snapshot.dpsText), "DPS: %.1f", m_playerOneStats.Dps(0, DpsStatistics::WholeFight));
+	snprintf(snapshot.highText, sizeof(snapshot.highText), "High: %llu", (unsigned long long)m_playerOneStats.High(0));
+	snprintf(snapshot.totalText, sizeof(snapshot.totalText), "Total: %llu", (unsigned long long)m_playerOneTotalDamage);
+	uint64_t fightSeconds = 0;
+	if (!m_wholeFightDamage.Empty())
+	{
+		fightSeconds = (TimerWheel::SteadyClockMillis() - m_wholeFightDamage.Start()) / 1000;
+	}
+
+	snprintf(snapshot.windowText, sizeof(snapshot.windowText), "5s: %.1f  30s: %.1f  60s: %.1f  %llu:%02llu",
+		m_playerOneStats.Dps(0, DpsStatistics::FiveSeconds),
+		m_playerOneStats.Dps(0, DpsStatistics::ThirtySeconds),
+		m_playerOneStats.Dps(0, DpsStatistics::OneMinute),
+		(unsigned long long)(fightSeconds / 60), (unsigned long long)(fightSeconds % 60));
+
+	snprintf(snapshot.hitText, sizeof(snapshot.hitText), "Hits: %llu  Biggest: %llu  Median: %llu  95th: %llu",
+		(unsigned long long)m_hitSizes.Count(),
+		(unsigned long long)m_hitSizes.Max(),
+		(unsigned long long)m_hitSizes.ValueAtPercentile(50),
+		(unsigned long long)m_hitSizes.ValueAtPercentile(95));
+
+	snapshot.graphHeights = m_graphHeights;
+	m_snapshots.Publish();
+}
+
+// The damage counters are sampled by the memory watch thread, this only picks up the latest sample.
+uint64_t RiseDpsMeter::ReadPlayerOneDamage()
+{
+	WatchSample sample;
+	if (m_playerOneDamageWatch != -1 && m_memoryWatch.Latest(m_playerOneDamageWatch, &sample) && sample.valid)
+	{
+		return sample.AsView<DamageView>().Get<TotalDamage>();
+	}
+	return 0;
 }
 
 void RiseDpsMeter::CheckHotkeys()
@@ -212,15 +376,27 @@ void RiseDpsMeter::CheckHotkeys()
 	}
 	else if (CheckHotkey('P'))
 	{
-		if (m_userDisabledDpsMeter)
-		{
-			m_userDisabledDpsMeter = false;
-		}
-		else
+		m_userDisabledDpsMeter.store(!m_userDisabledDpsMeter.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	} 
+
+	// Clicking the meter (without dragging it) switches what the graph shows.
+	if (m_dpsMeterWindow->clicked && !m_dpsMeterWindow->draggable)
+	{
+		GraphRange range = m_graphRange.load(std::memory_order_relaxed);
+		switch (range)
 		{
-			m_userDisabledDpsMeter = true;
+		case GraphRange::Recent:
+			range = GraphRange::LastMinute;
+			break;
+		case GraphRange::LastMinute:
+			range = GraphRange::WholeFight;
+			break;
+		default:
+			range = GraphRange::Recent;
+			break;
 		}
-	} 
+		m_graphRange.store(range, std::memory_order_relaxed);
+	}
 
 	if (CheckHotkey(HK_NONE, VK_LMENU))
 	{
@@ -234,51 +410,176 @@ void RiseDpsMeter::CheckHotkeys()
 	}
 }
 
-void RiseDpsMeter::ReadConfigFile(int* x, int* y)
+// Returns false if there is no config yet, the user then places the meter.
+bool RiseDpsMeter::ReadConfigFile(int* x, int* y)
 {
-	m_dpsMeterConfigFile.open(m_configFileName, std::fstream::in);
+	std::shared_ptr<const ConfigSnapshot> config = m_config.Snapshot();
+	m_configVersion = config->Version();
+
+	if (!config->Loaded())
+	{
+		return false;
+	}
+
+	if (config->NumEntries() == 0 && ReadLegacyConfigFile(config->Text(), x, y))
+	{
+		m_logger.Log("Converting %s to the [window] format", m_config.FileName().c_str());
+		WriteConfigFile(*x, *y);
+		m_savePosition = true;
+		return true;
+	}
 
-	if (m_dpsMeterConfigFile.is_open())
+	*x = (int)config->GetInt("window", "x", *x);
+	*y = (int)config->GetInt("window", "y", *y);
+	m_savePosition = true;
+	return true;
+}
+
+// The store reloads the file in the background, this only compares versions.
+void RiseDpsMeter::CheckConfigChanges()
+{
+	std::shared_ptr<const ConfigSnapshot> config = m_config.Snapshot();
+	if (config->Version() == m_configVersion)
 	{
-		std::string line = "";
-		getline(m_dpsMeterConfigFile, line);
-		std::stringstream stringStream(line);
-		std::istream_iterator<std::string> begin(stringStream);
-		std::istream_iterator<std::string> end;
-		std::vector<std::string> values(begin, end);
-		if (values.size() == 2)
+		return;
+	}
+
+	m_configVersion = config->Version();
+	if (config->Has("window", "x") && config->Has("window", "y"))
+	{
+		m_dpsMeterWindow->x = (int)config->GetInt("window", "x");
+		m_dpsMeterWindow->y = (int)config->GetInt("window", "y");
+		m_placeholderWindow->x = m_dpsMeterWindow->x;
+		m_placeholderWindow->y = m_dpsMeterWindow->y;
+	}
+}
+
+// Older versions wrote the position as "x y" on the first line.
+bool RiseDpsMeter::ReadLegacyConfigFile(std::string_view text, int* x, int* y)
+{
+	std::istringstream line(std::string(text.substr(0, text.find_first_of("\r\n"))));
+	int legacyX = 0, legacyY = 0;
+	std::string rest;
+	if (!(line >> legacyX >> legacyY) || line >> rest)
+	{
+		return false;
+	}
+
+	*x = legacyX;
+	*y = legacyY;
+	return true;
+}
+
+void RiseDpsMeter::WriteConfigFile()
+{
+	WriteConfigFile(m_dpsMeterWindow->x, m_dpsMeterWindow->y);
+}
+
+void RiseDpsMeter::WriteConfigFile(int x, int y)
+{
+	std::ofstream configFile(m_config.FileName());
+	if (configFile.is_open())
+	{
+		configFile << "[window]" << std::endl;
+		configFile << "x = " << x << std::endl;
+		configFile << "y = " << y << std::endl;
+	}
+	else
+	{
+		m_logger.Log("Failed to write %s", m_config.FileName().c_str());
+	}
+}
+
+// Scanning the game's image takes a moment, so this runs on the update thread rather than in Setup().
+void RiseDpsMeter::ResolveAddresses()
+{
+	PeImage game = PeImage::MainModule();
+	std::vector<uintptr_t> pointerChain = m_playerOneDamagePointerChain;
+	pointerChain[0] += game.Base();
+	if (!m_playerOneDamageSignature.empty())
+	{
+		ResolveFromSignature(game, "PlayerOneDamage", m_playerOneDamageSignature, &pointerChain);
+	}
+
+	m_playerOneDamageWatch = m_memoryWatch.WatchStruct<DamageView>(pointerChain, IdleSampleRateHz);
+}
+
+// A scan result is cached on disk for the game build it was found in.
+void RiseDpsMeter::ResolveFromSignature(const PeImage& game, const std::string& name, const std::string& signature, std::vector<uintptr_t>* pointerChain)
+{
+	// mov reg, [rip + displacement]: the displacement starts at byte 3 of the 7 byte instruction
+	constexpr size_t DisplacementOffset = 3;
+	constexpr size_t InstructionSize = 7;
+
+	std::vector<uint64_t> keyOffsets = { DisplacementOffset, InstructionSize };
+	keyOffsets.insert(keyOffsets.end(), pointerChain->begin() + 1, pointerChain->end());
+	uint64_t key = AddressCache::Key(signature, keyOffsets);
+
+	AddressCache cache(m_addressCacheFileName, ModuleFingerprint::Of(game, *m_gameMemory));
+	cache.Load();
+
+	const CachedAddress* cached = cache.Lookup(name, key);
+	uintptr_t cachedBase = 0;
+	if (cached != nullptr && cached->offsets.size() == pointerChain->size() - 1
+		&& m_gameMemory->Read(game.Base() + cached->moduleOffset, &cachedBase) && cachedBase != 0)
+	{
+		(*pointerChain)[0] = game.Base() + cached->moduleOffset;
+		std::copy(cached->offsets.begin(), cached->offsets.end(), pointerChain->begin() + 1);
+		return;
+	}
+
+	std::vector<Signature> signatures = { Signature::Parse(name, signature).RipRelative(DisplacementOffset, InstructionSize) };
+	std::vector<ScanResult> results = SignatureScanner().Scan(game.CodeAndDataSections(), signatures);
+	uintptr_t scannedBase = 0;
+	if (results[0].matchCount == 1 && m_gameMemory->Read(results[0].resolved, &scannedBase) && scannedBase != 0)
+	{
+		if (results[0].resolved != (*pointerChain)[0])
 		{
-			*x = std::stoi(values[0]);
-			*y = std::stoi(values[1]);
+			m_logger.Log("%s signature found the base at module offset 0x%llx instead of 0x%llx", name.c_str(),
+				(unsigned long long)(results[0].resolved - game.Base()), (unsigned long long)((*pointerChain)[0] - game.Base()));
 		}
-		m_dpsMeterConfigFile.close();
-		m_dpsMeterConfigFile.open(m_configFileName, std::fstream::out);
+		(*pointerChain)[0] = results[0].resolved;
+		cache.Store(name, key, (*pointerChain)[0] - game.Base(), std::vector<uintptr_t>(pointerChain->begin() + 1, pointerChain->end()));
+		cache.Save();
 	}
 	else
 	{
-		m_showPlaceholder = true;
+		m_logger.Log("%s signature matched %llu times or found no base, using the module offset", name.c_str(), (unsigned long long)results[0].matchCount);
 	}
 }
 
 void RiseDpsMeter::ResetState()
 {
-	m_dpsHistory.clear();
-	for (auto box : m_graphColumns)
+	m_playerOneStats.Reset();
+	m_damagePyramid.Reset();
+	if (!m_wholeFightDamage.Empty())
+	{
+		m_combatLog.HuntEnd(TimerWheel::SteadyClockMillis());
+	}
+
+	if (m_sampleIntervals.Count() != 0)
 	{
-		box->height = 0;
+		m_logger.Log("Damage sampling interval over the hunt: median %llu us, 99th %llu us, max %llu us",
+			(unsigned long long)m_sampleIntervals.ValueAtPercentile(50),
+			(unsigned long long)m_sampleIntervals.ValueAtPercentile(99),
+			(unsigned long long)m_sampleIntervals.Max());
 	}
+	m_hitSizes.Reset();
+	m_sampleIntervals.Reset();
+	m_playerOneDamageHistory.Clear();
+	m_wholeFightDamage.Reset();
+	m_playerOneLoggedDamage = 0;
+	std::fill(m_graphHeights.begin(), m_graphHeights.end(), 0);
 	m_playerOneTotalDamage = 0;
 	m_playerOnePreviousTotalDamage = 0;
-	m_playerOneAvgDps = 0;
-	m_playerOneMostDmgInOneSecond = 0;
-	m_timerUpdateDps.Reset();
+	m_updateTimers.Cancel(m_timerUpdateDps);
+	m_timerUpdateDps = 0;
 }
 
 RiseDpsMeter::~RiseDpsMeter()
 {
-	if (m_dpsMeterConfigFile.is_open())
+	if (m_savePosition)
 	{
-		m_dpsMeterConfigFile << m_dpsMeterWindow->x << " " << m_dpsMeterWindow->y << std::endl;
-		m_dpsMeterConfigFile.close();
+		WriteConfigFile();
 	}
 }
\ No newline at end of file
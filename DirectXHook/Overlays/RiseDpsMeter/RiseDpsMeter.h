@@ -3,62 +3,64 @@
 #include <SpriteBatch.h>
 #include <d3d11.h>
 #include <vector>
-#include <iomanip>
+#include <fstream>
 #include <sstream>
-#include <istream>
-#include <iterator>
+#include <string_view>
 
 #include "IRenderCallback.h"
 #include "OverlayFramework.h"
+#include "TripleBuffer.h"
+#include "TimerWheel.h"
+#include "ProcessMemoryAccess.h"
+#include "MemoryWatch.h"
+#include "TimeSeries.h"
+#include "CombatLog.h"
+#include "PeImage.h"
+#include "SignatureScanner.h"
+#include "AddressCache.h"
+#include "DpsStatistics.h"
+#include "DamagePyramid.h"
+#include "DamageTimeline.h"
+#include "HdrHistogram.h"
+#include "Config.h"
+#include "Logger.h"
 
-class Timer
+class RiseDpsMeter : public IRenderCallback
 {
 public:
-	Timer(unsigned int millis)
-	{
-		m_interval = millis;
-	}
+	void Setup();
+	void Render();
+	void Update();
+	~RiseDpsMeter();
 
-	bool Check()
+private:
+	enum class GraphRange
 	{
-		auto now = std::chrono::system_clock::now();
-		if (m_resetOnNextCheck)
-		{
-			m_lastExecutionTime = now;
-			m_resetOnNextCheck = false;
-			return false;
-		}
-
-		auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastExecutionTime);
-		if (diff.count() >= m_interval)
-		{
-			m_lastExecutionTime = now;
-			return true;
-		}
+		Recent, // one second per column
+		LastMinute,
+		WholeFight
+	};
 
-		return false;
-	}
+	Logger m_logger{ "RiseDpsMeter" };
 
-	void Reset()
+	// Everything Render() needs, produced by Update() on the update thread.
+	struct DpsSnapshot
 	{
-		m_resetOnNextCheck = true;
-	}
-private:
-	unsigned int m_interval = 0;
-	bool m_resetOnNextCheck = true;
-	std::chrono::system_clock::time_point m_lastExecutionTime;
-};
+		bool inCombat = false;
+		char dpsText[32] = { 0 };
+		char highText[32] = { 0 };
+		char totalText[32] = { 0 };
+		char windowText[80] = { 0 };
+		char hitText[96] = { 0 };
+		std::vector<int> graphHeights;
+	};
 
-class RiseDpsMeter : public IRenderCallback
-{
-public:
-	void Setup();
-	void Render();
-	~RiseDpsMeter();
+	TripleBuffer<DpsSnapshot> m_snapshots;
 
-private:
-	std::fstream m_dpsMeterConfigFile;
-	std::string m_configFileName = "rise_dps_meter.cfg";
+	ConfigStore m_config{ "rise_dps_meter.cfg" }; // [window] x, y
+	uint64_t m_configVersion = 0;
+	bool m_savePosition = false; // once the user has placed the meter
+	std::string m_addressCacheFileName = "rise_dps_meter_addresses.bin";
 	OF::Box* m_cornerWindow = nullptr;
 	OF::Box* m_dpsMeterWindow = nullptr;
 	OF::Box* m_dpsMeterWindowDivider = nullptr;
@@ -66,38 +68,81 @@ private:
 	OF::Box* m_placeholderOkButton = nullptr;
 	OF::Box* m_placeholderOkButtonBorder = nullptr;
 	std::vector<OF::Box*> m_graphColumns;
-	std::vector<uint64_t> m_dpsHistory;
+	std::vector<int> m_graphHeights;
+	std::vector<DamagePyramid::Summary> m_graphColumnSummaries;
+	std::vector<uint64_t> m_graphColumnDamage; // whole fight graph
+	std::atomic<GraphRange> m_graphRange{ GraphRange::Recent };
+	// Only player one's damage counter is known, the other party members' aren't tracked.
+	DamagePyramid m_damagePyramid; // damage per tick, for the recent and last minute graphs
+	// Damage counter changes at the update rate, in steady clock milliseconds. Bounded to 256 KB, the last half hour or more,
+	// the whole fight graph comes from m_wholeFightDamage.
+	static constexpr size_t MaxHistoryBlocks = 64;
+	TimeSeries m_playerOneDamageHistory{ MaxHistoryBlocks };
+	DamageTimeline m_wholeFightDamage; // for the whole fight graph
+	CombatLog m_combatLog{ "rise_dps_meter_combat.log" }; // every hunt, for offline analysis with CombatLogReader
+	uint64_t m_playerOneLoggedDamage = 0;
+	DpsStatistics m_playerOneStats;
 	uint64_t m_playerOneTotalDamage = 0;
 	uint64_t m_playerOnePreviousTotalDamage = 0;
-	uint64_t m_playerOneMostDmgInOneSecond = 0;
-	double m_playerOneAvgDps = 0;
-	Timer m_timerUpdateDps{ 1000 };
-	Timer m_timerCornerText{ 3000 };
-	bool m_showCornerText = true;
-	bool m_showPlaceholder = false;
+
+	// Hits are told apart by sampling the damage counters much faster than a hit can happen,
+	// every increase between two samples is one hit.
+	static constexpr unsigned int HitSampleRateHz = 1000;
+	static constexpr unsigned int IdleSampleRateHz = 10; // out of combat, only to notice the first hit
+	unsigned int m_sampleRateHz = IdleSampleRateHz; // of the damage watches, 0 while the meter is turned off
+	HdrHistogram m_hitSizes; // damage per hit
+	HdrHistogram m_sampleIntervals; // microseconds between samples, to see how steady the sampling is
+	uint64_t m_nextHitSample = 0;
+	WatchSample m_lastHitSample;
+	TimerWheel m_updateTimers; // advanced by Update()
+	TimerWheel::TimerId m_timerUpdateDps = 0;
 	bool m_showDpsMeter = false;
-	bool m_userDisabledDpsMeter = false;
+	std::atomic<bool> m_userDisabledDpsMeter{ false }; // toggled by Render(), read by Update()
 	int m_font = -1;
 
+	// The first entry is relative to the game's module base so it survives ASLR,
+	// a signature for the instruction that loads it (if set) makes it survive patches as well.
+	// The signature is unverified: mov rax, [rip + base] followed by the chain's first hop, mov rcx, [rax + 0x70].
+	// When it doesn't match exactly once, or points at an unreadable base, the module offset is used as before.
+	std::string m_playerOneDamageSignature = "48 8B 05 ?? ?? ?? ?? 48 8B 48 70 48 85 C9";
 	std::vector<uintptr_t> m_playerOneDamagePointerChain =
 	{
-		0x14C0A8A30,
+		0xC0A8A30,
 		0x70,
 		0x30,
 		0xB0,
 		0x4E0,
-		0x18
+		0 // the damage structure, see DamageView
 	};
-	uintptr_t m_playerOneDamageAddress = 0;
 
-	void DrawDpsMeter();
+	// Fields of the structure at the end of the damage pointer chain, only the total is known so far.
+	// Fields added here are sampled in the same read.
+	typedef Field<uint64_t, 0x18> TotalDamage;
+	typedef StructView<TotalDamage> DamageView;
+	std::shared_ptr<ProcessMemoryAccess> m_gameMemory = std::make_shared<ProcessMemoryAccess>();
+	MemoryWatch m_memoryWatch{ m_gameMemory };
+	MemoryWatch::WatchId m_playerOneDamageWatch = -1;
+	bool m_addressesResolved = false;
+
+	void DrawDpsMeter(const DpsSnapshot& snapshot);
 	void DrawPlaceholder();
 	void DrawCornerText();
+	OverlayTask PlaceMeter();
+	OverlayTask ShowCornerText();
 	void UpdateDamageStats();
+	void ExtractHits();
+	void UpdateSampleRate(bool inCombat);
 	void UpdateGraph();
+	void UpdateWholeFightGraph();
+	void PublishSnapshot();
 	uint64_t ReadPlayerOneDamage();
-	uintptr_t ReadPointerChain(std::vector<uintptr_t> pointerChain);
 	void CheckHotkeys();
-	void ReadConfigFile(int* x, int* y);
+	bool ReadConfigFile(int* x, int* y);
+	bool ReadLegacyConfigFile(std::string_view text, int* x, int* y);
+	void CheckConfigChanges();
+	void WriteConfigFile();
+	void WriteConfigFile(int x, int y);
+	void ResolveAddresses();
+	void ResolveFromSignature(const PeImage& game, const std::string& name, const std::string& signature, std::vector<uintptr_t>* pointerChain);
 	void ResetState();
 };
\ No newline at end of file
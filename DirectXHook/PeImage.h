@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Windows.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "SignatureScanner.h"
+
+/*
+* Reads the headers of a PE image that is mapped into memory (a loaded module),
+* e.g. to get the sections worth scanning for signatures.
+*/
+class PeImage
+{
+public:
+	PeImage(const void* base) : m_base((const uint8_t*)base)
+	{
+		if (m_base == nullptr)
+		{
+			return;
+		}
+
+		const IMAGE_DOS_HEADER* dosHeader = (const IMAGE_DOS_HEADER*)m_base;
+		if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE)
+		{
+			return;
+		}
+
+		const IMAGE_NT_HEADERS* ntHeaders = (const IMAGE_NT_HEADERS*)(m_base + dosHeader->e_lfanew);
+		if (ntHeaders->Signature != IMAGE_NT_SIGNATURE || ntHeaders->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR_MAGIC)
+		{
+			return;
+		}
+
+		m_ntHeaders = ntHeaders;
+	}
+
+	// The main executable of the process
+	static PeImage MainModule()
+	{
+		return PeImage(GetModuleHandle(nullptr));
+	}
+
+	bool IsValid() const
+	{
+		return m_ntHeaders != nullptr;
+	}
+
+	uintptr_t Base() const
+	{
+		return (uintptr_t)m_base;
+	}
+
+	uint32_t TimeDateStamp() const
+	{
+		return m_ntHeaders->FileHeader.TimeDateStamp;
+	}
+
+	uint32_t SizeOfImage() const
+	{
+		return m_ntHeaders->OptionalHeader.SizeOfImage;
+	}
+
+	// Readable code and initialized data sections, as ranges for the signature scanner.
+	// Pages that aren't committed and readable right now (guard pages, protected by a packer) are left out.
+	std::vector<ScanRange> CodeAndDataSections() const
+	{
+		return Sections(IMAGE_SCN_CNT_CODE | IMAGE_SCN_CNT_INITIALIZED_DATA);
+	}
+
+	// Readable code sections only, these don't change while the game runs.
+	std::vector<ScanRange> CodeSections() const
+	{
+		return Sections(IMAGE_SCN_CNT_CODE);
+	}
+
+private:
+	const uint8_t* m_base = nullptr;
+	const IMAGE_NT_HEADERS* m_ntHeaders = nullptr;
+
+	std::vector<ScanRange> Sections(DWORD contentFlags) const
+	{
+		std::vector<ScanRange> ranges;
+		if (!IsValid())
+		{
+			return ranges;
+		}
+
+		const IMAGE_SECTION_HEADER* section = IMAGE_FIRST_SECTION(m_ntHeaders);
+		for (WORD i = 0; i < m_ntHeaders->FileHeader.NumberOfSections; i++, section++)
+		{
+			DWORD flags = section->Characteristics;
+			if (!(flags & contentFlags) || !(flags & IMAGE_SCN_MEM_READ) || (flags & IMAGE_SCN_MEM_DISCARDABLE))
+			{
+				continue;
+			}
+
+			// The mapped size, packed executables often have sections with no raw data that are filled in at runtime.
+			DWORD size = section->Misc.VirtualSize != 0 ? section->Misc.VirtualSize : section->SizeOfRawData;
+			if (size == 0)
+			{
+				continue;
+			}
+
+			AddReadableRanges(Base() + section->VirtualAddress, size, &ranges);
+		}
+		return ranges;
+	}
+
+	// Splits [start, start + size) into the runs of pages that can be read without faulting.
+	static void AddReadableRanges(uintptr_t start, size_t size, std::vector<ScanRange>* ranges)
+	{
+		const DWORD readableFlags = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+			PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+		uintptr_t end = start + size;
+		uintptr_t address = start;
+		while (address < end)
+		{
+			MEMORY_BASIC_INFORMATION memoryInfo;
+			if (!VirtualQuery((void*)address, &memoryInfo, sizeof(MEMORY_BASIC_INFORMATION)))
+			{
+				return;
+			}
+
+			uintptr_t regionEnd = std::min(end, (uintptr_t)memoryInfo.BaseAddress + memoryInfo.RegionSize);
+			bool readable = memoryInfo.State == MEM_COMMIT
+				&& (memoryInfo.Protect & readableFlags) != 0
+				&& (memoryInfo.Protect & (PAGE_GUARD | PAGE_NOACCESS)) == 0;
+			if (readable)
+			{
+				// Adjacent readable regions with different protections are scanned as one range.
+				if (!ranges->empty() && ranges->back().address + ranges->back().size == address)
+				{
+					ranges->back().size += regionEnd - address;
+				}
+				else
+				{
+					ScanRange range;
+					range.data = (const uint8_t*)address;
+					range.size = regionEnd - address;
+					range.address = address;
+					ranges->push_back(range);
+				}
+			}
+			address = regionEnd;
+		}
+	}
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "MemoryAccess.h"
+#include "Logger.h"
+
+/*
+* Resolves a pointer chain (a base address followed by offsets) and caches the result.
+* Every pointer read along the way is remembered, on the next Resolve() the chain is validated by
+* re-reading those pointers with guarded reads, which costs no syscalls.
+* Only when a pointer changed (or can't be read) is the chain walked again, with fresh page information.
+* An empty chain is rejected and never resolves.
+*/
+class PointerChainResolver
+{
+public:
+	PointerChainResolver(IMemoryAccess& memory, PageCache& pages, const std::vector<uintptr_t>& pointerChain)
+		: m_memory(memory), m_pages(pages), m_pointerChain(pointerChain)
+	{
+		if (m_pointerChain.empty())
+		{
+			m_logger.Log("A pointer chain needs at least a base address, this one will never resolve");
+			return;
+		}
+
+		m_hopAddresses.resize(m_pointerChain.size() - 1);
+		m_hopValues.resize(m_pointerChain.size() - 1);
+	}
+
+	// Returns the final address of the chain, or 0 if it currently doesn't resolve.
+	uintptr_t Resolve()
+	{
+		if (m_valid && Validate())
+		{
+			return m_address;
+		}
+
+		if (m_valid)
+		{
+			// Something moved, the page information might be stale as well.
+			m_pages.Invalidate();
+		}
+
+		m_valid = Walk();
+		return m_valid ? m_address : 0;
+	}
+
+	void Invalidate()
+	{
+		m_valid = false;
+	}
+
+	size_t WalkCount() const
+	{
+		return m_walkCount;
+	}
+
+private:
+	Logger m_logger{ "PointerChainResolver" };
+	IMemoryAccess& m_memory;
+	PageCache& m_pages;
+	std::vector<uintptr_t> m_pointerChain;
+	std::vector<uintptr_t> m_hopAddresses;
+	std::vector<uintptr_t> m_hopValues;
+	uintptr_t m_address = 0;
+	bool m_valid = false;
+	size_t m_walkCount = 0;
+
+	bool Validate()
+	{
+		for (size_t i = 0; i < m_hopAddresses.size(); i++)
+		{
+			uintptr_t value = 0;
+			if (!m_memory.Read(m_hopAddresses[i], &value) || value != m_hopValues[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Walk()
+	{
+		if (m_pointerChain.empty())
+		{
+			return false;
+		}
+
+		m_walkCount++;
+
+		uintptr_t pointer = m_pointerChain[0];
+		for (size_t i = 0; i < m_pointerChain.size() - 1; i++)
+		{
+			if (!m_pages.IsReadable(pointer, sizeof(uintptr_t)))
+			{
+				return false;
+			}
+
+			m_hopAddresses[i] = pointer;
+			if (!m_memory.Read(pointer, &pointer) || pointer == 0)
+			{
+				return false;
+			}
+			m_hopValues[i] = pointer;
+
+			pointer += m_pointerChain[i + 1];
+		}
+
+		m_address = pointer;
+		return true;
+	}
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <cstdint>
+
+#include "Logger.h"
+#include "Trace.h"
+
+/*
+* Holds the game's Present calls, which freezes games that render and simulate on the same thread.
+* A held present thread sleeps on an event, it uses no CPU and wakes as soon as Release() or Step() signals it.
+*
+* Hold() takes effect after the frame in flight: that frame is still rendered (overlays can check IsHolding()
+* to draw into it) and presented, the next Present then waits. While held, the last presented frame stays on screen.
+* Step() lets single frames through, each one rendered and presented with the overlays before the gate closes again.
+*
+* Bound keys are handled on the window's thread as the key message arrives, the present thread doesn't have to run
+* for a held game to be released.
+*/
+class PresentGate
+{
+public:
+	static PresentGate& Instance()
+	{
+		static PresentGate instance;
+		return instance;
+	}
+
+	PresentGate(const PresentGate&) = delete;
+	PresentGate& operator=(const PresentGate&) = delete;
+
+	~PresentGate()
+	{
+		if (m_wakeEvent != nullptr)
+		{
+			CloseHandle(m_wakeEvent);
+		}
+	}
+
+	// Can be called from any thread.
+	void Hold()
+	{
+		m_steps.store(0, std::memory_order_relaxed);
+		m_holdRequested.store(true, std::memory_order_release);
+	}
+
+	// Can be called from any thread.
+	void Release()
+	{
+		m_releaseTime.store(Now(), std::memory_order_relaxed);
+		m_holdRequested.store(false, std::memory_order_release);
+		Wake();
+	}
+
+	// Lets frames through while held, does nothing otherwise.
+	void Step(uint32_t frames = 1)
+	{
+		if (!m_holdRequested.load(std::memory_order_acquire))
+		{
+			return;
+		}
+
+		m_releaseTime.store(Now(), std::memory_order_relaxed);
+		m_steps.fetch_add(frames, std::memory_order_release);
+		Wake();
+	}
+
+	void Toggle()
+	{
+		if (IsHolding())
+		{
+			Release();
+		}
+		else
+		{
+			Hold();
+		}
+	}
+
+	// True from Hold() until Release(), including the frame that is presented before the gate closes.
+	bool IsHolding() const
+	{
+		return m_holdRequested.load(std::memory_order_acquire);
+	}
+
+	// Keys that toggle the hold and step a single frame, 0 for none.
+	void BindKeys(uint8_t toggleKey, uint8_t stepKey = 0)
+	{
+		m_toggleKey.store(toggleKey, std::memory_order_relaxed);
+		m_stepKey.store(stepKey, std::memory_order_relaxed);
+	}
+
+	// Called by the input hook on the window's thread for the first message of a key press (not repeats).
+	void OnKeyDown(uint8_t key)
+	{
+		if (key == 0)
+		{
+			return;
+		}
+
+		if (key == m_toggleKey.load(std::memory_order_relaxed))
+		{
+			Toggle();
+		}
+		else if (key == m_stepKey.load(std::memory_order_relaxed))
+		{
+			Step();
+		}
+	}
+
+	// Set by the renderer. If the game presents from its window's thread the wait has to keep dispatching
+	// that thread's messages, otherwise the key that releases the gate could never arrive.
+	void SetWindow(HWND window)
+	{
+		m_windowThread = window != 0 ? GetWindowThreadProcessId(window, nullptr) : 0;
+	}
+
+	// Present thread, at the start of a present. Returns after the gate opens, or right away if it is open.
+	void Wait()
+	{
+		if (!m_closed)
+		{
+			return;
+		}
+
+		TRACE_SCOPE("PresentGate::Wait");
+		uint64_t holdStart = Now();
+		bool dispatchMessages = m_windowThread != 0 && GetCurrentThreadId() == m_windowThread;
+
+		while (m_holdRequested.load(std::memory_order_acquire))
+		{
+			uint32_t steps = m_steps.load(std::memory_order_acquire);
+			if (steps > 0 && m_steps.compare_exchange_weak(steps, steps - 1, std::memory_order_acq_rel))
+			{
+				break;
+			}
+
+			if (m_wakeEvent == nullptr)
+			{
+				Sleep(1);
+			}
+			else if (dispatchMessages)
+			{
+				if (MsgWaitForMultipleObjects(1, &m_wakeEvent, FALSE, INFINITE, QS_ALLINPUT) == WAIT_OBJECT_0 + 1)
+				{
+					DispatchMessages();
+				}
+			}
+			else
+			{
+				WaitForSingleObject(m_wakeEvent, INFINITE);
+			}
+		}
+
+		uint64_t now = Now();
+		uint64_t releaseTime = m_releaseTime.load(std::memory_order_relaxed);
+		m_wakeLatencyMicros = now > releaseTime && releaseTime > holdStart ? (now - releaseTime) * m_microsPerTick : 0;
+		m_heldMicros = (now - holdStart) * m_microsPerTick;
+		m_closed = false;
+		m_numHolds++;
+	}
+
+	// Present thread, after the overlays were drawn. Closes the gate for the next present if a hold was requested.
+	void EndFrame()
+	{
+		m_closed = m_holdRequested.load(std::memory_order_acquire);
+	}
+
+	// Time from the last Release()/Step() until the present thread was running again
+	double WakeLatencyMicros() const
+	{
+		return m_wakeLatencyMicros;
+	}
+
+	// How long the last wait lasted
+	double HeldMicros() const
+	{
+		return m_heldMicros;
+	}
+
+	uint64_t NumHolds() const
+	{
+		return m_numHolds;
+	}
+
+private:
+	Logger m_logger{ "PresentGate" };
+	HANDLE m_wakeEvent = nullptr; // auto reset, a wake that comes before the wait isn't lost
+	std::atomic<bool> m_holdRequested{ false };
+	std::atomic<uint32_t> m_steps{ 0 };
+	std::atomic<uint8_t> m_toggleKey{ 0 };
+	std::atomic<uint8_t> m_stepKey{ 0 };
+	std::atomic<uint64_t> m_releaseTime{ 0 };
+	DWORD m_windowThread = 0;
+	double m_microsPerTick = 0;
+
+	// Present thread only
+	bool m_closed = false;
+	double m_wakeLatencyMicros = 0;
+	double m_heldMicros = 0;
+	uint64_t m_numHolds = 0;
+
+	PresentGate()
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		m_microsPerTick = 1000000.0 / (double)frequency.QuadPart;
+
+		m_wakeEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+		if (m_wakeEvent == nullptr)
+		{
+			m_logger.Log("Failed to create the wake event, a held present will poll instead: %lu", GetLastError());
+		}
+	}
+
+	static uint64_t Now()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return (uint64_t)counter.QuadPart;
+	}
+
+	void Wake()
+	{
+		if (m_wakeEvent != nullptr)
+		{
+			SetEvent(m_wakeEvent);
+		}
+	}
+
+	// Only the present thread's own messages, which is what the game's message loop would do with them.
+	// A quit message is put back for the game and opens the gate so the game can act on it.
+	void DispatchMessages()
+	{
+		MSG msg;
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		{
+			if (msg.message == WM_QUIT)
+			{
+				PostQuitMessage((int)msg.wParam);
+				Release();
+				return;
+			}
+
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
+	}
+};
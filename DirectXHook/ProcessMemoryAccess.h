@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "MemoryAccess.h"
+
+// Reads memory of the process the hook is loaded into.
+class ProcessMemoryAccess : public IMemoryAccess
+{
+public:
+	bool Query(uintptr_t address, MemoryRegion* region) override
+	{
+		MEMORY_BASIC_INFORMATION memoryInfo;
+		if (!VirtualQuery((void*)address, &memoryInfo, sizeof(MEMORY_BASIC_INFORMATION)))
+		{
+			return false;
+		}
+
+		const DWORD readableFlags = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+			PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+		region->base = (uintptr_t)memoryInfo.BaseAddress;
+		region->size = memoryInfo.RegionSize;
+		region->readable = memoryInfo.State == MEM_COMMIT
+			&& (memoryInfo.Protect & readableFlags) != 0
+			&& (memoryInfo.Protect & (PAGE_GUARD | PAGE_NOACCESS)) == 0;
+		return true;
+	}
+
+	// Guarded so memory that was freed, turned into a guard page or can't be paged in after it was found readable
+	// doesn't take the game down.
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		uintptr_t guardPage = 0;
+		__try
+		{
+			memcpy(buffer, (const void*)address, size);
+		}
+		__except (ReadFilter(GetExceptionCode(), GetExceptionInformation(), &guardPage))
+		{
+			if (guardPage != 0)
+			{
+				RestoreGuard(guardPage);
+			}
+			return false;
+		}
+		return true;
+	}
+
+	using IMemoryAccess::Read;
+
+private:
+	static int ReadFilter(DWORD code, EXCEPTION_POINTERS* exception, uintptr_t* guardPage)
+	{
+		switch (code)
+		{
+		case EXCEPTION_ACCESS_VIOLATION:
+		case EXCEPTION_IN_PAGE_ERROR: // a mapped file or the page file couldn't be read
+			return EXCEPTION_EXECUTE_HANDLER;
+		case EXCEPTION_GUARD_PAGE:
+			*guardPage = (uintptr_t)exception->ExceptionRecord->ExceptionInformation[1];
+			return EXCEPTION_EXECUTE_HANDLER;
+		default:
+			return EXCEPTION_CONTINUE_SEARCH;
+		}
+	}
+
+	// Touching a guard page clears its guard, the game (or the stack it belongs to) still needs it.
+	static void RestoreGuard(uintptr_t address)
+	{
+		MEMORY_BASIC_INFORMATION memoryInfo;
+		if (VirtualQuery((void*)address, &memoryInfo, sizeof(MEMORY_BASIC_INFORMATION)) && memoryInfo.State == MEM_COMMIT)
+		{
+			DWORD oldProtect;
+			VirtualProtect((void*)address, 1, memoryInfo.Protect | PAGE_GUARD, &oldProtect);
+		}
+	}
+};
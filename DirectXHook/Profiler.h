@@ -0,0 +1,330 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <cstdint>
+
+/*
+* Live hierarchical CPU profiler for the present thread.
+* Scopes form a tree (a scope's node is found by its name and its parent), every frame each node accumulates
+* inclusive time (the scope itself) and child time, exclusive time is the difference.
+* At the end of a frame the totals are folded into smoothed averages for display.
+* Everything lives in fixed arrays, nothing is allocated after construction.
+*
+*	PROFILE_SCOPE("Render");
+*
+* Scopes on any thread other than the one calling BeginFrame() are ignored. Names must be string literals.
+* The node table grows while a frame runs, readers on other threads use LastFrame() instead.
+*/
+class Profiler
+{
+public:
+	typedef uint64_t(*Clock)();
+
+	static constexpr int MaxNodes = 64;
+	static constexpr int MaxDepth = 16;
+	static constexpr double Smoothing = 0.05; // weight of the newest frame in the averages
+
+	struct Node
+	{
+		const char* name = "";
+		int parent = -1;
+		int depth = 0;
+		double inclusiveMicros = 0; // smoothed
+		double exclusiveMicros = 0; // smoothed
+		double calls = 0; // smoothed calls per frame
+
+		// The current frame, in clock ticks
+		uint64_t frameInclusive = 0;
+		uint64_t frameChildren = 0;
+		uint32_t frameCalls = 0;
+	};
+
+	// The averages as of the last EndFrame(), copied there. Only EndFrame() writes it, so other threads can read it
+	// during the next frame as long as they are done before that frame ends (like jobs joined by the present thread).
+	struct Snapshot
+	{
+		struct Entry
+		{
+			const char* name = "";
+			int parent = -1;
+			int depth = 0;
+			double inclusiveMicros = 0;
+			double exclusiveMicros = 0;
+			double calls = 0;
+		};
+
+		Entry nodes[MaxNodes];
+		int numNodes = 0;
+		double frameMicros = 0;
+		double hookMicros = 0;
+		uint64_t numFrames = 0;
+	};
+
+	static Profiler& Instance()
+	{
+		static Profiler profiler(QueryPerformanceClock, QueryPerformanceFrequencyHz());
+		return profiler;
+	}
+
+	Profiler(Clock clock, uint64_t ticksPerSecond)
+	{
+		m_clock = clock;
+		m_microsPerTick = 1000000.0 / (double)ticksPerSecond;
+	}
+
+	void Enable(bool enabled)
+	{
+		m_enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool IsEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	// Frame time is measured from one BeginFrame() to the next.
+	void BeginFrame()
+	{
+		m_frameThread = GetCurrentThreadId();
+		uint64_t now = m_clock();
+		if (m_frameStart != 0)
+		{
+			// The first frame time is only known one frame after the other averages start.
+			double frameMicros = (now - m_frameStart) * m_microsPerTick;
+			m_frameMicros = m_frameMicros == 0 ? frameMicros : m_frameMicros + (frameMicros - m_frameMicros) * Smoothing;
+		}
+		m_frameStart = now;
+		m_inFrame = true;
+	}
+
+	// Folds the frame into the averages, scopes still open (there shouldn't be any) are dropped.
+	void EndFrame()
+	{
+		if (!m_inFrame)
+		{
+			return;
+		}
+
+		uint64_t hookTicks = 0;
+		for (int i = 0; i < m_numNodes; i++)
+		{
+			Node& node = m_nodes[i];
+			uint64_t exclusive = node.frameInclusive > node.frameChildren ? node.frameInclusive - node.frameChildren : 0;
+			Smooth(&node.inclusiveMicros, node.frameInclusive * m_microsPerTick);
+			Smooth(&node.exclusiveMicros, exclusive * m_microsPerTick);
+			Smooth(&node.calls, (double)node.frameCalls);
+			if (node.parent == -1)
+			{
+				hookTicks += node.frameInclusive;
+			}
+
+			node.frameInclusive = 0;
+			node.frameChildren = 0;
+			node.frameCalls = 0;
+		}
+
+		Smooth(&m_hookMicros, hookTicks * m_microsPerTick);
+		m_depth = 0;
+		m_ignoredDepth = 0;
+		m_inFrame = false;
+		m_numFrames++;
+		TakeSnapshot();
+	}
+
+	void Enter(const char* name)
+	{
+		if (!m_inFrame || GetCurrentThreadId() != m_frameThread)
+		{
+			return;
+		}
+
+		int parent = m_depth > 0 ? m_stack[m_depth - 1].node : -1;
+		int node = m_ignoredDepth == 0 && m_depth < MaxDepth ? FindOrAddNode(name, parent) : -1;
+		if (node == -1)
+		{
+			m_ignoredDepth++;
+			return;
+		}
+
+		m_stack[m_depth].node = node;
+		m_stack[m_depth].start = m_clock();
+		m_depth++;
+	}
+
+	void Exit()
+	{
+		if (!m_inFrame || GetCurrentThreadId() != m_frameThread)
+		{
+			return;
+		}
+
+		if (m_ignoredDepth > 0)
+		{
+			m_ignoredDepth--;
+			return;
+		}
+
+		if (m_depth == 0)
+		{
+			return;
+		}
+
+		m_depth--;
+		Node& node = m_nodes[m_stack[m_depth].node];
+		uint64_t elapsed = m_clock() - m_stack[m_depth].start;
+		node.frameInclusive += elapsed;
+		node.frameCalls++;
+		if (node.parent != -1)
+		{
+			m_nodes[node.parent].frameChildren += elapsed;
+		}
+	}
+
+	int NumNodes() const
+	{
+		return m_numNodes;
+	}
+
+	const Node& GetNode(int index) const
+	{
+		return m_nodes[index];
+	}
+
+	// Smoothed time between frames
+	double FrameMicros() const
+	{
+		return m_frameMicros;
+	}
+
+	// Smoothed time spent in top level scopes per frame
+	double HookMicros() const
+	{
+		return m_hookMicros;
+	}
+
+	uint64_t NumFrames() const
+	{
+		return m_numFrames;
+	}
+
+	const Snapshot& LastFrame() const
+	{
+		return m_snapshot;
+	}
+
+private:
+	struct StackEntry
+	{
+		int node = -1;
+		uint64_t start = 0;
+	};
+
+	std::atomic<bool> m_enabled{ false };
+	Clock m_clock = nullptr;
+	double m_microsPerTick = 0;
+	DWORD m_frameThread = 0;
+	bool m_inFrame = false;
+	uint64_t m_frameStart = 0;
+	uint64_t m_numFrames = 0;
+	double m_frameMicros = 0;
+	double m_hookMicros = 0;
+
+	Node m_nodes[MaxNodes];
+	int m_numNodes = 0;
+	StackEntry m_stack[MaxDepth];
+	int m_depth = 0;
+	int m_ignoredDepth = 0; // open scopes that didn't fit in the tree or the stack
+	Snapshot m_snapshot;
+
+	static uint64_t QueryPerformanceClock()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return (uint64_t)counter.QuadPart;
+	}
+
+	static uint64_t QueryPerformanceFrequencyHz()
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return (uint64_t)frequency.QuadPart;
+	}
+
+	void Smooth(double* average, double value)
+	{
+		*average = m_numFrames == 0 ? value : *average + (value - *average) * Smoothing;
+	}
+
+	void TakeSnapshot()
+	{
+		for (int i = 0; i < m_numNodes; i++)
+		{
+			const Node& node = m_nodes[i];
+			Snapshot::Entry& entry = m_snapshot.nodes[i];
+			entry.name = node.name;
+			entry.parent = node.parent;
+			entry.depth = node.depth;
+			entry.inclusiveMicros = node.inclusiveMicros;
+			entry.exclusiveMicros = node.exclusiveMicros;
+			entry.calls = node.calls;
+		}
+		m_snapshot.numNodes = m_numNodes;
+		m_snapshot.frameMicros = m_frameMicros;
+		m_snapshot.hookMicros = m_hookMicros;
+		m_snapshot.numFrames = m_numFrames;
+	}
+
+	int FindOrAddNode(const char* name, int parent)
+	{
+		for (int i = 0; i < m_numNodes; i++)
+		{
+			if (m_nodes[i].name == name && m_nodes[i].parent == parent)
+			{
+				return i;
+			}
+		}
+
+		if (m_numNodes == MaxNodes)
+		{
+			return -1;
+		}
+
+		Node& node = m_nodes[m_numNodes];
+		node.name = name;
+		node.parent = parent;
+		node.depth = parent == -1 ? 0 : m_nodes[parent].depth + 1;
+		return m_numNodes++;
+	}
+};
+
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name)
+	{
+		m_active = Profiler::Instance().IsEnabled();
+		if (m_active)
+		{
+			Profiler::Instance().Enter(name);
+		}
+	}
+
+	~ProfileScope()
+	{
+		if (m_active)
+		{
+			Profiler::Instance().Exit();
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	bool m_active = false;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
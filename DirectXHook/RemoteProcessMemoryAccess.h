@@ -0,0 +1,150 @@
+#pragma once
+
+#include "MemoryAccess.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <signal.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cinttypes>
+#include <cstdio>
+#endif
+
+/*
+* Reads the memory of another process (or this one through the same calls), for tools that run next to the game
+* and for testing and benchmarking the memory watch on Linux.
+* Windows uses ReadProcessMemory and VirtualQueryEx, Linux uses process_vm_readv and /proc/<pid>/maps.
+* Reading another process needs the rights to debug it.
+*/
+#ifdef _WIN32
+class RemoteProcessMemoryAccess : public IMemoryAccess
+{
+public:
+	RemoteProcessMemoryAccess(DWORD processId)
+	{
+		m_process = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
+	}
+
+	~RemoteProcessMemoryAccess()
+	{
+		if (m_process != nullptr)
+		{
+			CloseHandle(m_process);
+		}
+	}
+
+	RemoteProcessMemoryAccess(const RemoteProcessMemoryAccess&) = delete;
+	RemoteProcessMemoryAccess& operator=(const RemoteProcessMemoryAccess&) = delete;
+
+	bool IsOpen() const
+	{
+		return m_process != nullptr;
+	}
+
+	bool Query(uintptr_t address, MemoryRegion* region) override
+	{
+		MEMORY_BASIC_INFORMATION memoryInfo;
+		if (m_process == nullptr || !VirtualQueryEx(m_process, (void*)address, &memoryInfo, sizeof(MEMORY_BASIC_INFORMATION)))
+		{
+			return false;
+		}
+
+		const DWORD readableFlags = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+			PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+		region->base = (uintptr_t)memoryInfo.BaseAddress;
+		region->size = memoryInfo.RegionSize;
+		region->readable = memoryInfo.State == MEM_COMMIT
+			&& (memoryInfo.Protect & readableFlags) != 0
+			&& (memoryInfo.Protect & (PAGE_GUARD | PAGE_NOACCESS)) == 0;
+		return true;
+	}
+
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		SIZE_T bytesRead = 0;
+		return m_process != nullptr && ReadProcessMemory(m_process, (const void*)address, buffer, size, &bytesRead) && bytesRead == size;
+	}
+
+	using IMemoryAccess::Read;
+
+private:
+	HANDLE m_process = nullptr;
+};
+#else
+class RemoteProcessMemoryAccess : public IMemoryAccess
+{
+public:
+	RemoteProcessMemoryAccess(pid_t processId) : m_processId(processId) { }
+
+	bool IsOpen() const
+	{
+		return kill(m_processId, 0) == 0;
+	}
+
+	// Addresses between mappings come back as an unreadable region spanning the gap, so the page cache remembers them too.
+	bool Query(uintptr_t address, MemoryRegion* region) override
+	{
+		char fileName[64];
+		snprintf(fileName, sizeof(fileName), "/proc/%d/maps", (int)m_processId);
+		FILE* maps = fopen(fileName, "r");
+		if (maps == nullptr)
+		{
+			return false;
+		}
+
+		uintptr_t gapStart = 0;
+		uintptr_t gapEnd = UINTPTR_MAX;
+		bool found = false;
+		char line[512];
+		while (fgets(line, sizeof(line), maps) != nullptr)
+		{
+			uintptr_t start = 0, end = 0;
+			char permissions[5] = { 0 };
+			if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %4s", &start, &end, permissions) != 3)
+			{
+				continue;
+			}
+
+			if (address < start)
+			{
+				gapEnd = start;
+				break;
+			}
+
+			if (address < end)
+			{
+				region->base = start;
+				region->size = end - start;
+				region->readable = permissions[0] == 'r';
+				found = true;
+				break;
+			}
+			gapStart = end;
+		}
+		fclose(maps);
+
+		if (!found)
+		{
+			region->base = gapStart;
+			region->size = gapEnd - gapStart;
+			region->readable = false;
+		}
+		return true;
+	}
+
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		iovec local = { buffer, size };
+		iovec remote = { (void*)address, size };
+		return process_vm_readv(m_processId, &local, 1, &remote, 1, 0) == (ssize_t)size;
+	}
+
+	using IMemoryAccess::Read;
+
+private:
+	pid_t m_processId;
+};
+#endif
@@ -5,9 +5,12 @@ using namespace DirectX;
 
 bool Renderer::Init(IDXGISwapChain* swapChain, UINT syncInterval, UINT flags)
 {
+	TRACE_SCOPE("Renderer::Init");
+	PROFILE_SCOPE("Init");
 	if (m_firstInit)
 	{
 		m_logger.Log("Initializing renderer...");
+		QueryPerformanceFrequency(&m_performanceFrequency);
 
 		if (SUCCEEDED(swapChain->GetDevice(__uuidof(ID3D11Device), (void**)m_d3d11Device.GetAddressOf())))
 		{
@@ -53,6 +56,10 @@ bool Renderer::Init(IDXGISwapChain* swapChain, UINT syncInterval, UINT flags)
 	m_logger.Log("Window width: %i", m_windowWidth);
 	m_logger.Log("Window height: %i", m_windowHeight);
 	m_window = desc.OutputWindow;
+	InputHook::Instance().OnWindowDestroyed(&Renderer::OnWindowDestroyed, this);
+	InputHook::Instance().Install(m_window);
+	PresentGate::Instance().SetWindow(m_window);
+	JobSystem::Instance().RegisterThread(); // overlays' Prepare() jobs are started from here
 
 	ZeroMemory(&m_viewport, sizeof(D3D11_VIEWPORT));
 	m_viewport.Width = m_windowWidth;
@@ -117,12 +124,14 @@ bool Renderer::Init(IDXGISwapChain* swapChain, UINT syncInterval, UINT flags)
 
 void Renderer::Render()
 {	
+	TRACE_SCOPE("Renderer::Render");
 	if (m_d3d12Device.Get() == nullptr)
 	{
 		m_bufferIndex = 0;
 	}
 	else
 	{
+		PROFILE_SCOPE("Acquire wrapped back buffer");
 		m_bufferIndex = swapChain3->GetCurrentBackBufferIndex();
 		m_d3d11On12Device->AcquireWrappedResources(m_d3d11WrappedBackBuffers[m_bufferIndex].GetAddressOf(), 1);
 	}
@@ -130,6 +139,17 @@ void Renderer::Render()
 	m_d3d11Context->OMSetRenderTargets(1, m_d3d11RenderTargetViews[m_bufferIndex].GetAddressOf(), 0);
 	m_d3d11Context->RSSetViewports(1, &m_viewport);
 
+	{
+		PROFILE_SCOPE("Input");
+		InputHook::Instance().ProcessEvents();
+	}
+	CheckTraceHotkey();
+
+	{
+		PROFILE_SCOPE("Requested assets");
+		AssetCache::Instance().LoadRequested();
+	}
+
 	if (m_drawExamples)
 	{
 		if (!m_examplesLoaded)
@@ -144,25 +164,214 @@ void Renderer::Render()
 		DrawExampleText();
 	}
 
-	if (m_callbackObject != nullptr)
+	PrepareOverlays();
+	for (size_t i = 0; i < m_overlays.size(); i++)
+	{
+		RenderOverlay(i);
+	}
+	m_overlayScheduler.EndFrame();
+
+	if (m_d3d12Device.Get() != nullptr)
 	{
-		if (!m_callbackInitialized)
+		PROFILE_SCOPE("Release wrapped back buffer");
+		m_d3d11On12Device->ReleaseWrappedResources(m_d3d11WrappedBackBuffers[m_bufferIndex].GetAddressOf(), 1);
+		m_d3d11Context->Flush();
+	}
+}
+
+void Renderer::InitOverlay(OverlayLayer& overlay, size_t index)
+{
+	PROFILE_SCOPE(overlay.profileName);
+	TRACE_SCOPE_ARG("IRenderCallback::Setup", index);
+	overlay.callback->Init(m_d3d11Device, m_d3d11Context, m_spriteBatch, m_window);
+	overlay.callback->Setup();
+	overlay.initialized = true;
+
+	if (overlay.callback->UpdateInterval() != 0)
+	{
+		m_overlayUpdater.Add(overlay.callback, overlay.callback->UpdateInterval());
+	}
+}
+
+// Starts Prepare() as a job for every overlay that asked for it and will render this frame,
+// the present thread helps running them and returns once all have finished, before the first overlay draws.
+void Renderer::PrepareOverlays()
+{
+	PROFILE_SCOPE("Prepare");
+	JobCounter counter;
+	for (size_t i = 0; i < m_overlays.size(); i++)
+	{
+		OverlayLayer& overlay = m_overlays[i];
+		if (!overlay.initialized)
 		{
-			m_callbackObject->Init(m_d3d11Device, m_d3d11Context, m_spriteBatch, m_window);
-			m_callbackObject->Setup();
-			m_callbackInitialized = true;
+			InitOverlay(overlay, i);
 		}
 
+		bool composited = overlay.cacheValid && m_overlayScheduler.IsDecimated(i) && !m_overlayScheduler.IsDue(i);
+		if (overlay.callback->ParallelPrepare() && !composited)
+		{
+			IRenderCallback* callback = overlay.callback;
+			JobSystem::Instance().Run(counter, [callback, i]
+			{
+				TRACE_SCOPE_ARG("IRenderCallback::Prepare", i);
+				callback->Prepare();
+			});
+		}
+	}
+	JobSystem::Instance().Wait(counter);
+}
+
+// Renders one overlay of the chain and reports its cost to the scheduler.
+// Overlays within budget draw straight to the back buffer, decimated overlays draw into their cache
+// on the frames they are due and the cache is composited on every frame. Render() and tasks run on every frame
+// either way, so input isn't missed on the frames an overlay doesn't draw.
+void Renderer::RenderOverlay(size_t index)
+{
+	OverlayLayer& overlay = m_overlays[index];
+	PROFILE_SCOPE(overlay.profileName);
+
+	unsigned int interval = m_overlayScheduler.Interval(index);
+	if (interval != overlay.lastInterval)
+	{
+		LOG_DEBUG(m_logger, Render, "Overlay %zu now renders every %u frame(s), average cost: %.1f us", index, interval, m_overlayScheduler.AverageMicros(index));
+		overlay.lastInterval = interval;
+	}
+
+	bool decimated = m_overlayScheduler.IsDecimated(index);
+	if (decimated && overlay.cacheTexture == nullptr && !CreateOverlayCache(overlay))
+	{
+		decimated = false;
+	}
+	if (decimated)
+	{
+		overlay.framesNotDecimated = 0;
+	}
+
+	if (!decimated)
+	{
+		overlay.cacheValid = false;
+		if (overlay.cacheTexture != nullptr && ++overlay.framesNotDecimated >= CacheReleaseFrames)
+		{
+			ReleaseOverlayCache(overlay);
+		}
+	}
+	else if (overlay.cacheValid && !m_overlayScheduler.IsDue(index))
+	{
+		// Input and tasks still run every frame, only the drawing is decimated. What that costs counts against
+		// the overlay's budget on every frame.
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+		{
+			PROFILE_SCOPE("Render (composited)");
+			OF::SkipDrawing(true);
+			overlay.callback->Render();
+			overlay.callback->ResumeTasks();
+			OF::SkipDrawing(false);
+		}
+		QueryPerformanceCounter(&end);
+		m_overlayScheduler.Report(index, (end.QuadPart - start.QuadPart) * 1000000.0 / m_performanceFrequency.QuadPart, false);
+
+		m_spriteBatch->Begin(SpriteSortMode_Immediate);
+		m_spriteBatch->Draw(overlay.cacheShaderResourceView.Get(), XMFLOAT2(0.0f, 0.0f));
+		m_spriteBatch->End();
+		return;
+	}
+
+	if (decimated)
+	{
+		const float transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		m_d3d11Context->ClearRenderTargetView(overlay.cacheRenderTargetView.Get(), transparent);
+		m_d3d11Context->OMSetRenderTargets(1, overlay.cacheRenderTargetView.GetAddressOf(), 0);
+	}
+
+	LARGE_INTEGER start, end;
+	QueryPerformanceCounter(&start);
+	{
+		TRACE_SCOPE_ARG("IRenderCallback::Render", index);
 		m_spriteBatch->Begin(SpriteSortMode_BackToFront);
-		m_callbackObject->Render();
+		{
+			PROFILE_SCOPE("Render");
+			overlay.callback->Render();
+		}
+		{
+			PROFILE_SCOPE("Tasks");
+			overlay.callback->ResumeTasks();
+		}
+		PROFILE_SCOPE("SpriteBatch::End");
 		m_spriteBatch->End();
 	}
+	QueryPerformanceCounter(&end);
+	double micros = (end.QuadPart - start.QuadPart) * 1000000.0 / m_performanceFrequency.QuadPart;
+	m_overlayScheduler.Report(index, micros);
+	TRACE_COUNTER_ARG("Overlay cost (us)", index, micros);
 
-	if (m_d3d12Device.Get() != nullptr)
+	if (decimated)
 	{
-		m_d3d11On12Device->ReleaseWrappedResources(m_d3d11WrappedBackBuffers[m_bufferIndex].GetAddressOf(), 1);
-		m_d3d11Context->Flush();
+		overlay.cacheValid = true;
+		m_d3d11Context->OMSetRenderTargets(1, m_d3d11RenderTargetViews[m_bufferIndex].GetAddressOf(), 0);
+		m_spriteBatch->Begin(SpriteSortMode_Immediate);
+		m_spriteBatch->Draw(overlay.cacheShaderResourceView.Get(), XMFLOAT2(0.0f, 0.0f));
+		m_spriteBatch->End();
+	}
+}
+
+// Caches are the size of the back buffer, so their total size is bounded. An overlay that doesn't get one
+// draws every frame instead.
+bool Renderer::CreateOverlayCache(OverlayLayer& overlay)
+{
+	uint64_t bytes = (uint64_t)m_windowWidth * m_windowHeight * 4;
+	if (m_overlayCacheBytes + bytes > MaxOverlayCacheBytes)
+	{
+		LOG_EVERY_MS(m_logger, Warning, Render, 10000, "Overlay caches would exceed %llu MB, an overlay over its budget is drawn every frame",
+			MaxOverlayCacheBytes / (1024 * 1024));
+		return false;
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+	desc.Width = m_windowWidth;
+	desc.Height = m_windowHeight;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	HRESULT result = m_d3d11Device->CreateTexture2D(&desc, nullptr, overlay.cacheTexture.ReleaseAndGetAddressOf());
+	if (SUCCEEDED(result))
+	{
+		result = m_d3d11Device->CreateRenderTargetView(overlay.cacheTexture.Get(), nullptr, overlay.cacheRenderTargetView.ReleaseAndGetAddressOf());
+	}
+	if (SUCCEEDED(result))
+	{
+		result = m_d3d11Device->CreateShaderResourceView(overlay.cacheTexture.Get(), nullptr, overlay.cacheShaderResourceView.ReleaseAndGetAddressOf());
+	}
+
+	if (FAILED(result))
+	{
+		m_logger.Log("Failed to create overlay cache, the overlay will not be decimated");
+		PrintHresultError(result);
+		overlay.cacheTexture.Reset();
+		overlay.cacheRenderTargetView.Reset();
+		overlay.cacheShaderResourceView.Reset();
+		return false;
 	}
+
+	overlay.cacheValid = false;
+	overlay.cacheBytes = bytes;
+	m_overlayCacheBytes += bytes;
+	return true;
+}
+
+void Renderer::ReleaseOverlayCache(OverlayLayer& overlay)
+{
+	overlay.cacheTexture.Reset();
+	overlay.cacheRenderTargetView.Reset();
+	overlay.cacheShaderResourceView.Reset();
+	overlay.cacheValid = false;
+	m_overlayCacheBytes -= overlay.cacheBytes;
+	overlay.cacheBytes = 0;
 }
 
 // Creates the necessary things for rendering the examples.
@@ -376,7 +585,7 @@ void Renderer::DrawExampleTriangle()
 
 	if (hit == 2)
 	{
-		m_logger.Log("Hit the corner!"); // For some reason this prints twice sometimes?
+		LOG_EVERY_MS(m_logger, Debug, Render, 1000, "Hit the corner!"); // For some reason this prints twice sometimes?
 	}
 
 	m_triangleCounter += 0.01f;
@@ -472,19 +681,38 @@ void Renderer::DrawExampleText()
 
 void Renderer::OnPresent(IDXGISwapChain* pThis, UINT syncInterval, UINT flags)
 {
-	if (m_firstInit || m_resizeBuffers)
+	TRACE_SCOPE("Renderer::OnPresent");
+
+	// A held frame waits here, before anything is drawn into it.
+	PresentGate& gate = PresentGate::Instance();
+	gate.Wait();
+
+	Profiler& profiler = Profiler::Instance();
+	bool profiling = profiler.IsEnabled();
+	if (profiling)
+	{
+		profiler.BeginFrame();
+	}
+
 	{
-		if (!Init(pThis, syncInterval, flags))
+		PROFILE_SCOPE("Present");
+		if (!(m_firstInit || m_resizeBuffers) || Init(pThis, syncInterval, flags))
 		{
-			return;
+			Render();
 		}
 	}
 
-	Render();
+	if (profiling)
+	{
+		profiler.EndFrame();
+	}
+
+	gate.EndFrame();
 }
 
 void Renderer::OnResizeBuffers(IDXGISwapChain* pThis, UINT bufferCount, UINT width, UINT height, DXGI_FORMAT newFormat, UINT swapChainFlags)
 {
+	TRACE_SCOPE("Renderer::OnResizeBuffers");
 	m_logger.Log("ResizeBuffers was called!");
 	m_resizeBuffers = true;
 
@@ -502,6 +730,12 @@ void Renderer::OnResizeBuffers(IDXGISwapChain* pThis, UINT bufferCount, UINT wid
 		}
 	}
 
+	// Overlay caches are sized after the window, they get recreated when needed.
+	for (OverlayLayer& overlay : m_overlays)
+	{
+		ReleaseOverlayCache(overlay);
+	}
+
 	if (m_d3d11Context.Get() != nullptr)
 	{
 		m_d3d11Context->Flush();
@@ -513,10 +747,39 @@ void Renderer::DrawExampleTriangle(bool doDraw)
 	m_drawExamples = doDraw;
 }
 
+// Replaces the overlay chain with a single overlay.
 void Renderer::SetRenderCallback(IRenderCallback* object)
 {
-	m_callbackObject = object;
-	m_callbackInitialized = false;
+	m_overlays.clear();
+	m_overlayCacheBytes = 0;
+	m_overlayScheduler.Clear();
+	AddRenderCallback(object);
+}
+
+// Appends an overlay to the chain, overlays are drawn in the order they were added.
+// A budget of 0 means the overlay is never decimated because of its own cost.
+void Renderer::AddRenderCallback(IRenderCallback* object, int priority, unsigned int budgetMicros)
+{
+	if (object == nullptr)
+	{
+		return;
+	}
+
+	// Profiler scope names have to outlive the overlay, the first few overlays get their own.
+	static const char* profileNames[] = { "Overlay 0", "Overlay 1", "Overlay 2", "Overlay 3", "Overlay 4", "Overlay 5", "Overlay 6", "Overlay 7+" };
+	size_t numNames = sizeof(profileNames) / sizeof(profileNames[0]);
+
+	OverlayLayer overlay;
+	overlay.callback = object;
+	overlay.profileName = profileNames[m_overlays.size() < numNames ? m_overlays.size() : numNames - 1];
+	m_overlays.push_back(overlay);
+	m_overlayScheduler.Add(priority, budgetMicros);
+}
+
+// Budget for all overlays combined, lower priority overlays get decimated first when it's exceeded.
+void Renderer::SetOverlayFrameBudget(unsigned int budgetMicros)
+{
+	m_overlayScheduler.SetFrameBudget(budgetMicros);
 }
 
 void Renderer::SetCommandQueue(ID3D12CommandQueue* commandQueue)
@@ -525,6 +788,42 @@ void Renderer::SetCommandQueue(ID3D12CommandQueue* commandQueue)
 	missingCommandQueue = false;
 }
 
+// Ctrl + Shift + T writes the trace to disk, on its own thread since the file can get large.
+void Renderer::CheckTraceHotkey()
+{
+	const KeyState& keys = InputHook::Instance().Keys();
+	if (!Trace::Instance().IsEnabled() || !keys.IsDown(VK_LCONTROL) || !keys.IsDown(VK_LSHIFT) || !keys.WasPressed('T'))
+	{
+		return;
+	}
+
+	if (m_dumpingTrace.exchange(true))
+	{
+		return;
+	}
+
+	std::thread([this]
+	{
+		if (Trace::Instance().DumpChromeJson(m_traceFileName))
+		{
+			m_logger.Log("Trace written to %s", m_traceFileName);
+		}
+		else
+		{
+			m_logger.Log("Could not write %s", m_traceFileName);
+		}
+		m_dumpingTrace.store(false);
+	}).detach();
+}
+
+// The game is shutting down, overlays must stop reading its memory before it goes away.
+void Renderer::OnWindowDestroyed(void* context)
+{
+	Renderer* renderer = (Renderer*)context;
+	renderer->m_logger.Log("Game window destroyed, stopping overlay updates");
+	renderer->m_overlayUpdater.Stop();
+}
+
 void Renderer::PrintHresultError(HRESULT hr)
 {
 	if(SUCCEEDED(hr))
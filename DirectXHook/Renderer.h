@@ -12,10 +12,20 @@
 #include <SpriteBatch.h>
 #include <SpriteFont.h>
 #include <vector>
+#include <atomic>
+#include <thread>
 #include <comdef.h>
 
 #include "IRenderCallback.h"
+#include "InputHook.h"
+#include "PresentGate.h"
+#include "OverlayScheduler.h"
+#include "OverlayUpdater.h"
+#include "JobSystem.h"
 #include "Logger.h"
+#include "Trace.h"
+#include "Profiler.h"
+#include "OverlayFramework.h"
 
 class Renderer
 {
@@ -26,17 +36,43 @@ public:
 	void OnResizeBuffers(IDXGISwapChain* pThis, UINT bufferCount, UINT width, UINT height, DXGI_FORMAT newFormat, UINT swapChainFlags);
 	void DrawExampleTriangle(bool doDraw);
 	void SetRenderCallback(IRenderCallback* object);
+	void AddRenderCallback(IRenderCallback* object, int priority = 0, unsigned int budgetMicros = 0);
+	void SetOverlayFrameBudget(unsigned int budgetMicros);
 	void SetCommandQueue(ID3D12CommandQueue* commandQueue);
 
 private:
 	Logger m_logger{ "Renderer" };
 	HWND m_window = 0;
-	IRenderCallback* m_callbackObject = nullptr;
+
+	// An overlay in the render chain. The cache holds its last output for frames where it is decimated.
+	struct OverlayLayer
+	{
+		IRenderCallback* callback = nullptr;
+		const char* profileName = "";
+		bool initialized = false;
+		bool cacheValid = false;
+		unsigned int lastInterval = 1;
+		unsigned int framesNotDecimated = 0;
+		uint64_t cacheBytes = 0;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> cacheTexture = nullptr;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> cacheRenderTargetView = nullptr;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cacheShaderResourceView = nullptr;
+	};
+
+	static constexpr uint64_t MaxOverlayCacheBytes = 96ull * 1024 * 1024; // two caches at 4K, eleven at 1080p
+	static constexpr unsigned int CacheReleaseFrames = 600; // a cache is kept this long after its overlay fits its budget again
+
+	std::vector<OverlayLayer> m_overlays;
+	uint64_t m_overlayCacheBytes = 0;
+	OverlayScheduler m_overlayScheduler;
+	OverlayUpdater m_overlayUpdater;
+	LARGE_INTEGER m_performanceFrequency = { 0 };
+	const char* m_traceFileName = "directx_hook_trace.json";
+	std::atomic<bool> m_dumpingTrace{ false };
 	bool m_firstInit = true;
 	bool m_resizeBuffers = false;
 	bool m_drawExamples = false;
 	bool m_examplesLoaded = false;
-	bool m_callbackInitialized = false;
 	int m_windowWidth = 0;
 	int m_windowHeight = 0;
 	UINT m_bufferIndex = 0;
@@ -100,11 +136,18 @@ private:
 
 	bool Init(IDXGISwapChain* swapChain, UINT syncInterval, UINT flags);
 	void Render();
+	void InitOverlay(OverlayLayer& overlay, size_t index);
+	void PrepareOverlays();
+	void RenderOverlay(size_t index);
+	bool CreateOverlayCache(OverlayLayer& overlay);
+	void ReleaseOverlayCache(OverlayLayer& overlay);
 	void CreatePipeline();
 	Microsoft::WRL::ComPtr<ID3DBlob> LoadShader(const char* shaderData, std::string targetShaderVersion, std::string shaderEntry);
 	void CreateExampleTriangle();
 	void CreateExampleFont();
 	void DrawExampleTriangle();
 	void DrawExampleText();
+	void CheckTraceHotkey();
 	void PrintHresultError(HRESULT hr);
+	static void OnWindowDestroyed(void* context);
 };
\ No newline at end of file
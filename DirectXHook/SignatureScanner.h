@@ -0,0 +1,409 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <intrin.h>
+#include <immintrin.h>
+
+/*
+* Finds byte patterns ("48 8B 05 ?? ?? ?? ?? 48 85 C0") in memory, so addresses survive game patches
+* instead of being hard coded.
+*
+* All signatures are searched for in a single sweep over the memory: every block of 16 (SSE2) or 32 (AVX2) bytes
+* is compared against the anchor byte of each signature, and only anchor hits are verified against the full pattern.
+* Large ranges are split across threads.
+*/
+
+struct Signature
+{
+	std::string name;
+	std::vector<uint8_t> bytes;
+	std::vector<uint8_t> mask; // 1 = byte must match, 0 = wildcard
+	size_t anchor = 0; // offset of the byte used for the SIMD search
+
+	// RIP-relative resolution: the match is an instruction with a 32-bit displacement at ripOffset,
+	// the target is relative to the end of the instruction (match + instructionLength).
+	bool ripRelative = false;
+	size_t ripOffset = 0;
+	size_t instructionLength = 0;
+
+	// Extra offset added to the final address
+	intptr_t offset = 0;
+
+	// Parses "AB ?? CD ? EF" style patterns. Returns an empty signature (no bytes) if the pattern is malformed.
+	static Signature Parse(const std::string& name, const std::string& pattern)
+	{
+		Signature signature;
+		signature.name = name;
+
+		size_t i = 0;
+		while (i < pattern.size())
+		{
+			if (pattern[i] == ' ')
+			{
+				i++;
+				continue;
+			}
+
+			if (pattern[i] == '?')
+			{
+				signature.bytes.push_back(0);
+				signature.mask.push_back(0);
+				i += (i + 1 < pattern.size() && pattern[i + 1] == '?') ? 2 : 1;
+				continue;
+			}
+
+			if (i + 1 >= pattern.size() || !isxdigit((unsigned char)pattern[i]) || !isxdigit((unsigned char)pattern[i + 1]))
+			{
+				signature.bytes.clear();
+				signature.mask.clear();
+				return signature;
+			}
+
+			signature.bytes.push_back((uint8_t)std::stoul(pattern.substr(i, 2), nullptr, 16));
+			signature.mask.push_back(1);
+			i += 2;
+		}
+
+		signature.ChooseAnchor();
+		return signature;
+	}
+
+	Signature& RipRelative(size_t displacementOffset, size_t instructionSize)
+	{
+		ripRelative = true;
+		ripOffset = displacementOffset;
+		instructionLength = instructionSize;
+		return *this;
+	}
+
+	bool IsValid() const
+	{
+		return !bytes.empty() && mask[anchor] == 1;
+	}
+
+	bool Matches(const uint8_t* data) const
+	{
+		for (size_t i = 0; i < bytes.size(); i++)
+		{
+			if (mask[i] && data[i] != bytes[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	// Bytes that show up everywhere in x64 code make bad anchors, they'd trigger a full compare at every other position.
+	void ChooseAnchor()
+	{
+		const uint8_t commonBytes[] = { 0x00, 0xFF, 0xCC, 0x48, 0x8B, 0x89, 0x0F, 0x90, 0x4C, 0x24 };
+		bool found = false;
+		for (size_t i = 0; i < bytes.size(); i++)
+		{
+			if (!mask[i])
+			{
+				continue;
+			}
+
+			bool common = std::find(std::begin(commonBytes), std::end(commonBytes), bytes[i]) != std::end(commonBytes);
+			if (!found || !common)
+			{
+				anchor = i;
+				found = true;
+				if (!common)
+				{
+					return;
+				}
+			}
+		}
+	}
+};
+
+struct ScanRange
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	uintptr_t address = 0; // address the data is mapped at, used for RIP-relative resolution
+};
+
+struct ScanResult
+{
+	uintptr_t match = 0; // address of the first (lowest) match
+	uintptr_t resolved = 0; // match after RIP-relative resolution and offset
+	size_t matchCount = 0; // more than one match usually means the signature is too loose
+};
+
+class SignatureScanner
+{
+public:
+	// 0 threads = one per hardware thread
+	SignatureScanner(unsigned int numThreads = 0)
+	{
+		m_numThreads = numThreads != 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+		m_useAvx2 = CpuSupportsAvx2();
+	}
+
+	// Scans all ranges for all signatures in one sweep. Results are in the same order as the signatures.
+	std::vector<ScanResult> Scan(const std::vector<ScanRange>& ranges, const std::vector<Signature>& signatures) const
+	{
+		std::vector<ScanResult> results(signatures.size());
+
+		size_t longest = 0;
+		for (const Signature& signature : signatures)
+		{
+			longest = std::max(longest, signature.bytes.size());
+		}
+		if (longest == 0)
+		{
+			return results;
+		}
+
+		// Chunks overlap by the longest pattern so matches across chunk borders aren't missed.
+		std::vector<Chunk> chunks;
+		for (const ScanRange& range : ranges)
+		{
+			for (size_t start = 0; start < range.size; start += ChunkSize)
+			{
+				Chunk chunk;
+				chunk.data = range.data + start;
+				chunk.address = range.address + start;
+				chunk.size = std::min(range.size - start, ChunkSize + longest - 1);
+				chunk.owned = std::min(range.size - start, ChunkSize);
+				chunks.push_back(chunk);
+			}
+		}
+
+		unsigned int numThreads = (unsigned int)std::min<size_t>(m_numThreads, chunks.size());
+		std::vector<std::vector<ScanResult>> threadResults(numThreads, std::vector<ScanResult>(signatures.size()));
+		std::atomic<size_t> nextChunk{ 0 };
+
+		auto worker = [&](unsigned int thread)
+		{
+			size_t chunk;
+			while ((chunk = nextChunk.fetch_add(1)) < chunks.size())
+			{
+				ScanChunk(chunks[chunk], signatures, threadResults[thread]);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < numThreads; i++)
+		{
+			threads.emplace_back(worker, i);
+		}
+		worker(0);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (size_t i = 0; i < signatures.size(); i++)
+		{
+			for (const std::vector<ScanResult>& thread : threadResults)
+			{
+				const ScanResult& result = thread[i];
+				if (result.matchCount == 0)
+				{
+					continue;
+				}
+
+				if (results[i].matchCount == 0 || result.match < results[i].match)
+				{
+					results[i].match = result.match;
+				}
+				results[i].matchCount += result.matchCount;
+			}
+
+			if (results[i].matchCount != 0)
+			{
+				results[i].resolved = Resolve(signatures[i], results[i].match, ranges);
+			}
+		}
+
+		return results;
+	}
+
+private:
+	static constexpr size_t ChunkSize = 1024 * 1024;
+
+	// Matches starting in the overlap at the end of a chunk belong to the next chunk.
+	struct Chunk : ScanRange
+	{
+		size_t owned = 0;
+	};
+
+	unsigned int m_numThreads = 1;
+	bool m_useAvx2 = false;
+
+	static bool CpuSupportsAvx2()
+	{
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		__cpuid(info, 1);
+		bool osUsesXsave = (info[2] & (1 << 27)) != 0;
+		bool cpuHasAvx = (info[2] & (1 << 28)) != 0;
+		if (!osUsesXsave || !cpuHasAvx || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}
+
+	// Follows a RIP-relative operand. The displacement is read from the scanned data, not from the address.
+	static uintptr_t Resolve(const Signature& signature, uintptr_t match, const std::vector<ScanRange>& ranges)
+	{
+		if (!signature.ripRelative)
+		{
+			return match + signature.offset;
+		}
+
+		for (const ScanRange& range : ranges)
+		{
+			uintptr_t displacementAddress = match + signature.ripOffset;
+			if (displacementAddress >= range.address && displacementAddress + sizeof(int32_t) <= range.address + range.size)
+			{
+				int32_t displacement;
+				memcpy(&displacement, range.data + (displacementAddress - range.address), sizeof(int32_t));
+				return match + signature.instructionLength + displacement + signature.offset;
+			}
+		}
+		return 0;
+	}
+
+	static void Verify(const Chunk& chunk, size_t position, const Signature& signature, ScanResult& result)
+	{
+		// A match starting before the chunk was already seen by the previous chunk's overlap.
+		if (position < signature.anchor)
+		{
+			return;
+		}
+
+		size_t start = position - signature.anchor;
+		if (start >= chunk.owned || start + signature.bytes.size() > chunk.size || !signature.Matches(chunk.data + start))
+		{
+			return;
+		}
+
+		uintptr_t address = chunk.address + start;
+		if (result.matchCount == 0 || address < result.match)
+		{
+			result.match = address;
+		}
+		result.matchCount++;
+	}
+
+	void ScanChunk(const Chunk& chunk, const std::vector<Signature>& signatures, std::vector<ScanResult>& results) const
+	{
+		// Signatures sharing an anchor byte share the compare.
+		std::vector<uint8_t> anchors;
+		std::vector<std::vector<size_t>> anchorSignatures;
+		for (size_t i = 0; i < signatures.size(); i++)
+		{
+			if (!signatures[i].IsValid())
+			{
+				continue;
+			}
+
+			uint8_t anchor = signatures[i].bytes[signatures[i].anchor];
+			auto it = std::find(anchors.begin(), anchors.end(), anchor);
+			if (it == anchors.end())
+			{
+				anchors.push_back(anchor);
+				anchorSignatures.push_back({ i });
+			}
+			else
+			{
+				anchorSignatures[it - anchors.begin()].push_back(i);
+			}
+		}
+
+		size_t position;
+		if (m_useAvx2)
+		{
+			position = ScanAvx2(chunk, anchors, anchorSignatures, signatures, results);
+		}
+		else
+		{
+			position = ScanSse2(chunk, anchors, anchorSignatures, signatures, results);
+		}
+
+		for (; position < chunk.size; position++)
+		{
+			for (size_t a = 0; a < anchors.size(); a++)
+			{
+				if (chunk.data[position] == anchors[a])
+				{
+					for (size_t index : anchorSignatures[a])
+					{
+						Verify(chunk, position, signatures[index], results[index]);
+					}
+				}
+			}
+		}
+	}
+
+	size_t ScanSse2(const Chunk& chunk, const std::vector<uint8_t>& anchors, const std::vector<std::vector<size_t>>& anchorSignatures,
+		const std::vector<Signature>& signatures, std::vector<ScanResult>& results) const
+	{
+		size_t position = 0;
+		for (; position + 16 <= chunk.size; position += 16)
+		{
+			__m128i block = _mm_loadu_si128((const __m128i*)(chunk.data + position));
+			for (size_t a = 0; a < anchors.size(); a++)
+			{
+				unsigned int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8((char)anchors[a])));
+				while (hits != 0)
+				{
+					unsigned long bit;
+					_BitScanForward(&bit, hits);
+					hits &= hits - 1;
+					for (size_t index : anchorSignatures[a])
+					{
+						Verify(chunk, position + bit, signatures[index], results[index]);
+					}
+				}
+			}
+		}
+		return position;
+	}
+
+	size_t ScanAvx2(const Chunk& chunk, const std::vector<uint8_t>& anchors, const std::vector<std::vector<size_t>>& anchorSignatures,
+		const std::vector<Signature>& signatures, std::vector<ScanResult>& results) const
+	{
+		size_t position = 0;
+		for (; position + 32 <= chunk.size; position += 32)
+		{
+			__m256i block = _mm256_loadu_si256((const __m256i*)(chunk.data + position));
+			for (size_t a = 0; a < anchors.size(); a++)
+			{
+				unsigned int hits = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8((char)anchors[a])));
+				while (hits != 0)
+				{
+					unsigned long bit;
+					_BitScanForward(&bit, hits);
+					hits &= hits - 1;
+					for (size_t index : anchorSignatures[a])
+					{
+						Verify(chunk, position + bit, signatures[index], results[index]);
+					}
+				}
+			}
+		}
+		return position;
+	}
+};
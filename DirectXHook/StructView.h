@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "MemoryAccess.h"
+
+/*
+* Typed views of game structures. A field is a type at a fixed offset, known at compile time:
+*
+*	typedef Field<uint64_t, 0x18> TotalDamage;
+*	typedef Field<float, 0x40> Health;
+*	StructView<TotalDamage, Health> hunter;
+*	if (hunter.Read(memory, hunterAddress))
+*	{
+*		uint64_t damage = hunter.Get<TotalDamage>();
+*	}
+*
+* Read() copies the range covering all of the view's fields in one bounded read, Get() decodes from that copy.
+* Reading any number of fields of an object costs one validated read. MemoryWatch::WatchStruct() samples views
+* the same way on its thread.
+*/
+
+template<typename T, size_t FieldOffset>
+struct Field
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Fields must be trivially copyable");
+
+	typedef T Type;
+	static constexpr size_t Offset = FieldOffset;
+	static constexpr size_t End = FieldOffset + sizeof(T);
+};
+
+namespace StructViewDetail
+{
+	template<typename... Fields>
+	struct Extent;
+
+	template<typename First>
+	struct Extent<First>
+	{
+		static constexpr size_t Begin = First::Offset;
+		static constexpr size_t End = First::End;
+	};
+
+	template<typename First, typename... Rest>
+	struct Extent<First, Rest...>
+	{
+		static constexpr size_t Begin = First::Offset < Extent<Rest...>::Begin ? First::Offset : Extent<Rest...>::Begin;
+		static constexpr size_t End = First::End > Extent<Rest...>::End ? First::End : Extent<Rest...>::End;
+	};
+
+	template<typename Wanted, typename... Fields>
+	struct Contains : std::false_type { };
+
+	template<typename Wanted, typename First, typename... Rest>
+	struct Contains<Wanted, First, Rest...> : std::integral_constant<bool, std::is_same<Wanted, First>::value || Contains<Wanted, Rest...>::value> { };
+}
+
+template<typename... Fields>
+class StructView
+{
+public:
+	static_assert(sizeof...(Fields) > 0, "A view needs at least one field");
+
+	static constexpr size_t Begin = StructViewDetail::Extent<Fields...>::Begin;
+	static constexpr size_t End = StructViewDetail::Extent<Fields...>::End;
+	static constexpr size_t Size = End - Begin;
+
+	// Copies the fields' range of the structure at address. On failure the view keeps its previous contents.
+	bool Read(IMemoryAccess& memory, uintptr_t address)
+	{
+		uint8_t data[Size];
+		if (address == 0 || !memory.Read(address + Begin, data, Size))
+		{
+			return false;
+		}
+
+		memcpy(m_data, data, Size);
+		m_valid = true;
+		return true;
+	}
+
+	// For structures that are already in this process or were copied some other way.
+	void Assign(const void* structure)
+	{
+		memcpy(m_data, (const uint8_t*)structure + Begin, Size);
+		m_valid = true;
+	}
+
+	// For a copy of just the fields' range, Size bytes starting at Begin.
+	void AssignRange(const void* range)
+	{
+		memcpy(m_data, range, Size);
+		m_valid = true;
+	}
+
+	bool IsValid() const
+	{
+		return m_valid;
+	}
+
+	template<typename F>
+	typename F::Type Get() const
+	{
+		static_assert(StructViewDetail::Contains<F, Fields...>::value, "The field is not part of this view");
+
+		typename F::Type value;
+		memcpy(&value, m_data + (F::Offset - Begin), sizeof(value));
+		return value;
+	}
+
+private:
+	uint8_t m_data[Size] = { 0 };
+	bool m_valid = false;
+};
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "Varint.h"
+
+/*
+* Compressed, append-only series of (timestamp, value) points for long overlay histories.
+* Points are packed into fixed size blocks: the first point of a block is stored as is, every following point
+* as a zigzag varint of its timestamp's delta-of-delta and a zigzag varint of its value's delta.
+* Regularly sampled, slowly changing values take 2-3 bytes per point instead of 16.
+*
+* Blocks are independent, they can be decoded one at a time. With a block limit the oldest blocks are dropped.
+* Not thread safe.
+*/
+class TimeSeries
+{
+public:
+	static constexpr size_t BlockSize = 4096; // encoded bytes per block
+
+	struct Point
+	{
+		uint64_t timestamp = 0;
+		int64_t value = 0;
+	};
+
+	struct Block
+	{
+		Point first;
+		Point last;
+		int64_t lastTimestampDelta = 0;
+		uint32_t numPoints = 0;
+		uint32_t size = 0; // bytes used in data
+		uint8_t data[BlockSize];
+	};
+
+	// 0 blocks = no limit
+	TimeSeries(size_t maxBlocks = 0)
+	{
+		m_maxBlocks = maxBlocks;
+	}
+
+	// Timestamps must not go backwards.
+	void Append(uint64_t timestamp, int64_t value)
+	{
+		if (m_blocks.empty() || m_blocks.back().numPoints == 0)
+		{
+			StartBlock(timestamp, value);
+			return;
+		}
+
+		Block& block = m_blocks.back();
+		int64_t timestampDelta = (int64_t)(timestamp - block.last.timestamp);
+
+		uint8_t encoded[2 * Varint::MaxSize];
+		size_t size = Varint::Put(encoded, Varint::ZigZag(timestampDelta - block.lastTimestampDelta));
+		size += Varint::Put(encoded + size, Varint::ZigZag((int64_t)((uint64_t)value - (uint64_t)block.last.value)));
+
+		if (block.size + size > BlockSize)
+		{
+			StartBlock(timestamp, value);
+			return;
+		}
+
+		memcpy(block.data + block.size, encoded, size);
+		block.size += (uint32_t)size;
+		block.numPoints++;
+		block.last.timestamp = timestamp;
+		block.last.value = value;
+		block.lastTimestampDelta = timestampDelta;
+		m_numPoints++;
+	}
+
+	void Clear()
+	{
+		m_blocks.clear();
+		m_numPoints = 0;
+	}
+
+	size_t NumPoints() const
+	{
+		return m_numPoints;
+	}
+
+	size_t NumBlocks() const
+	{
+		return m_blocks.size();
+	}
+
+	const Block& GetBlock(size_t index) const
+	{
+		return m_blocks[index];
+	}
+
+	// Encoded size, for comparing against NumPoints() * sizeof(Point)
+	size_t CompressedBytes() const
+	{
+		size_t bytes = 0;
+		for (const Block& block : m_blocks)
+		{
+			bytes += sizeof(Point) + block.size;
+		}
+		return bytes;
+	}
+
+	bool Empty() const
+	{
+		return m_numPoints == 0;
+	}
+
+	Point First() const
+	{
+		return m_blocks.front().first;
+	}
+
+	Point Last() const
+	{
+		return m_blocks.back().last;
+	}
+
+	// Calls callback(const Point&) for every point of one block, oldest first.
+	template<typename Callback>
+	static void DecodeBlock(const Block& block, Callback callback)
+	{
+		if (block.numPoints == 0)
+		{
+			return;
+		}
+
+		Point point = block.first;
+		int64_t timestampDelta = 0;
+		callback(point);
+
+		size_t position = 0;
+		for (uint32_t i = 1; i < block.numPoints; i++)
+		{
+			timestampDelta += Varint::UnZigZag(Varint::GetUnchecked(block.data, &position));
+			point.timestamp += timestampDelta;
+			point.value = (int64_t)((uint64_t)point.value + (uint64_t)Varint::UnZigZag(Varint::GetUnchecked(block.data, &position)));
+			callback(point);
+		}
+	}
+
+	// Calls callback(const Point&) for every point, oldest first.
+	template<typename Callback>
+	void ForEach(Callback callback) const
+	{
+		for (const Block& block : m_blocks)
+		{
+			DecodeBlock(block, callback);
+		}
+	}
+
+	// Calls callback(const Point&) for every point with from <= timestamp < to, skipping blocks outside the range.
+	template<typename Callback>
+	void ForEachInRange(uint64_t from, uint64_t to, Callback callback) const
+	{
+		for (const Block& block : m_blocks)
+		{
+			if (block.numPoints == 0 || block.last.timestamp < from || block.first.timestamp >= to)
+			{
+				continue;
+			}
+
+			DecodeBlock(block, [&](const Point& point)
+			{
+				if (point.timestamp >= from && point.timestamp < to)
+				{
+					callback(point);
+				}
+			});
+		}
+	}
+
+private:
+	std::deque<Block> m_blocks;
+	size_t m_maxBlocks = 0;
+	size_t m_numPoints = 0;
+
+	void StartBlock(uint64_t timestamp, int64_t value)
+	{
+		if (m_maxBlocks != 0 && m_blocks.size() >= m_maxBlocks)
+		{
+			m_numPoints -= m_blocks.front().numPoints;
+			m_blocks.pop_front();
+		}
+
+		m_blocks.emplace_back();
+		Block& block = m_blocks.back();
+		block.first.timestamp = timestamp;
+		block.first.value = value;
+		block.last = block.first;
+		block.lastTimestampDelta = 0;
+		block.numPoints = 1;
+		block.size = 0;
+		m_numPoints++;
+	}
+};
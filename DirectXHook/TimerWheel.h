@@ -0,0 +1,391 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+* Hierarchical timer wheel driven by a monotonic clock.
+* Advance() is called once per frame (or once per Update()) and reads the clock a single time,
+* every timer due at that point fires from there. Scheduling, cancelling and expiring a timer is O(1).
+*
+* Time based timers have millisecond resolution, frame based timers count Advance() calls.
+* The clock can be swapped out, it must return monotonic milliseconds.
+*
+* Not thread safe, a wheel belongs to the thread that advances it.
+*/
+class TimerWheel
+{
+public:
+	typedef uint64_t TimerId; // 0 is never a valid id
+	typedef uint64_t(*Clock)();
+
+	static uint64_t SteadyClockMillis()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	TimerWheel(Clock clock = &SteadyClockMillis)
+	{
+		m_clock = clock;
+		m_now = m_clock();
+		m_timeWheel.current = m_now;
+	}
+
+	// Nodes point into the wheel's slot arrays, so the wheel can't be copied.
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	// Fires once after the given number of milliseconds.
+	TimerId After(uint64_t millis, std::function<void()> callback)
+	{
+		return Schedule(false, false, millis, std::move(callback));
+	}
+
+	// Fires every interval milliseconds. Missed intervals are skipped rather than fired back to back.
+	TimerId Every(uint64_t millis, std::function<void()> callback)
+	{
+		return Schedule(false, true, millis, std::move(callback));
+	}
+
+	// Fires once after the given number of Advance() calls.
+	TimerId AfterFrames(uint64_t frames, std::function<void()> callback)
+	{
+		return Schedule(true, false, frames, std::move(callback));
+	}
+
+	// Fires every given number of Advance() calls.
+	TimerId EveryFrames(uint64_t frames, std::function<void()> callback)
+	{
+		return Schedule(true, true, frames, std::move(callback));
+	}
+
+	bool IsActive(TimerId id) const
+	{
+		return Lookup(id) != nullptr;
+	}
+
+	bool Cancel(TimerId id)
+	{
+		const Node* node = Lookup(id);
+		if (node == nullptr)
+		{
+			return false;
+		}
+
+		uint32_t index = (uint32_t)(id & 0xFFFFFFFF);
+		Unlink(index);
+		Release(index);
+		return true;
+	}
+
+	// Re-arms a timer so its full interval counts from now.
+	bool Restart(TimerId id)
+	{
+		const Node* node = Lookup(id);
+		if (node == nullptr)
+		{
+			return false;
+		}
+
+		uint32_t index = (uint32_t)(id & 0xFFFFFFFF);
+		Unlink(index);
+		Wheel& wheel = WheelOf(m_nodes[index]);
+		m_nodes[index].expiry = wheel.current + m_nodes[index].interval;
+		Link(wheel, index);
+		return true;
+	}
+
+	// Reads the clock once and fires every timer that is due.
+	void Advance()
+	{
+		uint64_t now = m_clock();
+		if (now > m_now)
+		{
+			m_now = now;
+		}
+		m_frame++;
+
+		AdvanceWheel(m_frameWheel, m_frame);
+		AdvanceWheel(m_timeWheel, m_now);
+	}
+
+	// The clock reading of the last Advance(), shared by everything that runs this frame.
+	uint64_t Now() const
+	{
+		return m_now;
+	}
+
+	uint64_t Frame() const
+	{
+		return m_frame;
+	}
+
+private:
+	static constexpr int SlotBits = 6;
+	static constexpr int NumSlots = 1 << SlotBits;
+	static constexpr int SlotMask = NumSlots - 1;
+	static constexpr int NumLevels = 4; // 2^24 ticks, about 4.6 hours of milliseconds before timers need re-cascading
+	static constexpr uint32_t None = 0xFFFFFFFF;
+
+	struct Node
+	{
+		std::function<void()> callback;
+		uint64_t expiry = 0;
+		uint64_t interval = 0;
+		uint32_t generation = 1;
+		uint32_t next = None;
+		uint32_t previous = None;
+		uint32_t* head = nullptr; // the slot list this node is in, nullptr when free
+		bool frameBased = false;
+		bool periodic = false;
+	};
+
+	struct Wheel
+	{
+		uint64_t current = 0;
+		uint64_t occupied[NumLevels] = { 0 };
+		uint32_t slots[NumLevels][NumSlots];
+
+		Wheel()
+		{
+			for (int level = 0; level < NumLevels; level++)
+			{
+				for (int slot = 0; slot < NumSlots; slot++)
+				{
+					slots[level][slot] = None;
+				}
+			}
+		}
+	};
+
+	Clock m_clock = nullptr;
+	uint64_t m_now = 0;
+	uint64_t m_frame = 0;
+	Wheel m_timeWheel;
+	Wheel m_frameWheel;
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_freeNodes;
+
+	Wheel& WheelOf(const Node& node)
+	{
+		return node.frameBased ? m_frameWheel : m_timeWheel;
+	}
+
+	const Node* Lookup(TimerId id) const
+	{
+		uint32_t index = (uint32_t)(id & 0xFFFFFFFF);
+		uint32_t generation = (uint32_t)(id >> 32);
+		if (index >= m_nodes.size() || m_nodes[index].generation != generation || m_nodes[index].head == nullptr)
+		{
+			return nullptr;
+		}
+		return &m_nodes[index];
+	}
+
+	TimerId Schedule(bool frameBased, bool periodic, uint64_t delay, std::function<void()> callback)
+	{
+		uint32_t index;
+		if (!m_freeNodes.empty())
+		{
+			index = m_freeNodes.back();
+			m_freeNodes.pop_back();
+		}
+		else
+		{
+			index = (uint32_t)m_nodes.size();
+			m_nodes.emplace_back();
+		}
+
+		// A zero delay fires on the next Advance(), periodic timers need at least one tick between firings.
+		if (delay == 0)
+		{
+			delay = 1;
+		}
+
+		Node& node = m_nodes[index];
+		node.callback = std::move(callback);
+		node.frameBased = frameBased;
+		node.periodic = periodic;
+		node.interval = delay;
+
+		Wheel& wheel = WheelOf(node);
+		node.expiry = wheel.current + delay;
+		Link(wheel, index);
+
+		return ((TimerId)node.generation << 32) | index;
+	}
+
+	void Release(uint32_t index)
+	{
+		Node& node = m_nodes[index];
+		node.callback = nullptr;
+		node.generation++;
+		m_freeNodes.push_back(index);
+	}
+
+	void Link(Wheel& wheel, uint32_t index)
+	{
+		Node& node = m_nodes[index];
+		uint64_t delta = node.expiry > wheel.current ? node.expiry - wheel.current : 0;
+
+		int level = 0;
+		while (level < NumLevels - 1 && delta >= ((uint64_t)1 << (SlotBits * (level + 1))))
+		{
+			level++;
+		}
+
+		int slot;
+		if (delta >= ((uint64_t)1 << (SlotBits * NumLevels)))
+		{
+			// Too far out for the wheel, park it in the last slot of the top level and re-cascade it from there.
+			slot = (int)(((wheel.current >> (SlotBits * level)) + SlotMask) & SlotMask);
+		}
+		else
+		{
+			uint64_t expiry = delta == 0 ? wheel.current : node.expiry;
+			slot = (int)((expiry >> (SlotBits * level)) & SlotMask);
+		}
+
+		uint32_t* head = &wheel.slots[level][slot];
+		node.head = head;
+		node.previous = None;
+		node.next = *head;
+		if (*head != None)
+		{
+			m_nodes[*head].previous = index;
+		}
+		*head = index;
+		wheel.occupied[level] |= (uint64_t)1 << slot;
+	}
+
+	void Unlink(uint32_t index)
+	{
+		Node& node = m_nodes[index];
+		if (node.previous != None)
+		{
+			m_nodes[node.previous].next = node.next;
+		}
+		else
+		{
+			*node.head = node.next;
+		}
+
+		if (node.next != None)
+		{
+			m_nodes[node.next].previous = node.previous;
+		}
+
+		node.head = nullptr;
+		node.next = None;
+		node.previous = None;
+	}
+
+	// Occupancy bits are only cleared lazily, a stale bit just means an empty slot gets visited.
+	void UpdateOccupancy(Wheel& wheel, int level, int slot)
+	{
+		if (wheel.slots[level][slot] == None)
+		{
+			wheel.occupied[level] &= ~((uint64_t)1 << slot);
+		}
+	}
+
+	void Cascade(Wheel& wheel, int level, int slot)
+	{
+		uint32_t index = wheel.slots[level][slot];
+		wheel.slots[level][slot] = None;
+		wheel.occupied[level] &= ~((uint64_t)1 << slot);
+
+		while (index != None)
+		{
+			uint32_t next = m_nodes[index].next;
+			Link(wheel, index);
+			index = next;
+		}
+	}
+
+	void Expire(Wheel& wheel, int slot, uint64_t target)
+	{
+		uint32_t* head = &wheel.slots[0][slot];
+		while (*head != None)
+		{
+			uint32_t index = *head;
+			Unlink(index);
+
+			// The callback may schedule new timers and grow m_nodes, so it's moved out while it runs.
+			std::function<void()> callback = std::move(m_nodes[index].callback);
+			uint32_t generation = m_nodes[index].generation;
+
+			if (m_nodes[index].periodic)
+			{
+				// Measured against where this Advance() ends up so a stall doesn't fire the timer repeatedly.
+				m_nodes[index].expiry += m_nodes[index].interval;
+				if (m_nodes[index].expiry <= target)
+				{
+					m_nodes[index].expiry = target + m_nodes[index].interval;
+				}
+				Link(wheel, index);
+			}
+
+			callback();
+
+			// Put the callback back unless the timer was cancelled (or finished) in the meantime.
+			if (m_nodes[index].generation == generation)
+			{
+				if (m_nodes[index].head != nullptr)
+				{
+					m_nodes[index].callback = std::move(callback);
+				}
+				else
+				{
+					Release(index);
+				}
+			}
+		}
+		UpdateOccupancy(wheel, 0, slot);
+	}
+
+	void AdvanceWheel(Wheel& wheel, uint64_t target)
+	{
+		while (wheel.current < target)
+		{
+			// Nothing can expire before the next level 0 wrap-around, so skip straight to it.
+			if (wheel.occupied[0] == 0)
+			{
+				uint64_t skipTo = wheel.current | SlotMask;
+				wheel.current = skipTo < target ? skipTo : target;
+				if (wheel.current == target)
+				{
+					break;
+				}
+			}
+
+			wheel.current++;
+
+			if ((wheel.current & SlotMask) == 0)
+			{
+				int topLevel = 1;
+				while (topLevel < NumLevels - 1 && ((wheel.current >> (SlotBits * topLevel)) & SlotMask) == 0)
+				{
+					topLevel++;
+				}
+
+				for (int level = topLevel; level >= 1; level--)
+				{
+					int slot = (int)((wheel.current >> (SlotBits * level)) & SlotMask);
+					if (wheel.occupied[level] & ((uint64_t)1 << slot))
+					{
+						Cascade(wheel, level, slot);
+					}
+				}
+			}
+
+			int slot = (int)(wheel.current & SlotMask);
+			if (wheel.occupied[0] & ((uint64_t)1 << slot))
+			{
+				Expire(wheel, slot, target);
+			}
+		}
+	}
+};
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <Windows.h>
+#include <intrin.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+* Timeline tracing of the hook, the renderer and the overlays.
+* Spans and counters are recorded into a ring per thread (no locks, no allocation after the first event of a thread)
+* and dumped on demand as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev can open.
+* Recording is off unless enabled, a disabled TRACE_SCOPE costs one relaxed load.
+*
+*	TRACE_SCOPE("Renderer::Render");
+*	TRACE_SCOPE_ARG("Overlay", index); // the argument shows up in the span's details
+*	TRACE_COUNTER("Frame", frameNumber);
+*	TRACE_COUNTER_ARG("Overlay cost (us)", index, micros); // one series per argument
+*
+* Names must be string literals. The newest events win, a ring keeps the last EventsPerThread events of its thread.
+*/
+class Trace
+{
+public:
+	static constexpr size_t EventsPerThread = 65536;
+
+	enum class EventType : uint8_t
+	{
+		Span,
+		Counter
+	};
+
+	struct Event
+	{
+		const char* name = "";
+		uint64_t start = 0; // timestamp counter ticks
+		uint64_t value = 0; // duration in ticks for spans
+		int32_t arg = -1; // -1 = none
+		EventType type = EventType::Span;
+	};
+
+	static Trace& Instance()
+	{
+		static Trace trace;
+		return trace;
+	}
+
+	void Enable(bool enabled)
+	{
+		m_enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool IsEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	// The CPU's timestamp counter, reading it is a lot cheaper than the OS clock. Ticks are converted to time when dumping.
+	static uint64_t Now()
+	{
+		return __rdtsc();
+	}
+
+	void Record(const char* name, EventType type, uint64_t start, uint64_t value, int32_t arg = -1)
+	{
+		ThreadBuffer* buffer = CurrentThreadBuffer();
+		uint64_t head = buffer->head.load(std::memory_order_relaxed);
+		Slot& slot = buffer->slots[head % EventsPerThread];
+		slot.sequence.store(head * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.event.name = name;
+		slot.event.start = start;
+		slot.event.value = value;
+		slot.event.arg = arg;
+		slot.event.type = type;
+		slot.sequence.store(head * 2 + 2, std::memory_order_release);
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	// Can be called from any thread while recording goes on. An event whose slot was being written
+	// or reused while it was copied (its sequence isn't the finished one before and after) is left out.
+	bool DumpChromeJson(const std::string& fileName)
+	{
+		FILE* file = nullptr;
+		fopen_s(&file, fileName.c_str(), "w");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		std::vector<ThreadBuffer*> buffers;
+		{
+			std::lock_guard<std::mutex> lock(m_buffersMutex);
+			for (const std::unique_ptr<ThreadBuffer>& buffer : m_buffers)
+			{
+				buffers.push_back(buffer.get());
+			}
+		}
+
+		// Ticks per microsecond, measured against the steady clock since the trace was created
+		uint64_t endTicks = Now();
+		uint64_t endNanos = SteadyNanos();
+		double ticksPerMicro = endNanos > m_startNanos ? (endTicks - m_startTicks) * 1000.0 / (endNanos - m_startNanos) : 1000.0;
+
+		uint32_t processId = GetCurrentProcessId();
+		fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":0,\"args\":{\"name\":\"DirectXHook\"}}", processId);
+
+		for (ThreadBuffer* buffer : buffers)
+		{
+			uint64_t head = buffer->head.load(std::memory_order_acquire);
+			uint64_t begin = head > EventsPerThread ? head - EventsPerThread : 0;
+
+			for (uint64_t i = begin; i < head; i++)
+			{
+				Event event;
+				if (!ReadEvent(buffer->slots[i % EventsPerThread], i, &event))
+				{
+					continue;
+				}
+
+				if (event.type == EventType::Span)
+				{
+					fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+						event.name, processId, buffer->threadId, (int64_t)(event.start - m_startTicks) / ticksPerMicro, event.value / ticksPerMicro);
+					if (event.arg != -1)
+					{
+						fprintf(file, ",\"args\":{\"arg\":%d}", event.arg);
+					}
+				}
+				else
+				{
+					fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"args\":{",
+						event.name, processId, buffer->threadId, (int64_t)(event.start - m_startTicks) / ticksPerMicro);
+					if (event.arg != -1)
+					{
+						fprintf(file, "\"%d\":%llu}", event.arg, (unsigned long long)event.value);
+					}
+					else
+					{
+						fprintf(file, "\"value\":%llu}", (unsigned long long)event.value);
+					}
+				}
+				fprintf(file, "}");
+			}
+		}
+
+		fprintf(file, "\n]}\n");
+		bool written = ferror(file) == 0;
+		fclose(file);
+		return written;
+	}
+
+private:
+	// The sequence is odd while the event is being written and index * 2 + 2 once it is done.
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence{ 0 };
+		Event event;
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t threadId = 0;
+		std::atomic<uint64_t> head{ 0 };
+		Slot slots[EventsPerThread];
+	};
+
+	std::atomic<bool> m_enabled{ false };
+	uint64_t m_startTicks = 0;
+	uint64_t m_startNanos = 0;
+	std::mutex m_buffersMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_buffers; // never shrinks, a thread's events outlive the thread
+
+	Trace()
+	{
+		m_startTicks = Now();
+		m_startNanos = SteadyNanos();
+	}
+
+	static uint64_t SteadyNanos()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static bool ReadEvent(const Slot& slot, uint64_t index, Event* event)
+	{
+		uint64_t finished = index * 2 + 2;
+		if (slot.sequence.load(std::memory_order_acquire) != finished)
+		{
+			return false;
+		}
+
+		*event = slot.event;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot.sequence.load(std::memory_order_relaxed) == finished;
+	}
+
+	ThreadBuffer* CurrentThreadBuffer()
+	{
+		static thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer());
+			newBuffer->threadId = GetCurrentThreadId();
+			buffer = newBuffer.get();
+
+			std::lock_guard<std::mutex> lock(m_buffersMutex);
+			m_buffers.push_back(std::move(newBuffer));
+		}
+		return buffer;
+	}
+};
+
+class TraceScope
+{
+public:
+	TraceScope(const char* name, int32_t arg = -1)
+	{
+		if (Trace::Instance().IsEnabled())
+		{
+			m_name = name;
+			m_arg = arg;
+			m_start = Trace::Now();
+		}
+	}
+
+	~TraceScope()
+	{
+		if (m_name != nullptr)
+		{
+			Trace::Instance().Record(m_name, Trace::EventType::Span, m_start, Trace::Now() - m_start, m_arg);
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* m_name = nullptr;
+	uint64_t m_start = 0;
+	int32_t m_arg = -1;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, (int32_t)(arg))
+#define TRACE_COUNTER_ARG(name, arg, value) \
+	do \
+	{ \
+		if (Trace::Instance().IsEnabled()) \
+		{ \
+			Trace::Instance().Record(name, Trace::EventType::Counter, Trace::Now(), (uint64_t)(value), (int32_t)(arg)); \
+		} \
+	} while (0)
+#define TRACE_COUNTER(name, value) TRACE_COUNTER_ARG(name, -1, value)
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+/*
+* Hands the latest snapshot from one producer thread to one consumer thread without locking or waiting.
+* The producer fills WriteBuffer() and calls Publish(), the consumer calls Read() and always gets
+* the newest complete snapshot. Neither side ever sees the buffer the other side is working on.
+* WriteBuffer() holds whatever was published two snapshots ago, so the producer must overwrite every field.
+*/
+template<typename T>
+class TripleBuffer
+{
+public:
+	// Sets all three buffers, only call this before the producer and consumer threads start.
+	void Reset(const T& value)
+	{
+		for (T& buffer : m_buffers)
+		{
+			buffer = value;
+		}
+	}
+
+	T& WriteBuffer()
+	{
+		return m_buffers[m_writeIndex];
+	}
+
+	void Publish()
+	{
+		unsigned int previous = m_middle.exchange(m_writeIndex | DirtyBit, std::memory_order_acq_rel);
+		m_writeIndex = previous & IndexMask;
+	}
+
+	bool HasNewSnapshot() const
+	{
+		return m_middle.load(std::memory_order_relaxed) & DirtyBit;
+	}
+
+	const T& Read()
+	{
+		if (HasNewSnapshot())
+		{
+			unsigned int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+			m_readIndex = previous & IndexMask;
+		}
+		return m_buffers[m_readIndex];
+	}
+
+private:
+	static constexpr unsigned int DirtyBit = 4;
+	static constexpr unsigned int IndexMask = 3;
+
+	T m_buffers[3];
+	unsigned int m_writeIndex = 0;
+	unsigned int m_readIndex = 2;
+	alignas(64) std::atomic<unsigned int> m_middle{ 1 };
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+* LEB128 style variable length integers (7 bits per byte, high bit = more bytes follow)
+* and zigzag mapping so small negative numbers stay small.
+*/
+namespace Varint
+{
+	static constexpr size_t MaxSize = 10;
+
+	inline uint64_t ZigZag(int64_t value)
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	inline int64_t UnZigZag(uint64_t value)
+	{
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	// Writes at most MaxSize bytes, returns how many were written.
+	inline size_t Put(uint8_t* out, uint64_t value)
+	{
+		size_t size = 0;
+		while (value >= 0x80)
+		{
+			out[size++] = (uint8_t)(value | 0x80);
+			value >>= 7;
+		}
+		out[size++] = (uint8_t)value;
+		return size;
+	}
+
+	// Reads a varint at *position, fails (without moving) if it runs past size or is too long.
+	inline bool Get(const uint8_t* data, size_t size, size_t* position, uint64_t* value)
+	{
+		uint64_t result = 0;
+		size_t current = *position;
+		for (int shift = 0; shift < 70; shift += 7)
+		{
+			if (current >= size)
+			{
+				return false;
+			}
+
+			uint8_t byte = data[current++];
+			result |= (uint64_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				*value = result;
+				*position = current;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Reads a varint from data that is known to be well formed.
+	inline uint64_t GetUnchecked(const uint8_t* data, size_t* position)
+	{
+		uint64_t value = 0;
+		int shift = 0;
+		uint8_t byte;
+		do
+		{
+			byte = data[(*position)++];
+			value |= (uint64_t)(byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+		return value;
+	}
+}
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Check.h"
+#include "AddressCache.h"
+
+// Reads this process's own memory.
+class LocalMemory : public IMemoryAccess
+{
+public:
+	bool Query(uintptr_t, MemoryRegion*) override
+	{
+		return false;
+	}
+
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		if (address == 0)
+		{
+			return false;
+		}
+		memcpy(buffer, (const void*)address, size);
+		return true;
+	}
+};
+
+static void TestCache()
+{
+	const char* fileName = "address_cache_test.bin";
+	remove(fileName);
+
+	ModuleFingerprint fingerprint;
+	fingerprint.timeDateStamp = 123;
+	fingerprint.sizeOfImage = 0x1000000;
+	fingerprint.sampleHash = 0xDEADBEEF;
+
+	// The same signature with other offsets is another entry.
+	uint64_t key = AddressCache::Key("48 8B 05 ?? ?? ?? ??", { 3, 7, 0x70, 0x18 });
+	uint64_t otherKey = AddressCache::Key("48 8B 05 ?? ?? ?? ??", { 3, 7, 0x70, 0x20 });
+	CHECK(key != otherKey);
+	CHECK(key == AddressCache::Key("48 8B 05 ?? ?? ?? ??", { 3, 7, 0x70, 0x18 }));
+
+	{
+		AddressCache cache(fileName, fingerprint);
+		CHECK(!cache.Load());
+		cache.Store("A", key, 0x1234, { 1, 2, 3 });
+		cache.Store("B", key, 0x10);
+		CHECK(cache.IsDirty());
+		CHECK(cache.Save());
+	}
+	{
+		AddressCache cache(fileName, fingerprint);
+		CHECK(cache.Load());
+		const CachedAddress* address = cache.Lookup("A", key);
+		CHECK(address != nullptr);
+		if (address != nullptr)
+		{
+			CHECK_EQUAL(address->moduleOffset, 0x1234u);
+			CHECK_EQUAL(address->offsets.size(), 3u);
+			CHECK_EQUAL(address->offsets.back(), 3u);
+		}
+		CHECK(cache.Lookup("B", key) != nullptr);
+		CHECK(cache.Lookup("A", otherKey) == nullptr);
+
+		cache.Store("A", otherKey, 0x99);
+		CHECK(cache.Save());
+	}
+	{
+		AddressCache cache(fileName, fingerprint);
+		CHECK(cache.Load());
+		CHECK(cache.Lookup("A", key) == nullptr);
+		const CachedAddress* address = cache.Lookup("A", otherKey);
+		CHECK(address != nullptr && address->moduleOffset == 0x99);
+	}
+
+	// Another build of the game, or a damaged file, is ignored.
+	ModuleFingerprint otherBuild = fingerprint;
+	otherBuild.sampleHash++;
+	CHECK(!AddressCache(fileName, otherBuild).Load());
+
+	FILE* file = fopen(fileName, "r+b");
+	fseek(file, 30, SEEK_SET);
+	fputc(0x55, file);
+	fclose(file);
+	CHECK(!AddressCache(fileName, fingerprint).Load());
+}
+
+// A minimal image in memory: the fingerprint follows the code bytes and the header fields.
+static void TestFingerprint()
+{
+	struct Image
+	{
+		IMAGE_DOS_HEADER dos;
+		IMAGE_NT_HEADERS nt;
+		IMAGE_SECTION_HEADER sections[1];
+	};
+
+	alignas(4096) static uint8_t memory[0x3000] = {};
+	Image* image = (Image*)memory;
+	image->dos.e_magic = IMAGE_DOS_SIGNATURE;
+	image->dos.e_lfanew = offsetof(Image, nt);
+	image->nt.Signature = IMAGE_NT_SIGNATURE;
+	image->nt.OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR_MAGIC;
+	image->nt.OptionalHeader.SizeOfImage = sizeof(memory);
+	image->nt.FileHeader.TimeDateStamp = 42;
+	image->nt.FileHeader.NumberOfSections = 1;
+	image->nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+	image->sections[0].Misc.VirtualSize = 0x2000;
+	image->sections[0].VirtualAddress = 0x1000;
+	image->sections[0].Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_READ;
+	for (size_t i = 0x1000; i < sizeof(memory); i++)
+	{
+		memory[i] = (uint8_t)(i * 7);
+	}
+
+	uintptr_t base = (uintptr_t)memory;
+	FakeRegions() = { { base, sizeof(memory), MEM_COMMIT, PAGE_EXECUTE_READ } };
+
+	LocalMemory local;
+	PeImage pe(memory);
+	ModuleFingerprint first = ModuleFingerprint::Of(pe, local);
+	CHECK_EQUAL(first.timeDateStamp, 42u);
+	CHECK_EQUAL(first.sizeOfImage, (uint32_t)sizeof(memory));
+	CHECK(first == ModuleFingerprint::Of(pe, local));
+
+	memory[0x1000] ^= 0xFF;
+	CHECK(first != ModuleFingerprint::Of(pe, local));
+
+	PeImage none(nullptr);
+	CHECK_EQUAL(ModuleFingerprint::Of(none, local).sampleHash, 0u);
+	FakeRegions().clear();
+}
+
+int main()
+{
+	UseTestDirectory("AddressCacheTest");
+	TestCache();
+	TestFingerprint();
+	return CheckResult();
+}
@@ -0,0 +1,130 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "Check.h"
+#include "AssetArchive.h"
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static bool FakeDecode(const std::vector<uint8_t>& file, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height)
+{
+	width = 4;
+	height = 2;
+	pixels.assign(width * height * 4, (uint8_t)file.size());
+	return true;
+}
+
+// A game folder with the hook's own fonts and textures, a copy of one texture and a few hundred small files.
+static void MakeGameFolder(const std::filesystem::path& game)
+{
+	std::filesystem::path hook = HOOK_DIR;
+	std::filesystem::remove_all(game);
+	std::filesystem::create_directories(game / "hook_textures" / "sub");
+	std::filesystem::copy(hook / "hook_fonts", game / "hook_fonts");
+	std::filesystem::copy(hook / "hook_textures" / "blank.jpg", game / "hook_textures" / "blank.jpg");
+	std::filesystem::copy(hook / "hook_textures" / "blank.jpg", game / "hook_textures" / "sub" / "Copy.JPG");
+	for (int i = 0; i < 300; i++)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "t%d.bin", i);
+		std::ofstream file(game / "hook_textures" / name, std::ios::binary);
+		file << std::string(1000 + i, (char)i);
+	}
+}
+
+static void TestBuildAndRead()
+{
+	std::filesystem::path game = "asset_archive_test";
+	MakeGameFolder(game);
+
+	AssetArchiveBuilder builder;
+	size_t numFonts = builder.AddDirectory(game, "hook_fonts");
+	size_t numTextures = builder.AddDirectory(game, "hook_textures");
+	CHECK(numFonts > 0);
+	CHECK_EQUAL(numTextures, 302u);
+	CHECK(builder.Write((game / "hook_assets.pak").string()));
+	CHECK(builder.DuplicateBytes() > 0);
+
+	AssetArchive archive((game / "hook_assets.pak").string());
+	CHECK(archive.IsOpen());
+	CHECK_EQUAL(archive.NumEntries(), numFonts + numTextures);
+	CHECK_EQUAL(archive.NumBlobs(), numFonts + numTextures - 1);
+
+	// Any case, either slash and a leading "./" find the same asset.
+	AssetView font = archive.Find("hook_fonts/OpenSans-22.spritefont");
+	CHECK(font.kind == AssetKind::Font);
+	CHECK((uintptr_t)font.data % AssetArchive::PayloadAlignment == 0);
+	std::vector<uint8_t> original = ReadFile(std::filesystem::path(HOOK_DIR) / "hook_fonts" / "OpenSans-22.spritefont");
+	CHECK(original.size() == font.size && memcmp(original.data(), font.data, font.size) == 0);
+
+	AssetView blank = archive.Find(".\\HOOK_TEXTURES\\blank.jpg");
+	AssetView copy = archive.Find("hook_textures\\sub\\copy.jpg");
+	CHECK(blank.kind == AssetKind::Image);
+	CHECK(blank.data != nullptr && blank.data == copy.data);
+	CHECK(!archive.Find("hook_textures\\missing.png"));
+
+	AssetView small = archive.Find("hook_textures/t123.bin");
+	CHECK_EQUAL(small.size, 1123u);
+	CHECK(small.data != nullptr && small.data[0] == 123);
+
+	auto start = std::chrono::steady_clock::now();
+	const int numLookups = 200000;
+	size_t totalSize = 0;
+	for (int i = 0; i < numLookups; i++)
+	{
+		totalSize += archive.Find(i & 1 ? "hook_fonts\\OpenSans-22.spritefont" : "hook_textures\\t123.bin").size;
+	}
+	printf("%.0f ns per lookup\n", ElapsedMicros(start) * 1000 / numLookups);
+	CHECK_EQUAL(totalSize, (size_t)numLookups / 2 * (font.size + small.size));
+}
+
+static void TestDecodedAndCorrupt()
+{
+	std::filesystem::path game = "asset_archive_test";
+	std::string fileName = (game / "decoded.pak").string();
+	AssetArchiveBuilder builder;
+	builder.AddDirectory(game, "hook_textures", &FakeDecode);
+	CHECK(builder.Write(fileName));
+
+	{
+		AssetArchive archive(fileName);
+		AssetView texture = archive.Find("hook_textures/blank.jpg");
+		CHECK(texture.kind == AssetKind::Texture);
+		CHECK_EQUAL(texture.width, 4u);
+		CHECK_EQUAL(texture.height, 2u);
+		CHECK_EQUAL(texture.rowPitch, 16u);
+	}
+
+	// A blob that points past the end of the file fails the open instead of a later read.
+	AssetArchive::Header header;
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		file.read((char*)&header, sizeof(header));
+	}
+	{
+		std::fstream file(fileName, std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(sizeof(AssetArchive::Header) + header.numEntries * sizeof(AssetArchive::Entry) + offsetof(AssetArchive::Blob, size));
+		uint64_t size = 1ull << 40;
+		file.write((const char*)&size, sizeof(size));
+	}
+	AssetArchive corrupt(fileName);
+	CHECK(!corrupt.IsOpen());
+	CHECK(!corrupt.Find("hook_textures/blank.jpg"));
+
+	AssetArchive missing((game / "missing.pak").string());
+	CHECK(!missing.IsOpen());
+}
+
+int main()
+{
+	UseTestDirectory("AssetArchiveTest");
+	TestBuildAndRead();
+	TestDecodedAndCorrupt();
+	return CheckResult();
+}
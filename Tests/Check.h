@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+/*
+* Minimal checks for the tests. A failed CHECK prints where it failed and the test goes on,
+* main() returns CheckResult() so ctest sees the failure.
+*
+*	UseTestDirectory("InputQueueTest");
+*	CHECK(queue.Pop(&event));
+*	CHECK_EQUAL(event.key, 'P');
+*	return CheckResult();
+*/
+inline int& CheckFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline int CheckResult()
+{
+	if (CheckFailures() != 0)
+	{
+		printf("%d check(s) failed\n", CheckFailures());
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			CheckFailures()++; \
+		} \
+	} while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+	do \
+	{ \
+		auto checkActual = (actual); \
+		auto checkExpected = (expected); \
+		if (!(checkActual == checkExpected)) \
+		{ \
+			printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #actual, #expected, \
+				(long long)checkActual, (long long)checkExpected); \
+			CheckFailures()++; \
+		} \
+	} while (0)
+
+// Wall time for benchmarks, which print their numbers but only check correctness.
+inline double ElapsedMicros(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Every test runs in its own directory under the temp directory, so the files it writes (the hook's log included)
+// never end up where it was started from.
+inline void UseTestDirectory(const char* name)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "DirectXHookTests" / name;
+	std::filesystem::create_directories(directory);
+	std::filesystem::current_path(directory);
+}
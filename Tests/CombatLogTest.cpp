@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include "Check.h"
+#include "CombatLogReader.h"
+
+static std::vector<uint8_t> ReadFile(const char* fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void AppendFile(const char* fileName, const char* data, size_t size)
+{
+	FILE* file = fopen(fileName, "ab");
+	fwrite(data, 1, size, file);
+	fclose(file);
+}
+
+// Two sessions, the first one's last block cut off as if the game crashed, with a log of an older format in the way.
+static void TestSessions()
+{
+	const char* fileName = "combat_log_test.log";
+	remove(fileName);
+	remove("combat_log_test.log.old");
+	AppendFile(fileName, "DXCL\x01junk", 9);
+
+	uint64_t timestamp = 1000;
+	uint64_t damage[3] = {};
+	{
+		CombatLog log(fileName);
+		log.HuntStart(timestamp);
+		for (int i = 0; i < 1000; i++)
+		{
+			timestamp += 50;
+			int player = i % 3;
+			damage[player] += i * 7;
+			log.Damage(timestamp, player, damage[player]);
+		}
+		log.HuntEnd(timestamp);
+	}
+	FILE* old = fopen("combat_log_test.log.old", "rb");
+	CHECK(old != nullptr);
+	if (old != nullptr)
+	{
+		fclose(old);
+	}
+
+	AppendFile(fileName, "DXCB\x40\x00\x00\x00\x01\x80", 10);
+	{
+		CombatLog log(fileName);
+		log.HuntStart(timestamp);
+		log.Damage(timestamp + 10, 1, 5);
+		log.Damage(timestamp + 20, 1, 9);
+	}
+
+	std::vector<uint8_t> data = ReadFile(fileName);
+	data.push_back('D');
+	data.push_back('X');
+	for (int attach = 0; attach < 2; attach++)
+	{
+		CombatLogReader reader;
+		CHECK(attach == 0 ? reader.Open(fileName) : reader.Attach(data.data(), data.size()));
+		const std::vector<CombatLogHunt>& hunts = reader.Hunts();
+		CHECK_EQUAL(hunts.size(), 2u);
+		if (hunts.size() != 2)
+		{
+			continue;
+		}
+
+		CHECK(hunts[0].ended);
+		CHECK_EQUAL(hunts[0].endTime - hunts[0].startTime, 50000u);
+		CHECK_EQUAL(hunts[0].numSamples, 1000u);
+		std::vector<uint64_t> finalDamage = reader.FinalDamage(hunts[0]);
+		CHECK(finalDamage.size() >= 3);
+		for (size_t player = 0; player < 3 && player < finalDamage.size(); player++)
+		{
+			CHECK_EQUAL(finalDamage[player], damage[player]);
+		}
+
+		uint64_t last = 0;
+		size_t numSamples = 0;
+		bool ordered = true;
+		reader.ForEachSample(hunts[0], [&](const CombatLogSample& sample)
+		{
+			ordered = ordered && sample.timestamp >= last;
+			last = sample.timestamp;
+			numSamples++;
+		});
+		CHECK(ordered);
+		CHECK_EQUAL(numSamples, 1000u);
+
+		CHECK(!hunts[1].ended);
+		CHECK_EQUAL(hunts[1].endTime - hunts[1].startTime, 20u);
+		CHECK_EQUAL(hunts[1].numSamples, 2u);
+		CHECK_EQUAL(reader.FinalDamage(hunts[1])[1], 9u);
+	}
+
+	// A log that can't be opened drops its records instead of failing the game.
+	CombatLog unwritable("missing_directory/combat_log_test.log");
+	unwritable.HuntStart(1);
+	unwritable.Damage(2, 0, 1);
+}
+
+int main()
+{
+	UseTestDirectory("CombatLogTest");
+	TestSessions();
+	return CheckResult();
+}
@@ -0,0 +1,154 @@
+#include <fstream>
+#include <thread>
+
+#include "Check.h"
+#include "Config.h"
+
+static void TestParse()
+{
+	ConfigSnapshot config(
+		"top = 1\n"
+		"# comment\n"
+		"[window]\n"
+		" x = 100 \n"
+		"y=-20 ; trailing\n"
+		"name = \"a b ; c\"\n"
+		"flag = yes\n"
+		"hex = 0x50\n"
+		"scale = 1.5\n"
+		"x = 120\n"
+		"broken = 12abc\n"
+		"[other]\r\n"
+		"x=7\r\n", 3, true);
+
+	CHECK(config.Loaded());
+	CHECK_EQUAL(config.Version(), 3u);
+	CHECK_EQUAL(config.GetInt("", "top"), 1);
+	CHECK_EQUAL(config.GetInt("window", "y"), -20);
+	CHECK(config.GetString("window", "name") == "a b ; c");
+	CHECK(config.GetBool("window", "flag"));
+	CHECK_EQUAL(config.GetInt("window", "hex"), 0x50);
+	CHECK(config.GetFloat("window", "scale") == 1.5);
+	CHECK_EQUAL(config.GetInt("other", "x"), 7);
+
+	// The last of duplicate keys wins, missing or malformed values give the default.
+	CHECK_EQUAL(config.GetInt("window", "x"), 120);
+	CHECK_EQUAL(config.GetInt("window", "missing", -1), -1);
+	CHECK_EQUAL(config.GetInt("window", "broken", -1), -1);
+	CHECK_EQUAL(config.GetInt("missing", "x", -1), -1);
+	CHECK(!config.GetBool("window", "name", false));
+
+	ConfigSnapshot empty("", 0, false);
+	CHECK(!empty.Loaded());
+	CHECK_EQUAL(empty.NumEntries(), 0u);
+}
+
+// The shim has no directory notifications, so this goes through the watcher's polling fallback.
+static void TestReload()
+{
+	const char* fileName = "config_test.cfg";
+	{
+		std::ofstream file(fileName);
+		file << "[window]\nx = 100\n";
+	}
+
+	ConfigStore store(fileName);
+	std::shared_ptr<const ConfigSnapshot> first = store.Snapshot();
+	CHECK(first->Loaded());
+	CHECK_EQUAL(first->GetInt("window", "x"), 100);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	{
+		std::ofstream file(fileName);
+		file << "[window]\nx = 555\n";
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	while (store.Snapshot()->Version() == first->Version() && ElapsedMicros(start) < 5000000)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	printf("Reloaded after %.0f ms\n", ElapsedMicros(start) / 1000);
+	CHECK_EQUAL(store.Snapshot()->GetInt("window", "x"), 555);
+
+	// Readers that still hold the old snapshot keep seeing it.
+	CHECK_EQUAL(first->GetInt("window", "x"), 100);
+
+	start = std::chrono::steady_clock::now();
+	const int numReads = 1000000;
+	int64_t sum = 0;
+	for (int i = 0; i < numReads; i++)
+	{
+		sum += store.Snapshot()->GetInt("window", "x");
+	}
+	printf("%.1f ns per snapshot and lookup\n", ElapsedMicros(start) * 1000 / numReads);
+	CHECK_EQUAL(sum, 555ll * numReads);
+
+	ConfigStore missing("config_test_missing.cfg");
+	CHECK(!missing.Snapshot()->Loaded());
+}
+
+// A callback that takes a while runs without the watcher's lock: adding and removing files doesn't wait for it,
+// and removing the last file doesn't wait for the thread.
+static void TestSlowCallback()
+{
+	const char* fileName = "config_test_slow.cfg";
+	std::ofstream(fileName) << "x = 1\n";
+
+	struct Calls
+	{
+		std::atomic<int> started{ 0 };
+		std::atomic<int> finished{ 0 };
+	};
+	std::shared_ptr<Calls> calls = std::make_shared<Calls>();
+	ConfigWatcher& watcher = ConfigWatcher::Instance();
+	int id = watcher.Add(fileName, [calls]
+	{
+		calls->started++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		calls->finished++;
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	while (calls->started == 0 && ElapsedMicros(start) < 5000000)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(calls->started > 0);
+
+	start = std::chrono::steady_clock::now();
+	int other = watcher.Add("config_test_other.cfg", [] { });
+	watcher.Remove(other);
+	watcher.Remove(id);
+	double removeMicros = ElapsedMicros(start);
+	printf("Add and Remove took %.0f us while a callback ran\n", removeMicros);
+	CHECK(removeMicros < 50000);
+	CHECK_EQUAL(calls->finished.load(), 0);
+
+	// The callback that was running finishes, none starts after that.
+	std::this_thread::sleep_for(std::chrono::milliseconds(700));
+	CHECK_EQUAL(calls->finished.load(), calls->started.load());
+	int started = calls->started;
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	CHECK_EQUAL(calls->started.load(), started);
+	CHECK_EQUAL(calls.use_count(), 1l);
+
+	// The watcher starts a new thread for the next file.
+	ConfigStore store(fileName);
+	std::ofstream(fileName) << "x = 22\n";
+	start = std::chrono::steady_clock::now();
+	while (store.Snapshot()->GetInt("", "x") != 22 && ElapsedMicros(start) < 5000000)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	CHECK_EQUAL(store.Snapshot()->GetInt("", "x"), 22);
+}
+
+int main()
+{
+	UseTestDirectory("ConfigTest");
+	TestParse();
+	TestReload();
+	TestSlowCallback();
+	return CheckResult();
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "Overlays/RiseDpsMeter/DamagePyramid.h"
+
+static DamagePyramid::Summary Scan(const std::vector<uint64_t>& ticks, uint64_t begin, uint64_t end)
+{
+	DamagePyramid::Summary summary;
+	for (uint64_t tick = begin; tick < end && tick < ticks.size(); tick++)
+	{
+		DamagePyramid::Summary one{ ticks[tick], ticks[tick], ticks[tick], 1 };
+		summary.Merge(one);
+	}
+	return summary;
+}
+
+static bool Equal(const DamagePyramid::Summary& a, const DamagePyramid::Summary& b)
+{
+	return a.min == b.min && a.max == b.max && a.sum == b.sum && a.count == b.count;
+}
+
+static void Fill(DamagePyramid* pyramid, std::vector<uint64_t>* ticks, size_t numTicks, uint64_t seed)
+{
+	std::mt19937_64 random(seed);
+	for (size_t i = 0; i < numTicks; i++)
+	{
+		// Bursts of big hits between quiet stretches, so min and max differ per bucket.
+		uint64_t value = (i / 37) % 3 == 0 ? random() % 100 : 1000 + random() % 100000;
+		pyramid->Add(value);
+		ticks->push_back(value);
+	}
+}
+
+// While every level still holds the whole fight, any range is exact.
+static void TestExactRanges()
+{
+	static DamagePyramid pyramid;
+	std::vector<uint64_t> ticks;
+	Fill(&pyramid, &ticks, DamagePyramid::LevelCapacity, 1);
+
+	std::mt19937_64 random(2);
+	long mismatches = 0;
+	for (int i = 0; i < 20000; i++)
+	{
+		uint64_t begin = random() % (ticks.size() + 1);
+		uint64_t end = begin + random() % (ticks.size() + 10 - begin);
+		mismatches += !Equal(pyramid.Range(begin, end), Scan(ticks, begin, end));
+	}
+	CHECK_EQUAL(mismatches, 0l);
+
+	// Every single tick and the empty range
+	for (uint64_t tick = 0; tick < ticks.size(); tick++)
+	{
+		mismatches += !Equal(pyramid.Range(tick, tick + 1), Scan(ticks, tick, tick + 1));
+	}
+	CHECK_EQUAL(mismatches, 0l);
+	CHECK_EQUAL(pyramid.Range(5, 5).count, 0u);
+
+	// Columns split the range without gaps or overlaps, short ranges repeat ticks.
+	std::vector<DamagePyramid::Summary> columns;
+	pyramid.Summarize(100, 900, 360, &columns);
+	DamagePyramid::Summary merged;
+	for (const DamagePyramid::Summary& column : columns)
+	{
+		merged.Merge(column);
+	}
+	CHECK(Equal(merged, Scan(ticks, 100, 900)));
+
+	pyramid.Summarize(100, 110, 40, &columns);
+	for (size_t column = 0; column < columns.size(); column++)
+	{
+		mismatches += columns[column].count != 1 || columns[column].max != ticks[100 + column * 10 / 40];
+	}
+	CHECK_EQUAL(mismatches, 0l);
+
+	pyramid.Reset();
+	CHECK_EQUAL(pyramid.NumTicks(), 0u);
+	CHECK_EQUAL(pyramid.Range(0, 100).count, 0u);
+}
+
+// Ten hours of one second ticks: the last LevelCapacity ticks are exact, older ranges are rounded out
+// to the finest bucket still stored, so they contain the exact range and at most one such bucket more on each side.
+static void TestLongFight()
+{
+	static DamagePyramid pyramid;
+	std::vector<uint64_t> ticks;
+	Fill(&pyramid, &ticks, 10 * 3600, 3);
+	uint64_t numTicks = ticks.size();
+
+	std::mt19937_64 random(4);
+	long mismatches = 0;
+	long notCovered = 0;
+	long tooWide = 0;
+	for (int i = 0; i < 20000; i++)
+	{
+		uint64_t begin = random() % numTicks;
+		uint64_t end = begin + 1 + random() % (numTicks - begin);
+		DamagePyramid::Summary summary = pyramid.Range(begin, end);
+		DamagePyramid::Summary exact = Scan(ticks, begin, end);
+
+		if (begin + DamagePyramid::LevelCapacity >= numTicks)
+		{
+			mismatches += !Equal(summary, exact);
+			continue;
+		}
+
+		int level = 0;
+		while (((numTicks >> level) - (begin >> level)) > DamagePyramid::LevelCapacity)
+		{
+			level++;
+		}
+		notCovered += summary.count < exact.count || summary.sum < exact.sum || summary.max < exact.max || summary.min > exact.min;
+		tooWide += summary.count > exact.count + ((uint64_t)2 << level);
+	}
+	CHECK_EQUAL(mismatches, 0l);
+	CHECK_EQUAL(notCovered, 0l);
+	CHECK_EQUAL(tooWide, 0l);
+
+	// The whole fight is still exact at the top, the top level never wraps within ten hours.
+	CHECK(Equal(pyramid.Range(0, numTicks), Scan(ticks, 0, numTicks)));
+}
+
+// The graph's cost doesn't grow with the fight: 360 columns over everything, next to a scan of every tick.
+static void BenchmarkMultiHour()
+{
+	static DamagePyramid pyramid;
+	std::vector<uint64_t> ticks;
+	const size_t numTicks = 10 * 3600;
+
+	auto start = std::chrono::steady_clock::now();
+	Fill(&pyramid, &ticks, numTicks, 5);
+	double addMicros = ElapsedMicros(start);
+
+	std::vector<DamagePyramid::Summary> columns;
+	const int repeats = 100;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++)
+	{
+		pyramid.Summarize(0, numTicks, 360, &columns);
+	}
+	double pyramidMicros = ElapsedMicros(start) / repeats;
+
+	uint64_t check = 0;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++)
+	{
+		for (size_t column = 0; column < 360; column++)
+		{
+			check += Scan(ticks, numTicks * column / 360, numTicks * (column + 1) / 360).max;
+		}
+	}
+	double scanMicros = ElapsedMicros(start) / repeats;
+
+	printf("10 hours of ticks: Add %.1f ns per tick, 360 columns %.1f us from the pyramid, %.1f us scanning (%llu)\n",
+		addMicros * 1000 / numTicks, pyramidMicros, scanMicros, (unsigned long long)(check % 10));
+}
+
+int main()
+{
+	UseTestDirectory("DamagePyramidTest");
+	TestExactRanges();
+	TestLongFight();
+	BenchmarkMultiHour();
+	return CheckResult();
+}
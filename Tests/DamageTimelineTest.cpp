@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "Overlays/RiseDpsMeter/DamageTimeline.h"
+
+static uint64_t Sum(const std::vector<uint64_t>& columns)
+{
+	uint64_t sum = 0;
+	for (uint64_t column : columns)
+	{
+		sum += column;
+	}
+	return sum;
+}
+
+// In a short fight every hit lands in the column of its time, like it did when the graph decoded every point.
+static void TestShortFight()
+{
+	DamageTimeline timeline;
+	CHECK(timeline.Empty());
+
+	const uint64_t start = 500000;
+	const size_t numColumns = 100;
+	timeline.Add(start, 10);
+	timeline.Add(start + 2500, 20); // a quarter in
+	timeline.Add(start + 9990, 40); // the very end
+	CHECK(!timeline.Empty());
+	CHECK_EQUAL(timeline.Start(), start);
+
+	std::vector<uint64_t> columns;
+	timeline.Columns(start + 9999, numColumns, &columns);
+	CHECK_EQUAL(columns.size(), numColumns);
+	CHECK_EQUAL(Sum(columns), 70u);
+	CHECK_EQUAL(columns[0], 10u);
+	CHECK_EQUAL(columns[25], 20u);
+	CHECK_EQUAL(columns[99], 40u);
+
+	timeline.Reset();
+	CHECK(timeline.Empty());
+	timeline.Columns(start, numColumns, &columns);
+	CHECK_EQUAL(Sum(columns), 0u);
+}
+
+// Hours of steady damage: buckets have merged many times, the total is kept and every column gets its share
+// without the stripes uneven bucket counts per column would cause.
+static void TestLongFight()
+{
+	DamageTimeline timeline;
+	const uint64_t start = 1000;
+	const uint64_t fightMillis = 3 * 3600 * 1000;
+	for (uint64_t time = 0; time < fightMillis; time += 50)
+	{
+		timeline.Add(start + time, 100);
+	}
+
+	uint64_t total = fightMillis / 50 * 100;
+	CHECK(timeline.BucketMillis() * DamageTimeline::NumBuckets >= fightMillis);
+	CHECK(timeline.BucketMillis() * DamageTimeline::NumBuckets / 2 < fightMillis);
+
+	for (size_t numColumns : { 7, 350, 1000 })
+	{
+		std::vector<uint64_t> columns;
+		timeline.Columns(start + fightMillis - 1, numColumns, &columns);
+		uint64_t sum = Sum(columns);
+		CHECK(sum + numColumns >= total && sum <= total + numColumns);
+
+		auto [low, high] = std::minmax_element(columns.begin(), columns.end());
+		CHECK(*high - *low <= total / numColumns / 50); // within 2 %
+	}
+}
+
+// A burst in the middle of a long fight stays in the middle, damage is never lost or double counted.
+static void TestRandomFight()
+{
+	DamageTimeline timeline;
+	std::mt19937_64 random(1);
+	const uint64_t fightMillis = 5 * 3600 * 1000;
+	uint64_t total = 0;
+	uint64_t burst = 0;
+	for (uint64_t time = 0; time < fightMillis; time += 50 + random() % 20)
+	{
+		uint64_t damage = random() % 3 == 0 ? random() % 10000 : 0;
+		if (time >= fightMillis / 2 && time < fightMillis / 2 + 60000)
+		{
+			damage += 1000000;
+			burst += 1000000;
+		}
+		timeline.Add(time, damage);
+		total += damage;
+	}
+
+	std::vector<uint64_t> columns;
+	const size_t numColumns = 350;
+	timeline.Columns(fightMillis, numColumns, &columns);
+	uint64_t sum = Sum(columns);
+	CHECK(sum + numColumns >= total && sum <= total + numColumns);
+
+	size_t peak = std::max_element(columns.begin(), columns.end()) - columns.begin();
+	CHECK(peak >= numColumns / 2 - 1 && peak <= numColumns / 2 + 2);
+	CHECK(columns[peak] > burst / 4);
+}
+
+// The graph costs the same after ten hours as after a minute.
+static void BenchmarkColumns()
+{
+	DamageTimeline timeline;
+	const uint64_t fightMillis = 10 * 3600 * 1000ull;
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t time = 0; time < fightMillis; time += 50)
+	{
+		timeline.Add(time, time % 7);
+	}
+	double addMicros = ElapsedMicros(start);
+
+	std::vector<uint64_t> columns;
+	const int repeats = 1000;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++)
+	{
+		timeline.Columns(fightMillis, 350, &columns);
+	}
+	printf("10 hours at 20 Hz: Add %.1f ns, 350 columns %.1f us\n", addMicros * 1000 / (fightMillis / 50), ElapsedMicros(start) / repeats);
+}
+
+int main()
+{
+	UseTestDirectory("DamageTimelineTest");
+	TestShortFight();
+	TestLongFight();
+	TestRandomFight();
+	BenchmarkColumns();
+	return CheckResult();
+}
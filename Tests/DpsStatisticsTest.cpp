@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "Overlays/RiseDpsMeter/DpsStatistics.h"
+
+static uint64_t WindowSum(const std::vector<uint64_t>& ticks, size_t length)
+{
+	size_t count = std::min(length, ticks.size());
+	uint64_t sum = 0;
+	for (size_t i = ticks.size() - count; i < ticks.size(); i++)
+	{
+		sum += ticks[i];
+	}
+	return sum;
+}
+
+// Windowed DPS, High and the whole fight agree with a scan of every tick, also once the ring has wrapped
+// and the ticks that made the old High have been evicted.
+static void TestAgainstScan()
+{
+	static DpsStatistics stats;
+	std::mt19937_64 random(1);
+	std::vector<uint64_t> ticks;
+
+	// A huge hit early on, then smaller damage for longer than the ring holds.
+	const size_t numTicks = DpsStatistics::Capacity + 5000;
+	long mismatches = 0;
+	for (size_t i = 0; i < numTicks; i++)
+	{
+		uint64_t damage = i == 10 ? 1000000 : random() % 5000;
+		if (i % 97 < 3)
+		{
+			damage = 0; // nothing hit for a moment
+		}
+		stats.Add(&damage);
+		ticks.push_back(damage);
+
+		if (i % 1000 != 0 && i < numTicks - 10)
+		{
+			continue;
+		}
+
+		mismatches += stats.Dps(0, DpsStatistics::FiveSeconds) != (double)WindowSum(ticks, 5) / std::min<size_t>(5, ticks.size());
+		mismatches += stats.Dps(0, DpsStatistics::ThirtySeconds) != (double)WindowSum(ticks, 30) / std::min<size_t>(30, ticks.size());
+		mismatches += stats.Dps(0, DpsStatistics::OneMinute) != (double)WindowSum(ticks, 60) / std::min<size_t>(60, ticks.size());
+		mismatches += stats.Dps(0, DpsStatistics::WholeFight) != (double)WindowSum(ticks, ticks.size()) / ticks.size();
+
+		size_t stored = std::min(ticks.size(), DpsStatistics::Capacity);
+		mismatches += stats.High(0) != *std::max_element(ticks.end() - stored, ticks.end());
+		mismatches += stats.Ago(0, 0) != ticks.back();
+		mismatches += stats.Ago(0, stored - 1) != ticks[ticks.size() - stored];
+	}
+
+	CHECK_EQUAL(mismatches, 0l);
+	CHECK_EQUAL(stats.NumTicks(), (uint64_t)numTicks);
+	CHECK_EQUAL(stats.NumStored(), DpsStatistics::Capacity);
+	CHECK(stats.High(0) < 1000000); // the early hit has left the ring
+	CHECK_EQUAL(stats.Total(0), WindowSum(ticks, ticks.size()));
+
+	stats.Reset();
+	CHECK_EQUAL(stats.NumTicks(), 0u);
+	CHECK_EQUAL(stats.High(0), 0u);
+	CHECK(stats.Dps(0, DpsStatistics::OneMinute) == 0);
+	uint64_t damage = 7;
+	stats.Add(&damage);
+	CHECK(stats.Dps(0, DpsStatistics::OneMinute) == 7);
+	CHECK_EQUAL(stats.High(0), 7u);
+}
+
+// Every entity and the party total match what a single entity fed the same stream would report.
+static void TestEntities()
+{
+	const int numEntities = 4;
+	static DpsStatistics party(numEntities);
+	static DpsStatistics single[numEntities + 1];
+	CHECK_EQUAL(party.NumEntities(), numEntities);
+	CHECK_EQUAL(party.Party(), numEntities);
+
+	std::mt19937_64 random(3);
+	long mismatches = 0;
+	for (int tick = 0; tick < 3000; tick++)
+	{
+		// Players join late and one stops dealing damage halfway.
+		uint64_t damage[numEntities];
+		uint64_t total = 0;
+		for (int entity = 0; entity < numEntities; entity++)
+		{
+			damage[entity] = random() % (1000 * (entity + 1));
+			if ((entity == 2 && tick < 500) || (entity == 3 && tick > 1500))
+			{
+				damage[entity] = 0;
+			}
+			single[entity].Add(&damage[entity]);
+			total += damage[entity];
+		}
+		single[numEntities].Add(&total);
+		party.Add(damage);
+
+		for (int entity = 0; entity <= numEntities; entity++)
+		{
+			mismatches += party.Dps(entity, DpsStatistics::FiveSeconds) != single[entity].Dps(0, DpsStatistics::FiveSeconds);
+			mismatches += party.Dps(entity, DpsStatistics::OneMinute) != single[entity].Dps(0, DpsStatistics::OneMinute);
+			mismatches += party.Dps(entity, DpsStatistics::WholeFight) != single[entity].Dps(0, DpsStatistics::WholeFight);
+			mismatches += party.High(entity) != single[entity].High(0);
+			mismatches += party.Ago(entity, 0) != single[entity].Ago(0, 0);
+		}
+	}
+
+	CHECK_EQUAL(mismatches, 0l);
+	CHECK_EQUAL(party.Total(party.Party()), party.Total(0) + party.Total(1) + party.Total(2) + party.Total(3));
+	CHECK(party.Dps(3, DpsStatistics::OneMinute) == 0);
+
+	// More entities than supported are clamped.
+	CHECK_EQUAL(DpsStatistics(DpsStatistics::MaxEntities + 3).NumEntities(), DpsStatistics::MaxEntities);
+}
+
+// A tick costs the same after six hours as after six seconds.
+static void BenchmarkAdd()
+{
+	static DpsStatistics stats;
+	std::mt19937_64 random(2);
+	const int numTicks = 1000000;
+	std::vector<uint64_t> damage(numTicks);
+	for (uint64_t& value : damage)
+	{
+		value = random() % 100000;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numTicks; i++)
+	{
+		stats.Add(&damage[i]);
+	}
+	double micros = ElapsedMicros(start);
+	printf("Add: %.1f ns per tick over %d ticks, High %llu\n", micros * 1000 / numTicks, numTicks, (unsigned long long)stats.High(0));
+}
+
+int main()
+{
+	UseTestDirectory("DpsStatisticsTest");
+	TestAgainstScan();
+	TestEntities();
+	BenchmarkAdd();
+	return CheckResult();
+}
@@ -0,0 +1,151 @@
+#include <random>
+
+#include "Check.h"
+#include "FramePacer.h"
+
+// Fake time in the shim's QueryPerformanceCounter units (nanoseconds). Every read of the clock
+// takes 100 ns so spins end, a sleep oversleeps by whatever the test sets.
+static uint64_t fakeNow = 1000000000;
+static double oversleepMicros = 0;
+static int numSleeps = 0;
+
+static uint64_t FakeClock()
+{
+	fakeNow += 100;
+	return fakeNow;
+}
+
+static void FakeSleep(double micros)
+{
+	fakeNow += (uint64_t)((micros + oversleepMicros) * 1000);
+	numSleeps++;
+}
+
+static void Work(double micros)
+{
+	fakeNow += (uint64_t)(micros * 1000);
+}
+
+static void TestWaiter()
+{
+	HybridWaiter waiter(&FakeClock, &FakeSleep);
+	double initialSpin = waiter.SpinMicros();
+
+	// Never before the deadline, and not much after it when the sleep is on time.
+	std::mt19937 random(1);
+	int early = 0;
+	uint64_t maxLateTicks = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		oversleepMicros = random() % 100;
+		uint64_t deadline = fakeNow + 500000 + random() % 7500000;
+		waiter.WaitUntil(deadline);
+		early += fakeNow < deadline;
+		maxLateTicks = std::max(maxLateTicks, fakeNow - deadline);
+	}
+	CHECK_EQUAL(early, 0);
+	CHECK(maxLateTicks <= 200);
+	CHECK_EQUAL(waiter.LateWakes(), 0u);
+	CHECK_EQUAL(numSleeps, 1000);
+
+	// A late wakeup is counted and widens the margin at once, which then shrinks again.
+	oversleepMicros = 3000;
+	waiter.WaitUntil(fakeNow + 2000000);
+	CHECK_EQUAL(waiter.LateWakes(), 1u);
+	double widened = waiter.SpinMicros();
+	CHECK(widened > 3000);
+
+	oversleepMicros = 0;
+	for (int i = 0; i < 500; i++)
+	{
+		waiter.WaitUntil(fakeNow + 5000000);
+	}
+	CHECK(waiter.SpinMicros() < widened / 2);
+	CHECK(waiter.SpinMicros() >= HybridWaiter::MinSpinMicros);
+	printf("Spin margin %.0f us, widened to %.0f us by a late wake, back to %.0f us\n", initialSpin, widened, waiter.SpinMicros());
+
+	// Short waits only spin.
+	int sleepsBefore = numSleeps;
+	waiter.WaitUntil(fakeNow + 10000);
+	CHECK_EQUAL(numSleeps, sleepsBefore);
+}
+
+// Runs frames with jittery game and Present times, returns the mean frame time in microseconds.
+static double RunFrames(FramePacer& pacer, int numFrames, double workMicros, double jitterMicros, double* startToPresentMicros = nullptr)
+{
+	std::mt19937 random(2);
+	std::uniform_real_distribution<double> jitter(0, jitterMicros);
+	uint64_t first = 0;
+	double startToPresent = 0;
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		uint64_t start = fakeNow;
+		Work(workMicros + jitter(random));
+		pacer.BeforePresent();
+		startToPresent += (fakeNow - start) / 1000.0;
+		Work(300 + jitter(random) / 4);
+		pacer.AfterPresent();
+		if (frame == 0)
+		{
+			first = fakeNow;
+		}
+	}
+
+	if (startToPresentMicros != nullptr)
+	{
+		*startToPresentMicros = startToPresent / numFrames;
+	}
+	return (fakeNow - first) / 1000.0 / (numFrames - 1);
+}
+
+static void TestPacer()
+{
+	oversleepMicros = 200;
+	FramePacer uncapped(&FakeClock, &FakeSleep);
+	double uncappedMicros = RunFrames(uncapped, 600, 2000, 4000);
+	CHECK(uncappedMicros < 5000);
+
+	// 120 fps: frames average 8333 us and none is missed. The wait ends early by the smoothed Present time,
+	// so the frame times only vary as much as Present does.
+	FramePacer capped(&FakeClock, &FakeSleep);
+	capped.SetTargetFps(120);
+	double startToPresent = 0;
+	double cappedMicros = RunFrames(capped, 600, 2000, 4000, &startToPresent);
+	CHECK(cappedMicros > 8333 - 2 && cappedMicros < 8333 + 2);
+	const FramePacer::Stats& stats = capped.LastStats();
+	CHECK(stats.frames > 0);
+	CHECK_EQUAL(stats.missedFrames, 0u);
+	CHECK(stats.stdDevMicros < 500);
+
+	// Low latency waits after Present, so the next frame starts later and presents sooner after its start,
+	// and the frame boundaries are exact.
+	FramePacer lowLatency(&FakeClock, &FakeSleep);
+	lowLatency.SetTargetFps(120);
+	lowLatency.SetLowLatency(true);
+	double lowLatencyStartToPresent = 0;
+	double lowLatencyMicros = RunFrames(lowLatency, 600, 2000, 4000, &lowLatencyStartToPresent);
+	CHECK(lowLatencyMicros > 8333 - 2 && lowLatencyMicros < 8333 + 2);
+	CHECK(lowLatencyStartToPresent < startToPresent);
+	CHECK(lowLatency.LastStats().stdDevMicros < 5);
+	printf("Uncapped %.0f us, capped %.0f us (start to present %.0f us), low latency %.0f us (start to present %.0f us)\n",
+		uncappedMicros, cappedMicros, startToPresent, lowLatencyMicros, lowLatencyStartToPresent);
+
+	// Frames slower than the cap are counted as missed and don't build up a backlog.
+	FramePacer slow(&FakeClock, &FakeSleep);
+	slow.SetTargetFps(240);
+	double slowMicros = RunFrames(slow, 600, 5000, 0);
+	CHECK(slowMicros > 5300 - 2 && slowMicros < 5300 + 2);
+	CHECK(slow.LastStats().missedFrames > 0);
+
+	// Removing the cap takes effect on the next frame.
+	capped.SetTargetFps(0);
+	CHECK(RunFrames(capped, 100, 2000, 0) < 2400);
+}
+
+int main()
+{
+	UseTestDirectory("FramePacerTest");
+	TestWaiter();
+	TestPacer();
+	return CheckResult();
+}
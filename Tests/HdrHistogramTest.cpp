@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "HdrHistogram.h"
+
+// Percentiles of random values over the whole range are never below the exact value and less than 1/64 above it.
+static void TestPrecision()
+{
+	HdrHistogram histogram;
+	std::vector<uint64_t> values;
+	std::mt19937_64 random(1);
+	for (int i = 0; i < 100000; i++)
+	{
+		uint64_t value = random() >> (random() % 64);
+		values.push_back(value);
+		histogram.Record(value);
+	}
+	std::sort(values.begin(), values.end());
+
+	for (double percentile : { 1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 100.0 })
+	{
+		size_t rank = std::max<size_t>((size_t)(percentile / 100 * values.size() + 0.5), 1);
+		uint64_t exact = values[rank - 1];
+		uint64_t estimate = histogram.ValueAtPercentile(percentile);
+		CHECK(estimate >= exact);
+		CHECK(estimate - exact <= exact / 64);
+	}
+
+	CHECK_EQUAL(histogram.Count(), values.size());
+	CHECK(histogram.Min() == values.front());
+	CHECK(histogram.Max() == values.back());
+}
+
+// Small values have their own buckets and come out exact.
+static void TestSmallValues()
+{
+	HdrHistogram histogram;
+	for (uint64_t value = 1; value <= 100; value++)
+	{
+		histogram.Record(value);
+	}
+
+	CHECK_EQUAL(histogram.ValueAtPercentile(50), 50u);
+	CHECK_EQUAL(histogram.ValueAtPercentile(99), 99u);
+	CHECK_EQUAL(histogram.Mean(), 50.5);
+
+	histogram.Record(7, 100);
+	CHECK_EQUAL(histogram.Count(), 200u);
+	CHECK_EQUAL(histogram.ValueAtPercentile(50), 7u);
+
+	histogram.Reset();
+	CHECK_EQUAL(histogram.Count(), 0u);
+	CHECK_EQUAL(histogram.ValueAtPercentile(50), 0u);
+}
+
+int main()
+{
+	UseTestDirectory("HdrHistogramTest");
+	TestPrecision();
+	TestSmallValues();
+	return CheckResult();
+}
@@ -0,0 +1,87 @@
+#include <thread>
+
+#include "Check.h"
+#include "InputQueue.h"
+
+// Every event arrives once and in order across threads, a full queue refuses pushes instead of overwriting.
+static void TestQueue()
+{
+	static SpscQueue<InputEvent, 1024> queue;
+	const int numEvents = 200000;
+
+	std::thread producer([]
+	{
+		for (int i = 0; i < numEvents; i++)
+		{
+			InputEvent event{ InputEventType::KeyDown, (uint8_t)i, (int16_t)i };
+			while (!queue.Push(event)) { }
+		}
+	});
+
+	int received = 0;
+	int outOfOrder = 0;
+	InputEvent event;
+	while (received < numEvents)
+	{
+		if (queue.Pop(&event))
+		{
+			outOfOrder += event.key != (uint8_t)received || event.x != (int16_t)received;
+			received++;
+		}
+	}
+	producer.join();
+	CHECK_EQUAL(outOfOrder, 0);
+	CHECK(queue.Empty());
+
+	SpscQueue<int, 4> small;
+	for (int i = 0; i < 4; i++)
+	{
+		CHECK(small.Push(i));
+	}
+	CHECK(!small.Push(4));
+	int value = -1;
+	CHECK(small.Pop(&value));
+	CHECK_EQUAL(value, 0);
+}
+
+static void TestKeyState()
+{
+	KeyState keys;
+
+	// A press and release within one frame shows up as both.
+	keys.BeginFrame();
+	keys.Apply({ InputEventType::KeyDown, 'P' });
+	keys.Apply({ InputEventType::KeyUp, 'P' });
+	CHECK(keys.WasPressed('P'));
+	CHECK(keys.WasReleased('P'));
+	CHECK(!keys.IsDown('P'));
+
+	keys.BeginFrame();
+	CHECK(!keys.WasPressed('P'));
+
+	// Auto repeat doesn't press again.
+	keys.Apply({ InputEventType::KeyDown, 'W' });
+	keys.BeginFrame();
+	keys.Apply({ InputEventType::KeyDown, 'W' });
+	CHECK(keys.IsDown('W'));
+	CHECK(!keys.WasPressed('W'));
+
+	// Losing focus releases everything that is down.
+	keys.Apply({ InputEventType::KeyDown, 0xA0 });
+	keys.Apply({ InputEventType::FocusLost });
+	CHECK(!keys.IsDown('W'));
+	CHECK(!keys.IsDown(0xA0));
+	CHECK(keys.WasReleased('W'));
+
+	keys.Apply({ InputEventType::MouseMove, 0, 320, -5 });
+	CHECK_EQUAL(keys.MouseX(), 320);
+	CHECK_EQUAL(keys.MouseY(), -5);
+}
+
+int main()
+{
+	UseTestDirectory("InputQueueTest");
+	TestQueue();
+	TestKeyState();
+	return CheckResult();
+}
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <thread>
+
+#include "Check.h"
+#include "JobSystem.h"
+
+// Called with the main thread registered. The thread index is per thread and not per job system, so this has to use the first one.
+static void TestThreads(JobSystem& jobs)
+{
+	// Threads that aren't registered run their jobs inline, only one thread can register.
+	std::atomic<int> fromOther{ 0 };
+	std::thread other([&]
+	{
+		JobCounter counter;
+		std::atomic<int>* result = &fromOther;
+		jobs.Run(counter, [result] { result->fetch_add(1); });
+		CHECK_EQUAL(fromOther.load(), 1);
+		CHECK(counter.IsDone());
+		CHECK(!jobs.RegisterThread());
+	});
+	other.join();
+
+	std::atomic<long> items{ 0 };
+	for (int round = 0; round < 1000; round++)
+	{
+		JobCounter counter;
+		std::atomic<long>* total = &items;
+		jobs.ParallelFor(counter, 64, 4, [total](size_t begin, size_t end) { total->fetch_add((long)(end - begin)); });
+		jobs.Wait(counter);
+	}
+	CHECK_EQUAL(items.load(), 64000l);
+}
+
+// Jobs that fork ParallelFor batches of their own and wait for them, the sum shows every item ran once.
+static void TestNestedJobs(int numWorkers)
+{
+	JobSystem jobs(numWorkers);
+	CHECK(jobs.RegisterThread());
+	if (numWorkers == 3)
+	{
+		TestThreads(jobs);
+	}
+
+	std::atomic<long long> sum{ 0 };
+	const int numFrames = 50;
+	const int jobsPerFrame = 64;
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		JobCounter counter;
+		for (int job = 0; job < jobsPerFrame; job++)
+		{
+			std::atomic<long long>* total = &sum;
+			JobSystem* system = &jobs;
+			jobs.Run(counter, [total, system]
+			{
+				JobCounter inner;
+				system->ParallelFor(inner, 100, 7, [total](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						total->fetch_add((long long)i, std::memory_order_relaxed);
+					}
+				});
+				system->Wait(inner);
+			});
+		}
+		jobs.Wait(counter);
+		CHECK(counter.IsDone());
+	}
+	CHECK_EQUAL(sum.load(), (long long)numFrames * jobsPerFrame * 4950);
+
+	// Per job overhead, for empty jobs
+	auto start = std::chrono::steady_clock::now();
+	const int numBatches = 100;
+	const int batchSize = 1000;
+	for (int batch = 0; batch < numBatches; batch++)
+	{
+		JobCounter counter;
+		for (int job = 0; job < batchSize; job++)
+		{
+			jobs.Run(counter, [] { });
+		}
+		jobs.Wait(counter);
+	}
+	printf("%d workers: %.0f ns per empty job\n", numWorkers, ElapsedMicros(start) * 1000 / (numBatches * batchSize));
+}
+
+int main()
+{
+	UseTestDirectory("JobSystemTest");
+	for (int numWorkers : { 3, 1, 0 })
+	{
+		TestNestedJobs(numWorkers);
+	}
+	return CheckResult();
+}
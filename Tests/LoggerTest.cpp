@@ -0,0 +1,124 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "Logger.h"
+
+// The writer thread owns the file, so the test polls it until every record (or its drop notice) is there.
+static std::vector<std::string> ReadLog(size_t expectedLines)
+{
+	std::vector<std::string> lines;
+	for (int attempt = 0; attempt < 200; attempt++)
+	{
+		lines.clear();
+		std::ifstream file("directx_hook_log.txt");
+		std::string line;
+		while (std::getline(file, line))
+		{
+			lines.push_back(line);
+		}
+		if (lines.size() >= expectedLines)
+		{
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return lines;
+}
+
+static size_t CountThreads()
+{
+	size_t count = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("/proc/self/task"))
+	{
+		(void)entry;
+		count++;
+	}
+	return count;
+}
+
+// Loggers are constructed during DLL load, so a logger that hasn't logged yet has no thread and no file.
+static void TestLazyStart()
+{
+	std::filesystem::remove("directx_hook_log.txt"); // from the last run
+	size_t threads = CountThreads();
+	Logger logger("Lazy");
+	CHECK_EQUAL(CountThreads(), threads);
+	CHECK(!std::filesystem::exists("directx_hook_log.txt"));
+}
+
+static void TestLogging()
+{
+	Logger logger("Test");
+	std::string name = "hook";
+	unsigned int key = 0x50;
+	logger.Log("%s is loaded", name.c_str());
+	logger.Log("0x%x %zu %.1f %i", key, (size_t)3, 1.5, -7);
+	logger.Log("%p", (void*)nullptr);
+	LOG_TRACE(logger, Render, "never %d", 1);
+	for (int i = 0; i < 5; i++)
+	{
+		LOG_EVERY_MS(logger, Warning, Overlay, 60000, "rate limited %d", i);
+	}
+
+	// Records from several threads, each thread's stay in order.
+	const int numThreads = 4;
+	const int recordsPerThread = 200;
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < numThreads; thread++)
+	{
+		threads.emplace_back([&logger, thread]
+		{
+			for (int i = 0; i < recordsPerThread; i++)
+			{
+				logger.Log("thread %d record %d", thread, i);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	std::vector<std::string> lines = ReadLog(4 + numThreads * recordsPerThread);
+	CHECK(lines.size() >= 4);
+	CHECK(lines[0] == "Test > hook is loaded");
+	CHECK(lines[1] == "Test > 0x50 3 1.5 -7");
+	CHECK(lines[3] == "Test > rate limited 0");
+
+	int received = 0;
+	int outOfOrder = 0;
+	unsigned long long dropped = 0;
+	int next[numThreads] = {};
+	for (const std::string& line : lines)
+	{
+		int thread;
+		int record;
+		unsigned long long count;
+		if (sscanf(line.c_str(), "Test > thread %d record %d", &thread, &record) == 2)
+		{
+			outOfOrder += record < next[thread];
+			next[thread] = record + 1;
+			received++;
+		}
+		else if (sscanf(line.c_str(), "Logger > %llu messages were dropped", &count) == 1)
+		{
+			dropped += count;
+		}
+		CHECK(line.find("never") == std::string::npos);
+		CHECK(line.find("rate limited 1") == std::string::npos);
+	}
+	CHECK_EQUAL(outOfOrder, 0);
+	CHECK_EQUAL(received + dropped, (unsigned long long)numThreads * recordsPerThread);
+}
+
+int main()
+{
+	UseTestDirectory("LoggerTest");
+	TestLazyStart();
+	TestLogging();
+	return CheckResult();
+}
@@ -0,0 +1,265 @@
+#include <sys/mman.h>
+#include <atomic>
+#include <thread>
+
+#include "Check.h"
+#include "MemoryWatch.h"
+#include "RemoteProcessMemoryAccess.h"
+
+// One readable page at 0x10000. Every read returns the next value of a counter in both halves,
+// so read n gives ((n << 32) | n) and a sample that mixes two reads shows up.
+class CountingMemory : public IMemoryAccess
+{
+public:
+	static constexpr uintptr_t Address = 0x10000;
+
+	std::atomic<uint64_t> reads{ 0 };
+
+	bool Query(uintptr_t address, MemoryRegion* region) override
+	{
+		region->base = address & ~(uintptr_t)0xFFF;
+		region->size = 0x1000;
+		region->readable = region->base == Address;
+		return true;
+	}
+
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		uint64_t read = ++reads;
+		uint64_t value = (read << 32) | read;
+		memcpy(buffer, &value, size);
+		return true;
+	}
+};
+
+static bool Consistent(const WatchSample& sample)
+{
+	uint64_t value = sample.As<uint64_t>();
+	return sample.valid && (value >> 32) == (value & 0xFFFFFFFF);
+}
+
+// Readers racing the sampling thread only get complete samples, in order, and samples that were overwritten fail.
+static void TestRingWhileSampling()
+{
+	std::shared_ptr<CountingMemory> memory = std::make_shared<CountingMemory>();
+	MemoryWatch watch(memory);
+	MemoryWatch::WatchId id = watch.Watch<uint64_t>(CountingMemory::Address, 1000000); // as fast as the thread can go
+
+	long torn = 0;
+	long outOfOrder = 0;
+	long latestReads = 0;
+	long historyReads = 0;
+	uint64_t previousLatest = 0;
+	static WatchSample history[512];
+	auto start = std::chrono::steady_clock::now();
+	while (ElapsedMicros(start) < 300000)
+	{
+		WatchSample sample;
+		if (watch.Latest(id, &sample))
+		{
+			torn += !Consistent(sample);
+			outOfOrder += sample.As<uint64_t>() < previousLatest;
+			previousLatest = sample.As<uint64_t>();
+			latestReads++;
+		}
+
+		size_t copied = watch.History(id, history, 512);
+		for (size_t i = 0; i < copied; i++)
+		{
+			torn += !Consistent(history[i]);
+			if (i > 0)
+			{
+				outOfOrder += history[i].As<uint64_t>() <= history[i - 1].As<uint64_t>() || history[i].timestamp < history[i - 1].timestamp;
+			}
+		}
+		historyReads++;
+	}
+
+	uint64_t count = watch.SampleCount(id);
+	printf("%llu samples in 300 ms, %ld latest and %ld history reads alongside\n", (unsigned long long)count, latestReads, historyReads);
+	CHECK(latestReads > 0);
+	CHECK_EQUAL(torn, 0);
+	CHECK_EQUAL(outOfOrder, 0);
+
+	// Sample n is read n + 1, so every slot holds the sample it claims to.
+	watch.SetSampleRate(id, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	count = watch.SampleCount(id);
+	CHECK(count > MemoryWatch::HistorySize);
+	long misplaced = 0;
+	for (uint64_t sequence = count - (MemoryWatch::HistorySize - 1); sequence < count; sequence++)
+	{
+		WatchSample sample;
+		misplaced += !watch.Sample(id, sequence, &sample) || (sample.As<uint64_t>() & 0xFFFFFFFF) != sequence + 1;
+	}
+	CHECK_EQUAL(misplaced, 0);
+
+	WatchSample sample;
+	CHECK(!watch.Sample(id, count - MemoryWatch::HistorySize - 1, &sample));
+	CHECK(!watch.Sample(id, count, &sample));
+}
+
+// A paused watch isn't sampled, with nothing to sample the thread sleeps until a watch is resumed.
+static void TestPauseAndRate()
+{
+	std::shared_ptr<CountingMemory> memory = std::make_shared<CountingMemory>();
+	MemoryWatch watch(memory);
+	MemoryWatch::WatchId id = watch.Watch<uint64_t>(CountingMemory::Address, 1000);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	uint64_t samples = watch.SampleCount(id);
+	printf("%llu samples in 200 ms at 1 kHz\n", (unsigned long long)samples);
+	CHECK(samples >= 100 && samples <= 210);
+
+	watch.SetSampleRate(id, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	uint64_t reads = memory->reads;
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK_EQUAL(memory->reads.load(), reads);
+
+	// Resuming samples right away instead of waiting out the old schedule.
+	watch.SetSampleRate(id, 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK_EQUAL(memory->reads.load(), reads + 1);
+
+	watch.SetSampleRate(id, 100);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	uint64_t slowReads = memory->reads - reads;
+	CHECK(slowReads >= 10 && slowReads <= 23);
+}
+
+// Destroying the watch doesn't wait for the thread, which lets go of the memory access once it has stopped.
+static void TestDestroyWhileSampling()
+{
+	std::shared_ptr<CountingMemory> memory = std::make_shared<CountingMemory>();
+	MemoryWatch* watch = new MemoryWatch(memory);
+	watch->Watch<uint64_t>(CountingMemory::Address, 1000);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	auto start = std::chrono::steady_clock::now();
+	delete watch;
+	CHECK(ElapsedMicros(start) < 10000);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK_EQUAL(memory.use_count(), 1l);
+}
+
+// A hunter structure behind one pointer: the watch samples all of the view's fields with a single read.
+class StructMemory : public IMemoryAccess
+{
+public:
+	static constexpr uintptr_t Base = 0x20000;
+
+	uint8_t memory[0x200] = {};
+	std::atomic<int> reads{ 0 };
+
+	bool Query(uintptr_t address, MemoryRegion* region) override
+	{
+		region->base = Base;
+		region->size = sizeof(memory);
+		region->readable = address >= Base && address < Base + sizeof(memory);
+		return true;
+	}
+
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		if (address < Base || address + size > Base + sizeof(memory))
+		{
+			return false;
+		}
+		memcpy(buffer, memory + (address - Base), size);
+		reads++;
+		return true;
+	}
+};
+
+static void TestStructWatch()
+{
+	typedef Field<uint64_t, 0x18> TotalDamage;
+	typedef Field<float, 0x20> Health;
+	typedef Field<uint16_t, 0x2C> Level;
+	typedef StructView<Health, TotalDamage, Level> HunterView;
+
+	std::shared_ptr<StructMemory> memory = std::make_shared<StructMemory>();
+	const uintptr_t hunter = StructMemory::Base + 0x100;
+	memcpy(memory->memory, &hunter, sizeof(hunter)); // the pointer at Base leads to the hunter
+	uint64_t damage = 123456789;
+	float health = 150.5f;
+	uint16_t level = 7;
+	memcpy(memory->memory + 0x100 + 0x18, &damage, sizeof(damage));
+	memcpy(memory->memory + 0x100 + 0x20, &health, sizeof(health));
+	memcpy(memory->memory + 0x100 + 0x2C, &level, sizeof(level));
+
+	MemoryWatch watch(memory);
+	MemoryWatch::WatchId id = watch.WatchStruct<HunterView>({ StructMemory::Base, 0 }, 1000);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	watch.SetSampleRate(id, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	WatchSample sample;
+	CHECK(watch.Latest(id, &sample) && sample.valid);
+	HunterView view = sample.AsView<HunterView>();
+	CHECK(view.IsValid());
+	CHECK_EQUAL(view.Get<TotalDamage>(), damage);
+	CHECK(view.Get<Health>() == health);
+	CHECK_EQUAL(view.Get<Level>(), level);
+
+	// One read for the chain's pointer and one for all three fields, per sample.
+	uint64_t samples = watch.SampleCount(id);
+	CHECK(samples > 0);
+	CHECK(memory->reads <= 2 * (int)samples + 1);
+}
+
+// The process_vm_readv backend, reading this process as if it were another one.
+static void TestRemoteProcess()
+{
+	std::shared_ptr<RemoteProcessMemoryAccess> memory = std::make_shared<RemoteProcessMemoryAccess>(getpid());
+	static std::atomic<uint64_t> value{ 1234 };
+	uint64_t read = 0;
+	if (!memory->Read((uintptr_t)&value, &read))
+	{
+		printf("process_vm_readv is not allowed here (errno %d), skipping the remote process test\n", errno);
+		return;
+	}
+	CHECK_EQUAL(read, (uint64_t)1234);
+
+	MemoryRegion region;
+	CHECK(memory->Query((uintptr_t)&value, &region));
+	CHECK(region.readable && (uintptr_t)&value >= region.base && (uintptr_t)&value < region.base + region.size);
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	uint8_t* pages = (uint8_t*)mmap(nullptr, pageSize * 3, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	mprotect(pages, pageSize, PROT_NONE);
+	munmap(pages + pageSize * 2, pageSize);
+	CHECK(memory->Query((uintptr_t)pages, &region) && !region.readable);
+	CHECK(!memory->Read((uintptr_t)pages, &read));
+	CHECK(memory->Query((uintptr_t)pages + pageSize, &region) && region.readable);
+	CHECK(memory->Query((uintptr_t)pages + pageSize * 2, &region) && !region.readable && region.size >= pageSize);
+	CHECK(!memory->Read((uintptr_t)pages + pageSize * 2, &read));
+	munmap(pages, pageSize * 2);
+
+	MemoryWatch watch(memory);
+	MemoryWatch::WatchId id = watch.Watch<uint64_t>((uintptr_t)&value, 1000);
+	value = 5678;
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	WatchSample sample;
+	CHECK(watch.Latest(id, &sample) && sample.valid && sample.As<uint64_t>() == 5678);
+
+	const int numReads = 100000;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numReads; i++)
+	{
+		memory->Read((uintptr_t)&value, &read);
+	}
+	printf("process_vm_readv: %.3f us per 8 byte read\n", ElapsedMicros(start) / numReads);
+}
+
+int main()
+{
+	UseTestDirectory("MemoryWatchTest");
+	TestRingWhileSampling();
+	TestPauseAndRate();
+	TestDestroyWhileSampling();
+	TestStructWatch();
+	TestRemoteProcess();
+	return CheckResult();
+}
@@ -0,0 +1,110 @@
+#include "Check.h"
+#include "OverlayScheduler.h"
+
+// Draws every due overlay with a fixed cost for a number of frames. The others run with drawing skipped,
+// which costs skippedCosts (nothing if null).
+static void RunFrames(OverlayScheduler& scheduler, const double* costs, size_t numOverlays, int frames, int* renders = nullptr,
+	const double* skippedCosts = nullptr)
+{
+	for (int frame = 0; frame < frames; frame++)
+	{
+		for (size_t i = 0; i < numOverlays; i++)
+		{
+			if (scheduler.IsDue(i))
+			{
+				scheduler.Report(i, costs[i]);
+				if (renders != nullptr)
+				{
+					renders[i]++;
+				}
+			}
+			else if (skippedCosts != nullptr)
+			{
+				scheduler.Report(i, skippedCosts[i], false);
+			}
+		}
+		scheduler.EndFrame();
+	}
+}
+
+static void TestOverlayBudget()
+{
+	OverlayScheduler scheduler;
+	size_t slow = scheduler.Add(0, 100);
+	size_t cheap = scheduler.Add(0, 100);
+	double costs[] = { 350, 50 };
+	int renders[] = { 0, 0 };
+	RunFrames(scheduler, costs, 2, 400, renders);
+
+	CHECK_EQUAL(scheduler.Interval(slow), 4u);
+	CHECK(scheduler.IsDecimated(slow));
+	CHECK_EQUAL(scheduler.Interval(cheap), 1u);
+	CHECK(renders[slow] >= 99 && renders[slow] <= 102);
+	CHECK_EQUAL(renders[cheap], 400);
+
+	// Very slow overlays still render every MaxInterval frames.
+	scheduler.SetBudget(slow, 1);
+	RunFrames(scheduler, costs, 2, 10);
+	CHECK_EQUAL(scheduler.Interval(slow), OverlayScheduler::MaxInterval);
+}
+
+// Over the frame budget, the lowest priority overlays are decimated first.
+static void TestFrameBudget()
+{
+	OverlayScheduler scheduler;
+	size_t normal = scheduler.Add(1, 100);
+	size_t unimportant = scheduler.Add(0, 0);
+	size_t important = scheduler.Add(5, 0);
+	scheduler.SetFrameBudget(500);
+	double costs[] = { 350, 400, 100 };
+	RunFrames(scheduler, costs, 3, 200);
+
+	CHECK_EQUAL(scheduler.Interval(normal), 4u);
+	CHECK_EQUAL(scheduler.Interval(unimportant), 2u);
+	CHECK_EQUAL(scheduler.Interval(important), 1u);
+	CHECK_EQUAL(scheduler.AverageMicros(important), 100.0);
+}
+
+// Render() and tasks still run on skipped frames, the interval is chosen so the cost per frame fits the budget.
+static void TestSkippedFrameCost()
+{
+	OverlayScheduler scheduler;
+	size_t overlay = scheduler.Add(0, 100);
+	double costs[] = { 350 };
+	double skippedCosts[] = { 20 };
+	int renders[] = { 0 };
+	RunFrames(scheduler, costs, 1, 400, renders, skippedCosts);
+
+	// (350 + 4 * 20) / 5 = 86 us per frame, 4 would be 102.5
+	CHECK_EQUAL(scheduler.Interval(overlay), 5u);
+	CHECK_EQUAL(scheduler.SkippedMicros(overlay), 20.0);
+	CHECK(renders[0] >= 79 && renders[0] <= 82);
+
+	// If skipping alone costs more than the budget, the overlay is drawn as rarely as possible.
+	skippedCosts[0] = 120;
+	RunFrames(scheduler, costs, 1, 200, nullptr, skippedCosts);
+	CHECK_EQUAL(scheduler.Interval(overlay), OverlayScheduler::MaxInterval);
+}
+
+// The frame budget counts the skipped frames too: 400 us drawn every other frame plus 100 us skipped
+// is 250 us per frame, which needs an interval of 4 to get within 200.
+static void TestFrameBudgetWithSkippedCost()
+{
+	OverlayScheduler scheduler;
+	size_t overlay = scheduler.Add(0, 0);
+	scheduler.SetFrameBudget(200);
+	double costs[] = { 400 };
+	double skippedCosts[] = { 100 };
+	RunFrames(scheduler, costs, 1, 400, nullptr, skippedCosts);
+	CHECK_EQUAL(scheduler.Interval(overlay), 4u);
+}
+
+int main()
+{
+	UseTestDirectory("OverlaySchedulerTest");
+	TestOverlayBudget();
+	TestFrameBudget();
+	TestSkippedFrameCost();
+	TestFrameBudgetWithSkippedCost();
+	return CheckResult();
+}
@@ -0,0 +1,241 @@
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "Check.h"
+#include "OverlayTask.h"
+
+// Counts heap allocations, task frames should come from the pool once it has grown.
+static size_t numAllocations = 0;
+
+void* operator new(size_t size)
+{
+	numAllocations++;
+	void* pointer = malloc(size);
+	if (pointer == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+static uint64_t fakeNow = 0;
+
+static uint64_t FakeClock()
+{
+	return fakeNow;
+}
+
+static int counter = 0;
+
+static OverlayTask Sequence(std::vector<int>* log)
+{
+	log->push_back(1);
+	co_await NextFrame();
+	log->push_back(2);
+	co_await Frames(3);
+	log->push_back(3);
+	co_await Delay(100);
+	log->push_back(4);
+}
+
+static OverlayTask WaitForFlag(bool* flag)
+{
+	co_await Until([flag] { return *flag; });
+	counter += 1000;
+}
+
+// Stands in for AssetCache's AssetRequest, which needs Direct3D to load anything.
+struct FakeRequest
+{
+	bool done = false;
+
+	bool Done() const
+	{
+		return done;
+	}
+};
+
+static OverlayTask WaitForAsset(std::shared_ptr<const FakeRequest> request, int* loaded)
+{
+	co_await AssetReady(request);
+	(*loaded)++;
+}
+
+static OverlayTask Banner(int* drawn)
+{
+	Deadline hide = co_await After(100);
+	while (!hide.Passed())
+	{
+		(*drawn)++;
+		co_await NextFrame();
+	}
+}
+
+static OverlayTask Ticker()
+{
+	while (true)
+	{
+		counter++;
+		co_await NextFrame();
+	}
+}
+
+static OverlayTask Sleeper(int millis)
+{
+	while (true)
+	{
+		co_await Delay(millis);
+		counter++;
+	}
+}
+
+static OverlayTask Short(int frames)
+{
+	co_await Frames(frames);
+	counter++;
+}
+
+static void TestAwaiters()
+{
+	TaskScheduler scheduler(&FakeClock);
+	std::vector<int> log;
+	scheduler.Start(Sequence(&log));
+	const size_t expected[] = { 1, 2, 2, 2, 3, 3, 3, 3, 3, 4 };
+	for (size_t frame = 0; frame < 10; frame++)
+	{
+		fakeNow += 20;
+		scheduler.Resume();
+		CHECK_EQUAL(log.size(), expected[frame]);
+	}
+	CHECK_EQUAL(scheduler.NumTasks(), 0u);
+
+	bool flag = false;
+	scheduler.Start(WaitForFlag(&flag));
+	scheduler.Resume();
+	scheduler.Resume();
+	int before = counter;
+	flag = true;
+	scheduler.Resume();
+	CHECK_EQUAL(counter - before, 1000);
+	CHECK_EQUAL(scheduler.NumTasks(), 0u);
+
+	// Resumes in the frame the request is done, or right away if it already was.
+	std::shared_ptr<FakeRequest> request = std::make_shared<FakeRequest>();
+	int loaded = 0;
+	scheduler.Start(WaitForAsset(request, &loaded));
+	scheduler.Resume();
+	scheduler.Resume();
+	CHECK_EQUAL(loaded, 0);
+	request->done = true;
+	scheduler.Resume();
+	CHECK_EQUAL(loaded, 1);
+	scheduler.Start(WaitForAsset(request, &loaded));
+	scheduler.Resume();
+	CHECK_EQUAL(loaded, 2);
+	CHECK_EQUAL(scheduler.NumTasks(), 0u);
+
+	// Drawn every 16 ms frame until 100 ms have passed.
+	int drawn = 0;
+	scheduler.Start(Banner(&drawn));
+	for (int frame = 0; frame < 20; frame++)
+	{
+		scheduler.Resume();
+		fakeNow += 16;
+	}
+	CHECK_EQUAL(drawn, 7);
+	CHECK_EQUAL(scheduler.NumTasks(), 0u);
+
+	scheduler.Start(Ticker());
+	scheduler.Resume();
+	scheduler.CancelAll();
+	CHECK_EQUAL(scheduler.NumTasks(), 0u);
+}
+
+static void TestSteadyState()
+{
+	const int numTasks = 10000;
+	const int numFrames = 200;
+	{
+		TaskScheduler scheduler(&FakeClock);
+		for (int i = 0; i < numTasks; i++)
+		{
+			scheduler.Start(Ticker());
+		}
+		scheduler.Resume();
+
+		size_t allocationsBefore = numAllocations;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			scheduler.Resume();
+		}
+		printf("%d NextFrame tasks: %.1f ns per task per frame\n", numTasks, ElapsedMicros(start) * 1000 / numFrames / numTasks);
+		CHECK_EQUAL(numAllocations, allocationsBefore);
+	}
+	{
+		TaskScheduler scheduler(&FakeClock);
+		for (int i = 0; i < numTasks; i++)
+		{
+			scheduler.Start(Sleeper(1 + i % 50));
+		}
+		for (int frame = 0; frame < 100; frame++)
+		{
+			fakeNow++;
+			scheduler.Resume();
+		}
+
+		size_t allocationsBefore = numAllocations;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			fakeNow++;
+			scheduler.Resume();
+		}
+		printf("%d Delay tasks: %.1f us per frame\n", numTasks, ElapsedMicros(start) / numFrames);
+		CHECK_EQUAL(numAllocations, allocationsBefore);
+	}
+	{
+		// Short tasks started and finished every frame reuse the pooled frames.
+		TaskScheduler scheduler(&FakeClock);
+		for (int frame = 0; frame < 10; frame++)
+		{
+			for (int i = 0; i < 200; i++)
+			{
+				scheduler.Start(Short(1 + i % 4));
+			}
+			scheduler.Resume();
+		}
+
+		size_t allocationsBefore = numAllocations;
+		size_t chunksBefore = TaskFramePool::Instance().NumChunks();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			for (int i = 0; i < 200; i++)
+			{
+				scheduler.Start(Short(1 + i % 4));
+			}
+			scheduler.Resume();
+		}
+		CHECK_EQUAL(numAllocations, allocationsBefore);
+		CHECK_EQUAL(TaskFramePool::Instance().NumChunks(), chunksBefore);
+	}
+}
+
+int main()
+{
+	UseTestDirectory("OverlayTaskTest");
+	TestAwaiters();
+	TestSteadyState();
+	return CheckResult();
+}
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "Check.h"
+#include "OverlayUpdater.h"
+
+class CountingOverlay : public IRenderCallback
+{
+public:
+	std::atomic<int> updates{ 0 };
+	std::atomic<bool> inUpdate{ false };
+	std::thread::id updateThread;
+	std::chrono::milliseconds updateTime{ 0 };
+
+	void Render() override { }
+
+	void Update() override
+	{
+		inUpdate = true;
+		updateThread = std::this_thread::get_id();
+		std::this_thread::sleep_for(updateTime);
+		updates++;
+		inUpdate = false;
+	}
+};
+
+// Each overlay updates at its own interval on the update thread, Stop() ends the updates.
+static void TestIntervals()
+{
+	OverlayUpdater updater;
+	CountingOverlay fast;
+	CountingOverlay slow;
+	updater.Add(&fast, 10);
+	updater.Add(&slow, 40);
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	updater.Stop();
+
+	printf("updates in 400 ms: every 10 ms %d, every 40 ms %d\n", fast.updates.load(), slow.updates.load());
+	CHECK(fast.updates >= 20 && fast.updates <= 42);
+	CHECK(slow.updates >= 5 && slow.updates <= 12);
+	CHECK(fast.updates > slow.updates * 2);
+	CHECK(fast.updateThread != std::this_thread::get_id());
+
+	int updates = fast.updates;
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK_EQUAL(fast.updates.load(), updates);
+
+	// Overlays added after Stop() are never updated.
+	CountingOverlay late;
+	updater.Add(&late, 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK_EQUAL(late.updates.load(), 0);
+}
+
+// Stop() waits for a running Update() to return.
+static void TestStopWaitsForUpdate()
+{
+	OverlayUpdater updater;
+	CountingOverlay overlay;
+	overlay.updateTime = std::chrono::milliseconds(100);
+	updater.Add(&overlay, 1000);
+	while (!overlay.inUpdate)
+	{
+		std::this_thread::yield();
+	}
+
+	updater.Stop();
+	CHECK(!overlay.inUpdate);
+	CHECK_EQUAL(overlay.updates.load(), 1);
+}
+
+// Destroying a running updater doesn't wait for the thread, which stops on its own after the Update() in progress.
+static void TestDestroyWithoutStop()
+{
+	static CountingOverlay overlay;
+	overlay.updateTime = std::chrono::milliseconds(100);
+	OverlayUpdater* updater = new OverlayUpdater();
+	updater->Add(&overlay, 1000);
+	while (!overlay.inUpdate)
+	{
+		std::this_thread::yield();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	delete updater;
+	CHECK(ElapsedMicros(start) < 50000);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	CHECK(!overlay.inUpdate);
+	CHECK_EQUAL(overlay.updates.load(), 1);
+}
+
+int main()
+{
+	UseTestDirectory("OverlayUpdaterTest");
+	TestIntervals();
+	TestStopWaitsForUpdate();
+	TestDestroyWithoutStop();
+	return CheckResult();
+}
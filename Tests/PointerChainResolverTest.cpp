@@ -0,0 +1,82 @@
+#include <cstring>
+
+#include "Check.h"
+#include "PointerChainResolver.h"
+
+// 64 KB of fake game memory at 0x10000 that counts the expensive queries.
+class FakeMemory : public IMemoryAccess
+{
+public:
+	static constexpr uintptr_t Base = 0x10000;
+
+	uint8_t memory[1 << 16] = {};
+
+	bool Query(uintptr_t address, MemoryRegion* region) override
+	{
+		region->base = address & ~(uintptr_t)0xFFF;
+		region->size = 0x1000;
+		region->readable = address >= Base && address < Base + sizeof(memory);
+		return true;
+	}
+
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		if (address < Base || address + size > Base + sizeof(memory))
+		{
+			return false;
+		}
+		memcpy(buffer, memory + (address - Base), size);
+		return true;
+	}
+
+	void WritePointer(uintptr_t address, uintptr_t value)
+	{
+		memcpy(memory + (address - Base), &value, sizeof(value));
+	}
+};
+
+static void TestResolve()
+{
+	static FakeMemory memory;
+	PageCache pages(memory);
+	memory.WritePointer(0x10000, 0x12000);
+	memory.WritePointer(0x12000 + 0x70, 0x13000);
+	memory.WritePointer(0x13000 + 0x30, 0x14000);
+
+	// Walked once, then only validated.
+	PointerChainResolver resolver(memory, pages, { 0x10000, 0x70, 0x30, 0x18 });
+	CHECK_EQUAL(resolver.Resolve(), 0x14018u);
+	size_t queries = pages.QueryCount();
+	for (int i = 0; i < 1000; i++)
+	{
+		CHECK_EQUAL(resolver.Resolve(), 0x14018u);
+	}
+	CHECK_EQUAL(resolver.WalkCount(), 1u);
+	CHECK_EQUAL(pages.QueryCount(), queries);
+
+	// A pointer that changed walks the chain again with fresh page information.
+	memory.WritePointer(0x13000 + 0x30, 0x15000);
+	CHECK_EQUAL(resolver.Resolve(), 0x15018u);
+	CHECK_EQUAL(resolver.WalkCount(), 2u);
+
+	// Null or unreadable pointers don't resolve until the chain is back.
+	memory.WritePointer(0x12000 + 0x70, 0);
+	CHECK_EQUAL(resolver.Resolve(), 0u);
+	memory.WritePointer(0x12000 + 0x70, 0x90000);
+	CHECK_EQUAL(resolver.Resolve(), 0u);
+	memory.WritePointer(0x12000 + 0x70, 0x13000);
+	CHECK_EQUAL(resolver.Resolve(), 0x15018u);
+
+	PointerChainResolver empty(memory, pages, {});
+	CHECK_EQUAL(empty.Resolve(), 0u);
+
+	PointerChainResolver baseOnly(memory, pages, { 0x10000 });
+	CHECK_EQUAL(baseOnly.Resolve(), 0x10000u);
+}
+
+int main()
+{
+	UseTestDirectory("PointerChainResolverTest");
+	TestResolve();
+	return CheckResult();
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "PresentGate.h"
+
+// Waits up to a second for a condition another thread makes true.
+template<typename Predicate>
+static bool WaitFor(const Predicate& predicate)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (!predicate())
+	{
+		if (ElapsedMicros(start) > 1000000)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	return true;
+}
+
+// Key presses drive the gate of a fake present thread that "renders" for half a millisecond a frame.
+static void TestPresentThread()
+{
+	PresentGate& gate = PresentGate::Instance();
+	gate.BindKeys('P', 'O');
+
+	std::atomic<uint64_t> frames{ 0 };
+	std::atomic<bool> quit{ false };
+	std::thread present([&]
+	{
+		while (!quit)
+		{
+			gate.Wait();
+			frames++;
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+			gate.EndFrame();
+		}
+	});
+	CHECK(WaitFor([&] { return frames > 5; }));
+
+	// The frame in flight when the hold comes in is still presented, then the frames stop.
+	gate.OnKeyDown('P');
+	CHECK(gate.IsHolding());
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	uint64_t held = frames;
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	CHECK_EQUAL(frames.load(), held);
+
+	for (int step = 1; step <= 3; step++)
+	{
+		gate.OnKeyDown('O');
+		CHECK(WaitFor([&] { return frames == held + step; }));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK_EQUAL(frames.load(), held + 3);
+
+	// Unbound keys do nothing.
+	gate.OnKeyDown('X');
+	gate.OnKeyDown(0);
+	CHECK(gate.IsHolding());
+
+	gate.OnKeyDown('P');
+	CHECK(!gate.IsHolding());
+	CHECK(WaitFor([&] { return frames > held + 10; }));
+
+	// Stepping an open gate doesn't queue steps for the next hold.
+	gate.Step(5);
+	gate.Hold();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	held = frames;
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK_EQUAL(frames.load(), held);
+
+	// Release latency, from Release() until the present thread runs again.
+	std::vector<double> latencies;
+	for (int trial = 0; trial < 50; trial++)
+	{
+		gate.Hold();
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		uint64_t before = frames;
+		gate.Release();
+		CHECK(WaitFor([&] { return frames > before; }));
+		latencies.push_back(gate.WakeLatencyMicros());
+	}
+	std::sort(latencies.begin(), latencies.end());
+	printf("Release to present thread running: median %.1f us, max %.1f us\n", latencies[latencies.size() / 2], latencies.back());
+	CHECK(gate.NumHolds() > 0);
+
+	quit = true;
+	gate.Release();
+	present.join();
+}
+
+int main()
+{
+	UseTestDirectory("PresentGateTest");
+	TestPresentThread();
+	return CheckResult();
+}
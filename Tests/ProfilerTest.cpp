@@ -0,0 +1,143 @@
+#include <cstring>
+#include <thread>
+
+#include "Check.h"
+#include "Profiler.h"
+
+// One tick is one microsecond.
+static uint64_t fakeNow = 1;
+
+static uint64_t FakeClock()
+{
+	return fakeNow;
+}
+
+static int FindNode(const Profiler& profiler, const char* name)
+{
+	for (int i = 0; i < profiler.NumNodes(); i++)
+	{
+		if (strcmp(profiler.GetNode(i).name, name) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Present (30 us) > Render (15 us, called twice) > Text (3 us once), the frame is 1000 us.
+static void RunFrame(Profiler& profiler)
+{
+	uint64_t start = fakeNow;
+	profiler.BeginFrame();
+	profiler.Enter("Present");
+	fakeNow += 5;
+	profiler.Enter("Render");
+	fakeNow += 10;
+	profiler.Enter("Text");
+	fakeNow += 3;
+	profiler.Exit();
+	profiler.Exit();
+	profiler.Enter("Render");
+	fakeNow += 2;
+	profiler.Exit();
+	fakeNow += 10;
+	profiler.Exit();
+	profiler.EndFrame();
+	fakeNow = start + 1000;
+}
+
+static void TestAggregation()
+{
+	Profiler profiler(&FakeClock, 1000000);
+	for (int frame = 0; frame < 100; frame++)
+	{
+		RunFrame(profiler);
+	}
+
+	CHECK_EQUAL(profiler.NumNodes(), 3);
+	int present = FindNode(profiler, "Present");
+	int render = FindNode(profiler, "Render");
+	int text = FindNode(profiler, "Text");
+	CHECK(present != -1 && render != -1 && text != -1);
+	CHECK_EQUAL(profiler.GetNode(present).parent, -1);
+	CHECK_EQUAL(profiler.GetNode(render).parent, present);
+	CHECK_EQUAL(profiler.GetNode(text).parent, render);
+	CHECK_EQUAL(profiler.GetNode(text).depth, 2);
+
+	CHECK_EQUAL(profiler.GetNode(present).inclusiveMicros, 30.0);
+	CHECK_EQUAL(profiler.GetNode(present).exclusiveMicros, 15.0);
+	CHECK_EQUAL(profiler.GetNode(render).inclusiveMicros, 15.0);
+	CHECK_EQUAL(profiler.GetNode(render).exclusiveMicros, 12.0);
+	CHECK_EQUAL(profiler.GetNode(render).calls, 2.0);
+	CHECK_EQUAL(profiler.GetNode(text).calls, 1.0);
+	CHECK_EQUAL(profiler.HookMicros(), 30.0);
+	CHECK_EQUAL(profiler.FrameMicros(), 1000.0);
+	CHECK_EQUAL(profiler.NumFrames(), 100u);
+
+	const Profiler::Snapshot& snapshot = profiler.LastFrame();
+	CHECK_EQUAL(snapshot.numNodes, 3);
+	CHECK_EQUAL(snapshot.nodes[render].inclusiveMicros, 15.0);
+	CHECK_EQUAL(snapshot.numFrames, 100u);
+}
+
+// A slower frame moves the averages by Smoothing of the difference.
+static void TestSmoothing()
+{
+	Profiler profiler(&FakeClock, 1000000);
+	RunFrame(profiler);
+	RunFrame(profiler);
+	CHECK_EQUAL(profiler.FrameMicros(), 1000.0); // the first frame time seeds the average
+
+	profiler.BeginFrame();
+	profiler.Enter("Present");
+	fakeNow += 130;
+	profiler.Exit();
+	profiler.EndFrame();
+
+	double expected = 30 + (130 - 30) * Profiler::Smoothing;
+	double inclusive = profiler.GetNode(FindNode(profiler, "Present")).inclusiveMicros;
+	CHECK(inclusive > expected - 0.001 && inclusive < expected + 0.001);
+}
+
+// Scopes outside a frame, on other threads or past the node table are dropped without unbalancing the stack.
+static void TestIgnoredScopes()
+{
+	Profiler profiler(&FakeClock, 1000000);
+	profiler.Enter("Outside");
+	profiler.Exit();
+
+	profiler.BeginFrame();
+	profiler.Enter("Present");
+	std::thread other([&]
+	{
+		profiler.Enter("Other thread");
+		profiler.Exit();
+	});
+	other.join();
+
+	static char names[Profiler::MaxNodes + 8][16];
+	for (int i = 0; i < Profiler::MaxNodes + 8; i++)
+	{
+		snprintf(names[i], sizeof(names[i]), "Scope %d", i);
+		profiler.Enter(names[i]);
+		fakeNow++;
+		profiler.Exit();
+	}
+	fakeNow += 10;
+	profiler.Exit();
+	profiler.EndFrame();
+
+	CHECK_EQUAL(profiler.NumNodes(), Profiler::MaxNodes);
+	CHECK_EQUAL(FindNode(profiler, "Outside"), -1);
+	CHECK_EQUAL(FindNode(profiler, "Other thread"), -1);
+	CHECK_EQUAL(profiler.GetNode(FindNode(profiler, "Present")).inclusiveMicros, (double)(Profiler::MaxNodes + 8 + 10));
+}
+
+int main()
+{
+	UseTestDirectory("ProfilerTest");
+	TestAggregation();
+	TestSmoothing();
+	TestIgnoredScopes();
+	return CheckResult();
+}
@@ -0,0 +1,155 @@
+#include <cstring>
+#include <random>
+
+#include "Check.h"
+#include "PeImage.h"
+#include "SignatureScanner.h"
+
+// Random bytes with signatures planted across a chunk boundary, in the middle and at the very end.
+// The scanner has to agree with a byte by byte comparison.
+static void TestScan()
+{
+	std::vector<uint8_t> buffer(8 * 1024 * 1024 + 123);
+	std::mt19937 random(1);
+	for (uint8_t& byte : buffer)
+	{
+		byte = (uint8_t)random();
+	}
+
+	const uint8_t rip[] = { 0x48, 0x8B, 0x05, 0x10, 0, 0, 0, 0x48, 0x85, 0xC0 };
+	const uint8_t call[] = { 0xE8, 1, 2, 3, 4, 0x90, 0xAB, 0xCD, 0xEF, 0x12 };
+	const uint8_t tail[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0x11, 0x22 };
+	size_t chunkSize = 1024 * 1024;
+	memcpy(&buffer[chunkSize - 3], rip, sizeof(rip));
+	memcpy(&buffer[5000000], call, sizeof(call));
+	memcpy(&buffer[buffer.size() - sizeof(tail)], tail, sizeof(tail));
+
+	std::vector<Signature> signatures;
+	signatures.push_back(Signature::Parse("Rip", "48 8B 05 ?? ?? ?? ?? 48 85 C0").RipRelative(3, 7));
+	signatures.push_back(Signature::Parse("Call", "E8 ? ? ? ? 90 AB CD EF 12"));
+	signatures.push_back(Signature::Parse("Tail", "DE AD BE EF 11 22"));
+	signatures.push_back(Signature::Parse("Loose", "0F ??"));
+	signatures.push_back(Signature::Parse("Missing", "01 02 03 04 05 06 07 08"));
+	for (const Signature& signature : signatures)
+	{
+		CHECK(signature.IsValid());
+	}
+
+	std::vector<ScanResult> expected(signatures.size());
+	for (size_t i = 0; i < signatures.size(); i++)
+	{
+		for (size_t position = 0; position + signatures[i].bytes.size() <= buffer.size(); position++)
+		{
+			if (signatures[i].Matches(&buffer[position]))
+			{
+				if (expected[i].matchCount == 0)
+				{
+					expected[i].match = 0x1000 + position;
+				}
+				expected[i].matchCount++;
+			}
+		}
+	}
+	CHECK_EQUAL(expected[0].match, 0x1000 + chunkSize - 3);
+	CHECK_EQUAL(expected[4].matchCount, 0u);
+
+	ScanRange range{ buffer.data(), buffer.size(), 0x1000 };
+	for (unsigned int numThreads : { 1u, 4u })
+	{
+		SignatureScanner scanner(numThreads);
+		auto start = std::chrono::steady_clock::now();
+		std::vector<ScanResult> results = scanner.Scan({ range }, signatures);
+		double micros = ElapsedMicros(start);
+		printf("%u threads: %.2f GB/s\n", numThreads, buffer.size() / micros / 1000);
+
+		CHECK_EQUAL(results.size(), signatures.size());
+		for (size_t i = 0; i < signatures.size() && i < results.size(); i++)
+		{
+			CHECK_EQUAL(results[i].match, expected[i].match);
+			CHECK_EQUAL(results[i].matchCount, expected[i].matchCount);
+		}
+		CHECK_EQUAL(results[0].resolved, 0x1000 + chunkSize - 3 + 7 + 0x10);
+		CHECK_EQUAL(results[2].resolved, results[2].match);
+	}
+}
+
+static void TestParse()
+{
+	CHECK(!Signature::Parse("Empty", "").IsValid());
+	CHECK(!Signature::Parse("Wildcards", "?? ??").IsValid());
+	CHECK(!Signature::Parse("Malformed", "4G 12").IsValid());
+	Signature signature = Signature::Parse("Mixed", "ab ? CD");
+	CHECK_EQUAL(signature.bytes.size(), 3u);
+	CHECK_EQUAL(signature.mask[1], 0);
+	CHECK_EQUAL(signature.bytes[2], 0xCD);
+}
+
+// A code section with a guard page in the middle and a data section whose second half isn't committed.
+static void TestPeSections()
+{
+	struct Image
+	{
+		IMAGE_DOS_HEADER dos;
+		IMAGE_NT_HEADERS nt;
+		IMAGE_SECTION_HEADER sections[2];
+	};
+
+	alignas(4096) static uint8_t memory[0x6000] = {};
+	Image* image = (Image*)memory;
+	image->dos.e_magic = IMAGE_DOS_SIGNATURE;
+	image->dos.e_lfanew = offsetof(Image, nt);
+	image->nt.Signature = IMAGE_NT_SIGNATURE;
+	image->nt.OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR_MAGIC;
+	image->nt.FileHeader.NumberOfSections = 2;
+	image->nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+	image->sections[0].Misc.VirtualSize = 0x3000;
+	image->sections[0].VirtualAddress = 0x1000;
+	image->sections[0].Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_READ;
+	image->sections[1].Misc.VirtualSize = 0x1000;
+	image->sections[1].VirtualAddress = 0x4000;
+	image->sections[1].Characteristics = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ;
+
+	uintptr_t base = (uintptr_t)memory;
+	FakeRegions() =
+	{
+		{ base, 0x1000, MEM_COMMIT, PAGE_READONLY },
+		{ base + 0x1000, 0x1000, MEM_COMMIT, PAGE_EXECUTE_READ },
+		{ base + 0x2000, 0x1000, MEM_COMMIT, PAGE_READONLY | PAGE_GUARD },
+		{ base + 0x3000, 0x1000, MEM_COMMIT, PAGE_EXECUTE_READ },
+		{ base + 0x4000, 0x800, MEM_COMMIT, PAGE_READWRITE },
+		{ base + 0x4800, 0x800, MEM_RESERVE, PAGE_NOACCESS }
+	};
+
+	// Readable pieces next to each other are merged, even across sections.
+	PeImage pe(memory);
+	std::vector<ScanRange> ranges = pe.CodeAndDataSections();
+	CHECK_EQUAL(ranges.size(), 2u);
+	if (ranges.size() == 2)
+	{
+		CHECK_EQUAL(ranges[0].address, base + 0x1000);
+		CHECK_EQUAL(ranges[0].size, 0x1000u);
+		CHECK_EQUAL(ranges[1].address, base + 0x3000);
+		CHECK_EQUAL(ranges[1].size, 0x1800u);
+		CHECK(ranges[1].data == memory + 0x3000);
+	}
+
+	std::vector<ScanRange> code = pe.CodeSections();
+	CHECK_EQUAL(code.size(), 2u);
+	if (code.size() == 2)
+	{
+		CHECK_EQUAL(code[1].size, 0x1000u);
+	}
+
+	PeImage none(nullptr);
+	CHECK(none.CodeSections().empty());
+	FakeRegions().clear();
+}
+
+int main()
+{
+	UseTestDirectory("SignatureScannerTest");
+	TestScan();
+	TestParse();
+	TestPeSections();
+	return CheckResult();
+}
@@ -0,0 +1,86 @@
+#include <cstring>
+
+#include "Check.h"
+#include "StructView.h"
+
+// A synthetic memory image: one structure at 0x1000, everything past 0x1040 unreadable.
+class ImageMemory : public IMemoryAccess
+{
+public:
+	static constexpr uintptr_t Base = 0x1000;
+
+	uint8_t image[0x40] = {};
+	int reads = 0;
+
+	bool Query(uintptr_t address, MemoryRegion* region) override
+	{
+		region->base = Base;
+		region->size = sizeof(image);
+		region->readable = true;
+		return address >= Base && address < Base + sizeof(image);
+	}
+
+	bool Read(uintptr_t address, void* buffer, size_t size) override
+	{
+		reads++;
+		if (address < Base || address + size > Base + sizeof(image))
+		{
+			return false;
+		}
+		memcpy(buffer, image + (address - Base), size);
+		return true;
+	}
+};
+
+typedef Field<uint64_t, 0x18> TotalDamage;
+typedef Field<float, 0x08> Health;
+typedef Field<uint16_t, 0x30> Level;
+typedef StructView<TotalDamage, Health, Level> HunterView;
+
+// The covering range is known at compile time, whatever order the fields are listed in.
+static_assert(HunterView::Begin == 0x08, "");
+static_assert(HunterView::End == 0x32, "");
+static_assert(HunterView::Size == 0x2A, "");
+static_assert(StructView<TotalDamage>::Size == sizeof(uint64_t), "");
+
+static void TestRead()
+{
+	ImageMemory memory;
+	uint64_t damage = 0x123456789ull;
+	float health = 99.5f;
+	uint16_t level = 42;
+	memcpy(memory.image + 0x18, &damage, sizeof(damage));
+	memcpy(memory.image + 0x08, &health, sizeof(health));
+	memcpy(memory.image + 0x30, &level, sizeof(level));
+
+	HunterView hunter;
+	CHECK(!hunter.IsValid());
+	CHECK(hunter.Read(memory, ImageMemory::Base));
+	CHECK_EQUAL(memory.reads, 1);
+	CHECK(hunter.IsValid());
+	CHECK_EQUAL(hunter.Get<TotalDamage>(), damage);
+	CHECK(hunter.Get<Health>() == health);
+	CHECK_EQUAL(hunter.Get<Level>(), level);
+
+	// A failed read keeps what was read before, a null address doesn't read at all.
+	CHECK(!hunter.Read(memory, ImageMemory::Base + 0x20));
+	CHECK(!hunter.Read(memory, 0));
+	CHECK_EQUAL(memory.reads, 2);
+	CHECK_EQUAL(hunter.Get<TotalDamage>(), damage);
+
+	// The same structure already in this process, or a copy of just the fields' range
+	HunterView local;
+	local.Assign(memory.image);
+	CHECK_EQUAL(local.Get<Level>(), level);
+	HunterView range;
+	range.AssignRange(memory.image + HunterView::Begin);
+	CHECK_EQUAL(range.Get<TotalDamage>(), damage);
+	CHECK(range.Get<Health>() == health);
+}
+
+int main()
+{
+	UseTestDirectory("StructViewTest");
+	TestRead();
+	return CheckResult();
+}
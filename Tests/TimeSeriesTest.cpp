@@ -0,0 +1,100 @@
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "TimeSeries.h"
+
+// A damage counter sampled about every 50 ms, with the odd jitter, reset and overflow.
+static std::vector<TimeSeries::Point> MakePoints(size_t count)
+{
+	std::vector<TimeSeries::Point> points;
+	std::mt19937 random(9);
+	uint64_t timestamp = 1000000;
+	int64_t value = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		timestamp += 50 + (random() % 3 == 0 ? random() % 5 : 0);
+		if (random() % 4 == 0)
+		{
+			value += random() % 5000;
+		}
+		if (i == 1000)
+		{
+			value = -5;
+		}
+		if (i == 5000)
+		{
+			value = std::numeric_limits<int64_t>::max() - 3;
+		}
+		if (i == 5001)
+		{
+			value = std::numeric_limits<int64_t>::min();
+		}
+		points.push_back({ timestamp, value });
+	}
+	return points;
+}
+
+static void TestRoundTrip()
+{
+	std::vector<TimeSeries::Point> points = MakePoints(500000);
+	TimeSeries series;
+	for (const TimeSeries::Point& point : points)
+	{
+		series.Append(point.timestamp, point.value);
+	}
+	CHECK_EQUAL(series.NumPoints(), points.size());
+	CHECK(series.First().timestamp == points.front().timestamp);
+	CHECK(series.Last().value == points.back().value);
+
+	size_t index = 0;
+	size_t mismatches = 0;
+	auto start = std::chrono::steady_clock::now();
+	series.ForEach([&](const TimeSeries::Point& point)
+	{
+		mismatches += point.timestamp != points[index].timestamp || point.value != points[index].value;
+		index++;
+	});
+	double decodeMicros = ElapsedMicros(start);
+	CHECK_EQUAL(index, points.size());
+	CHECK_EQUAL(mismatches, 0u);
+
+	double bytesPerPoint = (double)series.CompressedBytes() / points.size();
+	CHECK(bytesPerPoint < 4);
+	printf("%.2f bytes per point (%.1fx smaller), decoded %.0f million points/s\n",
+		bytesPerPoint, sizeof(TimeSeries::Point) / bytesPerPoint, points.size() / decodeMicros);
+
+	size_t inRange = 0;
+	series.ForEachInRange(points[100].timestamp, points[200].timestamp, [&](const TimeSeries::Point&) { inRange++; });
+	CHECK_EQUAL(inRange, 100u);
+}
+
+// With a block limit the oldest blocks go and the newest points stay.
+static void TestBlockLimit()
+{
+	std::vector<TimeSeries::Point> points = MakePoints(100000);
+	TimeSeries series(2);
+	for (const TimeSeries::Point& point : points)
+	{
+		series.Append(point.timestamp, point.value);
+	}
+	CHECK_EQUAL(series.NumBlocks(), 2u);
+	CHECK(series.NumPoints() < points.size());
+
+	size_t counted = 0;
+	series.ForEach([&](const TimeSeries::Point&) { counted++; });
+	CHECK_EQUAL(counted, series.NumPoints());
+	CHECK(series.Last().timestamp == points.back().timestamp);
+
+	series.Clear();
+	CHECK(series.Empty());
+}
+
+int main()
+{
+	UseTestDirectory("TimeSeriesTest");
+	TestRoundTrip();
+	TestBlockLimit();
+	return CheckResult();
+}
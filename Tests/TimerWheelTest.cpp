@@ -0,0 +1,159 @@
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "TimerWheel.h"
+
+static uint64_t fakeNow = 1000;
+
+static uint64_t FakeClock()
+{
+	return fakeNow;
+}
+
+// Advanced one millisecond at a time, a timer fires on exactly its due millisecond on every level of the wheel.
+static void TestExactExpiry()
+{
+	TimerWheel wheel(&FakeClock);
+	int fired = 0;
+	int wrong = 0;
+	for (uint64_t delay : { 1, 5, 63, 64, 100, 4095, 4096, 5000, 262143, 262144, 300000 })
+	{
+		uint64_t due = fakeNow + delay;
+		wheel.After(delay, [&, due]
+		{
+			wrong += fakeNow != due;
+			fired++;
+		});
+	}
+
+	for (int i = 0; i < 300001; i++)
+	{
+		fakeNow++;
+		wheel.Advance();
+	}
+	CHECK_EQUAL(fired, 11);
+	CHECK_EQUAL(wrong, 0);
+}
+
+// Random timers, cancels and clock jumps: nothing fires early, every one-shot fires once, periodic timers keep up.
+static void TestRandomized()
+{
+	TimerWheel wheel(&FakeClock);
+	std::mt19937_64 random(1);
+
+	struct Expected
+	{
+		uint64_t due = 0;
+		uint64_t interval = 0;
+		bool periodic = false;
+		bool cancelled = false;
+		int fired = 0;
+	};
+
+	std::vector<Expected> timers(3000);
+	std::vector<TimerWheel::TimerId> ids;
+	int early = 0;
+	int repeated = 0;
+	for (size_t i = 0; i < timers.size(); i++)
+	{
+		uint64_t delay = random() % 5 == 0 ? random() % 20000000 : random() % 5000;
+		delay = std::max<uint64_t>(delay, 1);
+		Expected& timer = timers[i];
+		timer.due = fakeNow + delay;
+		timer.interval = delay;
+		timer.periodic = random() % 4 == 0;
+		if (timer.periodic)
+		{
+			ids.push_back(wheel.Every(delay, [&timer, &early]
+			{
+				early += fakeNow < timer.due;
+				timer.fired++;
+				timer.due += timer.interval;
+				if (timer.due <= fakeNow)
+				{
+					timer.due = fakeNow + timer.interval;
+				}
+			}));
+		}
+		else
+		{
+			ids.push_back(wheel.After(delay, [&timer, &early, &repeated]
+			{
+				early += fakeNow < timer.due;
+				repeated += timer.fired != 0;
+				timer.fired++;
+			}));
+		}
+	}
+
+	for (int i = 0; i < 300; i++)
+	{
+		size_t index = random() % ids.size();
+		wheel.Cancel(ids[index]);
+		CHECK(!wheel.IsActive(ids[index]));
+		timers[index].cancelled = true;
+	}
+
+	uint64_t end = fakeNow + 21000000;
+	while (fakeNow < end)
+	{
+		fakeNow += 1 + random() % 50;
+		if (random() % 1000 == 0)
+		{
+			fakeNow += random() % 100000;
+		}
+		wheel.Advance();
+	}
+
+	int missed = 0;
+	for (const Expected& timer : timers)
+	{
+		if (timer.cancelled)
+		{
+			continue;
+		}
+		missed += timer.periodic ? timer.due + timer.interval < fakeNow : timer.fired == 0;
+	}
+	CHECK_EQUAL(early, 0);
+	CHECK_EQUAL(repeated, 0);
+	CHECK_EQUAL(missed, 0);
+}
+
+static void TestFramesAndRestart()
+{
+	TimerWheel wheel(&FakeClock);
+	uint64_t firedFrame = 0;
+	wheel.AfterFrames(3, [&] { firedFrame = wheel.Frame(); });
+	int everyOther = 0;
+	wheel.EveryFrames(2, [&] { everyOther++; });
+	for (int i = 0; i < 10; i++)
+	{
+		wheel.Advance();
+	}
+	CHECK_EQUAL(firedFrame, 3u);
+	CHECK_EQUAL(everyOther, 5);
+
+	int fired = 0;
+	TimerWheel::TimerId id = wheel.After(100, [&] { fired++; });
+	fakeNow += 90;
+	wheel.Advance();
+	CHECK(wheel.Restart(id));
+	fakeNow += 90;
+	wheel.Advance();
+	CHECK_EQUAL(fired, 0);
+	fakeNow += 10;
+	wheel.Advance();
+	CHECK_EQUAL(fired, 1);
+	CHECK(!wheel.IsActive(id));
+	CHECK(!wheel.Cancel(id));
+}
+
+int main()
+{
+	UseTestDirectory("TimerWheelTest");
+	TestExactExpiry();
+	TestRandomized();
+	TestFramesAndRestart();
+	return CheckResult();
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <thread>
+
+#include "Check.h"
+#include "Trace.h"
+
+// Counter events whose argument is derived from the value, a torn event breaks the relation.
+static void TestDumpWhileRecording()
+{
+	Trace& trace = Trace::Instance();
+	trace.Enable(true);
+
+	std::atomic<bool> done{ false };
+	std::thread recorder([&]
+	{
+		uint64_t value = 0;
+		while (!done)
+		{
+			value++;
+			trace.Record("Counter", Trace::EventType::Counter, Trace::Now(), value, (int32_t)(value % 1000003));
+		}
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	std::regex counter("\"(\\d+)\":(\\d+)\\}");
+	long events = 0;
+	long torn = 0;
+	for (int dump = 0; dump < 10; dump++)
+	{
+		CHECK(trace.DumpChromeJson("trace_test.json"));
+		std::ifstream file("trace_test.json");
+		std::string line;
+		std::smatch match;
+		while (std::getline(file, line))
+		{
+			if (std::regex_search(line, match, counter))
+			{
+				events++;
+				torn += std::stoull(match[2]) % 1000003 != std::stoull(match[1]);
+			}
+		}
+	}
+	done = true;
+	recorder.join();
+
+	CHECK(events > 0);
+	CHECK_EQUAL(torn, 0);
+}
+
+static void TestSpans()
+{
+	Trace& trace = Trace::Instance();
+	auto start = std::chrono::steady_clock::now();
+	const int numSpans = 1000000;
+	for (int i = 0; i < numSpans; i++)
+	{
+		TRACE_SCOPE_ARG("Span", 7);
+	}
+	printf("%.1f ns per span\n", ElapsedMicros(start) * 1000 / numSpans);
+
+	trace.Enable(false);
+	{
+		TRACE_SCOPE("Disabled");
+	}
+
+	CHECK(trace.DumpChromeJson("trace_test.json"));
+	std::ifstream file("trace_test.json");
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	CHECK(text.find("\"name\":\"Span\",\"ph\":\"X\"") != std::string::npos);
+	CHECK(text.find("\"args\":{\"arg\":7}") != std::string::npos);
+	CHECK(text.find("Disabled") == std::string::npos);
+	CHECK(text.rfind("]}") != std::string::npos);
+}
+
+int main()
+{
+	UseTestDirectory("TraceTest");
+	TestDumpWhileRecording();
+	TestSpans();
+	return CheckResult();
+}
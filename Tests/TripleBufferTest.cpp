@@ -0,0 +1,123 @@
+#include <atomic>
+#include <thread>
+
+#include "Check.h"
+#include "TripleBuffer.h"
+
+struct Snapshot
+{
+	long sequence = 0;
+	long negated = 0; // always -sequence in a complete snapshot
+};
+
+// Spans several cache lines, so a torn copy shows up as differing words.
+struct WideSnapshot
+{
+	long words[64] = {};
+};
+
+static void TestSingleThread()
+{
+	TripleBuffer<Snapshot> buffer;
+	buffer.Reset({ 0, 0 });
+	CHECK(!buffer.HasNewSnapshot());
+
+	buffer.WriteBuffer() = { 1, -1 };
+	buffer.Publish();
+	buffer.WriteBuffer() = { 2, -2 };
+	buffer.Publish();
+	CHECK(buffer.HasNewSnapshot());
+	CHECK_EQUAL(buffer.Read().sequence, 2);
+	CHECK(!buffer.HasNewSnapshot());
+	CHECK_EQUAL(buffer.Read().sequence, 2);
+}
+
+// The consumer only ever sees complete snapshots, and never an older one than it saw before.
+static void TestProducerConsumer()
+{
+	TripleBuffer<Snapshot> buffer;
+	buffer.Reset({ 0, 0 });
+	std::atomic<bool> done{ false };
+	const long numSnapshots = 2000000;
+
+	std::thread producer([&]
+	{
+		for (long i = 1; i <= numSnapshots; i++)
+		{
+			Snapshot& snapshot = buffer.WriteBuffer();
+			snapshot.sequence = i;
+			snapshot.negated = -i;
+			buffer.Publish();
+		}
+		done = true;
+	});
+
+	long last = 0;
+	long torn = 0;
+	long backwards = 0;
+	while (!done || buffer.HasNewSnapshot())
+	{
+		const Snapshot& snapshot = buffer.Read();
+		torn += snapshot.sequence != -snapshot.negated;
+		backwards += snapshot.sequence < last;
+		last = snapshot.sequence;
+	}
+	producer.join();
+
+	CHECK_EQUAL(torn, 0);
+	CHECK_EQUAL(backwards, 0);
+	CHECK_EQUAL(buffer.Read().sequence, numSnapshots);
+}
+
+// Once Publish() has returned, the next Read() returns that snapshot or a newer one, never an older one
+// that happened to be lying around in a buffer.
+static void TestReadsLatest()
+{
+	TripleBuffer<WideSnapshot> buffer;
+	buffer.Reset({});
+	std::atomic<long> published{ 0 };
+	const long numSnapshots = 500000;
+
+	std::thread producer([&]
+	{
+		for (long i = 1; i <= numSnapshots; i++)
+		{
+			WideSnapshot& snapshot = buffer.WriteBuffer();
+			for (long& word : snapshot.words)
+			{
+				word = i;
+			}
+			buffer.Publish();
+			published.store(i, std::memory_order_release);
+		}
+	});
+
+	long torn = 0;
+	long stale = 0;
+	long reads = 0;
+	for (long seen = 0; seen < numSnapshots; reads++)
+	{
+		seen = published.load(std::memory_order_acquire);
+		const WideSnapshot& snapshot = buffer.Read();
+		for (long word : snapshot.words)
+		{
+			torn += word != snapshot.words[0];
+		}
+		stale += snapshot.words[0] < seen;
+	}
+	producer.join();
+
+	CHECK(reads > 0);
+	CHECK_EQUAL(torn, 0);
+	CHECK_EQUAL(stale, 0);
+	CHECK_EQUAL(buffer.Read().words[63], numSnapshots);
+}
+
+int main()
+{
+	UseTestDirectory("TripleBufferTest");
+	TestSingleThread();
+	TestProducerConsumer();
+	TestReadsLatest();
+	return CheckResult();
+}
@@ -0,0 +1,75 @@
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#include "Check.h"
+#include "Varint.h"
+
+static void TestRoundTrip()
+{
+	std::mt19937_64 random(1);
+	uint8_t buffer[Varint::MaxSize];
+	for (int i = 0; i < 100000; i++)
+	{
+		uint64_t value = random() >> (random() % 64);
+		size_t size = Varint::Put(buffer, value);
+		CHECK(size >= 1 && size <= Varint::MaxSize);
+
+		size_t position = 0;
+		uint64_t decoded = 0;
+		CHECK(Varint::Get(buffer, size, &position, &decoded));
+		CHECK_EQUAL(position, size);
+		CHECK(decoded == value);
+
+		position = 0;
+		CHECK(Varint::GetUnchecked(buffer, &position) == value);
+		CHECK_EQUAL(position, size);
+	}
+}
+
+static void TestSizes()
+{
+	uint8_t buffer[Varint::MaxSize];
+	CHECK_EQUAL(Varint::Put(buffer, 0), 1u);
+	CHECK_EQUAL(Varint::Put(buffer, 127), 1u);
+	CHECK_EQUAL(Varint::Put(buffer, 128), 2u);
+	CHECK_EQUAL(Varint::Put(buffer, std::numeric_limits<uint64_t>::max()), Varint::MaxSize);
+}
+
+static void TestZigZag()
+{
+	for (int64_t value : { (int64_t)0, (int64_t)-1, (int64_t)1, (int64_t)-64, (int64_t)63, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max() })
+	{
+		CHECK(Varint::UnZigZag(Varint::ZigZag(value)) == value);
+	}
+	CHECK_EQUAL(Varint::ZigZag(-1), 1u);
+	CHECK_EQUAL(Varint::ZigZag(1), 2u);
+}
+
+// Truncated and overlong input fails and leaves the position alone.
+static void TestMalformed()
+{
+	uint8_t truncated[] = { 0x80, 0x80 };
+	size_t position = 0;
+	uint64_t value = 0;
+	CHECK(!Varint::Get(truncated, sizeof(truncated), &position, &value));
+	CHECK_EQUAL(position, 0u);
+
+	uint8_t overlong[11];
+	for (uint8_t& byte : overlong)
+	{
+		byte = 0xFF;
+	}
+	CHECK(!Varint::Get(overlong, sizeof(overlong), &position, &value));
+	CHECK_EQUAL(position, 0u);
+}
+
+int main()
+{
+	UseTestDirectory("VarintTest");
+	TestRoundTrip();
+	TestSizes();
+	TestZigZag();
+	TestMalformed();
+	return CheckResult();
+}
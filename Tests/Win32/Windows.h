@@ -0,0 +1,668 @@
+#pragma once
+
+/*
+* Just enough of the Win32 API, implemented on POSIX, to build the hook's portable cores on Linux.
+* Events, semaphores and waitable timers are real (condition variables and clock_nanosleep),
+* so waits and wakeups behave like on Windows. Window functions do nothing, directory change notifications
+* always fail (watchers fall back to polling) and VirtualQuery answers from a table the test fills in.
+*/
+
+#include <cpuid.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <map>
+#include <mutex>
+#include <vector>
+
+typedef void* HANDLE;
+typedef void* HWND;
+typedef void* HMODULE;
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned long DWORD;
+typedef long LONG;
+typedef long long LONGLONG;
+typedef unsigned int UINT;
+typedef unsigned long long DWORD_PTR;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef intptr_t LONG_PTR;
+typedef wchar_t WCHAR;
+
+union LARGE_INTEGER
+{
+	long long QuadPart;
+};
+
+#define FALSE 0
+#define TRUE 1
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define MAXIMUM_WAIT_OBJECTS 64
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define CALLBACK
+
+inline DWORD GetLastError()
+{
+	return 0;
+}
+
+inline DWORD GetCurrentThreadId()
+{
+	return (DWORD)gettid();
+}
+
+inline DWORD GetCurrentProcessId()
+{
+	return (DWORD)getpid();
+}
+
+inline void OutputDebugStringA(const char*) { }
+
+inline void fopen_s(FILE** file, const char* fileName, const char* mode)
+{
+	*file = fopen(fileName, mode);
+}
+
+// Clock
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	counter->QuadPart = time.tv_sec * 1000000000ll + time.tv_nsec;
+	return TRUE;
+}
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 1000000000ll;
+	return TRUE;
+}
+
+inline void Sleep(DWORD millis)
+{
+	usleep(millis * 1000);
+}
+
+// Threads
+
+#define THREAD_PRIORITY_BELOW_NORMAL (-1)
+#define THREAD_PRIORITY_NORMAL 0
+
+inline HANDLE GetCurrentThread()
+{
+	return (HANDLE)(intptr_t)-2;
+}
+
+inline int GetThreadPriority(HANDLE)
+{
+	return THREAD_PRIORITY_NORMAL;
+}
+
+inline BOOL SetThreadPriority(HANDLE, int)
+{
+	return TRUE;
+}
+
+inline BOOL SwitchToThread()
+{
+	return sched_yield() == 0;
+}
+
+// Takes the native handle of a std::thread, which is a pthread_t here.
+template<typename Thread>
+inline DWORD_PTR SetThreadAffinityMask(Thread thread, DWORD_PTR mask)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int i = 0; i < 64; i++)
+	{
+		if ((mask >> i) & 1)
+		{
+			CPU_SET(i, &set);
+		}
+	}
+	return pthread_setaffinity_np((pthread_t)thread, sizeof(set), &set) == 0 ? 1 : 0;
+}
+
+// Waitable objects. Each handle points to one of these, the kind says which.
+
+struct Win32Object
+{
+	enum class Kind
+	{
+		Event,
+		Semaphore,
+		Timer
+	};
+
+	Kind kind;
+	std::mutex mutex;
+	std::condition_variable signaled;
+	bool manualReset = false;
+	bool set = false; // events
+	long count = 0; // semaphores
+	timespec due = {}; // timers, CLOCK_MONOTONIC
+
+	explicit Win32Object(Kind kind) : kind(kind) { }
+};
+
+inline HANDLE CreateEventA(void*, BOOL manualReset, BOOL initialState, const char*)
+{
+	Win32Object* event = new Win32Object(Win32Object::Kind::Event);
+	event->manualReset = manualReset;
+	event->set = initialState;
+	return event;
+}
+
+inline BOOL SetEvent(HANDLE handle)
+{
+	Win32Object* event = (Win32Object*)handle;
+	{
+		std::lock_guard<std::mutex> lock(event->mutex);
+		event->set = true;
+	}
+	event->signaled.notify_all();
+	return TRUE;
+}
+
+inline BOOL ResetEvent(HANDLE handle)
+{
+	Win32Object* event = (Win32Object*)handle;
+	std::lock_guard<std::mutex> lock(event->mutex);
+	event->set = false;
+	return TRUE;
+}
+
+inline HANDLE CreateSemaphoreA(void*, long initialCount, long, const char*)
+{
+	Win32Object* semaphore = new Win32Object(Win32Object::Kind::Semaphore);
+	semaphore->count = initialCount;
+	return semaphore;
+}
+
+inline BOOL ReleaseSemaphore(HANDLE handle, long count, long*)
+{
+	Win32Object* semaphore = (Win32Object*)handle;
+	{
+		std::lock_guard<std::mutex> lock(semaphore->mutex);
+		semaphore->count += count;
+	}
+	semaphore->signaled.notify_all();
+	return TRUE;
+}
+
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 2
+#define TIMER_ALL_ACCESS 0
+
+inline HANDLE CreateWaitableTimerExW(void*, const wchar_t*, DWORD, DWORD)
+{
+	return new Win32Object(Win32Object::Kind::Timer);
+}
+
+// Only relative due times (negative, in 100 ns units) are supported.
+inline BOOL SetWaitableTimer(HANDLE handle, const LARGE_INTEGER* dueTime, long, void*, void*, BOOL)
+{
+	Win32Object* timer = (Win32Object*)handle;
+	long long nanos = -dueTime->QuadPart * 100;
+	clock_gettime(CLOCK_MONOTONIC, &timer->due);
+	timer->due.tv_sec += nanos / 1000000000;
+	timer->due.tv_nsec += nanos % 1000000000;
+	if (timer->due.tv_nsec >= 1000000000)
+	{
+		timer->due.tv_sec++;
+		timer->due.tv_nsec -= 1000000000;
+	}
+	return TRUE;
+}
+
+inline DWORD WaitForSingleObject(HANDLE handle, DWORD millis)
+{
+	Win32Object* object = (Win32Object*)handle;
+	if (object->kind == Win32Object::Kind::Timer)
+	{
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &object->due, nullptr);
+		return WAIT_OBJECT_0;
+	}
+
+	std::unique_lock<std::mutex> lock(object->mutex);
+	auto ready = [object]
+	{
+		return object->kind == Win32Object::Kind::Event ? object->set : object->count > 0;
+	};
+
+	if (millis == INFINITE)
+	{
+		object->signaled.wait(lock, ready);
+	}
+	else if (!object->signaled.wait_for(lock, std::chrono::milliseconds(millis), ready))
+	{
+		return WAIT_TIMEOUT;
+	}
+
+	if (object->kind == Win32Object::Kind::Semaphore)
+	{
+		object->count--;
+	}
+	else if (!object->manualReset)
+	{
+		object->set = false;
+	}
+	return WAIT_OBJECT_0;
+}
+
+// Waits on the first handle only, which is all the cores need when change notifications are unavailable.
+inline DWORD WaitForMultipleObjects(DWORD, const HANDLE* handles, BOOL, DWORD millis)
+{
+	return WaitForSingleObject(handles[0], millis);
+}
+
+#define QS_ALLINPUT 0x4FF
+
+inline DWORD MsgWaitForMultipleObjects(DWORD, const HANDLE* handles, BOOL, DWORD millis, DWORD)
+{
+	return WaitForSingleObject(handles[0], millis);
+}
+
+// The objects are never freed, tests create a handful.
+inline BOOL CloseHandle(HANDLE)
+{
+	return TRUE;
+}
+
+// Files
+
+#define GENERIC_READ 0x80000000
+#define FILE_SHARE_READ 1
+#define FILE_SHARE_WRITE 2
+#define FILE_SHARE_DELETE 4
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define FILE_FLAG_BACKUP_SEMANTICS 0x02000000
+#define FILE_FLAG_OVERLAPPED 0x40000000
+#define FILE_LIST_DIRECTORY 1
+#define FILE_MAP_READ 4
+#define MOVEFILE_REPLACE_EXISTING 1
+#define MOVEFILE_WRITE_THROUGH 8
+
+// File handles are descriptors offset past the small values other handles could take.
+static constexpr intptr_t FileHandleBase = 0x10000;
+
+inline HANDLE CreateFileA(const char* fileName, DWORD, DWORD, void*, DWORD, DWORD, HANDLE)
+{
+	int descriptor = open(fileName, O_RDONLY);
+	return descriptor < 0 ? INVALID_HANDLE_VALUE : (HANDLE)(descriptor + FileHandleBase);
+}
+
+inline BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size)
+{
+	struct stat status;
+	if (fstat((int)((intptr_t)file - FileHandleBase), &status) != 0)
+	{
+		return FALSE;
+	}
+	size->QuadPart = status.st_size;
+	return TRUE;
+}
+
+inline BOOL MoveFileExA(const char* from, const char* to, DWORD)
+{
+	return rename(from, to) == 0;
+}
+
+struct FILETIME
+{
+	DWORD dwLowDateTime;
+	DWORD dwHighDateTime;
+};
+
+struct WIN32_FILE_ATTRIBUTE_DATA
+{
+	DWORD dwFileAttributes;
+	FILETIME ftCreationTime;
+	FILETIME ftLastAccessTime;
+	FILETIME ftLastWriteTime;
+	DWORD nFileSizeHigh;
+	DWORD nFileSizeLow;
+};
+
+enum GET_FILEEX_INFO_LEVELS
+{
+	GetFileExInfoStandard
+};
+
+inline BOOL GetFileAttributesExA(const char* fileName, GET_FILEEX_INFO_LEVELS, void* information)
+{
+	struct stat status;
+	if (stat(fileName, &status) != 0)
+	{
+		return FALSE;
+	}
+
+	WIN32_FILE_ATTRIBUTE_DATA* data = (WIN32_FILE_ATTRIBUTE_DATA*)information;
+	uint64_t time = status.st_mtim.tv_sec * 10000000ull + status.st_mtim.tv_nsec / 100;
+	data->ftLastWriteTime.dwLowDateTime = (DWORD)time;
+	data->ftLastWriteTime.dwHighDateTime = (DWORD)(time >> 32);
+	data->nFileSizeLow = (DWORD)status.st_size;
+	data->nFileSizeHigh = (DWORD)((uint64_t)status.st_size >> 32);
+	return TRUE;
+}
+
+// A mapping handle is the file handle, the view is a private read only mmap of the whole file.
+
+inline std::map<const void*, size_t>& MappedViews()
+{
+	static std::map<const void*, size_t> views;
+	return views;
+}
+
+inline HANDLE CreateFileMappingA(HANDLE file, void*, DWORD, DWORD, DWORD, const char*)
+{
+	return file;
+}
+
+inline void* MapViewOfFile(HANDLE mapping, DWORD, DWORD, DWORD, size_t)
+{
+	int descriptor = (int)((intptr_t)mapping - FileHandleBase);
+	struct stat status;
+	if (fstat(descriptor, &status) != 0)
+	{
+		return nullptr;
+	}
+
+	void* view = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	MappedViews()[view] = status.st_size;
+	return view;
+}
+
+inline BOOL UnmapViewOfFile(const void* view)
+{
+	munmap((void*)view, MappedViews()[view]);
+	MappedViews().erase(view);
+	return TRUE;
+}
+
+// Directory change notifications
+
+#define FILE_NOTIFY_CHANGE_FILE_NAME 1
+#define FILE_NOTIFY_CHANGE_SIZE 8
+#define FILE_NOTIFY_CHANGE_LAST_WRITE 16
+
+struct OVERLAPPED
+{
+	uintptr_t Internal = 0;
+	uintptr_t InternalHigh = 0;
+	DWORD Offset = 0;
+	DWORD OffsetHigh = 0;
+	HANDLE hEvent = nullptr;
+};
+
+struct FILE_NOTIFY_INFORMATION
+{
+	DWORD NextEntryOffset;
+	DWORD Action;
+	DWORD FileNameLength;
+	WCHAR FileName[1];
+};
+
+inline BOOL ReadDirectoryChangesW(HANDLE, void*, DWORD, BOOL, DWORD, DWORD*, OVERLAPPED*, void*)
+{
+	return FALSE;
+}
+
+inline BOOL GetOverlappedResult(HANDLE, OVERLAPPED*, DWORD* bytes, BOOL)
+{
+	*bytes = 0;
+	return FALSE;
+}
+
+inline BOOL CancelIoEx(HANDLE, OVERLAPPED*)
+{
+	return TRUE;
+}
+
+// Strings
+
+#define CP_ACP 0
+#define CSTR_EQUAL 2
+
+// Test file names are ASCII.
+inline int MultiByteToWideChar(UINT, DWORD, const char* text, int length, wchar_t* wide, int wideLength)
+{
+	int i = 0;
+	for (; i < length && i < wideLength; i++)
+	{
+		wide[i] = (unsigned char)text[i];
+	}
+	return i;
+}
+
+inline int CompareStringOrdinal(const wchar_t* a, int lengthA, const wchar_t* b, int lengthB, BOOL ignoreCase)
+{
+	if (lengthA != lengthB)
+	{
+		return 1;
+	}
+	for (int i = 0; i < lengthA; i++)
+	{
+		if (ignoreCase ? towlower(a[i]) != towlower(b[i]) : a[i] != b[i])
+		{
+			return 1;
+		}
+	}
+	return CSTR_EQUAL;
+}
+
+// Memory
+
+#define MEM_COMMIT 0x1000
+#define MEM_RESERVE 0x2000
+#define PAGE_NOACCESS 0x01
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define PAGE_EXECUTE_READ 0x20
+#define PAGE_EXECUTE_READWRITE 0x40
+#define PAGE_EXECUTE_WRITECOPY 0x80
+#define PAGE_GUARD 0x100
+
+struct MEMORY_BASIC_INFORMATION
+{
+	void* BaseAddress;
+	void* AllocationBase;
+	DWORD AllocationProtect;
+	size_t RegionSize;
+	DWORD State;
+	DWORD Protect;
+	DWORD Type;
+};
+
+struct FakeRegion
+{
+	uintptr_t base;
+	size_t size;
+	DWORD state;
+	DWORD protect;
+};
+
+inline std::vector<FakeRegion>& FakeRegions()
+{
+	static std::vector<FakeRegion> regions;
+	return regions;
+}
+
+inline size_t VirtualQuery(const void* address, MEMORY_BASIC_INFORMATION* information, size_t)
+{
+	for (const FakeRegion& region : FakeRegions())
+	{
+		if ((uintptr_t)address >= region.base && (uintptr_t)address < region.base + region.size)
+		{
+			information->BaseAddress = (void*)region.base;
+			information->RegionSize = region.size;
+			information->State = region.state;
+			information->Protect = region.protect;
+			return sizeof(MEMORY_BASIC_INFORMATION);
+		}
+	}
+	return 0;
+}
+
+// PE headers, only the fields PeImage reads
+
+#define IMAGE_DOS_SIGNATURE 0x5A4D
+#define IMAGE_NT_SIGNATURE 0x00004550
+#define IMAGE_NT_OPTIONAL_HDR_MAGIC 0x20b
+#define IMAGE_SCN_CNT_CODE 0x20
+#define IMAGE_SCN_CNT_INITIALIZED_DATA 0x40
+#define IMAGE_SCN_MEM_DISCARDABLE 0x02000000
+#define IMAGE_SCN_MEM_READ 0x40000000
+
+struct IMAGE_DOS_HEADER
+{
+	WORD e_magic;
+	WORD unused[29];
+	LONG e_lfanew;
+};
+
+struct IMAGE_FILE_HEADER
+{
+	WORD Machine;
+	WORD NumberOfSections;
+	DWORD TimeDateStamp;
+	DWORD PointerToSymbolTable;
+	DWORD NumberOfSymbols;
+	WORD SizeOfOptionalHeader;
+	WORD Characteristics;
+};
+
+struct IMAGE_OPTIONAL_HEADER
+{
+	WORD Magic;
+	DWORD SizeOfImage;
+};
+
+struct IMAGE_NT_HEADERS
+{
+	DWORD Signature;
+	IMAGE_FILE_HEADER FileHeader;
+	IMAGE_OPTIONAL_HEADER OptionalHeader;
+};
+
+struct IMAGE_SECTION_HEADER
+{
+	char Name[8];
+	union
+	{
+		DWORD VirtualSize;
+	} Misc;
+	DWORD VirtualAddress;
+	DWORD SizeOfRawData;
+	DWORD Characteristics;
+};
+
+#define IMAGE_FIRST_SECTION(headers) ((const IMAGE_SECTION_HEADER*)((const char*)&(headers)->OptionalHeader + (headers)->FileHeader.SizeOfOptionalHeader))
+
+inline HMODULE GetModuleHandle(const char*)
+{
+	return nullptr;
+}
+
+// Windows and messages, there is no window
+
+#define GWLP_WNDPROC (-4)
+#define PM_REMOVE 1
+#define MAPVK_VSC_TO_VK_EX 3
+#define LOWORD(value) ((WORD)((value) & 0xFFFF))
+#define HIWORD(value) ((WORD)(((value) >> 16) & 0xFFFF))
+
+#define WM_DESTROY 0x0002
+#define WM_SETFOCUS 0x0007
+#define WM_KILLFOCUS 0x0008
+#define WM_QUIT 0x0012
+#define WM_KEYDOWN 0x0100
+#define WM_KEYUP 0x0101
+#define WM_SYSKEYDOWN 0x0104
+#define WM_SYSKEYUP 0x0105
+#define WM_MOUSEMOVE 0x0200
+#define WM_LBUTTONDOWN 0x0201
+#define WM_LBUTTONUP 0x0202
+#define WM_LBUTTONDBLCLK 0x0203
+#define WM_RBUTTONDOWN 0x0204
+#define WM_RBUTTONUP 0x0205
+#define WM_RBUTTONDBLCLK 0x0206
+#define WM_MBUTTONDOWN 0x0207
+#define WM_MBUTTONUP 0x0208
+#define WM_MBUTTONDBLCLK 0x0209
+#define WM_MOUSEWHEEL 0x020A
+
+#define VK_LBUTTON 0x01
+#define VK_RBUTTON 0x02
+#define VK_MBUTTON 0x04
+#define VK_SHIFT 0x10
+#define VK_CONTROL 0x11
+#define VK_MENU 0x12
+#define VK_LSHIFT 0xA0
+#define VK_RSHIFT 0xA1
+#define VK_LCONTROL 0xA2
+#define VK_RCONTROL 0xA3
+#define VK_LMENU 0xA4
+#define VK_RMENU 0xA5
+
+typedef LRESULT(*WNDPROC)(HWND, UINT, WPARAM, LPARAM);
+
+struct POINT
+{
+	LONG x;
+	LONG y;
+};
+
+struct MSG
+{
+	HWND hwnd;
+	UINT message;
+	WPARAM wParam;
+	LPARAM lParam;
+};
+
+inline DWORD GetWindowThreadProcessId(HWND, DWORD*) { return 0; }
+inline HWND GetForegroundWindow() { return nullptr; }
+inline BOOL IsWindowUnicode(HWND) { return TRUE; }
+inline BOOL GetCursorPos(POINT*) { return TRUE; }
+inline BOOL ScreenToClient(HWND, POINT*) { return TRUE; }
+inline LONG_PTR GetWindowLongPtrW(HWND, int) { return 0; }
+inline LONG_PTR GetWindowLongPtrA(HWND, int) { return 0; }
+inline LONG_PTR SetWindowLongPtrW(HWND, int, LONG_PTR) { return 0; }
+inline LONG_PTR SetWindowLongPtrA(HWND, int, LONG_PTR) { return 0; }
+inline LRESULT CallWindowProcW(WNDPROC, HWND, UINT, WPARAM, LPARAM) { return 0; }
+inline LRESULT CallWindowProcA(WNDPROC, HWND, UINT, WPARAM, LPARAM) { return 0; }
+inline LRESULT DefWindowProcW(HWND, UINT, WPARAM, LPARAM) { return 0; }
+inline LRESULT DefWindowProcA(HWND, UINT, WPARAM, LPARAM) { return 0; }
+inline BOOL SetPropA(HWND, const char*, HANDLE) { return TRUE; }
+inline HANDLE GetPropA(HWND, const char*) { return nullptr; }
+inline HANDLE RemovePropA(HWND, const char*) { return nullptr; }
+inline short GetAsyncKeyState(int) { return 0; }
+inline UINT MapVirtualKey(UINT, UINT) { return 0; }
+inline BOOL PeekMessage(MSG*, HWND, UINT, UINT, UINT) { return FALSE; }
+inline BOOL TranslateMessage(const MSG*) { return TRUE; }
+inline LRESULT DispatchMessage(const MSG*) { return 0; }
+inline void PostQuitMessage(int) { }
@@ -0,0 +1,5 @@
+#pragma once
+
+// Only what headers like IRenderCallback.h name, nothing is ever created.
+struct ID3D11Device;
+struct ID3D11DeviceContext;
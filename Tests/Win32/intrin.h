@@ -0,0 +1,30 @@
+#pragma once
+
+// MSVC's intrinsics on top of GCC's and Clang's.
+
+#include <cpuid.h>
+#include <x86intrin.h>
+
+#undef __cpuid
+
+inline void __cpuid(int info[4], int leaf)
+{
+	__cpuid_count(leaf, 0, info[0], info[1], info[2], info[3]);
+}
+
+#if !defined(__clang__) && (__GNUC__ < 11)
+inline void __cpuidex(int info[4], int leaf, int subleaf)
+{
+	__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+}
+#endif
+
+inline unsigned char _BitScanForward(unsigned long* index, unsigned int mask)
+{
+	if (mask == 0)
+	{
+		return 0;
+	}
+	*index = (unsigned long)__builtin_ctz(mask);
+	return 1;
+}
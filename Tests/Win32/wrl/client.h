@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Microsoft::WRL
+{
+	// Holds a pointer without reference counting, the tests never create COM objects.
+	template<typename T>
+	class ComPtr
+	{
+	public:
+		ComPtr() { }
+		ComPtr(std::nullptr_t) { }
+		ComPtr(T* pointer) : m_pointer(pointer) { }
+
+		T* Get() const { return m_pointer; }
+		T* operator->() const { return m_pointer; }
+		explicit operator bool() const { return m_pointer != nullptr; }
+
+	private:
+		T* m_pointer = nullptr;
+	};
+}